@@ -61,8 +61,26 @@ typedef enum struct_type {
 	ST_JMPCSKL,
 	ST_MYSKL,
 	ST_REDBLACK,
+	ST_SLHPP,
+	ST_STLSET,
 } struct_type_t;
 
+#ifdef SLHPP
+/*
+ * These are in drv_hpp.cc.
+ */
+extern void *slhpp_create(int);
+extern void slhpp_add(void *, uint64_t);
+extern int slhpp_find(void *, uint64_t);
+extern uint64_t slhpp_foldr(void *);
+extern uint64_t slhpp_foldl(void *);
+extern void *stlset_create(void);
+extern void stlset_add(void *, uint64_t);
+extern int stlset_find(void *, uint64_t);
+extern uint64_t stlset_foldr(void *);
+extern uint64_t stlset_foldl(void *);
+#endif
+
 static unsigned int state0[32];
 static unsigned int state1[32] = {
     3,
@@ -53,6 +53,8 @@ typedef union container {
 #ifdef MYSKL
 	MySKL_t		*myskl;
 #endif
+	void		*slhpp;
+	void		*stlset;
 } container_t;
 
 void
@@ -86,6 +88,7 @@ gnu_cmpfun(const void *z1, const void *z2, void *private)
  */
 int do_subseq_sl;
 int do_subseq_arr;
+int sl_kv;	/* set by the `kv` keyword */
 slablist_elem_t subseq[100];
 int seq_cap;
 
@@ -118,6 +121,48 @@ sl_cmpfun(slablist_elem_t v1, slablist_elem_t v2)
 	return (0);
 }
 
+/*
+ * Appends the elements in `e` to the array that `z` points into.
+ */
+selem_t
+naive_copy(selem_t z, selem_t *e, uint64_t sz)
+{
+	slablist_elem_t *arr = z.sle_p;
+	bcopy(e, arr, sz * sizeof (slablist_elem_t));
+	z.sle_p = arr + sz;
+	return (z);
+}
+
+/*
+ * The obvious search, that slablist_subseq() is benchmarked against: copy the
+ * list out, try every starting position, and compare the pattern from there
+ * until the first mismatch.
+ */
+int
+naive_subseq(slablist_t *sl, slablist_elem_t *pat, uint64_t len)
+{
+	uint64_t elems = slablist_get_elems(sl);
+	uint64_t i;
+	uint64_t k;
+	int r = 0;
+	if (len > elems) {
+		return (0);
+	}
+	slablist_elem_t *arr = malloc(elems * sizeof (slablist_elem_t));
+	selem_t z;
+	z.sle_p = arr;
+	(void) slablist_foldr(sl, naive_copy, z);
+	for (i = 0; i <= elems - len && !r; i++) {
+		k = 0;
+		while (k < len && sl_cmpfun(arr[i + k], pat[k]) == 0) {
+			k++;
+		}
+		r = (k == len);
+	}
+	free(arr);
+	return (r);
+}
+
 int
 bndfun(slablist_elem_t e, slablist_elem_t min, slablist_elem_t max)
 {
@@ -131,6 +176,15 @@ bndfun(slablist_elem_t e, slablist_elem_t min, slablist_elem_t max)
         return (0);
 }
 
+/*
+ * Integers are their own prefixes.
+ */
+uint64_t
+pfxfun(slablist_elem_t e)
+{
+	return (e.sle_u);
+}
+
 #ifdef UUTIL
 int
 cmpfun(const void *z1, const void *z2, void *private)
@@ -350,6 +404,10 @@ gnuprb_op(container_t *c, slablist_elem_t elem)
 void
 sl_op(container_t *c, slablist_elem_t elem)
 {
+	if (sl_kv) {
+		slablist_put(c->sl, elem, elem, 0);
+		return;
+	}
 	slablist_add(c->sl, elem, 0);
 }
 
@@ -671,16 +729,82 @@ redblack_op(container_t *c, slablist_elem_t elem)
 }
 #endif
 
+#ifdef SLHPP
+/*
+ * The C++ slab_list and std::set, from drv_hpp.cc. Comparing these against
+ * `sl` shows what the C interface's indirect comparisons cost.
+ */
+void
+slhpp_op(container_t *c, slablist_elem_t elem)
+{
+	slhpp_add(c->slhpp, elem.sle_u);
+}
+
+int
+slhpp_fnd(container_t *c, slablist_elem_t elem)
+{
+	return (slhpp_find(c->slhpp, elem.sle_u));
+}
+
+void
+slhpp_fdr(container_t *c)
+{
+	uint64_t sum = slhpp_foldr(c->slhpp);
+}
+
+void
+slhpp_fdl(container_t *c)
+{
+	uint64_t sum = slhpp_foldl(c->slhpp);
+}
+
+void
+stlset_op(container_t *c, slablist_elem_t elem)
+{
+	stlset_add(c->stlset, elem.sle_u);
+}
+
+int
+stlset_fnd(container_t *c, slablist_elem_t elem)
+{
+	return (stlset_find(c->stlset, elem.sle_u));
+}
+
+void
+stlset_fdr(container_t *c)
+{
+	uint64_t sum = stlset_foldr(c->stlset);
+}
+
+void
+stlset_fdl(container_t *c)
+{
+	uint64_t sum = stlset_foldl(c->stlset);
+}
+#endif
+
+int
+sl_fnd(container_t *c, slablist_elem_t elem)
+{
+	slablist_elem_t found;
+	if (sl_kv) {
+		return (slablist_get_value(c->sl, elem, &found) == SL_SUCCESS);
+	}
+	return (slablist_find(c->sl, elem, &found) == SL_SUCCESS);
+}
+
 typedef void (*struct_subr_t)(container_t *, slablist_elem_t);
 typedef void (*struct_subr_fold_t)(container_t *c);
 typedef int (*struct_subr_rem_t)(container_t *, slablist_elem_t, uint64_t,
     slablist_rem_cb_t *);
+typedef int (*struct_subr_find_t)(container_t *, slablist_elem_t);
 
 
-struct_subr_t sadd_f[12];
-struct_subr_rem_t srem_f[12];
-struct_subr_fold_t sfdl_f[12];
-struct_subr_fold_t sfdr_f[12];
+struct_subr_t sadd_f[14];
+struct_subr_rem_t srem_f[14];
+struct_subr_fold_t sfdl_f[14];
+struct_subr_fold_t sfdr_f[14];
+struct_subr_find_t sfnd_f[14];
 
 void
 set_add_callbacks(void)
@@ -707,6 +831,13 @@ set_add_callbacks(void)
 #else
 	sadd_f[ST_REDBLACK] = NULL;
 #endif
+#ifdef SLHPP
+	sadd_f[ST_SLHPP] = &slhpp_op;
+	sadd_f[ST_STLSET] = &stlset_op;
+#else
+	sadd_f[ST_SLHPP] = NULL;
+	sadd_f[ST_STLSET] = NULL;
+#endif
 
 }
 
@@ -765,6 +896,13 @@ set_foldr_callbacks(void)
 #else
 	sfdr_f[ST_REDBLACK] = NULL;
 #endif
+#ifdef SLHPP
+	sfdr_f[ST_SLHPP] = slhpp_fdr;
+	sfdr_f[ST_STLSET] = stlset_fdr;
+#else
+	sfdr_f[ST_SLHPP] = NULL;
+	sfdr_f[ST_STLSET] = NULL;
+#endif
 
 }
 
@@ -796,6 +934,27 @@ set_foldl_callbacks(void)
 #else
 	sfdl_f[ST_REDBLACK] = NULL;
 #endif
+#ifdef SLHPP
+	sfdl_f[ST_SLHPP] = slhpp_fdl;
+	sfdl_f[ST_STLSET] = stlset_fdl;
+#else
+	sfdl_f[ST_SLHPP] = NULL;
+	sfdl_f[ST_STLSET] = NULL;
+#endif
+}
+
+/*
+ * Only the slab lists and the structures we compare them with directly have
+ * a find callback.
+ */
+void
+set_find_callbacks(void)
+{
+	sfnd_f[ST_SL] = &sl_fnd;
+#ifdef SLHPP
+	sfnd_f[ST_SLHPP] = &slhpp_fnd;
+	sfnd_f[ST_STLSET] = &stlset_fnd;
+#endif
 }
 
 void
@@ -815,6 +974,7 @@ do_ops(container_t *ls, struct_type_t t, uint64_t maxops, int str, int ord,
 	set_rem_callbacks();
 	set_foldr_callbacks();
 	set_foldl_callbacks();
+	set_find_callbacks();
 	uint64_t ops = 1;
 	slablist_elem_t elem;
 	while (ops <= maxops) {
@@ -868,21 +1028,39 @@ do_ops(container_t *ls, struct_type_t t, uint64_t maxops, int str, int ord,
 				l++;
 			}
 			/* this should evaluate to true for ordered slablists */
+			STRUC_SUBSEQ_BEGIN(0);
 			has_subseq = slablist_subseq(ls->sl, sl_ss, NULL, 0);
+			STRUC_SUBSEQ_END(has_subseq);
 			slablist_reverse(sl_ss);
 			/* this is _likely_ to evaluate to false */
+			STRUC_SUBSEQ_BEGIN(0);
 			has_subseq = slablist_subseq(ls->sl, sl_ss, NULL, 0);
+			STRUC_SUBSEQ_END(has_subseq);
+			slablist_destroy(sl_ss, NULL);
 		}
-		/* Same as the previous but for subseq arrays */
+		/*
+		 * Same as the previous but for subseq arrays. We also run the
+		 * naive search on the same patterns, so that the two can be
+		 * compared with drv/subseq.d.
+		 */
 		if (do_subseq_arr && seq_cap == 100) {
 			/* this should evaluate to true for ordered slablists */
+			STRUC_SUBSEQ_BEGIN(0);
 			has_subseq = slablist_subseq(ls->sl, NULL, subseq,
 			    100);
+			STRUC_SUBSEQ_END(has_subseq);
+			STRUC_SUBSEQ_BEGIN(1);
+			has_subseq = naive_subseq(ls->sl, subseq, 100);
+			STRUC_SUBSEQ_END(has_subseq);
 			subseq_reverse(subseq);
 			/* this is _likely_ to evaluate to false */
+			STRUC_SUBSEQ_BEGIN(0);
 			has_subseq = slablist_subseq(ls->sl, NULL, subseq,
 			    100);
-			
+			STRUC_SUBSEQ_END(has_subseq);
+			STRUC_SUBSEQ_BEGIN(1);
+			has_subseq = naive_subseq(ls->sl, subseq, 100);
+			STRUC_SUBSEQ_END(has_subseq);
 		}
 		if (seq_cap == 100) {
 			seq_cap = 0;
@@ -942,6 +1120,37 @@ do_foldls(container_t *ls, struct_type_t t, int str)
 	STRUC_FOLDL_END();
 }
 
+/*
+ * Looks up every element that do_ops() added, in the order in which it added
+ * them. As in do_free_remaining(), a random input pattern is replayed by
+ * resetting the random number generator.
+ */
+void
+do_finds(container_t *ls, struct_type_t t, uint64_t maxops)
+{
+	if (sfnd_f[t] == NULL) {
+		return;
+	}
+	if (is_rand) {
+		init_rand();
+	}
+	uint64_t ops = 1;
+	slablist_elem_t elem;
+	while (ops <= maxops) {
+		/* as with adds, we use get_data to induce overhead */
+		elem.sle_u = get_data(fd);
+		if (is_seq_inc) {
+			elem.sle_u = ops + 1;
+		} else if (is_seq_dec) {
+			elem.sle_u = (maxops + 1) - ops;
+		}
+		STRUC_FIND_BEGIN();
+		int found = sfnd_f[t](ls, elem);
+		STRUC_FIND_END(found);
+		ops++;
+	}
+}
+
 void
 rm_cb_str(slablist_elem_t e)
 {
@@ -1025,6 +1234,12 @@ main(int ac, char *av[])
 	int do_foldr = 0;
 	int do_foldl = 0;
 	int do_dups = 0;
+	int do_compress = 0;
+	int do_find = 0;
+	int sl_size = SL_SLAB_1K;
+	int sl_width = 0;
+	uint16_t sl_fanout = 0;
+	int sl_prefix = 0;
 	is_rand = 0;
 	is_seq_inc = 0;
 	is_seq_dec = 0;
@@ -1076,6 +1291,20 @@ main(int ac, char *av[])
 		printf("%s is not supported on this particular version.\n",
 			av[1]);
 		exit(0);
+#endif
+	} else if (strcmp("slhpp", av[1]) == 0) {
+		struct_type = ST_SLHPP;
+#ifndef SLHPP
+		printf("%s is not supported on this particular version.\n",
+			av[1]);
+		exit(0);
+#endif
+	} else if (strcmp("stlset", av[1]) == 0) {
+		struct_type = ST_STLSET;
+#ifndef SLHPP
+		printf("%s is not supported on this particular version.\n",
+			av[1]);
+		exit(0);
 #endif
 	}
 	while (aci < ac) {
@@ -1125,6 +1354,36 @@ main(int ac, char *av[])
 		if (strcmp("dup", av[aci]) == 0) {
 			do_dups++;
 		}
+		if (strcmp("compress", av[aci]) == 0) {
+			do_compress++;
+		}
+		if (strcmp("find", av[aci]) == 0) {
+			do_find++;
+		}
+		if (strcmp("slab1k", av[aci]) == 0) {
+			sl_size = SL_SLAB_1K;
+		}
+		if (strcmp("slab512", av[aci]) == 0) {
+			sl_size = SL_SLAB_512;
+		}
+		if (strcmp("slab4k", av[aci]) == 0) {
+			sl_size = SL_SLAB_4K;
+		}
+		if (strcmp("slab16k", av[aci]) == 0) {
+			sl_size = SL_SLAB_16K;
+		}
+		if (strcmp("elem32", av[aci]) == 0) {
+			sl_width = SL_ELEM_32;
+		}
+		if (strcmp("kv", av[aci]) == 0) {
+			sl_kv = SL_KV;
+		}
+		if (strcmp("prefix", av[aci]) == 0) {
+			sl_prefix++;
+		}
+		if (strncmp("fanout=", av[aci], 7) == 0) {
+			sl_fanout = (uint16_t)atoi(av[aci] + 7);
+		}
 		aci++;
 	}
 
@@ -1140,6 +1399,18 @@ main(int ac, char *av[])
 		printf("ERROR: Can't do duplicates and subsequences at the same time");
 		exit(0);
 	}
+	if (sl_width && (strsrt || strord)) {
+		printf("ERROR: Only integers can be stored in elem32 lists");
+		exit(0);
+	}
+	if (sl_kv && !intsrt) {
+		printf("ERROR: Only sorted integers can be stored in kv lists");
+		exit(0);
+	}
+	if (sl_prefix && !intsrt) {
+		printf("ERROR: Only sorted integer lists can have prefixes");
+		exit(0);
+	}
 	int sl_flag = 0;
 	if (intsrt || strsrt) {
 		sl_flag = SL_SORTED;
@@ -1147,6 +1418,7 @@ main(int ac, char *av[])
 	if (intord || strord) {
 		sl_flag = SL_ORDERED;
 	}
+	sl_flag |= sl_size | sl_width | sl_kv;
 #ifdef UUTIL
 	uuavl_umem_init();
 #endif
@@ -1179,6 +1451,12 @@ main(int ac, char *av[])
 
 	case ST_SL:
 		cis.sl = slablist_create("intlistsrt", sl_cmpfun, bndfun, sl_flag);
+		if (sl_fanout) {
+			slablist_set_subslab_fanout(cis.sl, sl_fanout);
+		}
+		if (sl_prefix) {
+			slablist_set_prefix(cis.sl, pfxfun);
+		}
 		break;
 	case ST_UUAVL:
 #ifdef UUTIL
@@ -1230,6 +1508,16 @@ main(int ac, char *av[])
 	case ST_REDBLACK:
 #ifdef LIBREDBLACK
 		cis.redblack = rbinit(bt_cmpfun, NULL);
+#endif
+		break;
+	case ST_SLHPP:
+#ifdef SLHPP
+		cis.slhpp = slhpp_create(sl_size);
+#endif
+		break;
+	case ST_STLSET:
+#ifdef SLHPP
+		cis.stlset = stlset_create();
 #endif
 		break;
 	}
@@ -1244,6 +1532,17 @@ main(int ac, char *av[])
 	}
 	if (intsrt) {
 		do_ops(&cis, struct_type, maxops, INT, SRT, do_dups);
+		if (struct_type == ST_SL && do_compress) {
+			/*
+			 * The first pass only clears the hot-marks left by
+			 * do_ops(), the second one actually compresses.
+			 */
+			(void) slablist_compress(cis.sl);
+			(void) slablist_compress(cis.sl);
+		}
+		if (do_find) {
+			do_finds(&cis, struct_type, maxops);
+		}
 		if (do_rem) {
 			do_free_remaining(&cis, struct_type, INT, SRT, maxops);
 		}
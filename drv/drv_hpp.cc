@@ -0,0 +1,105 @@
+/*
+ * These wrap slab_list<uint64_t> (from slablist.hpp) and std::set<uint64_t>
+ * behind C functions, so that drv_gen can drive them like any of the other
+ * structures. Both only hold sorted integers.
+ */
+#include <stdint.h>
+#include <set>
+#include <slablist.hpp>
+
+typedef libslablist::slab_list<uint64_t> slhpp_t;
+typedef std::set<uint64_t> stlset_t;
+
+extern "C" {
+
+void *
+slhpp_create(int sz)
+{
+	return (new slhpp_t("slhpp", (uint8_t)sz));
+}
+
+void
+slhpp_add(void *c, uint64_t e)
+{
+	(void) ((slhpp_t *)c)->insert(e);
+}
+
+int
+slhpp_find(void *c, uint64_t e)
+{
+	slhpp_t *l = (slhpp_t *)c;
+	return (l->find(e) != l->end());
+}
+
+uint64_t
+slhpp_foldr(void *c)
+{
+	slhpp_t *l = (slhpp_t *)c;
+	uint64_t sum = 0;
+	slhpp_t::iterator i = l->begin();
+	while (i != l->end()) {
+		sum += *i;
+		++i;
+	}
+	return (sum);
+}
+
+uint64_t
+slhpp_foldl(void *c)
+{
+	slhpp_t *l = (slhpp_t *)c;
+	uint64_t sum = 0;
+	slhpp_t::iterator i = l->end();
+	while (i != l->begin()) {
+		--i;
+		sum += *i;
+	}
+	return (sum);
+}
+
+void *
+stlset_create(void)
+{
+	return (new stlset_t());
+}
+
+void
+stlset_add(void *c, uint64_t e)
+{
+	(void) ((stlset_t *)c)->insert(e);
+}
+
+int
+stlset_find(void *c, uint64_t e)
+{
+	stlset_t *s = (stlset_t *)c;
+	return (s->find(e) != s->end());
+}
+
+uint64_t
+stlset_foldr(void *c)
+{
+	stlset_t *s = (stlset_t *)c;
+	uint64_t sum = 0;
+	stlset_t::iterator i = s->begin();
+	while (i != s->end()) {
+		sum += *i;
+		++i;
+	}
+	return (sum);
+}
+
+uint64_t
+stlset_foldl(void *c)
+{
+	stlset_t *s = (stlset_t *)c;
+	uint64_t sum = 0;
+	stlset_t::reverse_iterator i = s->rbegin();
+	while (i != s->rend()) {
+		sum += *i;
+		++i;
+	}
+	return (sum);
+}
+
+}
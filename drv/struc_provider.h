@@ -31,6 +31,24 @@ extern "C" {
 #define	STRUC_ADD_END_ENABLED() \
 	__dtraceenabled_struc___add_end(0)
 #endif
+#define	STRUC_FIND_BEGIN() \
+	__dtrace_struc___find_begin()
+#ifndef	__sparc
+#define	STRUC_FIND_BEGIN_ENABLED() \
+	__dtraceenabled_struc___find_begin()
+#else
+#define	STRUC_FIND_BEGIN_ENABLED() \
+	__dtraceenabled_struc___find_begin(0)
+#endif
+#define	STRUC_FIND_END(arg0) \
+	__dtrace_struc___find_end(arg0)
+#ifndef	__sparc
+#define	STRUC_FIND_END_ENABLED() \
+	__dtraceenabled_struc___find_end()
+#else
+#define	STRUC_FIND_END_ENABLED() \
+	__dtraceenabled_struc___find_end(0)
+#endif
 #define	STRUC_FOLDL_BEGIN() \
 	__dtrace_struc___foldl_begin()
 #ifndef	__sparc
@@ -85,6 +103,24 @@ extern "C" {
 #define	STRUC_REM_END_ENABLED() \
 	__dtraceenabled_struc___rem_end(0)
 #endif
+#define	STRUC_SUBSEQ_BEGIN(arg0) \
+	__dtrace_struc___subseq_begin(arg0)
+#ifndef	__sparc
+#define	STRUC_SUBSEQ_BEGIN_ENABLED() \
+	__dtraceenabled_struc___subseq_begin()
+#else
+#define	STRUC_SUBSEQ_BEGIN_ENABLED() \
+	__dtraceenabled_struc___subseq_begin(0)
+#endif
+#define	STRUC_SUBSEQ_END(arg0) \
+	__dtrace_struc___subseq_end(arg0)
+#ifndef	__sparc
+#define	STRUC_SUBSEQ_END_ENABLED() \
+	__dtraceenabled_struc___subseq_end()
+#else
+#define	STRUC_SUBSEQ_END_ENABLED() \
+	__dtraceenabled_struc___subseq_end(0)
+#endif
 
 
 extern void __dtrace_struc___add_begin(void *, uint64_t, uint64_t);
@@ -99,6 +135,18 @@ extern int __dtraceenabled_struc___add_end(void);
 #else
 extern int __dtraceenabled_struc___add_end(long);
 #endif
+extern void __dtrace_struc___find_begin();
+#ifndef	__sparc
+extern int __dtraceenabled_struc___find_begin(void);
+#else
+extern int __dtraceenabled_struc___find_begin(long);
+#endif
+extern void __dtrace_struc___find_end(int);
+#ifndef	__sparc
+extern int __dtraceenabled_struc___find_end(void);
+#else
+extern int __dtraceenabled_struc___find_end(long);
+#endif
 extern void __dtrace_struc___foldl_begin(void);
 #ifndef	__sparc
 extern int __dtraceenabled_struc___foldl_begin(void);
@@ -135,6 +183,18 @@ extern int __dtraceenabled_struc___rem_end(void);
 #else
 extern int __dtraceenabled_struc___rem_end(long);
 #endif
+extern void __dtrace_struc___subseq_begin(int);
+#ifndef	__sparc
+extern int __dtraceenabled_struc___subseq_begin(void);
+#else
+extern int __dtraceenabled_struc___subseq_begin(long);
+#endif
+extern void __dtrace_struc___subseq_end(int);
+#ifndef	__sparc
+extern int __dtraceenabled_struc___subseq_end(void);
+#else
+extern int __dtraceenabled_struc___subseq_end(long);
+#endif
 
 #else
 
@@ -142,6 +202,10 @@ extern int __dtraceenabled_struc___rem_end(long);
 #define	STRUC_ADD_BEGIN_ENABLED() (0)
 #define	STRUC_ADD_END(arg0)
 #define	STRUC_ADD_END_ENABLED() (0)
+#define	STRUC_FIND_BEGIN()
+#define	STRUC_FIND_BEGIN_ENABLED() (0)
+#define	STRUC_FIND_END(arg0)
+#define	STRUC_FIND_END_ENABLED() (0)
 #define	STRUC_FOLDL_BEGIN()
 #define	STRUC_FOLDL_BEGIN_ENABLED() (0)
 #define	STRUC_FOLDL_END()
@@ -154,6 +218,10 @@ extern int __dtraceenabled_struc___rem_end(long);
 #define	STRUC_REM_BEGIN_ENABLED() (0)
 #define	STRUC_REM_END(arg0)
 #define	STRUC_REM_END_ENABLED() (0)
+#define	STRUC_SUBSEQ_BEGIN(arg0)
+#define	STRUC_SUBSEQ_BEGIN_ENABLED() (0)
+#define	STRUC_SUBSEQ_END(arg0)
+#define	STRUC_SUBSEQ_END_ENABLED() (0)
 
 #endif
 
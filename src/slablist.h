@@ -28,6 +28,28 @@
 #define	SL_SORTED 0x80
 #define	SL_ORDERED 0x00
 #define	SL_CIRCULAR 0x10
+/*
+ * The size of the slabs is chosen at creation time, with one of these flags.
+ * The default is 1K.
+ */
+#define	SL_SLAB_1K 0x00
+#define	SL_SLAB_512 0x20
+#define	SL_SLAB_4K 0x40
+#define	SL_SLAB_16K 0x60
+/*
+ * The elements of a list created with SL_ELEM_32 are unsigned 32-bit integers
+ * (in sle_u), and its slabs hold twice as many of them. Only the low 32 bits
+ * of an added element are kept.
+ */
+#define	SL_ELEM_32 0x08
+/*
+ * A list created with SL_KV is a sorted map: every element (key) has a value
+ * stored next to it, which is set with slablist_put(). Keys can be 64 or
+ * 32 bits wide (see SL_ELEM_32), values are always 64 bits wide. Everything
+ * other than slablist_get_value() only sees the keys. Key-value lists can't
+ * be compressed, saved or logged (those return SL_EKV).
+ */
+#define	SL_KV 0x04
 
 #define	SL_SUCCESS	0
 #define	SL_ENFOUND	-1
@@ -38,10 +60,21 @@
 #define	SL_ENCIRC	-6
 #define	SL_EDUP		-7
 #define	SL_ESML		-8
+#define	SL_EIO		-9
+#define	SL_ERDONLY	-10
+#define	SL_ENOSPC	-11
+#define	SL_EKV		-12
+#define	SL_ENEMPTY	-13
+
+/* sync policies of write-ahead logs */
+#define	SL_SYNC_NONE	0
+#define	SL_SYNC_BATCH	1
+#define	SL_SYNC_EACH	2
 
 
 
 typedef struct slablist_bm slablist_bm_t;
+typedef struct slablist_span slablist_span_t;
 
 typedef union slablist_elem {
 	uint64_t	sle_u;
@@ -59,10 +92,51 @@ typedef struct mt_slablist mt_slablist_t;
 typedef int slablist_cmp_t(slablist_elem_t, slablist_elem_t);
 typedef int slablist_bnd_t(slablist_elem_t, slablist_elem_t, slablist_elem_t);
 typedef slablist_elem_t slablist_fold_t(slablist_elem_t, slablist_elem_t *, uint64_t);
+/*
+ * Like slablist_fold_t, but the function can set its last argument to non-zero
+ * to stop the fold, once the accumulator holds the answer.
+ */
+typedef slablist_elem_t slablist_fold_until_t(slablist_elem_t,
+    slablist_elem_t *, uint64_t, int *);
 typedef void slablist_map_t(slablist_elem_t *, uint64_t);
 
 typedef void slablist_rem_cb_t(slablist_elem_t);
 
+/*
+ * Used to save and load lists of pointers. The serialize callback writes its
+ * element into the buffer (if the buffer is big enough) and returns the number
+ * of bytes it needs. The deserialize callback turns those bytes back into an
+ * element.
+ */
+typedef uint64_t slablist_ser_t(slablist_elem_t, void *, uint64_t);
+typedef slablist_elem_t slablist_deser_t(void *, uint64_t);
+
+/*
+ * Used to filter lookups. Elements that compare as equal must hash to the
+ * same value.
+ */
+typedef uint64_t slablist_hash_t(slablist_elem_t);
+
+/*
+ * Used to index lists. Maps elements to numbers in the same order, so that
+ * lookups can interpolate between them.
+ */
+typedef double slablist_key_t(slablist_elem_t);
+
+/*
+ * Used to speed up comparisons in sorted lists of pointers. Maps elements to
+ * prefixes that never disagree with the comparison function: if one element is
+ * smaller than another, its prefix is no larger than the other's. The first 8
+ * bytes of a string, read as a big-endian number, make such a prefix.
+ */
+typedef uint64_t slablist_pfx_t(slablist_elem_t);
+
+/*
+ * Used to aggregate ranges of sorted lists. Combines the aggregates of two
+ * adjacent runs of elements (in order) into the aggregate of both.
+ */
+typedef slablist_elem_t slablist_comb_t(slablist_elem_t, slablist_elem_t);
+
 
 extern void slablist_map(slablist_t *, slablist_map_t);
 extern void slablist_map_range(slablist_t *sl, slablist_map_t f, slablist_elem_t min,
@@ -80,6 +154,21 @@ extern int slablist_range_min(slablist_t *, slablist_bm_t *,
 extern int slablist_range_max(slablist_t *, slablist_bm_t *,
     slablist_elem_t min, slablist_elem_t max, slablist_elem_t *);
 
+extern int slablist_lower_bound(slablist_t *, slablist_bm_t *, slablist_elem_t,
+    slablist_elem_t *);
+extern int slablist_upper_bound(slablist_t *, slablist_bm_t *, slablist_elem_t,
+    slablist_elem_t *);
+extern int slablist_floor(slablist_t *, slablist_bm_t *, slablist_elem_t,
+    slablist_elem_t *);
+extern int slablist_ceil(slablist_t *, slablist_bm_t *, slablist_elem_t,
+    slablist_elem_t *);
+
+extern int slablist_span_begin(slablist_t *, slablist_elem_t, slablist_elem_t,
+    slablist_span_t **);
+extern int slablist_span_next(slablist_span_t *, slablist_elem_t **,
+    uint64_t *);
+extern void slablist_span_end(slablist_span_t *);
+
 extern slablist_elem_t slablist_foldl(slablist_t *, slablist_fold_t,
 slablist_elem_t zero);
 extern slablist_elem_t slablist_foldr(slablist_t *, slablist_fold_t,
@@ -90,6 +179,25 @@ slablist_elem_t, slablist_elem_t, slablist_elem_t zero);
 extern slablist_elem_t slablist_foldr_range(slablist_t *, slablist_fold_t,
 slablist_elem_t, slablist_elem_t, slablist_elem_t zero);
 
+extern slablist_elem_t slablist_foldl_until(slablist_t *,
+    slablist_fold_until_t, slablist_elem_t zero);
+extern slablist_elem_t slablist_foldr_until(slablist_t *,
+    slablist_fold_until_t, slablist_elem_t zero);
+extern slablist_elem_t slablist_foldl_range_until(slablist_t *,
+    slablist_fold_until_t, slablist_elem_t, slablist_elem_t,
+    slablist_elem_t zero);
+extern slablist_elem_t slablist_foldr_range_until(slablist_t *,
+    slablist_fold_until_t, slablist_elem_t, slablist_elem_t,
+    slablist_elem_t zero);
+
+extern int slablist_set_aggregate(slablist_t *, slablist_fold_t,
+    slablist_comb_t, slablist_elem_t zero);
+extern int slablist_aggregate_range(slablist_t *, slablist_elem_t,
+    slablist_elem_t, slablist_elem_t *);
+extern uint64_t slablist_rank(slablist_t *, slablist_elem_t);
+extern uint64_t slablist_count_range(slablist_t *, slablist_elem_t,
+    slablist_elem_t);
+
 /*
  * TODO implement the mt functions.
  */
@@ -100,12 +208,29 @@ slablist_t *slablist_create(char *, slablist_cmp_t, slablist_bnd_t, uint8_t);
 extern void slablist_destroy(slablist_t *, slablist_rem_cb_t);
 //extern void slablist_mt_destroy(mt_slablist_t *);
 
+extern slablist_t *slablist_clone(slablist_t *);
+extern int slablist_mvcc_enable(slablist_t *);
+extern slablist_t *slablist_pin(slablist_t *);
+extern void slablist_unpin(slablist_t *, slablist_t *);
+extern void slablist_mvcc_lock(slablist_t *);
+extern void slablist_mvcc_unlock(slablist_t *);
+
 extern void slablist_set_reap_pslabs(slablist_t *, uint8_t);
 //extern void slablist_mt_set_reap_pslabs(mt_slablist_t *, uint8_t);
 
 extern void slablist_set_reap_slabs(slablist_t *, uint64_t);
 //extern void slablist_mt_set_reap_slabs(mt_slablist_t *, uint64_t);
 
+extern void slablist_set_spare_max(slablist_t *, uint8_t);
+
+extern uint8_t slablist_get_spare_max(slablist_t *);
+
+extern void slablist_set_subslab_fanout(slablist_t *, uint16_t);
+
+extern uint16_t slablist_get_subslab_fanout(slablist_t *);
+
+extern uint16_t slablist_get_slab_elems(slablist_t *);
+
 extern void slablist_set_attach_req(slablist_t *, uint64_t);
 //extern void slablist_mt_set_attach_req(slablist_t *, uint64_t);
 
@@ -128,6 +253,10 @@ extern char *slablist_get_name(slablist_t *);
 //extern char *slablist_mt_get_name(mt_slablist_t *);
 
 extern int slablist_add(slablist_t *, slablist_elem_t, int);
+extern int slablist_put(slablist_t *, slablist_elem_t, slablist_elem_t, int);
+extern int slablist_get_value(slablist_t *, slablist_elem_t, slablist_elem_t *);
+extern int slablist_update_value(slablist_t *, slablist_elem_t,
+    slablist_elem_t);
 //extern int slablist_mt_add(mt_slablist_t *, slablist_elem_t, int);
 
 extern int slablist_sort(slablist_t *, slablist_cmp_t, slablist_bnd_t);
@@ -142,6 +271,35 @@ extern int slablist_rem_range(slablist_t *, slablist_elem_t, slablist_elem_t, sl
 extern void slablist_reap(slablist_t *);
 //extern void slablist_mt_reap(mt_slablist_t *);
 
+extern uint64_t slablist_compress(slablist_t *);
+
+extern uint64_t slablist_get_cold_slabs(slablist_t *);
+extern uint64_t slablist_get_last_hits(slablist_t *);
+extern uint64_t slablist_get_last_misses(slablist_t *);
+
+extern int slablist_save(slablist_t *, int);
+extern int slablist_save_ser(slablist_t *, int, slablist_ser_t);
+extern slablist_t *slablist_load(int, slablist_cmp_t, slablist_bnd_t);
+extern slablist_t *slablist_load_deser(int, slablist_cmp_t, slablist_bnd_t,
+    slablist_deser_t);
+extern int slablist_save_mapped(slablist_t *, int);
+extern slablist_t *slablist_open_mapped(int, slablist_cmp_t, slablist_bnd_t);
+extern int slablist_log_attach(slablist_t *, int, uint8_t, uint32_t);
+extern int slablist_log_flush(slablist_t *);
+extern int slablist_log_detach(slablist_t *);
+extern int slablist_checkpoint(slablist_t *, int);
+extern int slablist_checkpoint_incremental(slablist_t *, int);
+extern slablist_t *slablist_restore(int, int *, int, slablist_cmp_t,
+    slablist_bnd_t);
+extern uint64_t slablist_get_lsn(slablist_t *);
+extern slablist_t *slablist_shm_create(char *, size_t, char *, slablist_cmp_t,
+    slablist_bnd_t, uint8_t);
+extern slablist_t *slablist_shm_attach(char *, slablist_cmp_t, slablist_bnd_t);
+extern void slablist_shm_detach(slablist_t *);
+extern void slablist_shm_rdlock(slablist_t *);
+extern void slablist_shm_wrlock(slablist_t *);
+extern void slablist_shm_unlock(slablist_t *);
+
 extern slablist_elem_t slablist_get(slablist_t *, uint64_t);
 //extern slablist_elem_t slablist_mt_get(mt_slablist_t *, uint64_t);
 
@@ -149,6 +307,11 @@ extern slablist_elem_t slablist_get(slablist_t *, uint64_t);
 extern slablist_elem_t slablist_head(slablist_t *);
 extern slablist_elem_t slablist_end(slablist_t *);
 extern int slablist_find(slablist_t *, slablist_elem_t, slablist_elem_t *);
+extern int slablist_find_many(slablist_t *, slablist_elem_t *, uint64_t,
+    slablist_elem_t *, int *);
+extern int slablist_set_hash(slablist_t *, slablist_hash_t);
+extern int slablist_set_key(slablist_t *, slablist_key_t);
+extern int slablist_set_prefix(slablist_t *, slablist_pfx_t);
 //extern int slablist_mt_find(mt_slablist_t *, slablist_elem_t, slablist_elem_t *);
 
 extern int slablist_subseq(slablist_t *, slablist_t *, slablist_elem_t *, uint64_t);
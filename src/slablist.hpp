@@ -0,0 +1,745 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/LIBSLABLIST.LICENSE
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/LIBSLABLIST.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright 2012 Nicholas Zivkovic. All rights reserved.
+ * Use is subject to license terms.
+ */
+
+/*
+ * This is a C++ interface to sorted slab lists. slab_list<T, Compare> holds
+ * `T`s in the order given by `Compare`, and can stand in for a std::set<T,
+ * Compare>: it has bidirectional iterators, find(), lower_bound(),
+ * upper_bound(), equal_range(), and an insert() that refuses duplicates.
+ *
+ * Going through the C interface costs us an indirect call to the comparison
+ * or bounds function for every element that a search looks at, and a trip
+ * through a slablist_elem_t for every element we get back. So the searches
+ * are instantiated here, with `Compare` inlined. A lookup descends the layers
+ * the way find_bubble_up() does (or scans the slabs, like find_linear_scan()
+ * does, if there are no sublayers), and finishes with a binary search of the
+ * slab, like slab_bin_srch(). An insert into a slab that has room for it
+ * shifts the slab in place, like add_elem() does. An insert into a full slab
+ * hands the slab that we found to slablist_add_found(), which spills or
+ * splits it without searching for it again; the element then ends up in that
+ * slab or next to it, so that's where we look for it. Inserts into small lists
+ * and removals go through slablist_add() and slablist_rem(), which call back
+ * into `Compare` through a function pointer. So do inserts into lists that
+ * have a log, a Bloom filter, clones, or MVCC readers (set up through
+ * handle()), since those have to know about every insert.
+ *
+ * `T` has to be a trivial type that fits in a slablist_elem_t. A `T` that
+ * fits in 32 bits gets a narrow list (see SL_ELEM_32), whose slabs hold twice
+ * as many elements. `Compare` has to be a stateless strict weak ordering,
+ * since the C code constructs its own instances of it.
+ *
+ * Unlike those of a std::set, iterators are bookmarks into the slabs, and any
+ * insert or erase invalidates all of them. An iterator holds a copy of the
+ * element it is on, so the reference it hands out is only good for as long as
+ * the iterator stays where it is.
+ *
+ * The searches read the private structures of the list, so this header
+ * includes slablist_impl.h (and with it slablist.h, which shouldn't also be
+ * included). It has to be compiled with the same SL_COMPACT_LAYOUT setting as
+ * the library.
+ */
+
+#ifndef	_SLABLIST_HPP
+#define	_SLABLIST_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "slablist_impl.h"
+#include "slablist_cons.h"
+extern void ripple_update_extrema(subslab_t *);
+extern int slablist_add_found(slab_t *, slablist_elem_t);
+}
+
+namespace libslablist {
+
+template <typename T, typename Compare = std::less<T> >
+class slab_list {
+	static_assert(std::is_trivial<T>::value,
+	    "slab_list elements have to be trivial types");
+	static_assert(sizeof (T) <= sizeof (slablist_elem_t),
+	    "slab_list elements have to fit in a slablist_elem_t");
+
+public:
+	typedef T key_type;
+	typedef T value_type;
+	typedef Compare key_compare;
+	typedef Compare value_compare;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	class iterator {
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T *pointer;
+		typedef const T &reference;
+
+		iterator() : it_val()
+		{
+			it_bm.sb_list = NULL;
+			it_bm.sb_node = NULL;
+			it_bm.sb_index = 0;
+		}
+
+		const T &
+		operator*() const
+		{
+			return (it_val);
+		}
+
+		const T *
+		operator->() const
+		{
+			return (&it_val);
+		}
+
+		/*
+		 * Like slablist_next(), stepping off the last element
+		 * leaves the bookmark unpositioned, which is end().
+		 */
+		iterator &
+		operator++()
+		{
+			slablist_t *sl = it_bm.sb_list;
+			cow_scope cs(sl);
+			if (IS_SMALL_LIST(sl)) {
+				small_list_t *sml = (small_list_t *)
+				    it_bm.sb_node;
+				sml = LNK(sml->sml_next);
+				it_bm.sb_node = sml;
+				if (sml != NULL) {
+					it_val = unpack(sml->sml_data);
+				}
+				return (*this);
+			}
+			slab_t *s = (slab_t *)it_bm.sb_node;
+			it_bm.sb_index++;
+			if (it_bm.sb_index == s->s_elems) {
+				s = LNK(s->s_next);
+				it_bm.sb_node = s;
+				it_bm.sb_index = 0;
+				if (s == NULL) {
+					return (*this);
+				}
+			}
+			it_val = elem(s, it_bm.sb_index);
+			return (*this);
+		}
+
+		/*
+		 * Like slablist_prev(), stepping back from end() gets us to
+		 * the last element.
+		 */
+		iterator &
+		operator--()
+		{
+			slablist_t *sl = it_bm.sb_list;
+			cow_scope cs(sl);
+			if (IS_SMALL_LIST(sl)) {
+				slablist_elem_t e;
+				(void) slablist_prev(sl, &it_bm, &e);
+				it_val = unpack(e);
+				return (*this);
+			}
+			slab_t *s = (slab_t *)it_bm.sb_node;
+			if (s == NULL) {
+				s = (slab_t *)LNK(sl->sl_end);
+				it_bm.sb_index = s->s_elems;
+			}
+			it_bm.sb_index--;
+			if (it_bm.sb_index < 0) {
+				s = LNK(s->s_prev);
+				it_bm.sb_index = s->s_elems - 1;
+			}
+			it_bm.sb_node = s;
+			it_val = elem(s, it_bm.sb_index);
+			return (*this);
+		}
+
+		iterator
+		operator++(int)
+		{
+			iterator old = *this;
+			++*this;
+			return (old);
+		}
+
+		iterator
+		operator--(int)
+		{
+			iterator old = *this;
+			--*this;
+			return (old);
+		}
+
+		bool
+		operator==(const iterator &o) const
+		{
+			return (it_bm.sb_node == o.it_bm.sb_node &&
+			    it_bm.sb_index == o.it_bm.sb_index);
+		}
+
+		bool
+		operator!=(const iterator &o) const
+		{
+			return (!(*this == o));
+		}
+
+		/*
+		 * The bookmark, for use with slablist_next() and friends.
+		 */
+		const slablist_bm_t *
+		bookmark() const
+		{
+			return (&it_bm);
+		}
+
+	private:
+		friend class slab_list;
+
+		iterator(slablist_t *sl, void *node, int16_t index)
+		    : it_val()
+		{
+			it_bm.sb_list = sl;
+			it_bm.sb_node = node;
+			it_bm.sb_index = index;
+			if (node == NULL) {
+				return;
+			}
+			if (IS_SMALL_LIST(sl)) {
+				small_list_t *sml = (small_list_t *)node;
+				it_val = unpack(sml->sml_data);
+			} else {
+				it_val = elem((slab_t *)node, index);
+			}
+		}
+
+		slablist_bm_t	it_bm;
+		T		it_val;
+	};
+
+	typedef iterator const_iterator;
+
+	explicit
+	slab_list(const char *name = "slab_list", uint8_t size = SL_SLAB_1K)
+	    : l_name(name), l_size(size)
+	{
+		l_list = slablist_create(const_cast<char *>(name), cmp_elem,
+		    bnd_elem, flags(size));
+	}
+
+	slab_list(slab_list &&o)
+	    : l_list(o.l_list), l_name(o.l_name), l_size(o.l_size)
+	{
+		o.l_list = NULL;
+	}
+
+	slab_list &
+	operator=(slab_list &&o)
+	{
+		std::swap(l_list, o.l_list);
+		std::swap(l_name, o.l_name);
+		std::swap(l_size, o.l_size);
+		return (*this);
+	}
+
+	slab_list(const slab_list &) = delete;
+	slab_list &operator=(const slab_list &) = delete;
+
+	~slab_list()
+	{
+		if (l_list != NULL) {
+			slablist_destroy(l_list, NULL);
+		}
+	}
+
+	/*
+	 * The underlying list, for everything that only the C interface
+	 * offers (folds, compression, checkpoints, and so on).
+	 */
+	slablist_t *
+	handle() const
+	{
+		return (l_list);
+	}
+
+	bool
+	empty() const
+	{
+		return (l_list->sl_elems == 0);
+	}
+
+	size_type
+	size() const
+	{
+		return (l_list->sl_elems);
+	}
+
+	iterator
+	begin() const
+	{
+		if (l_list->sl_elems == 0) {
+			return (end());
+		}
+		cow_scope cs(l_list);
+		return (iterator(l_list, LNK(l_list->sl_head), 0));
+	}
+
+	iterator
+	end() const
+	{
+		return (iterator(l_list, NULL, 0));
+	}
+
+	iterator
+	lower_bound(const T &key) const
+	{
+		return (bound(key, 0));
+	}
+
+	iterator
+	upper_bound(const T &key) const
+	{
+		return (bound(key, 1));
+	}
+
+	std::pair<iterator, iterator>
+	equal_range(const T &key) const
+	{
+		iterator lo = bound(key, 0);
+		iterator hi = lo;
+		if (lo != end() && !Compare()(key, *lo)) {
+			++hi;
+		}
+		return (std::make_pair(lo, hi));
+	}
+
+	iterator
+	find(const T &key) const
+	{
+		iterator it = bound(key, 0);
+		if (it != end() && Compare()(key, *it)) {
+			return (end());
+		}
+		return (it);
+	}
+
+	size_type
+	count(const T &key) const
+	{
+		return (find(key) != end());
+	}
+
+	/*
+	 * Adds `v`, unless there already is an element equivalent to it. The
+	 * iterator is on `v`, or on the element that kept it out.
+	 */
+	std::pair<iterator, bool>
+	insert(const T &v)
+	{
+		slablist_t *sl = l_list;
+		if (IS_SMALL_LIST(sl) || sl->sl_log != NULL ||
+		    sl->sl_cow != NULL || sl->sl_mvcc != NULL ||
+		    sl->sl_shm != NULL || sl->sl_bloom != NULL) {
+			return (insert_slow(v));
+		}
+		slab_t *s = find_slab(v, 0);
+		int i = slab_srch(s, v, 0);
+		if (i < s->s_elems && !Compare()(v, elem(s, i))) {
+			return (std::make_pair(iterator(sl, s, i), false));
+		}
+		if (SLAB_IS_COLD(s) || s->s_elems == SLAB_ELEM_MAX(s)) {
+			return (insert_found(s, v));
+		}
+		add_elem(s, pack(v), i);
+		sl->sl_elems++;
+		return (std::make_pair(iterator(sl, s, i), true));
+	}
+
+	size_type
+	erase(const T &key)
+	{
+		return (slablist_rem(l_list, pack(key), 0, NULL) == SL_SUCCESS);
+	}
+
+	iterator
+	erase(iterator pos)
+	{
+		T v = *pos;
+		(void) erase(v);
+		return (bound(v, 1));
+	}
+
+	void
+	clear()
+	{
+		slablist_destroy(l_list, NULL);
+		l_list = slablist_create(const_cast<char *>(l_name), cmp_elem,
+		    bnd_elem, flags(l_size));
+	}
+
+private:
+	static const bool narrow = sizeof (T) <= sizeof (uint32_t);
+	static const std::size_t esz =
+	    narrow ? sizeof (uint32_t) : sizeof (slablist_elem_t);
+
+	static uint8_t
+	flags(uint8_t size)
+	{
+		return (SL_SORTED | size | (narrow ? SL_ELEM_32 : 0));
+	}
+
+	/*
+	 * In a narrow list, `T` goes in the low 32 bits of sle_u, which is
+	 * all that the slabs keep.
+	 */
+	static slablist_elem_t
+	pack(const T &v)
+	{
+		slablist_elem_t e;
+		e.sle_u = 0;
+		if (narrow) {
+			uint32_t u = 0;
+			std::memcpy(&u, &v, sizeof (T));
+			e.sle_u = u;
+		} else {
+			std::memcpy(&e, &v, sizeof (T));
+		}
+		return (e);
+	}
+
+	static T
+	unpack32(uint32_t u)
+	{
+		T v;
+		std::memcpy(&v, &u, sizeof (T));
+		return (v);
+	}
+
+	static T
+	unpack(slablist_elem_t e)
+	{
+		if (narrow) {
+			return (unpack32((uint32_t)e.sle_u));
+		}
+		T v;
+		std::memcpy(&v, &e, sizeof (T));
+		return (v);
+	}
+
+	/*
+	 * Reads the i'th element of the slab `s`, which is hot, straight out
+	 * of the array.
+	 */
+	static T
+	hot_elem(slab_t *s, int i)
+	{
+		if (narrow) {
+			return (unpack32(SLAB_NARROW_ARR(s)[i]));
+		}
+		return (unpack(s->s_arr[i]));
+	}
+
+	static T
+	elem(slab_t *s, int i)
+	{
+		if (SLAB_IS_COLD(s)) {
+			return (unpack(cold_slab_elem(s, i)));
+		}
+		return (hot_elem(s, i));
+	}
+
+	/*
+	 * These are what the C code calls back into.
+	 */
+	static int
+	cmp_elem(slablist_elem_t a, slablist_elem_t b)
+	{
+		T x = unpack(a);
+		T y = unpack(b);
+		if (Compare()(x, y)) {
+			return (-1);
+		}
+		if (Compare()(y, x)) {
+			return (1);
+		}
+		return (0);
+	}
+
+	static int
+	bnd_elem(slablist_elem_t e, slablist_elem_t min, slablist_elem_t max)
+	{
+		T x = unpack(e);
+		if (Compare()(x, unpack(min))) {
+			return (-1);
+		}
+		if (Compare()(unpack(max), x)) {
+			return (1);
+		}
+		return (0);
+	}
+
+	/*
+	 * True if `e` comes before the first element that we are looking for,
+	 * which is the first element that is not less than `key`, or, if
+	 * `incl` is set, the first element that is greater than it.
+	 */
+	static bool
+	before(const T &e, const T &key, int incl)
+	{
+		if (incl) {
+			return (!Compare()(key, e));
+		}
+		return (Compare()(e, key));
+	}
+
+	/*
+	 * Finds the first element that isn't before `key` in slab `s`, or
+	 * returns s->s_elems if there isn't one.
+	 */
+	static int
+	slab_srch(slab_t *s, const T &key, int incl)
+	{
+		int min = 0;
+		int max = s->s_elems;
+		if (SLAB_IS_COLD(s)) {
+			while (min < max) {
+				int mid = (min + max) >> 1;
+				if (before(elem(s, mid), key, incl)) {
+					min = mid + 1;
+				} else {
+					max = mid;
+				}
+			}
+			return (min);
+		}
+		while (min < max) {
+			int mid = (min + max) >> 1;
+			if (before(hot_elem(s, mid), key, incl)) {
+				min = mid + 1;
+			} else {
+				max = mid;
+			}
+		}
+		return (min);
+	}
+
+	/*
+	 * Finds the first child of subslab `ss` whose maximum isn't before
+	 * `key`, or the last child if there isn't one. `top` says whether the
+	 * children are slabs. Since the children's ranges don't overlap, a
+	 * child whose range takes in `key` is the one, and we can stop there,
+	 * like subslab_bin_srch() does.
+	 */
+	static int
+	subslab_srch(subslab_t *ss, const T &key, int incl, int top)
+	{
+		int min = 0;
+		int max = ss->ss_elems - 1;
+		while (min < max) {
+			int mid = (min + max) >> 1;
+			void *c = GET_SUBSLAB_ELEM(ss, mid);
+			slablist_elem_t cmin = top ? ((slab_t *)c)->s_min :
+			    ((subslab_t *)c)->ss_min;
+			slablist_elem_t cmax = top ? ((slab_t *)c)->s_max :
+			    ((subslab_t *)c)->ss_max;
+			if (before(unpack(cmax), key, incl)) {
+				min = mid + 1;
+			} else if (!Compare()(key, unpack(cmin))) {
+				return (mid);
+			} else {
+				max = mid;
+			}
+		}
+		return (min);
+	}
+
+	/*
+	 * Links are read through the forwarding map of the clone that we're
+	 * reading (see cow_enter()) for as long as one of these is around.
+	 */
+	struct cow_scope {
+		slablist_t	*cs_held;
+
+		cow_scope(slablist_t *sl) : cs_held(cow_enter(sl))
+		{
+		}
+
+		~cow_scope()
+		{
+			cow_exit(cs_held);
+		}
+	};
+
+	/*
+	 * Finds the slab that holds the first element that isn't before
+	 * `key`. If there is no such element, that is the last slab.
+	 */
+	slab_t *
+	find_slab(const T &key, int incl) const
+	{
+		slablist_t *sl = l_list;
+		if (sl->sl_sublayers == 0) {
+			slab_t *s = (slab_t *)LNK(sl->sl_head);
+			while (LNK(s->s_next) != NULL &&
+			    before(unpack(s->s_max), key, incl)) {
+				s = LNK(s->s_next);
+			}
+			return (s);
+		}
+		slablist_t *bl = LNK(sl->sl_baselayer);
+		subslab_t *ss = (subslab_t *)LNK(bl->sl_head);
+		while (LNK(ss->ss_next) != NULL &&
+		    before(unpack(ss->ss_max), key, incl)) {
+			ss = LNK(ss->ss_next);
+		}
+		int layer = 1;
+		while (layer < sl->sl_sublayers) {
+			ss = (subslab_t *)GET_SUBSLAB_ELEM(ss,
+			    subslab_srch(ss, key, incl, 0));
+			layer++;
+		}
+		return ((slab_t *)GET_SUBSLAB_ELEM(ss,
+		    subslab_srch(ss, key, incl, 1)));
+	}
+
+	iterator
+	bound(const T &key, int incl) const
+	{
+		slablist_t *sl = l_list;
+		if (sl->sl_elems == 0) {
+			return (end());
+		}
+		cow_scope cs(sl);
+		if (IS_SMALL_LIST(sl)) {
+			small_list_t *sml = (small_list_t *)LNK(sl->sl_head);
+			while (sml != NULL &&
+			    before(unpack(sml->sml_data), key, incl)) {
+				sml = LNK(sml->sml_next);
+			}
+			return (iterator(sl, sml, 0));
+		}
+		slab_t *s = find_slab(key, incl);
+		int i = slab_srch(s, key, incl);
+		if (i == s->s_elems) {
+			s = LNK(s->s_next);
+			i = 0;
+		}
+		return (iterator(sl, s, i));
+	}
+
+	/*
+	 * Inserts `e` at index `i` of slab `s`, which has room for it, and
+	 * updates the subslabs below the slab, like add_elem() and
+	 * ripple_ai() do.
+	 */
+	static void
+	add_elem(slab_t *s, slablist_elem_t e, int i)
+	{
+		char *a = (char *)s->s_arr;
+		std::memmove(a + (i + 1) * esz, a + i * esz,
+		    (s->s_elems - i) * esz);
+		if (narrow) {
+			SLAB_NARROW_ARR(s)[i] = (uint32_t)e.sle_u;
+		} else {
+			s->s_arr[i] = e;
+		}
+		int edge = 0;
+		if (i == 0) {
+			s->s_min = e;
+			edge = 1;
+		}
+		if (i == s->s_elems) {
+			s->s_max = e;
+			edge = 1;
+		}
+		s->s_elems++;
+		s->s_hot = 1;
+		SLAB_SET_DIRTY(s);
+		if (LNK(s->s_below) == NULL) {
+			return;
+		}
+		if (edge) {
+			ripple_update_extrema(LNK(s->s_below));
+		}
+		subslab_t *q = LNK(s->s_below);
+		while (q != NULL) {
+			q->ss_usr_elems++;
+			q->ss_agg_ok = 0;
+			q = LNK(q->ss_below);
+		}
+	}
+
+	std::pair<iterator, bool>
+	insert_slow(const T &v)
+	{
+		int r = slablist_add(l_list, pack(v), 0);
+		return (std::make_pair(bound(v, 0), r == SL_SUCCESS));
+	}
+
+	/*
+	 * Hands `v`, which is not in the list yet, to slablist_add_found(),
+	 * along with the slab `s` that we found for it. That spills or splits
+	 * `s` if it is full, and `v` ends up in `s` or in one of its
+	 * neighbours, so we look there instead of searching the whole list
+	 * again. A cold slab gets thawed into new memory, so in that case we
+	 * do search from the top.
+	 */
+	std::pair<iterator, bool>
+	insert_found(slab_t *s, const T &v)
+	{
+		slablist_t *sl = l_list;
+		if (SLAB_IS_COLD(s)) {
+			(void) slablist_add_found(s, pack(v));
+			return (std::make_pair(bound(v, 0), true));
+		}
+		(void) slablist_add_found(s, pack(v));
+		slab_t *p = (LNK(s->s_prev) != NULL) ? LNK(s->s_prev) : s;
+		int k = 0;
+		while (p != NULL && k < 4 && !SLAB_IS_COLD(p)) {
+			if (!before(unpack(p->s_max), v, 0)) {
+				iterator it(sl, p, slab_srch(p, v, 0));
+				return (std::make_pair(it, true));
+			}
+			p = LNK(p->s_next);
+			k++;
+		}
+		return (std::make_pair(bound(v, 0), true));
+	}
+
+	slablist_t	*l_list;
+	const char	*l_name;
+	uint8_t		l_size;
+};
+
+}
+
+#endif	/* _SLABLIST_HPP */
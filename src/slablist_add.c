@@ -62,12 +62,12 @@ small_list_add(slablist_t *sl, slablist_elem_t elem, int rep,
 	 * If the ptr to the head of this slablist is null, we have to create
 	 * the head node, store `elem` into it, update metadata, and return.
 	 */
-	if (sl->sl_head == NULL) {
-		sl->sl_head = mk_sml_node();
+	if (LNK(sl->sl_head) == NULL) {
+		sl->sl_head = MKLNK(mk_sml_node());
 		SLABLIST_SET_HEAD(sl, elem);
-		sl->sl_end = sl->sl_head;
+		sl->sl_end = MKLNK(LNK(sl->sl_head));
 		SLABLIST_SET_END(sl, elem);
-		((small_list_t *)sl->sl_head)->sml_data = elem;
+		((small_list_t *)LNK(sl->sl_head))->sml_data = elem;
 		sl->sl_elems++;
 		SLABLIST_SL_INC_ELEMS(sl);
 		ret = SL_SUCCESS;
@@ -82,7 +82,7 @@ small_list_add(slablist_t *sl, slablist_elem_t elem, int rep,
 	 * element after it.
 	 */
 	if (SLIST_SORTED(sl->sl_flags)) {
-		sml = sl->sl_head;
+		sml = LNK(sl->sl_head);
 		small_list_t *prev = NULL;
 		uint64_t i = 0;
 		while (i < sl->sl_elems) {
@@ -90,7 +90,7 @@ small_list_add(slablist_t *sl, slablist_elem_t elem, int rep,
 			 * If `elem` is less than the data in the current
 			 * sml_node, we add `elem` before it.
 			 */
-			if (sl->sl_cmp_elem(elem, sml->sml_data) < 0) {
+			if (SL_CMPF(sl)(elem, sml->sml_data) < 0) {
 				nsml = mk_sml_node();
 				nsml->sml_data = elem;
 				link_sml_node(sl, prev, nsml);
@@ -102,7 +102,7 @@ small_list_add(slablist_t *sl, slablist_elem_t elem, int rep,
 			 * either replace its data with `elem` or, we error out
 			 * depending on the user's preference.
 			 */
-			if (sl->sl_cmp_elem(elem, sml->sml_data) == 0) {
+			if (SL_CMPF(sl)(elem, sml->sml_data) == 0) {
 				if (rep) {
 					if (repd_elem != NULL) {
 						*repd_elem = sml->sml_data;
@@ -120,7 +120,7 @@ small_list_add(slablist_t *sl, slablist_elem_t elem, int rep,
 			 * until we reach the end.
 			 */
 			prev = sml;
-			sml = sml->sml_next;
+			sml = LNK(sml->sml_next);
 			i++;
 		}
 
@@ -130,7 +130,7 @@ small_list_add(slablist_t *sl, slablist_elem_t elem, int rep,
 		 */
 		if (sml == NULL) {
 			nsml = mk_sml_node();
-			sl->sl_end = nsml;
+			sl->sl_end = MKLNK(nsml);
 			SLABLIST_SET_END(sl, elem);
 			nsml->sml_data = elem;
 			link_sml_node(sl, prev, nsml);
@@ -144,12 +144,12 @@ small_list_add(slablist_t *sl, slablist_elem_t elem, int rep,
 	/*
 	 * We place the element at the end of the list.
 	 */
-	sml = sl->sl_head;
-	small_list_t *end_node = sl->sl_end;
+	sml = LNK(sl->sl_head);
+	small_list_t *end_node = LNK(sl->sl_end);
 	nsml = mk_sml_node();
 	nsml->sml_data = elem;
 	link_sml_node(sl, end_node, nsml);
-	sl->sl_end = nsml;
+	sl->sl_end = MKLNK(nsml);
 	SLABLIST_SET_END(sl, elem);
 
 end:;
@@ -175,10 +175,11 @@ end:;
 }
 
 /*
- * Inserts an `elem` to add into slab `s` at index `i`.
+ * Inserts an `elem` to add into slab `s` at index `i`, with the value `val`
+ * if `s` is in a key-value list.
  */
 static void
-add_elem(slab_t *s, slablist_elem_t elem, int i)
+add_elem(slab_t *s, slablist_elem_t elem, slablist_elem_t val, int i)
 {
 	/*
 	 * Test the consistency of the slab before addition.
@@ -192,13 +193,16 @@ add_elem(slab_t *s, slablist_elem_t elem, int i)
 
 	ip = i;
 
-	size_t shiftsz = (s->s_elems - (size_t)i) << 3;
-	if (shiftsz > 0) {
-		SLABLIST_FWDSHIFT_BEGIN(s->s_list, s, i);
-		bcopy(&(s->s_arr[i]), &(s->s_arr[(i+1)]), shiftsz);
+	uint64_t shift = s->s_elems - i;
+	if (shift > 0) {
+		SLABLIST_FWDSHIFT_BEGIN(LNK(s->s_list), s, i);
+		slab_move(s, i, s, i + 1, shift);
 		SLABLIST_FWDSHIFT_END();
 	}
-	s->s_arr[i] = elem;
+	SLAB_SET(s, i, elem);
+	SLAB_SET_VAL(s, i, val);
+	SLAB_SET_PFX(s, i, elem);
+	SLAB_SET_DIRTY(s);
 
 	/*
 	 * If we added at the beginning of the slab, we have to change the
@@ -206,7 +210,7 @@ add_elem(slab_t *s, slablist_elem_t elem, int i)
 	 * maximum.
 	 */
 	if (ip == 0) {
-		s->s_min = s->s_arr[0];
+		s->s_min = SLAB_GET(s, 0);
 		SLABLIST_SLAB_SET_MIN(s);
 	}
 
@@ -216,7 +220,7 @@ add_elem(slab_t *s, slablist_elem_t elem, int i)
 	 * into an empty slab, we have to change _both_ of the extrema.
 	 */
 	if (ip == (s->s_elems)) {
-		s->s_max = s->s_arr[(s->s_elems)];
+		s->s_max = SLAB_GET(s, s->s_elems);
 		SLABLIST_SLAB_SET_MAX(s);
 	}
 
@@ -228,12 +232,12 @@ add_elem(slab_t *s, slablist_elem_t elem, int i)
 	 * slab (i.e. the next time we call this function). But we do want to
 	 * update the max value.
 	 */
-	if (s->s_elems < SELEM_MAX) {
+	if (s->s_elems < SLAB_ELEM_MAX(s)) {
 		s->s_elems++;
 		SLABLIST_SLAB_INC_ELEMS(s);
 	} else {
-		s->s_min = s->s_arr[0];
-		s->s_max = s->s_arr[(SELEM_MAX - 1)];
+		s->s_min = SLAB_GET(s, 0);
+		s->s_max = SLAB_GET(s, (SLAB_ELEM_MAX(s) - 1));
 		SLABLIST_SLAB_SET_MIN(s);
 		SLABLIST_SLAB_SET_MAX(s);
 	}
@@ -254,7 +258,7 @@ add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 {
 
 	slablist_t *sl;
-	sl = s->ss_list;
+	sl = LNK(s->ss_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 
 	/*
@@ -316,7 +320,7 @@ add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 			max_cmp = ssi->ss_max;
 		}
 
-#define	EQ(x, y) (sl->sl_cmp_elem(x, y) == 0)
+#define	EQ(x, y) (SL_CMPF(sl)(x, y) == 0)
 
 		int eq_max_ck_min_ck = EQ(max_ck, min_ck);
 		int eq_min_ck_max_cmp = EQ(min_ck, max_cmp);
@@ -328,7 +332,7 @@ add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 		    (eq_min_ck_max_cmp && eq_max_cmp_min_cmp) ||
 		    (eq_min_ck_max_cmp && eq_max_cmp_min_cmp) ||
 		    (eq_min_ck_max_cmp) ||
-		    (sl->sl_bnd_elem(max_ck, min_cmp, max_cmp) > 0)) {
+		    (SL_BNDF(sl)(max_ck, min_cmp, max_cmp) > 0)) {
 			i++;
 		}
 
@@ -352,11 +356,11 @@ add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 	ip = i;
 
 
-	SLABLIST_SUBFWDSHIFT_BEGIN(s->ss_list, s, i);
+	SLABLIST_SUBFWDSHIFT_BEGIN(LNK(s->ss_list), s, i);
 	size_t shiftsz = (s->ss_elems - i) << 3;
 	int ixi = i + 1;
 	if (shiftsz > 0) {
-		bcopy(&(GET_SUBSLAB_ELEM(s, i)), &(GET_SUBSLAB_ELEM(s, ixi)),
+		bcopy(&SUBSLAB_ELEMS(s)[i], &SUBSLAB_ELEMS(s)[ixi],
 		    shiftsz);
 	}
 
@@ -364,13 +368,13 @@ add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 	slablist_elem_t min;
 
 	if (s1 != NULL) {
-		s1->s_below = s;
+		s1->s_below = MKLNK(s);
 		SLABLIST_SLAB_SET_BELOW(s1);
 		SET_SUBSLAB_ELEM(s, s1, i);
 		max = s1->s_max;
 		min = s1->s_min;
 	} else {
-		s2->ss_below = s;
+		s2->ss_below = MKLNK(s);
 		SLABLIST_SUBSLAB_SET_BELOW(s2);
 		SET_SUBSLAB_ELEM(s, s2, i);
 		max = s2->ss_max;
@@ -402,17 +406,17 @@ add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 	/*
 	 * Same deal as the slab_t equivalent of this function. [add_elem()]
 	 */
-	if (s->ss_elems < SUBELEM_MAX) {
+	if (s->ss_elems < SUBSLAB_ELEM_MAX(s)) {
 		s->ss_elems++;
 		SLABLIST_SUBSLAB_INC_ELEMS(s);
 	} else {
 		if (s1 != NULL) {
 			stmp_lst = (slab_t *)GET_SUBSLAB_ELEM(s,
-			    SUBELEM_MAX - 1);
+			    SUBSLAB_ELEM_MAX(s) - 1);
 			s->ss_max = stmp_lst->s_max;
 		} else {
 			sstmp_lst = (subslab_t *)GET_SUBSLAB_ELEM(s,
-			    SUBELEM_MAX - 1);
+			    SUBSLAB_ELEM_MAX(s) - 1);
 			s->ss_max = sstmp_lst->ss_max;
 		}
 		SLABLIST_SUBSLAB_SET_MAX(s);
@@ -431,12 +435,14 @@ add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
  * into the slab next to `s`.
  */
 static void
-addsn(slab_t *s, slablist_elem_t elem, int q)
+addsn(slab_t *s, slablist_elem_t elem, slablist_elem_t val, int q)
 {
-	slablist_elem_t lst_elem = s->s_arr[(s->s_elems - 1)];
-	slablist_elem_t b4_lst_elem = s->s_arr[(s->s_elems - 2)];
-	slab_t *snx = s->s_next;
+	slablist_elem_t lst_elem = SLAB_GET(s, (s->s_elems - 1));
+	slablist_elem_t lst_val = slab_val(s, (s->s_elems - 1));
+	slablist_elem_t b4_lst_elem = SLAB_GET(s, (s->s_elems - 2));
+	slab_t *snx = LNK(s->s_next);
 	s->s_elems--;
+	SLAB_SET_DIRTY(s);
 	SLABLIST_SLAB_DEC_ELEMS(s);
 
 	s->s_max = b4_lst_elem;
@@ -449,8 +455,8 @@ addsn(slab_t *s, slablist_elem_t elem, int q)
 	if (q > s->s_elems) {
 		q--;
 	}
-	add_elem(snx, lst_elem, 0);
-	add_elem(s, elem, q);
+	add_elem(snx, lst_elem, lst_val, 0);
+	add_elem(s, elem, val, q);
 }
 
 /*
@@ -463,12 +469,36 @@ ripple_inc_usr_elems(subslab_t *found)
 	subslab_t *q = found;
 	while (q != NULL) {
 		q->ss_usr_elems++;
+		q->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(q);
-		q = q->ss_below;
+		q = LNK(q->ss_below);
 	}
 }
 
 
+/*
+ * Moves the user-element count of slab `s1` or subslab `s2` from `from` and
+ * the subslabs below it to `to` and the subslabs below it, stopping at the
+ * subslab that the two have in common (which is returned).
+ */
+static subslab_t *
+move_usr_elems(subslab_t *from, subslab_t *to, slab_t *s1, subslab_t *s2)
+{
+	uint64_t diff = (s1 != NULL) ? s1->s_elems : s2->ss_usr_elems;
+	while (from != to) {
+		from->ss_usr_elems -= diff;
+		from->ss_agg_ok = 0;
+		SLABLIST_SET_USR_ELEMS(from);
+		to->ss_usr_elems += diff;
+		to->ss_agg_ok = 0;
+		SLABLIST_SET_USR_ELEMS(to);
+		from = LNK(from->ss_below);
+		to = LNK(to->ss_below);
+	}
+	agg_dirty(from);
+	return (from);
+}
+
 /*
  * Inserts slab `s1` or subslab `s2` into `s`, which is a full subslab, but
  * moves the maximum element into the subslab next to `s`.
@@ -477,11 +507,42 @@ static subslab_t *
 sub_addsn(subslab_t *s, slab_t *s1, subslab_t *s2, int mk)
 {
 	(void) mk; /* we will use this in the future */
+	subslab_t *snx = LNK(s->ss_next);
+	slab_t *lst_slab = NULL;
+	subslab_t *lst_subslab = NULL;
+	/*
+	 * If the new element sorts after every element in `s`, moving the
+	 * maximum into `snx` and then appending the new element to `s` would
+	 * invert their order. We just put the new element at the front of
+	 * `snx` instead, and move its user-element count along with it (the
+	 * count was split off of something that lives under `s`).
+	 */
+	int k = 0;
+	if (s1 != NULL) {
+		k = subslab_bin_srch_top(s1->s_max, s);
+	} else {
+		k = subslab_bin_srch(s2->ss_max, s);
+	}
+	if (k >= s->ss_elems) {
+		/*
+		 * The new element was split off of the last element of `s`,
+		 * so the maximum of `s` is stale.
+		 */
+		if (s1 != NULL) {
+			lst_slab = GET_SUBSLAB_ELEM(s, s->ss_elems - 1);
+			s->ss_max = lst_slab->s_max;
+		} else {
+			lst_subslab = GET_SUBSLAB_ELEM(s, s->ss_elems - 1);
+			s->ss_max = lst_subslab->ss_max;
+		}
+		SLABLIST_SUBSLAB_SET_MAX(s);
+		add_slab(snx, s1, s2, 0);
+		return (move_usr_elems(s, snx, s1, s2));
+	}
+
 	uint16_t lst_index = s->ss_elems - 1;
 	uint16_t b4_lst_index = s->ss_elems - 2;
-	slab_t *lst_slab = NULL;
 	slab_t *b4_lst_slab = NULL;
-	subslab_t *lst_subslab = NULL;
 	subslab_t *b4_lst_subslab = NULL;
 	uint64_t diff = 0;
 	if (s1 != NULL) {
@@ -496,29 +557,24 @@ sub_addsn(subslab_t *s, slab_t *s1, subslab_t *s2, int mk)
 		diff = lst_subslab->ss_usr_elems;
 	}
 	SLABLIST_SUBSLAB_SET_MAX(s);
-	subslab_t *snx = s->ss_next;
 	s->ss_elems--;
 	SLABLIST_SUBSLAB_DEC_ELEMS(s);
 
-	int k = 0;
-	if (s1 != NULL) {
-		k = subslab_bin_srch_top(s1->s_max, s);
-	} else {
-		k = subslab_bin_srch(s2->ss_max, s);
-	}
-
 	add_slab(snx, lst_slab, lst_subslab, 0);
 	add_slab(s, s1, s2, k);
 	subslab_t *p = s;
 	subslab_t *q = snx;
 	while (p != q) {
 		p->ss_usr_elems -= diff;
+		p->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(p);
 		q->ss_usr_elems += diff;
+		q->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(q);
-		p = p->ss_below;
-		q = q->ss_below;
+		p = LNK(p->ss_below);
+		q = LNK(q->ss_below);
 	}
+	agg_dirty(p);
 	return (p);
 }
 
@@ -527,27 +583,29 @@ sub_addsn(subslab_t *s, slab_t *s1, subslab_t *s2, int mk)
  * into the slab previous to `s`.
  */
 static void
-addsp(slab_t *s, slablist_elem_t elem, int q)
+addsp(slab_t *s, slablist_elem_t elem, slablist_elem_t val, int q)
 {
 	/*
 	 * Whenever this function gets called we assume the `s` is FULL.
 	 */
-	slablist_elem_t fst_elem = s->s_arr[0];
-	slab_t *spv = s->s_prev;
+	slablist_elem_t fst_elem = SLAB_GET(s, 0);
+	slablist_elem_t fst_val = slab_val(s, 0);
+	slab_t *spv = LNK(s->s_prev);
 	s->s_elems--;
+	SLAB_SET_DIRTY(s);
 	SLABLIST_SLAB_DEC_ELEMS(s);
 
-	SLABLIST_BWDSHIFT_BEGIN(s->s_list, s, 1);
-	bcopy(&(s->s_arr[1]), s->s_arr, ((SELEM_MAX - 1)*8));
+	SLABLIST_BWDSHIFT_BEGIN(LNK(s->s_list), s, 1);
+	slab_move(s, 1, s, 0, SLAB_ELEM_MAX(s) - 1);
 	SLABLIST_BWDSHIFT_END();
 
-	s->s_min = s->s_arr[0];
+	s->s_min = SLAB_GET(s, 0);
 	SLABLIST_SLAB_SET_MIN(s);
 
 	int j = 0;
 	j = spv->s_elems;
 
-	add_elem(spv, fst_elem, j);
+	add_elem(spv, fst_elem, fst_val, j);
 	/*
 	 * We calculated the position `q` before we did the bwdshift. To
 	 * compensate for the changes to the array, we insert at position `q -
@@ -556,7 +614,7 @@ addsp(slab_t *s, slablist_elem_t elem, int q)
 	if (q > 0) {
 		q -= 1;
 	}
-	add_elem(s, elem, q);
+	add_elem(s, elem, val, q);
 }
 
 /*
@@ -579,11 +637,32 @@ sub_addsp(subslab_t *s, slab_t *s1, subslab_t *s2, int mk)
 	} else {
 		fst_subslab = (subslab_t *)(GET_SUBSLAB_ELEM(s, 0));
 	}
-	subslab_t *spv = s->ss_prev;
+	subslab_t *spv = LNK(s->ss_prev);
 
+	/*
+	 * Same deal as in `sub_addsn`: if the new element sorts before every
+	 * element in `s`, it goes at the end of `spv`.
+	 */
+	slablist_t *sl = LNK(s->ss_list);
+	int c;
+	if (s1 != NULL) {
+		c = SL_CMPF(sl)(s1->s_max, fst_slab->s_min);
+	} else {
+		c = SL_CMPF(sl)(s2->ss_max, fst_subslab->ss_min);
+	}
+	if (c < 0) {
+		if (s1 != NULL) {
+			s->ss_min = fst_slab->s_min;
+		} else {
+			s->ss_min = fst_subslab->ss_min;
+		}
+		SLABLIST_SUBSLAB_SET_MIN(s);
+		add_slab(spv, s1, s2, spv->ss_elems);
+		return (move_usr_elems(s, spv, s1, s2));
+	}
 
-	SLABLIST_SUBBWDSHIFT_BEGIN(s->ss_list, s, 1);
-	bcopy(&(GET_SUBSLAB_ELEM(s, 1)), &(GET_SUBSLAB_ELEM(s, 0)),
+	SLABLIST_SUBBWDSHIFT_BEGIN(LNK(s->ss_list), s, 1);
+	bcopy(&SUBSLAB_ELEMS(s)[1], &SUBSLAB_ELEMS(s)[0],
 	    ((s->ss_elems - 1) * sizeof (void *)));
 	SLABLIST_SUBBWDSHIFT_END();
 
@@ -622,17 +701,20 @@ sub_addsp(subslab_t *s, slab_t *s1, subslab_t *s2, int mk)
 	subslab_t *p = s;
 	subslab_t *q = spv;
 	if (0 && p == q && s1 != NULL) {
-		ripple_inc_usr_elems(s1->s_below);
+		ripple_inc_usr_elems(LNK(s1->s_below));
 		return (NULL);
 	}
 	while (p != q) {
 		p->ss_usr_elems -= diff;
+		p->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(p);
 		q->ss_usr_elems += diff;
+		q->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(q);
-		p = p->ss_below;
-		q = q->ss_below;
+		p = LNK(p->ss_below);
+		q = LNK(q->ss_below);
 	}
+	agg_dirty(p);
 	return (p);
 }
 
@@ -651,7 +733,7 @@ subslab_update_extrema(subslab_t *p)
 	subslab_t *ssf;
 	subslab_t *ssl;
 	/* update extrema of `p` */
-	if (p->ss_list->sl_layer == 1) {
+	if (LNK(p->ss_list)->sl_layer == 1) {
 		slab_t *f = GET_SUBSLAB_ELEM(p, 0);
 		slab_t *l = GET_SUBSLAB_ELEM(p, last);
 		p->ss_min = f->s_min;
@@ -673,13 +755,13 @@ ripple_update_extrema(subslab_t *p)
 {
 	while (p != NULL) {
 		subslab_update_extrema(p);
-		if (p->ss_next != NULL) {
-			subslab_update_extrema(p->ss_next);
+		if (LNK(p->ss_next) != NULL) {
+			subslab_update_extrema(LNK(p->ss_next));
 		}
-		if (p->ss_prev != NULL) {
-			subslab_update_extrema(p->ss_prev);
+		if (LNK(p->ss_prev) != NULL) {
+			subslab_update_extrema(LNK(p->ss_prev));
 		}
-		p = p->ss_below;
+		p = LNK(p->ss_below);
 	}
 }
 
@@ -688,56 +770,56 @@ ripple_update_extrema(subslab_t *p)
 void
 ripple_ai(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	subslab_t *p = s->s_below;
+	subslab_t *p = LNK(s->s_below);
 	ripple_update_extrema(p);
-	ripple_inc_usr_elems(s->s_below);
+	ripple_inc_usr_elems(LNK(s->s_below));
 }
 
 void
 ripple_aa(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	subslab_t *p = s->s_below;
+	subslab_t *p = LNK(s->s_below);
 	ripple_update_extrema(p);
-	ripple_inc_usr_elems(s->s_next->s_below);
+	ripple_inc_usr_elems(LNK(LNK(s->s_next)->s_below));
 }
 
 void
 ripple_ab(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	subslab_t *p = s->s_below;
+	subslab_t *p = LNK(s->s_below);
 	ripple_update_extrema(p);
-	ripple_inc_usr_elems(s->s_prev->s_below);
+	ripple_inc_usr_elems(LNK(LNK(s->s_prev)->s_below));
 }
 
 void
 ripple_aisn(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	subslab_t *p = s->s_next->s_below;
+	subslab_t *p = LNK(LNK(s->s_next)->s_below);
 	ripple_update_extrema(p);
-	ripple_inc_usr_elems(s->s_next->s_below);
+	ripple_inc_usr_elems(LNK(LNK(s->s_next)->s_below));
 }
 
 void
 ripple_aisp(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	subslab_t *p = s->s_prev->s_below;
+	subslab_t *p = LNK(LNK(s->s_prev)->s_below);
 	ripple_update_extrema(p);
-	ripple_inc_usr_elems(s->s_prev->s_below);
+	ripple_inc_usr_elems(LNK(LNK(s->s_prev)->s_below));
 }
 
 
@@ -750,89 +832,90 @@ ripple_common(slab_t *s, subslab_t *p, slab_t *n, subslab_t *nn)
 	add_ctx_t t;
 	bzero(&t, sizeof (add_ctx_t));
 	int status;
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 	/*
 	 * We update the extrema.
 	 */
 	ripple_update_extrema(p);
-	if (n->s_below != NULL) {
-		status = sl->sl_bnd_elem(n->s_min, n->s_below->ss_min,
-				n->s_below->ss_max);
+	if (LNK(n->s_below) != NULL) {
+		status = SL_BNDF(sl)(n->s_min, LNK(n->s_below)->ss_min,
+				LNK(n->s_below)->ss_max);
 		if (sorting && status == FS_IN_RANGE) {
-			if (sl->sl_cmp_elem(n->s_min,
-			    n->s_below->ss_max) == 0) {
+			if (SL_CMPF(sl)(n->s_min,
+			    LNK(n->s_below)->ss_max) == 0) {
 				status  = FS_OVER_RANGE;
 			}
 		}
-		t = subslab_gen_add(status, n, nn, n->s_below);
+		t = subslab_gen_add(status, n, nn, LNK(n->s_below));
 		while (t.ac_subslab_new != NULL) {
 			nn = t.ac_subslab_new;
 			/*
 			 * If there is no subslab, there is no point in
 			 * continueing.
 			 */
-			if (nn->ss_below == NULL) {
+			subslab_t *nb = LNK(nn->ss_below);
+			if (nb == NULL) {
 				break;
 			}
-			status = sl->sl_bnd_elem(nn->ss_min,
-			    nn->ss_below->ss_min, nn->ss_below->ss_max);
-			t = subslab_gen_add(status, NULL, nn, nn->ss_below);
+			status = SL_BNDF(sl)(nn->ss_min, nb->ss_min,
+			    nb->ss_max);
+			t = subslab_gen_add(status, NULL, nn, nb);
 		}
 		/*
 		 * We update the extrema again (who knows what may have
 		 * changed).
 		 */
 		ripple_update_extrema(p);
-		ripple_inc_usr_elems(n->s_below);
+		ripple_inc_usr_elems(LNK(n->s_below));
 	}
 }
 
 void
 ripple_aam(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	slab_t *n = s->s_next; /* new slab */
+	slab_t *n = LNK(s->s_next); /* new slab */
 	subslab_t *nn = NULL; /* new subslab */
-	subslab_t *p = s->s_next->s_below;
+	subslab_t *p = LNK(LNK(s->s_next)->s_below);
 	ripple_common(s, p, n, nn);
 }
 
 void
 ripple_abm(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	slab_t *n = s->s_prev; /* new slab */
+	slab_t *n = LNK(s->s_prev); /* new slab */
 	subslab_t *nn = NULL; /* new subslab */
-	subslab_t *p = s->s_prev->s_below;
+	subslab_t *p = LNK(LNK(s->s_prev)->s_below);
 	ripple_common(s, p, n, nn);
 }
 
 void
 ripple_aisnm(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	slab_t *n = s->s_next; /* new slab */
+	slab_t *n = LNK(s->s_next); /* new slab */
 	subslab_t *nn = NULL; /* new subslab */
-	subslab_t *p = s->s_next->s_below;
+	subslab_t *p = LNK(LNK(s->s_next)->s_below);
 	ripple_common(s, p, n, nn);
 }
 
 void
 ripple_aispm(slab_t *s)
 {
-	if (s->s_below == NULL) {
+	if (LNK(s->s_below) == NULL) {
 		return;
 	}
-	slab_t *n = s->s_prev; /* new slab */
+	slab_t *n = LNK(s->s_prev); /* new slab */
 	subslab_t *nn = NULL; /* new subslab */
-	subslab_t *p = s->s_prev->s_below;
+	subslab_t *p = LNK(LNK(s->s_prev)->s_below);
 	ripple_common(s, p, n, nn);
 }
 
@@ -844,7 +927,8 @@ ripple_aispm(slab_t *s)
  * error.
  */
 static add_ctx_t
-gen_add_ira(slablist_t *sl, slab_t *s, slablist_elem_t elem, int rep)
+gen_add_ira(slablist_t *sl, slab_t *s, slablist_elem_t elem,
+    slablist_elem_t val, int rep)
 {
 	/*
 	 * If we are adding into a subslab, then we are adding an
@@ -856,7 +940,12 @@ gen_add_ira(slablist_t *sl, slab_t *s, slablist_elem_t elem, int rep)
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 
 	int i = slab_bin_srch(elem, s);
-	if (!sorting && !rep && sl->sl_cmp_elem(elem, s->s_arr[i]) == 0) {
+	/*
+	 * The insertion point can be one past the last elem, which may also
+	 * be one past the end of a full slab's array.
+	 */
+	int dup = i < s->s_elems && SL_CMPF(sl)(elem, SLAB_GET(s, i)) == 0;
+	if (!sorting && !rep && dup) {
 		SLABLIST_SLAB_AR(sl, NULL, elem, 0);
 		ctx.ac_how = AC_HOW_EDUP;
 		return (ctx);
@@ -865,9 +954,10 @@ gen_add_ira(slablist_t *sl, slab_t *s, slablist_elem_t elem, int rep)
 	 * If the slab `s` is not full, or if there is the possibility of
 	 * replacing an existing element we try to add into the slab. On the
 	 * other hand, if the slab is full, we have to try to add the elem
-	 * into the slab `s` while moving elems between the adjacent slabs.
+	 * into the slab `s` while moving elems between the adjacent slabs. A
+	 * full slab can only take a replacement if `elem` is already in it.
 	 */
-	if (s->s_elems < SELEM_MAX || rep) {
+	if (s->s_elems < SLAB_ELEM_MAX(s) || (rep && dup)) {
 		/*
 		 * If this slablist is being used as an intermediary for
 		 * sorting an unsorted slab list, we have to adjust for the
@@ -881,16 +971,19 @@ gen_add_ira(slablist_t *sl, slab_t *s, slablist_elem_t elem, int rep)
 		if (sorting) {
 			goto skip_rep;
 		}
-		if (sl->sl_cmp_elem(s->s_arr[i], elem) == 0) {
-			ctx.ac_repd_elem = s->s_arr[i];
-			ctx.ac_how = AC_HOW_INTO;
-			s->s_arr[i] = elem;
+		if (dup) {
+			ctx.ac_repd_elem = SLAB_GET(s, i);
+			ctx.ac_how = AC_HOW_REP;
+			SLAB_SET(s, i, elem);
+			SLAB_SET_VAL(s, i, val);
+			SLAB_SET_PFX(s, i, elem);
+			SLAB_SET_DIRTY(s);
 			SLABLIST_SLAB_AR(sl, NULL, elem, 1);
 			return (ctx);
 		}
 skip_rep:;
 		SLABLIST_SLAB_AI(sl, s, elem);
-		add_elem(s, elem, i);
+		add_elem(s, elem, val, i);
 		ripple_ai(s);
 		ctx.ac_how = AC_HOW_INTO;
 
@@ -927,45 +1020,44 @@ skip_rep:;
 		 *	[X X X X X X X X] [E Y Y Y...
 		 *	   E comes after X, making the sort stable.
 		 */
-		if (sorting &&
-		    sl->sl_cmp_elem(elem, s->s_arr[i]) == 0) {
+		if (sorting && dup) {
 			slablist_elem_t tmp = elem;
-			elem = s->s_arr[i];
-			s->s_arr[i] = tmp;
+			elem = SLAB_GET(s, i);
+			SLAB_SET(s, i, tmp);
 		}
-		slab_t *snx = s->s_next;
-		slab_t *spv = s->s_prev;
-		if (snx != NULL && snx->s_elems < SELEM_MAX) {
+		slab_t *snx = LNK(s->s_next);
+		slab_t *spv = LNK(s->s_prev);
+		if (snx != NULL && snx->s_elems < SLAB_ELEM_MAX(snx)) {
 			SLABLIST_SLAB_AISN(sl, s, elem);
-			addsn(s, elem, i);
+			addsn(s, elem, val, i);
 			ripple_aisn(s);
 			ctx.ac_how = AC_HOW_SP_NX;
 			return (ctx);
 		}
-		if (spv != NULL && spv->s_elems < SELEM_MAX) {
+		if (spv != NULL && spv->s_elems < SLAB_ELEM_MAX(spv)) {
 			SLABLIST_SLAB_AISP(sl, s, elem);
-			addsp(s, elem, i);
+			addsp(s, elem, val, i);
 			ripple_aisp(s);
 			ctx.ac_how = AC_HOW_SP_PV;
 			return (ctx);
 		}
-		if (snx == NULL || snx->s_elems == SELEM_MAX) {
+		if (snx == NULL || snx->s_elems == SLAB_ELEM_MAX(snx)) {
 			SLABLIST_SLAB_AISNM(sl, s, elem);
-			ns = mk_slab();
+			ns = get_spare_slab(sl);
 			SLABLIST_SLAB_MK(sl);
 			link_slab(ns, s, SLAB_LINK_AFTER);
-			addsn(s, elem, i);
+			addsn(s, elem, val, i);
 			ripple_aisnm(s);
 			ctx.ac_how = AC_HOW_SP_NX;
 			ctx.ac_slab_new = ns;
 			return (ctx);
 		}
-		if (spv == NULL || spv->s_elems == SELEM_MAX) {
+		if (spv == NULL || spv->s_elems == SLAB_ELEM_MAX(spv)) {
 			SLABLIST_SLAB_AISPM(sl, s, elem);
-			ns = mk_slab();
+			ns = get_spare_slab(sl);
 			SLABLIST_SLAB_MK(sl);
 			link_slab(ns, s, SLAB_LINK_BEFORE);
-			addsp(s, elem, i);
+			addsp(s, elem, val, i);
 			ripple_aispm(s);
 			ctx.ac_how = AC_HOW_SP_PV;
 			ctx.ac_slab_new = ns;
@@ -995,7 +1087,7 @@ sub_gen_add_ira(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 	 * other hand, if the slab is full, we have to try to add the elem
 	 * into the slab `s` while moving elems between the adjacent slabs.
 	 */
-	if (s->ss_elems < SUBELEM_MAX) {
+	if (s->ss_elems < SUBSLAB_ELEM_MAX(s)) {
 
 		if (s1 != NULL) {
 			i = subslab_bin_srch_top(s1->s_max, s);
@@ -1008,27 +1100,26 @@ sub_gen_add_ira(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 		ctx.ac_how = AC_HOW_INTO;
 	} else {
 
-		subslab_t *snx = s->ss_next;
-		subslab_t *spv = s->ss_prev;
+		subslab_t *snx = LNK(s->ss_next);
+		subslab_t *spv = LNK(s->ss_prev);
 		subslab_t *common = NULL;
-		if (snx != NULL && snx->ss_elems < SUBELEM_MAX) {
+		if (snx != NULL && snx->ss_elems < SUBSLAB_ELEM_MAX(snx)) {
 			SLABLIST_SUBSLAB_AISN(sl, s, s1, s2);
 			common = sub_addsn(s, s1, s2, 0);
 			ctx.ac_how = AC_HOW_SP_NX;
 			ctx.ac_subslab_common = common;
 			return (ctx);
 		}
-		if (spv != NULL && spv->ss_elems < SUBELEM_MAX) {
+		if (spv != NULL && spv->ss_elems < SUBSLAB_ELEM_MAX(spv)) {
 			SLABLIST_SUBSLAB_AISP(sl, s, s1, s2);
 			common = sub_addsp(s, s1, s2, 0);
 			ctx.ac_how = AC_HOW_SP_PV;
 			ctx.ac_subslab_common = common;
 			return (ctx);
 		}
-		if (snx == NULL || snx->ss_elems == SUBELEM_MAX) {
+		if (snx == NULL || snx->ss_elems == SUBSLAB_ELEM_MAX(snx)) {
 			SLABLIST_SUBSLAB_AISNM(sl, s, s1, s2);
-			ns = mk_subslab();
-			ns->ss_arr = mk_subarr();
+			ns = get_spare_subslab(sl);
 			SLABLIST_SUBSLAB_MK(sl);
 			link_subslab(ns, s, SLAB_LINK_AFTER);
 			common = sub_addsn(s, s1, s2, 1);
@@ -1037,10 +1128,9 @@ sub_gen_add_ira(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 			ctx.ac_subslab_common = common;
 			return (ctx);
 		}
-		if (spv == NULL || spv->ss_elems == SUBELEM_MAX) {
+		if (spv == NULL || spv->ss_elems == SUBSLAB_ELEM_MAX(spv)) {
 			SLABLIST_SUBSLAB_AISPM(sl, s, s1, s2);
-			ns = mk_subslab();
-			ns->ss_arr = mk_subarr();
+			ns = get_spare_subslab(sl);
 			SLABLIST_SUBSLAB_MK(sl);
 			link_subslab(ns, s, SLAB_LINK_BEFORE);
 			common = sub_addsp(s, s1, s2, 1);
@@ -1053,6 +1143,21 @@ sub_gen_add_ira(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 	return (ctx);
 }
 
+/*
+ * Returns true if `s` is a slab that isn't full.
+ */
+static int
+slab_has_room(slab_t *s)
+{
+	return (s != NULL && s->s_elems < SLAB_ELEM_MAX(s));
+}
+
+static int
+subslab_has_room(subslab_t *s)
+{
+	return (s != NULL && s->ss_elems < SUBSLAB_ELEM_MAX(s));
+}
+
 /*
  * Assuming that `elem` is under the range of `s`, we have the following
  * possible way of adding `elem` into the slablist.
@@ -1065,7 +1170,8 @@ sub_gen_add_ira(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
  *	Create new previous slab, add into that.
  */
 static add_ctx_t
-gen_add_ura(slablist_t *sl, slab_t *s, slablist_elem_t elem)
+gen_add_ura(slablist_t *sl, slab_t *s, slablist_elem_t elem,
+    slablist_elem_t val)
 {
 	/*
 	 * If we are adding into a subslab, then we are adding an
@@ -1075,33 +1181,33 @@ gen_add_ura(slablist_t *sl, slab_t *s, slablist_elem_t elem)
 	slab_t *ns = NULL;
 	add_ctx_t ctx;
 	bzero(&ctx, sizeof (add_ctx_t));
-	if (s->s_elems < SELEM_MAX) {
+	if (s->s_elems < SLAB_ELEM_MAX(s)) {
 		SLABLIST_SLAB_AI(sl, s, elem);
-		add_elem(s, elem, i);
+		add_elem(s, elem, val, i);
 		ripple_ai(s);
 		ctx.ac_how = AC_HOW_INTO;
 		return (ctx);
 	}
-	if (s->s_prev != NULL && s->s_prev->s_elems < SELEM_MAX) {
+	if (slab_has_room(LNK(s->s_prev))) {
 		SLABLIST_SLAB_AB(sl, s, elem);
-		i = slab_bin_srch(elem, s->s_prev);
-		add_elem(s->s_prev, elem, i);
+		i = slab_bin_srch(elem, LNK(s->s_prev));
+		add_elem(LNK(s->s_prev), elem, val, i);
 		ripple_ab(s);
 		ctx.ac_how = AC_HOW_BEFORE;
 		return (ctx);
 	}
-	if (s->s_next != NULL && s->s_next->s_elems < SELEM_MAX) {
+	if (slab_has_room(LNK(s->s_next))) {
 		SLABLIST_SLAB_AISN(sl, s, elem);
-		addsn(s, elem, i);
+		addsn(s, elem, val, i);
 		ripple_aisn(s);
 		ctx.ac_how = AC_HOW_SP_NX;
 		return (ctx);
 	}
 	SLABLIST_SLAB_ABM(sl, s, elem);
-	ns = mk_slab();
+	ns = get_spare_slab(sl);
 	SLABLIST_SLAB_MK(sl);
 	link_slab(ns, s, SLAB_LINK_BEFORE);
-	add_elem(s->s_prev, elem, 0);
+	add_elem(LNK(s->s_prev), elem, val, 0);
 	ripple_abm(s);
 	ctx.ac_how = AC_HOW_BEFORE;
 	ctx.ac_slab_new = ns;
@@ -1125,25 +1231,25 @@ sub_gen_add_ura(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 		i = subslab_bin_srch(s2->ss_max, s);
 	}
 	subslab_t *ns = NULL;
-	if (s->ss_elems < SUBELEM_MAX) {
+	if (s->ss_elems < SUBSLAB_ELEM_MAX(s)) {
 		SLABLIST_SUBSLAB_AI(sl, s, s1, s2);
 		add_slab(s, s1, s2, i);
 		ctx.ac_how = AC_HOW_INTO;
 		return (ctx);
 	}
-	if (s->ss_prev != NULL && s->ss_prev->ss_elems < SUBELEM_MAX) {
+	if (subslab_has_room(LNK(s->ss_prev))) {
 		SLABLIST_SUBSLAB_AB(sl, s, s1, s2);
 		if (s1 != NULL) {
-			i = subslab_bin_srch_top(s1->s_max, s->ss_prev);
+			i = subslab_bin_srch_top(s1->s_max, LNK(s->ss_prev));
 		} else {
-			i = subslab_bin_srch(s2->ss_max, s->ss_prev);
+			i = subslab_bin_srch(s2->ss_max, LNK(s->ss_prev));
 		}
-		add_slab(s->ss_prev, s1, s2, i);
+		add_slab(LNK(s->ss_prev), s1, s2, i);
 		ctx.ac_how = AC_HOW_BEFORE;
 		return (ctx);
 	}
 	subslab_t *common = NULL;
-	if (s->ss_next != NULL && s->ss_next->ss_elems < SUBELEM_MAX) {
+	if (subslab_has_room(LNK(s->ss_next))) {
 		SLABLIST_SUBSLAB_AISN(sl, s, s1, s2);
 		common = sub_addsn(s, s1, s2, 0);
 		ctx.ac_how = AC_HOW_SP_NX;
@@ -1151,11 +1257,10 @@ sub_gen_add_ura(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 		return (ctx);
 	}
 	SLABLIST_SUBSLAB_ABM(sl, s, s1, s2);
-	ns = mk_subslab();
-	ns->ss_arr = mk_subarr();
+	ns = get_spare_subslab(sl);
 	SLABLIST_SUBSLAB_MK(sl);
 	link_subslab(ns, s, SLAB_LINK_BEFORE);
-	add_slab(s->ss_prev, s1, s2, 0);
+	add_slab(LNK(s->ss_prev), s1, s2, 0);
 	ctx.ac_how = AC_HOW_BEFORE;
 	ctx.ac_subslab_new = ns;
 	return (ctx);
@@ -1173,40 +1278,41 @@ sub_gen_add_ura(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
  *	Create new next slab, add into that.
  */
 static add_ctx_t
-gen_add_ora(slablist_t *sl, slab_t *s, slablist_elem_t elem)
+gen_add_ora(slablist_t *sl, slab_t *s, slablist_elem_t elem,
+    slablist_elem_t val)
 {
 	int i = slab_bin_srch(elem, s);
 	slab_t *ns = NULL;
 	add_ctx_t ctx;
 	bzero(&ctx, sizeof (add_ctx_t));
 
-	if (s->s_elems < SELEM_MAX) {
+	if (s->s_elems < SLAB_ELEM_MAX(s)) {
 		SLABLIST_SLAB_AI(sl, s, elem);
-		add_elem(s, elem, i);
+		add_elem(s, elem, val, i);
 		ripple_ai(s);
 		ctx.ac_how = AC_HOW_INTO;
 		return (ctx);
 	}
-	if (s->s_next != NULL && s->s_next->s_elems < SELEM_MAX) {
+	if (slab_has_room(LNK(s->s_next))) {
 		SLABLIST_SLAB_AA(sl, s, elem);
-		i = slab_bin_srch(elem, s->s_next);
-		add_elem(s->s_next, elem, i);
+		i = slab_bin_srch(elem, LNK(s->s_next));
+		add_elem(LNK(s->s_next), elem, val, i);
 		ripple_aa(s);
 		ctx.ac_how = AC_HOW_AFTER;
 		return (ctx);
 	}
-	if (s->s_prev != NULL && s->s_prev->s_elems < SELEM_MAX) {
+	if (slab_has_room(LNK(s->s_prev))) {
 		SLABLIST_SLAB_AISP(sl, s, elem);
-		addsp(s, elem, i);
+		addsp(s, elem, val, i);
 		ripple_aisp(s);
 		ctx.ac_how = AC_HOW_SP_PV;
 		return (ctx);
 	}
 	SLABLIST_SLAB_AAM(sl, s, elem);
-	ns = mk_slab();
+	ns = get_spare_slab(sl);
 	SLABLIST_SLAB_MK(sl);
 	link_slab(ns, s, SLAB_LINK_AFTER);
-	add_elem(s->s_next, elem, 0);
+	add_elem(LNK(s->s_next), elem, val, 0);
 	ripple_aam(s);
 	ctx.ac_how = AC_HOW_AFTER;
 	ctx.ac_slab_new = ns;
@@ -1226,25 +1332,25 @@ sub_gen_add_ora(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 		i = subslab_bin_srch(s2->ss_max, s);
 	}
 	subslab_t *ns = NULL;
-	if (s->ss_elems < SUBELEM_MAX) {
+	if (s->ss_elems < SUBSLAB_ELEM_MAX(s)) {
 		SLABLIST_SUBSLAB_AI(sl, s, s1, s2);
 		add_slab(s, s1, s2, i);
 		ctx.ac_how = AC_HOW_INTO;
 		return (ctx);
 	}
-	if (s->ss_next != NULL && s->ss_next->ss_elems < SUBELEM_MAX) {
+	if (subslab_has_room(LNK(s->ss_next))) {
 		SLABLIST_SUBSLAB_AA(sl, s, s1, s2);
 		if (s1 != NULL) {
-			i = subslab_bin_srch_top(s1->s_max, s->ss_next);
+			i = subslab_bin_srch_top(s1->s_max, LNK(s->ss_next));
 		} else {
-			i = subslab_bin_srch(s2->ss_max, s->ss_next);
+			i = subslab_bin_srch(s2->ss_max, LNK(s->ss_next));
 		}
-		add_slab(s->ss_next, s1, s2, i);
+		add_slab(LNK(s->ss_next), s1, s2, i);
 		ctx.ac_how = AC_HOW_AFTER;
 		return (ctx);
 	}
 	subslab_t *common = NULL;
-	if (s->ss_prev != NULL && s->ss_prev->ss_elems < SUBELEM_MAX) {
+	if (subslab_has_room(LNK(s->ss_prev))) {
 		SLABLIST_SUBSLAB_AISP(sl, s, s1, s2);
 		common = sub_addsp(s, s1, s2, 0);
 		ctx.ac_how = AC_HOW_SP_PV;
@@ -1252,11 +1358,10 @@ sub_gen_add_ora(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
 		return (ctx);
 	}
 	SLABLIST_SUBSLAB_AAM(sl, s, s1, s2);
-	ns = mk_subslab();
-	ns->ss_arr = mk_subarr();
+	ns = get_spare_subslab(sl);
 	SLABLIST_SUBSLAB_MK(sl);
 	link_subslab(ns, s, SLAB_LINK_AFTER);
-	add_slab(s->ss_next, s1, s2, 0);
+	add_slab(LNK(s->ss_next), s1, s2, 0);
 	ctx.ac_how = AC_HOW_AFTER;
 	ctx.ac_subslab_new = ns;
 	return (ctx);
@@ -1273,24 +1378,25 @@ sub_gen_add_ora(slablist_t *sl, subslab_t *s, slab_t *s1, subslab_t *s2)
  * capacity. See the above three functions for more details.
  */
 static add_ctx_t
-slab_gen_add(int status, slablist_elem_t elem, slab_t *s, int rep)
+slab_gen_add(int status, slablist_elem_t elem, slablist_elem_t val, slab_t *s,
+    int rep)
 {
 	add_ctx_t ctx;
 	bzero(&ctx, sizeof (add_ctx_t));
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 
 	if (status == FS_IN_RANGE) {
-		ctx = gen_add_ira(sl, s, elem, rep);
+		ctx = gen_add_ira(sl, s, elem, val, rep);
 		return (ctx);
 	}
 
 	if (status == FS_OVER_RANGE) {
-		ctx = gen_add_ora(sl, s, elem);
+		ctx = gen_add_ora(sl, s, elem, val);
 		return (ctx);
 	}
 
 	if (status == FS_UNDER_RANGE) {
-		ctx = gen_add_ura(sl, s, elem);
+		ctx = gen_add_ura(sl, s, elem, val);
 		return (ctx);
 	}
 
@@ -1300,7 +1406,7 @@ slab_gen_add(int status, slablist_elem_t elem, slab_t *s, int rep)
 static add_ctx_t
 subslab_gen_add(int status, slab_t *s1, subslab_t *s2, subslab_t *s)
 {
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	add_ctx_t ctx;
 	bzero(&ctx, sizeof (add_ctx_t));
 
@@ -1323,23 +1429,94 @@ subslab_gen_add(int status, slab_t *s1, subslab_t *s2, subslab_t *s)
 }
 
 /*
- * This function adds an element to a slablist. `rep` indicates if an
- * already-added element with an identical key should to be replaced.
- * This function is an entry point into libslablist.
+ * Adds `elem` to `s`, the slab that find_slab() found for it, where `fs` is
+ * the FS_* status that find_slab() returned. Attaches a sublayer if the list
+ * has grown enough to need a new one. Returns the AC_HOW_* way in which `elem`
+ * was added.
  */
-int
-slablist_add_impl(slablist_t *sl, slablist_elem_t elem, int rep)
+static int
+add_found(slablist_t *sl, int fs, slab_t *s, slablist_elem_t elem,
+    slablist_elem_t val, int rep)
+{
+	/*
+	 * slab_gen_add() may spill into either neighbour, so all three
+	 * slabs have to be writable.
+	 */
+	s = thaw_slab_nbrs(s);
+	add_ctx_t ctx = slab_gen_add(fs, elem, val, s, rep);
+
+	slablist_t *usl = NULL;
+
+	if (LNK(sl->sl_sublayer) == NULL) {
+		usl = sl;
+	} else {
+		usl = LNK(sl->sl_baselayer);
+	}
+
+	/*
+	 * If we have sl_req_sublayer slabs at the baselayer (or, if we
+	 * have no sublayers, in the slablist in general) we map the
+	 * slabs in the slablist/baselayer to a newly created
+	 * baselayer.
+	 */
+	if (sl->sl_req_sublayer &&
+	    usl->sl_slabs >= sl->sl_req_sublayer) {
+		attach_sublayer(usl);
+	}
+
+	return (ctx.ac_how);
+}
+
+/*
+ * Wraps up an addition to `sl`, once the element is in its slab.
+ */
+static int
+add_done(slablist_t *sl, slablist_elem_t elem, int how)
 {
+	int ret;
+
+	try_reap_all(sl);
+
+	if (how == AC_HOW_EDUP) {
+		ret = SL_EDUP;
+	} else if (how == AC_HOW_REP) {
+		ret = SL_SUCCESS;
+	} else {
+		sl->sl_elems++;
+		SLABLIST_SL_INC_ELEMS(sl);
+		bloom_add(sl, elem);
+		ret = SL_SUCCESS;
+	}
+	agg_flush(sl);
 
+	SLABLIST_ADD_END(ret);
+	return (ret);
+}
+
+/*
+ * This function adds an element to a slablist. `rep` indicates if an
+ * already-added element with an identical key should to be replaced. If `sl`
+ * is a key-value list, `val` is the value of the element, and replaces the
+ * value of the element that gets replaced.
+ */
+static int
+add_impl(slablist_t *sl, slablist_elem_t elem, slablist_elem_t val, int rep)
+{
+	if (SLIST_IS_NARROW(sl->sl_flags)) {
+		elem.sle_u &= UINT32_MAX;
+	}
 
 	int ret;
 	/*
 	 * The number of elements is too small to justify the use of slabs. So
 	 * we store the data in a singly linked list.
 	 */
-	if (IS_SMALL_LIST(sl) && sl->sl_elems <= (SMELEM_MAX - 1)) {
+	if (IS_SMALL_LIST(sl) && sl->sl_elems < sl->sl_smelem_max) {
 		SLABLIST_ADD_BEGIN(sl, elem, rep);
 		ret = small_list_add(sl, elem, 0,  NULL);
+		if (ret == SL_SUCCESS) {
+			bloom_add(sl, elem);
+		}
 		SLABLIST_ADD_END(ret);
 		return (ret);
 	}
@@ -1348,15 +1525,32 @@ slablist_add_impl(slablist_t *sl, slablist_elem_t elem, int rep)
 	 * If the number of elems has grown to an acceptable level, we turn the
 	 * list into a slab.
 	 */
-	if (IS_SMALL_LIST(sl) && sl->sl_elems == SMELEM_MAX) {
+	slab_t *s;
+
+	if (IS_SMALL_LIST(sl) && sl->sl_elems == sl->sl_smelem_max) {
 		small_list_to_slab(sl);
+		if (sl->sl_elems == 0) {
+			/*
+			 * Only a key-value list gets here, and its new slab is
+			 * empty, so there is nothing to search.
+			 */
+			SLABLIST_ADD_BEGIN(sl, elem, rep);
+			s = LNK(sl->sl_head);
+			SLAB_SET(s, 0, elem);
+			SLAB_SET_VAL(s, 0, val);
+			SLAB_SET_PFX(s, 0, elem);
+			s->s_min = elem;
+			s->s_max = elem;
+			s->s_elems++;
+			SLABLIST_SLAB_INC_ELEMS(s);
+			SLABLIST_SET_HEAD(sl, elem);
+			SLABLIST_SET_END(sl, elem);
+			return (add_done(sl, elem, AC_HOW_INTO));
+		}
 	}
 
 
-
-	slab_t *s;
-
-	int edup = 0;
+	int how = AC_HOW_INTO;
 
 	if (SLIST_SORTED(sl->sl_flags)) {
 		/*
@@ -1370,46 +1564,15 @@ slablist_add_impl(slablist_t *sl, slablist_elem_t elem, int rep)
 
 		SLABLIST_ADD_BEGIN(sl, elem, rep);
 
-		int fs;
-		slab_t *found;
 		/*
 		 * If we have sublayers, we do a binary search from the
 		 * base-slab to the candidate topslab. Otherwise, we just do a
-		 * linear search on our slab list. See the find_bubble_up()
-		 * implementation in slablist_find.c for details.
+		 * linear search on our slab list. See the find_slab() and
+		 * find_bubble_up() implementations in slablist_find.c for
+		 * details.
 		 */
-		if (sl->sl_sublayers) {
-			fs = find_bubble_up(sl, elem, &found);
-			s = found;
-		} else {
-			fs = find_linear_scan(sl, elem, &s);
-		}
-
-		add_ctx_t ctx = slab_gen_add(fs, elem, s, rep);
-		if (ctx.ac_how == AC_HOW_EDUP) {
-			edup++;
-		}
-
-		slablist_t *usl = NULL;
-
-		if (sl->sl_sublayer == NULL) {
-			usl = sl;
-		} else {
-			usl = sl->sl_baselayer;
-		}
-
-		/*
-		 * If we have sl_req_sublayer slabs at the baselayer (or, if we
-		 * have no sublayers, in the slablist in general) we map the
-		 * slabs in the slablist/baselayer to a newly created
-		 * baselayer.
-		 */
-		if (sl->sl_req_sublayer &&
-		    usl->sl_slabs >= sl->sl_req_sublayer) {
-			attach_sublayer(usl);
-		}
-
-
+		int fs = find_slab(sl, elem, &s);
+		how = add_found(sl, fs, s, elem, val, rep);
 	} else {
 
 		SLABLIST_ADD_BEGIN(sl, elem, rep);
@@ -1417,18 +1580,19 @@ slablist_add_impl(slablist_t *sl, slablist_elem_t elem, int rep)
 		 * If the slablist is ordered, we place the element at the end
 		 * of the list which is at the end of the last slab.
 		 */
-		s = (slab_t *)sl->sl_end;
+		s = thaw_slab((slab_t *)LNK(sl->sl_end));
 
-		if (s->s_elems < SELEM_MAX) {
-			s->s_arr[s->s_elems] = elem;
+		if (s->s_elems < SLAB_ELEM_MAX(s)) {
+			SLAB_SET(s, s->s_elems, elem);
 			s->s_max = elem;
 			s->s_elems++;
+			SLAB_SET_DIRTY(s);
 			SLABLIST_SET_END(sl, elem);
 			SLABLIST_SLAB_INC_ELEMS(s);
 		} else {
-			slab_t *ns = mk_slab();
+			slab_t *ns = get_spare_slab(sl);
 			SLABLIST_SLAB_MK(sl);
-			ns->s_arr[0] = elem;
+			SLAB_SET(ns, 0, elem);
 			ns->s_min = elem;
 			ns->s_max = elem;
 			link_slab(ns, s, SLAB_LINK_AFTER);
@@ -1437,31 +1601,129 @@ slablist_add_impl(slablist_t *sl, slablist_elem_t elem, int rep)
 		}
 	}
 
-	try_reap_all(sl);
+	return (add_done(sl, elem, how));
+}
 
-	if (edup) {
-		ret = SL_EDUP;
-	} else {
-		sl->sl_elems++;
-		SLABLIST_SL_INC_ELEMS(sl);
-		ret = SL_SUCCESS;
-	}
+/*
+ * This function adds an element to a slablist, with a value of 0 if it is a
+ * key-value list. This function is an entry point into libslablist.
+ */
+int
+slablist_add_impl(slablist_t *sl, slablist_elem_t elem, int rep)
+{
+	slablist_elem_t zero;
+	zero.sle_u = 0;
+	return (add_impl(sl, elem, zero, rep));
+}
 
+/*
+ * This is the part of slablist_add_impl() that comes after find_slab(), for
+ * callers that have already found the slab `s` that `elem` goes into, the way
+ * find_slab() would have. The C++ interface in slablist.hpp uses it, so that
+ * an insertion into a full slab doesn't have to search the list twice. `s`
+ * has to be a slab of a sorted list that isn't small. Like
+ * slablist_add_impl(), this knows nothing of logs, clones, MVCC readers, or
+ * shared lists.
+ */
+int
+slablist_add_found(slab_t *s, slablist_elem_t elem)
+{
+	slablist_t *sl = LNK(s->s_list);
+	SLABLIST_ADD_BEGIN(sl, elem, 0);
+	slablist_elem_t zero;
+	zero.sle_u = 0;
+	int fs = SL_BNDF(sl)(elem, s->s_min, s->s_max);
+	int how = add_found(sl, fs, s, elem, zero, 0);
+	return (add_done(sl, elem, how));
+}
 
-	SLABLIST_ADD_END(ret);
+/*
+ * Takes the locks that slablist_add() and slablist_put() need, and adds `elem`
+ * with the value `val`.
+ */
+static int
+add_locked(slablist_t *sl, slablist_elem_t elem, slablist_elem_t val, int rep)
+{
+	if (IS_MAPPED_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	int mtook = mvcc_enter(sl);
+	slablist_t *held = cow_enter(sl);
+	cow_own(sl, SLIST_SORTED(sl->sl_flags) ? COW_RANGE : COW_END, elem,
+	    elem);
+	int took = shm_enter(sl, 1);
+	int ret = SL_SUCCESS;
+	if (IS_SHM_LIST(sl) && shm_full(sl)) {
+		ret = SL_ENOSPC;
+	} else if (sl->sl_log != NULL) {
+		ret = log_append(sl, SL_LOG_ADD, elem, elem, rep);
+	}
+	if (ret == SL_SUCCESS) {
+		ret = add_impl(sl, elem, val, rep);
+		if (ret != SL_SUCCESS && sl->sl_log != NULL) {
+			log_cancel(sl);
+		}
+	}
+	shm_exit(sl, took);
+	cow_exit(held);
+	mvcc_exit(sl, mtook);
 	return (ret);
-
 }
 
 /*
  * This function is the interface function. We sometimes use the
  * slablist_add_impl() internally, and would like to distinguish between
- * user-induced calls and library-induced calls, when tracing.
+ * user-induced calls and library-induced calls, when tracing. Adding to a
+ * key-value list gives the element a value of 0.
  */
 int
 slablist_add(slablist_t *sl, slablist_elem_t elem, int rep)
 {
-	int ret = slablist_add_impl(sl, elem, rep);
+	slablist_elem_t zero;
+	zero.sle_u = 0;
+	return (add_locked(sl, elem, zero, rep));
+}
+
+/*
+ * Adds `key` to the key-value list `sl`, with the value `val`. If `key` is
+ * already in the list, and `rep` is set, the key and its value are replaced.
+ * Otherwise the list is left as it is, and we return SL_EDUP.
+ */
+int
+slablist_put(slablist_t *sl, slablist_elem_t key, slablist_elem_t val, int rep)
+{
+	if (!SLIST_IS_KV(sl->sl_flags)) {
+		return (SL_EKV);
+	}
+	return (add_locked(sl, key, val, rep));
+}
+
+/*
+ * Sets the value of `key`, which has to be in the key-value list `sl`, to
+ * `val`. This is cheaper than a slablist_put() that replaces the key, because
+ * the keys are left alone.
+ */
+int
+slablist_update_value(slablist_t *sl, slablist_elem_t key, slablist_elem_t val)
+{
+	if (!SLIST_IS_KV(sl->sl_flags)) {
+		return (SL_EKV);
+	}
+	int mtook = mvcc_enter(sl);
+	slablist_t *held = cow_enter(sl);
+	cow_own(sl, COW_RANGE, key, key);
+	int took = shm_enter(sl, 1);
+	slab_t *s;
+	int i;
+	int ret = kv_find(sl, key, &s, &i);
+	if (ret == SL_SUCCESS) {
+		SLAB_VAL(s, i) = val;
+		SLAB_SET_DIRTY(s);
+		agg_flush(sl);
+	}
+	shm_exit(sl, took);
+	cow_exit(held);
+	mvcc_exit(sl, mtook);
 	return (ret);
 }
 
@@ -1476,43 +1738,71 @@ slablist_add(slablist_t *sl, slablist_elem_t elem, int rep)
 int
 slablist_sort(slablist_t *sl, slablist_cmp_t cmp, slablist_bnd_t bnd)
 {
+	if (IS_MAPPED_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	slablist_t *held = cow_enter(sl);
+	cow_own_all(sl);
 	/*
 	 * We create a special kind of sorted slab list that we will use to
 	 * sort the elements in `sl`.
 	 */
+	thaw_slabs(sl);
 	slablist_t *tmp = slablist_create("temp_sorting", cmp,
-	    bnd, SL_SORTED);
+	    bnd, SL_SORTED | SLIST_IS_NARROW(sl->sl_flags));
 	SLIST_SET_SORTING_TEMP(tmp->sl_flags);
+	sl->sl_last = NULL;
+	tmp->sl_selem_max = sl->sl_selem_max;
+	tmp->sl_subelem_max = sl->sl_subelem_max;
+	tmp->sl_smelem_max = sl->sl_smelem_max;
+	tmp->sl_req_sublayer = sl->sl_req_sublayer;
 	uint64_t i = 0;
 	uint64_t j = 0;
 	if (IS_SMALL_LIST(sl)) {
 		small_list_t *prev_node = NULL;
-		small_list_t *node = sl->sl_head;
+		small_list_t *node = LNK(sl->sl_head);
 		while (i < sl->sl_elems) {
 			slablist_add_impl(tmp, node->sml_data, 0);
 			prev_node = node;
-			node = node->sml_next;
+			node = LNK(node->sml_next);
 			rm_sml_node(prev_node);
 			i++;
 		}
 	} else {
 		slab_t *prev_slab = NULL;
-		slab_t *slab = sl->sl_head;
+		slab_t *slab = LNK(sl->sl_head);
 		while (i < sl->sl_slabs) {
 			j = 0;
 			while (j < slab->s_elems) {
-				slablist_add_impl(tmp, slab->s_arr[j], 0);
+				slablist_add_impl(tmp, SLAB_GET(slab, j), 0);
 				j++;
 			}
 			prev_slab = slab;
-			slab = slab->s_next;
-			rm_slab(prev_slab);
+			slab = LNK(slab->s_next);
+			rm_slab(prev_slab, SLIST_SLAB_BYTES(sl));
 			i++;
 		}
-		sl->sl_head = tmp->sl_head;
+		sl->sl_head = MKLNK(LNK(tmp->sl_head));
+		sl->sl_end = MKLNK(LNK(tmp->sl_end));
+		sl->sl_slabs = tmp->sl_slabs;
+		/*
+		 * The slabs got their ids from `tmp`, so they need new ones.
+		 * They also still point at `tmp` and its sublayers, which are
+		 * about to be destroyed.
+		 */
+		slab = LNK(sl->sl_head);
+		while (slab != NULL) {
+			slab->s_list = MKLNK(sl);
+			slab->s_below = NULL;
+			sl->sl_slab_id++;
+			slab->s_id = sl->sl_slab_id;
+			SLAB_SET_DIRTY(slab);
+			slab = LNK(slab->s_next);
+		}
 	}
 	tmp->sl_head = NULL;
 	slablist_destroy(tmp, NULL);
+	cow_exit(held);
 	return (SL_SUCCESS);
 }
 
@@ -1523,40 +1813,46 @@ slablist_sort(slablist_t *sl, slablist_cmp_t cmp, slablist_bnd_t bnd)
 void
 slablist_reverse(slablist_t *sl)
 {
-	if (SLIST_SORTED(sl->sl_flags)) {
+	if (SLIST_SORTED(sl->sl_flags) || IS_MAPPED_LIST(sl)) {
 		return;
 	}
-	void *head = sl->sl_head;
-	sl->sl_head = sl->sl_end;
-	sl->sl_end = head;
+	slablist_t *held = cow_enter(sl);
+	cow_own_all(sl);
+	thaw_slabs(sl);
+	void *head = LNK(sl->sl_head);
+	sl->sl_head = MKLNK(LNK(sl->sl_end));
+	sl->sl_end = MKLNK(head);
 	if (IS_SMALL_LIST(sl)) {
 		small_list_t *n = head;
 		small_list_t *n_tmp;
 		small_list_t *n_prev = NULL;
 		while (n != NULL) {
-			n_tmp = n->sml_next;
-			n->sml_next = n_prev;
+			n_tmp = LNK(n->sml_next);
+			n->sml_next = MKLNK(n_prev);
 			n_prev = n;
 			n = n_tmp;
 		}
+		cow_exit(held);
 		return;
 	}
 	slab_t *s = head;
 	slab_t *tmp;
 	while (s != NULL) {
-		tmp = s->s_next;
-		s->s_next = s->s_prev;
-		s->s_prev = tmp;
-		uint8_t i = 0;
-		uint8_t j = s->s_elems - 1;
+		tmp = LNK(s->s_next);
+		s->s_next = MKLNK(LNK(s->s_prev));
+		s->s_prev = MKLNK(tmp);
+		uint16_t i = 0;
+		uint16_t j = s->s_elems - 1;
 		slablist_elem_t t;
 		while (i < j) {
-			t = s->s_arr[i];
-			s->s_arr[i] = s->s_arr[j];
-			s->s_arr[j] = t;
+			t = SLAB_GET(s, i);
+			SLAB_SET(s, i, SLAB_GET(s, j));
+			SLAB_SET(s, j, t);
 			i++;
 			j--;
 		}
+		SLAB_SET_DIRTY(s);
 		s = tmp;
 	}
+	cow_exit(held);
 }
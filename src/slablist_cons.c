@@ -26,7 +26,12 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <strings.h>
+#include <string.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "slablist_impl.h"
 #include "slablist_find.h"
 #include "slablist_test.h"
@@ -43,6 +48,54 @@ static int init = 0;
 /* static slablist_t *lst_sl = NULL; */
 /* static pthread_mutex_t lst_sl_lk; */
 extern int slablist_umem_init();
+static void trim_spares(slablist_t *, uint8_t);
+static void cow_leave(slablist_t *, slablist_rem_cb_t);
+static void mvcc_destroy(slablist_t *);
+static void fwd_prune(slablist_t *);
+static shm_map_t *shm_map_of(slablist_t *);
+static void shm_unmap(shm_map_t *);
+
+/*
+ * Sets the slab and subslab capacities of `sl`, which depend on its flags, and
+ * on whether it keeps key prefixes.
+ */
+void
+set_caps(slablist_t *sl)
+{
+	uint8_t fl = sl->sl_flags;
+	size_t esz = SLIST_ENTRY_SZ(sl);
+	switch (SLIST_SLAB_SIZE(fl)) {
+	case SL_SLAB_512:
+		sl->sl_selem_max = SLAB_NELEMS(512, esz);
+		break;
+	case SL_SLAB_4K:
+		sl->sl_selem_max = SLAB_NELEMS(4096, esz);
+		break;
+	case SL_SLAB_16K:
+		sl->sl_selem_max = SLAB_NELEMS(16384, esz);
+		break;
+	default:
+		sl->sl_selem_max = SLAB_NELEMS(1024, esz);
+		break;
+	}
+	if (esz != SLIST_ELEM_SZ(sl) && SLIST_IS_NARROW(fl)) {
+		sl->sl_selem_max &= ~1;
+	}
+	sl->sl_subelem_max = SUBELEM_MAX;
+	/*
+	 * A small list can grow to about half the size of a slab, but never
+	 * beyond SMELEM_MAX. The nodes of a small list have no room for
+	 * values, so a key-value list goes straight to slabs, and back to an
+	 * empty small list once it has no elements left.
+	 */
+	sl->sl_smelem_max = sl->sl_selem_max / 2;
+	if (sl->sl_smelem_max > SMELEM_MAX) {
+		sl->sl_smelem_max = SMELEM_MAX;
+	}
+	if (SLIST_IS_KV(fl)) {
+		sl->sl_smelem_max = 0;
+	}
+}
 
 slablist_t *
 slablist_create(
@@ -65,6 +118,10 @@ slablist_create(
 	list->sl_name = name;
 	list->sl_cmp_elem = cmpfun;
 	list->sl_bnd_elem = bndfun;
+	/* A key-value list is always sorted. */
+	if (SLIST_IS_KV(fl)) {
+		fl |= SL_SORTED;
+	}
 	list->sl_flags = fl;
 
 	/* reap defaults */
@@ -73,6 +130,10 @@ slablist_create(
 
 	list->sl_req_sublayer = 10;
 
+	list->sl_spare_max = SL_SPARE_MAX_DEF;
+
+	set_caps(list);
+
 	SLABLIST_CREATE(list);
 	return (list);
 }
@@ -132,6 +193,45 @@ slablist_set_attach_req(slablist_t *sl, uint64_t req)
 	} else {
 		sl->sl_req_sublayer = SL_REQ_MAX;
 	}
+	if (sl->sl_req_sublayer > sl->sl_subelem_max) {
+		sl->sl_req_sublayer = sl->sl_subelem_max;
+	}
+}
+
+/*
+ * This function allows the user to set the number of slabs (or subslabs) that
+ * a subslab can point to. A smaller fan-out means more sublayers, but less
+ * shifting in each subslab. It has to be set before the list grows large
+ * enough to get a sublayer --- afterwards, this function does nothing.
+ */
+void
+slablist_set_subslab_fanout(slablist_t *sl, uint16_t fanout)
+{
+	if (sl->sl_sublayers) {
+		return;
+	}
+	if (fanout > SUBELEM_MAX) {
+		fanout = SUBELEM_MAX;
+	}
+	if (fanout < SUBELEM_MIN) {
+		fanout = SUBELEM_MIN;
+	}
+	sl->sl_subelem_max = fanout;
+	if (sl->sl_req_sublayer > fanout) {
+		sl->sl_req_sublayer = fanout;
+	}
+}
+
+uint16_t
+slablist_get_subslab_fanout(slablist_t *sl)
+{
+	return (sl->sl_subelem_max);
+}
+
+uint16_t
+slablist_get_slab_elems(slablist_t *sl)
+{
+	return (sl->sl_selem_max);
 }
 
 uint64_t
@@ -140,10 +240,28 @@ slablist_get_attach_req(slablist_t *sl)
 	return (sl->sl_req_sublayer);
 }
 
+/*
+ * This function allows the user to set the maximum number of empty slabs (and
+ * empty subslabs) that the list holds on to for reuse. A value of 0 disables
+ * the spare pool altogether. Any spares above the new maximum are freed.
+ */
+void
+slablist_set_spare_max(slablist_t *sl, uint8_t new)
+{
+	sl->sl_spare_max = new;
+	trim_spares(sl, new);
+}
+
+uint8_t
+slablist_get_spare_max(slablist_t *sl)
+{
+	return (sl->sl_spare_max);
+}
+
 char *
 slablist_get_name(slablist_t *sl)
 {
-	return (sl->sl_name);
+	return (SL_NAME(sl));
 }
 
 uint8_t
@@ -173,6 +291,507 @@ slablist_get_type(slablist_t *sl)
 	return (SL_ORDERED);
 }
 
+/*
+ * The spare pool always lives in the toplayer, so that subslabs freed in one
+ * sublayer can be reused by another, and so that detaching a sublayer does
+ * not lose any spares.
+ */
+static slablist_t *
+spare_owner(slablist_t *sl)
+{
+	while (LNK(sl->sl_superlayer) != NULL) {
+		sl = LNK(sl->sl_superlayer);
+	}
+	return (sl);
+}
+
+/*
+ * Returns an empty slab, taken from the spare pool if possible.
+ */
+slab_t *
+get_spare_slab(slablist_t *sl)
+{
+	slablist_t *o = spare_owner(sl);
+	slab_t *s = LNK(o->sl_spare_slabs);
+	if (s == NULL) {
+		s = mk_slab(SLIST_SLAB_BYTES(o));
+	} else {
+		o->sl_spare_slabs = MKLNK(LNK(s->s_next));
+		o->sl_nspare_slabs--;
+		s->s_next = NULL;
+	}
+	/*
+	 * A new slab is about to be written to. Writes go through SLAB_SET(),
+	 * which needs to know what list the slab is in.
+	 */
+	s->s_list = MKLNK(sl);
+	s->s_hot = 1;
+	o->sl_slab_id++;
+	s->s_id = o->sl_slab_id;
+	SLAB_SET_DIRTY(s);
+	return (s);
+}
+
+/*
+ * Returns an empty subslab with an empty subarr_t already attached, taken from
+ * the spare pool if possible.
+ */
+subslab_t *
+get_spare_subslab(slablist_t *sl)
+{
+	slablist_t *o = spare_owner(sl);
+	subslab_t *s = LNK(o->sl_spare_subslabs);
+	if (s == NULL) {
+		return (mk_subslab_arr());
+	}
+	o->sl_spare_subslabs = MKLNK(LNK(s->ss_next));
+	o->sl_nspare_subslabs--;
+	s->ss_next = NULL;
+	return (s);
+}
+
+/*
+ * Gives an unlinked slab straight back to the allocator, bypassing the pool.
+ */
+void
+free_slab(slablist_t *sl, slab_t *s)
+{
+	slablist_t *o = spare_owner(sl);
+	if (o->sl_last == s) {
+		o->sl_last = NULL;
+	}
+	if (s->s_fwd) {
+		cow_freed(o, s);
+	}
+	/*
+	 * Cold slabs are allocated at their packed size.
+	 */
+	if (SLAB_IS_COLD(s)) {
+		o->sl_cold_slabs--;
+		rm_buf(s, COLD_SLAB_BYTES(s->s_elems, s->s_bits));
+		return;
+	}
+	rm_slab(s, SLIST_SLAB_BYTES(o));
+}
+
+/*
+ * Gives an unlinked slab back to the pool, or to the allocator if the pool is
+ * full. The slab is zeroed either way, just like rm_slab() would.
+ */
+void
+put_spare_slab(slablist_t *sl, slab_t *s)
+{
+	slablist_t *o = spare_owner(sl);
+	/*
+	 * Cold slabs are allocated at their packed size, and can't be reused.
+	 */
+	if (SLAB_IS_COLD(s) || o->sl_nspare_slabs >= o->sl_spare_max) {
+		free_slab(sl, s);
+		return;
+	}
+	if (o->sl_last == s) {
+		o->sl_last = NULL;
+	}
+	if (s->s_fwd) {
+		cow_freed(o, s);
+	}
+	bzero(s, SLIST_SLAB_BYTES(o));
+	s->s_next = MKLNK(LNK(o->sl_spare_slabs));
+	o->sl_spare_slabs = MKLNK(s);
+	o->sl_nspare_slabs++;
+}
+
+/*
+ * Gives an unlinked subslab (and its subarr_t) back to the pool, or to the
+ * allocator if the pool is full.
+ */
+void
+put_spare_subslab(slablist_t *sl, subslab_t *s)
+{
+	slablist_t *o = spare_owner(sl);
+	subarr_t *sa = LNK(s->ss_arr);
+	if (s->ss_fwd) {
+		cow_freed(o, s);
+	}
+	if (o->sl_nspare_subslabs >= o->sl_spare_max) {
+		rm_subslab_arr(s);
+		return;
+	}
+	bzero(sa, sizeof (subarr_t));
+	bzero(s, sizeof (subslab_t));
+	s->ss_arr = MKLNK(sa);
+	s->ss_next = MKLNK(LNK(o->sl_spare_subslabs));
+	o->sl_spare_subslabs = MKLNK(s);
+	o->sl_nspare_subslabs++;
+}
+
+/*
+ * Frees spares until there are at most `max` of each kind in the pool.
+ */
+static void
+trim_spares(slablist_t *sl, uint8_t max)
+{
+	slablist_t *o = spare_owner(sl);
+	slab_t *s;
+	subslab_t *ss;
+	while (o->sl_nspare_slabs > max) {
+		s = LNK(o->sl_spare_slabs);
+		o->sl_spare_slabs = MKLNK(LNK(s->s_next));
+		o->sl_nspare_slabs--;
+		rm_slab(s, SLIST_SLAB_BYTES(o));
+	}
+	while (o->sl_nspare_subslabs > max) {
+		ss = LNK(o->sl_spare_subslabs);
+		o->sl_spare_subslabs = MKLNK(LNK(ss->ss_next));
+		o->sl_nspare_subslabs--;
+		rm_subslab_arr(ss);
+	}
+}
+
+/*
+ * Returns all of the spares to the allocator.
+ */
+void
+rm_spares(slablist_t *sl)
+{
+	trim_spares(sl, 0);
+}
+
+/*
+ * Decodes the i'th element of the cold slab `s`.
+ */
+slablist_elem_t
+cold_slab_elem(slab_t *s, int i)
+{
+	uint64_t *w = (uint64_t *)s->s_arr;
+	uint8_t b = s->s_bits;
+	uint64_t off = (uint64_t)i * b;
+	uint64_t wi = 1 + (off >> 6);
+	uint64_t sh = off & 63;
+	uint64_t v = w[wi] >> sh;
+	if (sh + b > 64) {
+		v |= w[wi + 1] << (64 - sh);
+	}
+	v &= (1ULL << b) - 1;
+	slablist_elem_t e;
+	e.sle_u = w[0] + v;
+	return (e);
+}
+
+/*
+ * Widens an element of a narrow (SL_ELEM_32) slab.
+ */
+slablist_elem_t
+narrow_elem(uint32_t v)
+{
+	slablist_elem_t e;
+	e.sle_u = v;
+	return (e);
+}
+
+/*
+ * Returns the i'th value of `s`, or 0 if `s` isn't in a key-value list.
+ */
+slablist_elem_t
+slab_val(slab_t *s, int i)
+{
+	slablist_elem_t v;
+	v.sle_u = 0;
+	if (SLAB_IS_KV(s)) {
+		v = SLAB_VAL(s, i);
+	}
+	return (v);
+}
+
+/*
+ * Moves the `n` elements at index `i` of slab `s` to index `j` of slab `d`, as
+ * bcopy() would, along with their values if the list is a key-value list, and
+ * their prefixes if it has any. The two runs can overlap.
+ */
+void
+slab_move(slab_t *s, uint64_t i, slab_t *d, uint64_t j, uint64_t n)
+{
+	bcopy(SLAB_ADDR(s, i), SLAB_ADDR(d, j), SLAB_RUN(s, n));
+	if (SLAB_IS_KV(s)) {
+		bcopy(&SLAB_VAL(s, i), &SLAB_VAL(d, j),
+		    n * sizeof (slablist_elem_t));
+	}
+	if (SLIST_HAS_PFX(LNK(s->s_list))) {
+		bcopy(&SLAB_PFX(s, i), &SLAB_PFX(d, j), n * sizeof (uint64_t));
+	}
+}
+
+/*
+ * Recomputes the prefixes of all of the elements of `s`, after they have been
+ * changed in place.
+ */
+static void
+slab_reset_pfxs(slab_t *s)
+{
+	if (!SLIST_HAS_PFX(LNK(s->s_list))) {
+		return;
+	}
+	uint64_t i = 0;
+	while (i < s->s_elems) {
+		SLAB_SET_PFX(s, i, SLAB_GET(s, i));
+		i++;
+	}
+}
+
+/*
+ * Returns the elements of `s` as an array. If `s` is cold or narrow, the
+ * elements are decoded into `buf`, which has to be big enough to hold a full
+ * slab (see mk_decode_buf()).
+ */
+slablist_elem_t *
+slab_elems(slab_t *s, slablist_elem_t *buf)
+{
+	if (!SLAB_IS_COLD(s) && !SLAB_IS_NARROW(s)) {
+		return (s->s_arr);
+	}
+	int i = 0;
+	while (i < s->s_elems) {
+		buf[i] = SLAB_ELEM(s, i);
+		i++;
+	}
+	return (buf);
+}
+
+/*
+ * Returns a buffer that slab_elems() can decode a slab into, if `sl` has any
+ * cold slabs or is narrow, and NULL otherwise.
+ */
+slablist_elem_t *
+mk_decode_buf(slablist_t *sl)
+{
+	if (sl->sl_cold_slabs == 0 && !SLIST_IS_NARROW(sl->sl_flags)) {
+		return (NULL);
+	}
+	return (mk_buf(sl->sl_selem_max * sizeof (slablist_elem_t)));
+}
+
+void
+rm_decode_buf(slablist_t *sl, slablist_elem_t *buf)
+{
+	if (buf != NULL) {
+		rm_buf(buf, sl->sl_selem_max * sizeof (slablist_elem_t));
+	}
+}
+
+/*
+ * Makes everything that points to slab `old` point to slab `new`, which has
+ * a copy of the meta-data of `old`.
+ */
+static void
+replace_slab(slab_t *old, slab_t *new)
+{
+	slablist_t *sl = LNK(new->s_list);
+	if (LNK(new->s_prev) != NULL) {
+		LNK(new->s_prev)->s_next = MKLNK(new);
+	}
+	if (LNK(new->s_next) != NULL) {
+		LNK(new->s_next)->s_prev = MKLNK(new);
+	}
+	if (LNK(sl->sl_head) == old) {
+		sl->sl_head = MKLNK(new);
+	}
+	if (LNK(sl->sl_end) == old) {
+		sl->sl_end = MKLNK(new);
+	}
+	if (sl->sl_last == old) {
+		sl->sl_last = new;
+	}
+	if (old->s_fwd) {
+		cow_moved(sl, old, new);
+		old->s_fwd = 0;
+		new->s_fwd = 1;
+	}
+	if (LNK(new->s_below) != NULL) {
+		int j = sublayer_slab_ptr_srch(old, LNK(new->s_below));
+		SET_SUBSLAB_ELEM(LNK(new->s_below), new, j);
+	}
+}
+
+/*
+ * Re-encodes `s` in frame-of-reference form, if that at least halves its
+ * size. Returns the slab that replaces `s`, or `s` itself.
+ */
+static slab_t *
+freeze_slab(slab_t *s)
+{
+	slablist_t *sl = LNK(s->s_list);
+	uint64_t lo = SLAB_GET(s, 0).sle_u;
+	uint64_t hi = lo;
+	int i = 1;
+	while (i < s->s_elems) {
+		uint64_t e = SLAB_GET(s, i).sle_u;
+		if (e < lo) {
+			lo = e;
+		}
+		if (e > hi) {
+			hi = e;
+		}
+		i++;
+	}
+	uint8_t b = 1;
+	while (b < 64 && ((hi - lo) >> b) != 0) {
+		b++;
+	}
+	size_t sz = COLD_SLAB_BYTES(s->s_elems, b);
+	if (sz * 2 > SLIST_SLAB_BYTES(sl)) {
+		return (s);
+	}
+
+	slab_t *c = mk_zbuf(sz);
+	bcopy(s, c, sizeof (slab_t));
+	c->s_bits = b;
+	uint64_t *w = (uint64_t *)c->s_arr;
+	w[0] = lo;
+	i = 0;
+	while (i < s->s_elems) {
+		uint64_t v = SLAB_GET(s, i).sle_u - lo;
+		uint64_t off = (uint64_t)i * b;
+		uint64_t wi = 1 + (off >> 6);
+		uint64_t sh = off & 63;
+		w[wi] |= v << sh;
+		if (sh + b > 64) {
+			w[wi + 1] |= v >> (64 - sh);
+		}
+		i++;
+	}
+	replace_slab(s, c);
+	if (SLABLIST_TEST_SLAB_FREEZE_ENABLED()) {
+		SLABLIST_TEST_SLAB_FREEZE(test_slab_freeze(s, c), c);
+	}
+	SLABLIST_SLAB_FREEZE(sl, c);
+	put_spare_slab(sl, s);
+	sl->sl_cold_slabs++;
+	return (c);
+}
+
+/*
+ * Must be called on any slab that is about to be written to. If `s` is cold,
+ * it gets decoded into a new full-sized slab, which is returned. Either way,
+ * the returned slab is marked as hot, so that the next call to
+ * slablist_compress() leaves it alone.
+ */
+slab_t *
+thaw_slab(slab_t *s)
+{
+	if (!SLAB_IS_COLD(s)) {
+		s->s_hot = 1;
+		return (s);
+	}
+	slablist_t *sl = LNK(s->s_list);
+	slab_t *n = get_spare_slab(sl);
+	bcopy(s, n, sizeof (slab_t));
+	n->s_bits = 0;
+	n->s_hot = 1;
+	int i = 0;
+	while (i < s->s_elems) {
+		SLAB_SET(n, i, cold_slab_elem(s, i));
+		i++;
+	}
+	replace_slab(s, n);
+	SLABLIST_SLAB_THAW(sl, n);
+	sl->sl_cold_slabs--;
+	rm_buf(s, COLD_SLAB_BYTES(s->s_elems, s->s_bits));
+	return (n);
+}
+
+/*
+ * Thaws `s` and the slabs adjacent to it, which are the only slabs that an
+ * insertion into or a removal from `s` can write to. Returns the thawed `s`.
+ */
+slab_t *
+thaw_slab_nbrs(slab_t *s)
+{
+	if (LNK(s->s_prev) != NULL) {
+		(void) thaw_slab(LNK(s->s_prev));
+	}
+	if (LNK(s->s_next) != NULL) {
+		(void) thaw_slab(LNK(s->s_next));
+	}
+	return (thaw_slab(s));
+}
+
+/*
+ * Thaws every slab in `sl`.
+ */
+void
+thaw_slabs(slablist_t *sl)
+{
+	if (IS_SMALL_LIST(sl) || sl->sl_cold_slabs == 0) {
+		return;
+	}
+	slab_t *s = LNK(sl->sl_head);
+	while (s != NULL) {
+		s = thaw_slab(s);
+		s = LNK(s->s_next);
+	}
+}
+
+/*
+ * Freezes every slab that hasn't been written to since the last call, and
+ * marks the rest as candidates for the next call. So a slab has to survive
+ * one full compression interval untouched before it gets frozen. Returns the
+ * number of cold slabs in the list. Bookmarks into `sl` are invalidated.
+ * The frame-of-reference encoding has no room for values or prefixes, so
+ * key-value lists and lists with prefixes are left as they are.
+ */
+uint64_t
+slablist_compress(slablist_t *sl)
+{
+	if (IS_SMALL_LIST(sl) || IS_MAPPED_LIST(sl) || IS_SHM_LIST(sl) ||
+	    SLIST_IS_KV(sl->sl_flags) || SLIST_HAS_PFX(sl)) {
+		return (0);
+	}
+	/*
+	 * Freezing slabs doesn't change what's in the list, so it's not worth
+	 * copying the shared slabs for.
+	 */
+	if (IS_COW_LIST(sl) && sl->sl_cow->cw_refs > 1) {
+		return (sl->sl_cold_slabs);
+	}
+	slablist_t *held = cow_enter(sl);
+	cow_own_all(sl);
+	SLABLIST_COMPRESS_BEGIN(sl);
+	slab_t *s = LNK(sl->sl_head);
+	while (s != NULL) {
+		if (s->s_hot) {
+			s->s_hot = 0;
+		} else if (!SLAB_IS_COLD(s)) {
+			s = freeze_slab(s);
+		}
+		s = LNK(s->s_next);
+	}
+	SLABLIST_COMPRESS_END(sl->sl_cold_slabs);
+	cow_exit(held);
+	return (sl->sl_cold_slabs);
+}
+
+uint64_t
+slablist_get_cold_slabs(slablist_t *sl)
+{
+	return (sl->sl_cold_slabs);
+}
+
+/*
+ * The number of searches that the last slab found saved us, and the number it
+ * didn't (see find_slab()).
+ */
+uint64_t
+slablist_get_last_hits(slablist_t *sl)
+{
+	return (sl->sl_last_hits);
+}
+
+uint64_t
+slablist_get_last_misses(slablist_t *sl)
+{
+	return (sl->sl_last_misses);
+}
+
 void
 link_sml_node(slablist_t *sl, small_list_t *prev, small_list_t *to_link)
 {
@@ -180,14 +799,14 @@ link_sml_node(slablist_t *sl, small_list_t *prev, small_list_t *to_link)
 	small_list_t *next = NULL;
 
 	if (prev != NULL) {
-		next = prev->sml_next;
-		prev->sml_next = to_link;
-		to_link->sml_next = next;
+		next = LNK(prev->sml_next);
+		prev->sml_next = MKLNK(to_link);
+		to_link->sml_next = MKLNK(next);
 	} else {
-		next = sl->sl_head;
-		sl->sl_head = to_link;
+		next = LNK(sl->sl_head);
+		sl->sl_head = MKLNK(to_link);
 		SLABLIST_SET_HEAD(sl, to_link->sml_data);
-		to_link->sml_next = next;
+		to_link->sml_next = MKLNK(next);
 	}
 
 	sl->sl_elems++;
@@ -208,16 +827,16 @@ unlink_sml_node(slablist_t *sl, small_list_t *prev)
 	 * remove the next node.
 	 */
 	if (prev == NULL) {
-		to_rem = sl->sl_head;
-		sl->sl_head = to_rem->sml_next;
-		if (to_rem->sml_next != NULL) {
-			SLABLIST_SET_HEAD(sl, to_rem->sml_next->sml_data);
+		to_rem = LNK(sl->sl_head);
+		sl->sl_head = MKLNK(LNK(to_rem->sml_next));
+		if (LNK(to_rem->sml_next) != NULL) {
+			SLABLIST_SET_HEAD(sl, LNK(to_rem->sml_next)->sml_data);
 		}
 	} else {
-		to_rem = prev->sml_next;
-		prev->sml_next = to_rem->sml_next;
-		if (to_rem->sml_next == NULL) {
-			sl->sl_end = prev;
+		to_rem = LNK(prev->sml_next);
+		prev->sml_next = MKLNK(LNK(to_rem->sml_next));
+		if (LNK(to_rem->sml_next) == NULL) {
+			sl->sl_end = MKLNK(prev);
 			SLABLIST_SET_END(sl, prev->sml_data);
 		}
 	}
@@ -233,38 +852,38 @@ unlink_sml_node(slablist_t *sl, small_list_t *prev)
 void
 link_slab(slab_t *s1, slab_t *s2, int flag)
 {
-	slablist_t *sl = s2->s_list;
-	s1->s_below = s2->s_below;
+	slablist_t *sl = LNK(s2->s_list);
+	s1->s_below = MKLNK(LNK(s2->s_below));
 	if (flag == SLAB_LINK_BEFORE) {
 		SLABLIST_LINK_SLAB_BEFORE(sl, s1, s2);
-		s1->s_next = s2;
-		s1->s_prev = s2->s_prev;
-		s2->s_prev = s1;
-		if (s1->s_prev != NULL) {
-			s1->s_prev->s_next = s1;
-		}
-		if (s2 == sl->sl_head) {
-			sl->sl_head = s1;
+		s1->s_next = MKLNK(s2);
+		s1->s_prev = MKLNK(LNK(s2->s_prev));
+		s2->s_prev = MKLNK(s1);
+		if (LNK(s1->s_prev) != NULL) {
+			LNK(s1->s_prev)->s_next = MKLNK(s1);
+		}
+		if (s2 == LNK(sl->sl_head)) {
+			sl->sl_head = MKLNK(s1);
 			SLABLIST_SET_HEAD(sl, s1->s_min);
 		}
 	}
 
 	if (flag == SLAB_LINK_AFTER) {
 		SLABLIST_LINK_SLAB_AFTER(sl, s1, s2);
-		s1->s_prev = s2;
-		s1->s_next = s2->s_next;
-		s2->s_next = s1;
-		if (s1->s_next != NULL) {
-			s1->s_next->s_prev = s1;
+		s1->s_prev = MKLNK(s2);
+		s1->s_next = MKLNK(LNK(s2->s_next));
+		s2->s_next = MKLNK(s1);
+		if (LNK(s1->s_next) != NULL) {
+			LNK(s1->s_next)->s_prev = MKLNK(s1);
 		} else {
-			sl->sl_end = s1;
+			sl->sl_end = MKLNK(s1);
 			SLABLIST_SET_END(sl, s1->s_max);
 		}
 	}
 
-	s2->s_list->sl_slabs++;
-	SLABLIST_SL_INC_SLABS(s2->s_list);
-	s1->s_list = s2->s_list;
+	LNK(s2->s_list)->sl_slabs++;
+	SLABLIST_SL_INC_SLABS(LNK(s2->s_list));
+	s1->s_list = MKLNK(LNK(s2->s_list));
 
 }
 
@@ -275,39 +894,40 @@ link_slab(slab_t *s1, slab_t *s2, int flag)
 void
 link_subslab(subslab_t *s1, subslab_t *s2, int flag)
 {
-	slablist_t *sl = s2->ss_list;
-	s1->ss_below = s2->ss_below;
+	slablist_t *sl = LNK(s2->ss_list);
+	s1->ss_below = MKLNK(LNK(s2->ss_below));
 	if (flag == SLAB_LINK_BEFORE) {
 		SLABLIST_LINK_SUBSLAB_BEFORE(sl, s1, s2);
-		s1->ss_next = s2;
-		s1->ss_prev = s2->ss_prev;
-		s2->ss_prev = s1;
-		if (s1->ss_prev != NULL) {
-			s1->ss_prev->ss_next = s1;
-		}
-		if (s2 == sl->sl_head) {
-			sl->sl_head = s1;
+		s1->ss_next = MKLNK(s2);
+		s1->ss_prev = MKLNK(LNK(s2->ss_prev));
+		s2->ss_prev = MKLNK(s1);
+		if (LNK(s1->ss_prev) != NULL) {
+			LNK(s1->ss_prev)->ss_next = MKLNK(s1);
+		}
+		if (s2 == LNK(sl->sl_head)) {
+			sl->sl_head = MKLNK(s1);
 			SLABLIST_SET_HEAD(sl, s1->ss_min);
 		}
 	}
 
 	if (flag == SLAB_LINK_AFTER) {
 		SLABLIST_LINK_SUBSLAB_AFTER(sl, s1, s2);
-		s1->ss_prev = s2;
-		s1->ss_next = s2->ss_next;
-		s2->ss_next = s1;
-		if (s1->ss_next != NULL) {
-			s1->ss_next->ss_prev = s1;
-		}
-		if (s2 == sl->sl_end) {
-			sl->sl_end = s1;
+		s1->ss_prev = MKLNK(s2);
+		s1->ss_next = MKLNK(LNK(s2->ss_next));
+		s2->ss_next = MKLNK(s1);
+		if (LNK(s1->ss_next) != NULL) {
+			LNK(s1->ss_next)->ss_prev = MKLNK(s1);
+		}
+		if (s2 == LNK(sl->sl_end)) {
+			sl->sl_end = MKLNK(s1);
 			SLABLIST_SET_END(sl, s1->ss_max);
 		}
 	}
 
-	s2->ss_list->sl_slabs++;
-	SLABLIST_SL_INC_SUBSLABS(s2->ss_list);
-	s1->ss_list = s2->ss_list;
+	LNK(s2->ss_list)->sl_slabs++;
+	SLABLIST_SL_INC_SUBSLABS(LNK(s2->ss_list));
+	s1->ss_list = MKLNK(LNK(s2->ss_list));
+	spare_owner(sl)->sl_base_gen++;
 
 }
 
@@ -317,21 +937,21 @@ link_subslab(subslab_t *s1, subslab_t *s2, int flag)
 void
 unlink_slab(slab_t *s)
 {
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 	SLABLIST_UNLINK_SLAB(sl, s);
-	if (s->s_prev != NULL) {
-		s->s_prev->s_next = s->s_next;
-		if (sl->sl_end == s) {
-			sl->sl_end = s->s_prev;
-			SLABLIST_SET_END(sl, s->s_prev->s_max);
+	if (LNK(s->s_prev) != NULL) {
+		LNK(s->s_prev)->s_next = MKLNK(LNK(s->s_next));
+		if (LNK(sl->sl_end) == s) {
+			sl->sl_end = MKLNK(LNK(s->s_prev));
+			SLABLIST_SET_END(sl, LNK(s->s_prev)->s_max);
 		}
 	}
 
-	if (s->s_next != NULL) {
-		s->s_next->s_prev = s->s_prev;
-		if (sl->sl_head == s) {
-			sl->sl_head = s->s_next;
-			SLABLIST_SET_HEAD(sl, s->s_next->s_min);
+	if (LNK(s->s_next) != NULL) {
+		LNK(s->s_next)->s_prev = MKLNK(LNK(s->s_prev));
+		if (LNK(sl->sl_head) == s) {
+			sl->sl_head = MKLNK(LNK(s->s_next));
+			SLABLIST_SET_HEAD(sl, LNK(s->s_next)->s_min);
 		}
 	}
 
@@ -345,26 +965,27 @@ unlink_slab(slab_t *s)
 void
 unlink_subslab(subslab_t *s)
 {
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	SLABLIST_UNLINK_SUBSLAB(sl, s);
-	if (s->ss_prev != NULL) {
-		s->ss_prev->ss_next = s->ss_next;
-		if (sl->sl_end == s) {
-			sl->sl_end = s->ss_prev;
-			SLABLIST_SET_END(sl, s->ss_prev->ss_max);
+	if (LNK(s->ss_prev) != NULL) {
+		LNK(s->ss_prev)->ss_next = MKLNK(LNK(s->ss_next));
+		if (LNK(sl->sl_end) == s) {
+			sl->sl_end = MKLNK(LNK(s->ss_prev));
+			SLABLIST_SET_END(sl, LNK(s->ss_prev)->ss_max);
 		}
 	}
 
-	if (s->ss_next != NULL) {
-		s->ss_next->ss_prev = s->ss_prev;
-		if (sl->sl_head == s) {
-			sl->sl_head = s->ss_next;
-			SLABLIST_SET_HEAD(sl, s->ss_next->ss_min);
+	if (LNK(s->ss_next) != NULL) {
+		LNK(s->ss_next)->ss_prev = MKLNK(LNK(s->ss_prev));
+		if (LNK(sl->sl_head) == s) {
+			sl->sl_head = MKLNK(LNK(s->ss_next));
+			SLABLIST_SET_HEAD(sl, LNK(s->ss_next)->ss_min);
 		}
 	}
 
 	sl->sl_slabs--;
 	SLABLIST_SL_DEC_SUBSLABS(sl);
+	spare_owner(sl)->sl_base_gen++;
 }
 
 /*
@@ -375,23 +996,23 @@ remove_slabs(slablist_t *sl, slablist_rem_cb_t cb)
 {
 	slab_t *s;
 	slab_t *sn;
-	s = sl->sl_head;
+	s = LNK(sl->sl_head);
 	uint64_t i = 0;
 	uint64_t nslabs = sl->sl_slabs;
 	while (i < nslabs) {
-		sn = s->s_next;
+		sn = LNK(s->s_next);
 		if (cb == NULL) {
 			goto skip_cb;
 		}
 
 		int j = 0;
-		while (j <= s->s_elems) {
-			cb(s->s_arr[j]);
+		while (j < s->s_elems) {
+			cb(SLAB_ELEM(s, j));
 			j++;
 		}
 skip_cb:;
 		unlink_slab(s);
-		rm_slab(s);
+		put_spare_slab(sl, s);
 		SLABLIST_SLAB_RM(sl);
 		s = sn;
 		i++;
@@ -406,14 +1027,13 @@ remove_subslabs(slablist_t *sl)
 {
 	subslab_t *s;
 	subslab_t *sn;
-	s = sl->sl_head;
+	s = LNK(sl->sl_head);
 	uint64_t i = 0;
 	uint64_t nslabs = sl->sl_slabs;
 	while (i < nslabs) {
-		sn = s->ss_next;
+		sn = LNK(s->ss_next);
 		unlink_subslab(s);
-		rm_subarr(s->ss_arr);
-		rm_subslab(s);
+		rm_subslab_arr(s);
 		SLABLIST_SUBSLAB_RM(sl);
 		s = sn;
 		i++;
@@ -434,15 +1054,64 @@ slablist_destroy(slablist_t *sl, slablist_rem_cb_t cb)
 	small_list_t *sml;
 	small_list_t *smln;
 
-	/*
-	 * If we are dealing with a non-empty small list, we remove
+	if (sl->sl_log != NULL) {
+		(void) slablist_log_detach(sl);
+	}
+
+	if (IS_MVCC_LIST(sl)) {
+		mvcc_destroy(sl);
+	}
+
+	bloom_release(sl->sl_bloom);
+	sl->sl_bloom = NULL;
+	rix_destroy(sl);
+
+	/*
+	 * A mapped list only owns its mapping.
+	 */
+	if (IS_MAPPED_LIST(sl)) {
+		(void) munmap((void *)sl->sl_map, sl->sl_map_len);
+		rm_slablist(sl);
+		return;
+	}
+
+	/*
+	 * A shared list is torn down like any other list, with its segment as
+	 * the arena, and then the segment itself goes away.
+	 */
+	if (IS_SHM_LIST(sl)) {
+		shm_map_t *m = shm_map_of(sl);
+		slablist_shm_t *shm = m->sm_seg;
+		char name[SL_SHM_NAME_MAX];
+		(void) strcpy(name, shm->shm_name);
+		int took = shm_enter(sl, 1);
+		sl->sl_name = SL_NAME(sl);
+		sl->sl_shm = NULL;
+		slablist_destroy(sl, cb);
+		shm_exit(sl, took);
+		shm_unmap(m);
+		(void) shm_unlink(name);
+		return;
+	}
+
+	/*
+	 * The nodes of a cloned list are only freed by the last handle that
+	 * uses them.
+	 */
+	if (IS_COW_LIST(sl)) {
+		cow_leave(sl, cb);
+		return;
+	}
+
+	/*
+	 * If we are dealing with a non-empty small list, we remove
 	 * the individual linked list nodes.
 	 */
-	if (IS_SMALL_LIST(sl) && sl->sl_head != NULL) {
-		sml = sl->sl_head;
+	if (IS_SMALL_LIST(sl) && LNK(sl->sl_head) != NULL) {
+		sml = LNK(sl->sl_head);
 		uint64_t i = 0;
 		while (i < sl->sl_elems) {
-			smln = sml->sml_next;
+			smln = LNK(sml->sml_next);
 			if (cb != NULL) {
 				cb(sml->sml_data);
 			}
@@ -454,29 +1123,1653 @@ slablist_destroy(slablist_t *sl, slablist_rem_cb_t cb)
 
 	slablist_t *p;
 	slablist_t *q;
-	p = sl->sl_sublayer;
+	p = LNK(sl->sl_sublayer);
 	/*
 	 * We remove all of the slabs in the top layer/
 	 */
-	if (!(IS_SMALL_LIST(sl)) && sl->sl_head != NULL) {
+	if (!(IS_SMALL_LIST(sl)) && LNK(sl->sl_head) != NULL) {
 		remove_slabs(sl, NULL);
 	}
 
 	/*
 	 * We remove all of the sublabs in the sublayers, one by one.
 	 */
-	if (!(IS_SMALL_LIST(sl)) && sl->sl_sublayer != NULL) {
+	if (!(IS_SMALL_LIST(sl)) && LNK(sl->sl_sublayer) != NULL) {
 		while (p != NULL) {
 			q = p;
 			remove_subslabs(p);
-			p = q->sl_sublayer;
+			p = LNK(q->sl_sublayer);
 			rm_slablist(q);
 		}
 	}
 
-	rm_slablist(sl);
+	rm_spares(sl);
+	if (sl->sl_name_alloc) {
+		rm_buf(sl->sl_name, strlen(sl->sl_name) + 1);
+	}
+	rm_slablist(sl);
+}
+
+/*
+ * Shared Lists
+ *
+ * These functions create a slab list in a shared memory segment, and let
+ * other processes attach to it. See slablist_shm_t in slablist_impl.h for
+ * how the segment is laid out, and what it demands of the processes that
+ * share it.
+ *
+ * slablist_add(), slablist_rem(), and slablist_rem_range() take the write
+ * lock of a shared list, and slablist_find() and slablist_get() take the read
+ * lock, if the calling thread doesn't already hold either. Anything else
+ * (folds, bookmarks, reaping, sorting) has to be bracketed by
+ * slablist_shm_rdlock() or slablist_shm_wrlock(), and slablist_shm_unlock(),
+ * since the links of the list can only be followed by a thread that holds
+ * its lock. A thread can hold the lock of only one shared list at a time.
+ * Shared lists are never compressed, as the segment may not have room for the
+ * cold slabs.
+ */
+
+/*
+ * The segments that this process has mapped, and the number of them. The
+ * count lets MKLNK() skip the lookup of the segment in processes that have
+ * never mapped one.
+ */
+static shm_map_t *shm_maps;
+static pthread_mutex_t shm_maps_lock = PTHREAD_MUTEX_INITIALIZER;
+uint32_t shm_nmaps;
+
+/*
+ * The segment whose lock the calling thread holds, if any.
+ */
+static __thread shm_map_t *shm_held;
+
+#define	SHM_HAS(seg, p)	((char *)(p) >= (char *)(seg) &&\
+	(char *)(p) < (char *)(seg) + (seg)->shm_size)
+
+/*
+ * Turns the tagged offset `v` into a pointer into the segment that the
+ * calling thread holds the lock of.
+ */
+void *
+shm_ptr(uintptr_t v)
+{
+	return ((char *)shm_held->sm_seg + (v & ~(uintptr_t)1));
+}
+
+/*
+ * Turns `p` into a tagged offset, if it points into the segment that the
+ * calling thread holds the lock of.
+ */
+void *
+shm_off(void *p)
+{
+	shm_map_t *m = shm_held;
+	if (m == NULL || p == NULL || !SHM_HAS(m->sm_seg, p)) {
+		return (p);
+	}
+	return ((void *)(((char *)p - (char *)m->sm_seg) | 1));
+}
+
+slablist_cmp_t *
+shm_cmp(void)
+{
+	return (shm_held->sm_cmp);
+}
+
+slablist_bnd_t *
+shm_bnd(void)
+{
+	return (shm_held->sm_bnd);
+}
+
+/*
+ * Records that `seg` is mapped into this process, with the callbacks `cmp` and
+ * `bnd`.
+ */
+static shm_map_t *
+shm_map(slablist_shm_t *seg, slablist_cmp_t *cmp, slablist_bnd_t *bnd)
+{
+	shm_map_t *m = mk_zbuf(sizeof (shm_map_t));
+	m->sm_seg = seg;
+	m->sm_cmp = cmp;
+	m->sm_bnd = bnd;
+	(void) pthread_mutex_lock(&shm_maps_lock);
+	m->sm_next = shm_maps;
+	shm_maps = m;
+	shm_nmaps++;
+	(void) pthread_mutex_unlock(&shm_maps_lock);
+	return (m);
+}
+
+/*
+ * Unmaps the segment of `m`, and forgets about it.
+ */
+static void
+shm_unmap(shm_map_t *m)
+{
+	(void) pthread_mutex_lock(&shm_maps_lock);
+	shm_map_t **pp = &shm_maps;
+	while (*pp != m) {
+		pp = &(*pp)->sm_next;
+	}
+	*pp = m->sm_next;
+	shm_nmaps--;
+	(void) pthread_mutex_unlock(&shm_maps_lock);
+	(void) munmap((void *)m->sm_seg, m->sm_seg->shm_size);
+	rm_buf(m, sizeof (shm_map_t));
+}
+
+/*
+ * Returns the segment that the shared list `sl` lives in.
+ */
+static shm_map_t *
+shm_map_of(slablist_t *sl)
+{
+	(void) pthread_mutex_lock(&shm_maps_lock);
+	shm_map_t *m = shm_maps;
+	while (m != NULL && !SHM_HAS(m->sm_seg, sl)) {
+		m = m->sm_next;
+	}
+	(void) pthread_mutex_unlock(&shm_maps_lock);
+	return (m);
+}
+
+/*
+ * Takes the lock of `sl` (for writing, if `wr`), unless `sl` isn't shared, or
+ * the calling thread already holds the lock. A writer allocates from the
+ * segment. Returns 1 if the lock was taken, so that shm_exit() knows to drop
+ * it.
+ */
+int
+shm_enter(slablist_t *sl, int wr)
+{
+	if (!IS_SHM_LIST(sl) ||
+	    (shm_held != NULL && SHM_HAS(shm_held->sm_seg, sl))) {
+		return (0);
+	}
+	shm_map_t *m = shm_map_of(sl);
+	slablist_shm_t *shm = m->sm_seg;
+	if (wr) {
+		(void) pthread_rwlock_wrlock(&shm->shm_lock);
+		(void) shm_set_arena(shm);
+	} else {
+		(void) pthread_rwlock_rdlock(&shm->shm_lock);
+	}
+	shm_held = m;
+	SLABLIST_SHM_LOCK(sl, wr);
+	return (1);
+}
+
+void
+shm_exit(slablist_t *sl, int took)
+{
+	if (!took || shm_held == NULL || !SHM_HAS(shm_held->sm_seg, sl)) {
+		return;
+	}
+	slablist_shm_t *shm = shm_held->sm_seg;
+	SLABLIST_SHM_UNLOCK(sl);
+	(void) shm_set_arena(NULL);
+	shm_held = NULL;
+	(void) pthread_rwlock_unlock(&shm->shm_lock);
+}
+
+/*
+ * Creates the shared memory object `shm` (a name suitable for shm_open(3C)),
+ * of `size` bytes, and creates an empty slab list in it. The object must not
+ * exist yet. The returned list lives until slablist_destroy() is called on
+ * it, which also unlinks the object. Processes that are forked after this
+ * returns can use the list right away; others have to call
+ * slablist_shm_attach().
+ */
+slablist_t *
+slablist_shm_create(char *shm, size_t size, char *name, slablist_cmp_t cmpfun,
+    slablist_bnd_t bndfun, uint8_t fl)
+{
+	if (strlen(shm) >= SL_SHM_NAME_MAX || size < sizeof (slablist_shm_t) +
+	    sizeof (slablist_t)) {
+		return (NULL);
+	}
+	int fd = shm_open(shm, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) {
+		return (NULL);
+	}
+	slablist_shm_t *seg = MAP_FAILED;
+	if (ftruncate(fd, size) == 0) {
+		seg = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+		    0);
+	}
+	(void) close(fd);
+	if (seg == MAP_FAILED) {
+		(void) shm_unlink(shm);
+		return (NULL);
+	}
+
+	pthread_rwlockattr_t attr;
+	(void) pthread_rwlockattr_init(&attr);
+	(void) pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	(void) pthread_rwlock_init(&seg->shm_lock, &attr);
+	(void) pthread_rwlockattr_destroy(&attr);
+	bcopy(SL_SHM_MAGIC, seg->shm_magic, sizeof (seg->shm_magic));
+	(void) strcpy(seg->shm_name, shm);
+	seg->shm_size = size;
+	seg->shm_brk = sizeof (slablist_shm_t);
+
+	/*
+	 * We make the new segment ours as if we had locked it, so that the
+	 * list is allocated from it, and its links are stored as offsets.
+	 */
+	shm_map_t *held = shm_held;
+	shm_held = shm_map(seg, cmpfun, bndfun);
+	slablist_shm_t *old = shm_set_arena(seg);
+	slablist_t *sl = slablist_create(NULL, cmpfun, bndfun, fl);
+	sl->sl_cmp_elem = NULL;
+	sl->sl_bnd_elem = NULL;
+	if (name != NULL) {
+		char *buf = mk_buf(strlen(name) + 1);
+		(void) strcpy(buf, name);
+		sl->sl_name = MKLNK(buf);
+		sl->sl_name_alloc = 1;
+	}
+	sl->sl_shm = MKLNK(seg);
+	seg->shm_list = SHM_OFF(seg, sl);
+	(void) shm_set_arena(old);
+	shm_held = held;
+	return (sl);
+}
+
+/*
+ * Maps the shared list that slablist_shm_create() made in the object `shm`,
+ * wherever there is room for it. The calling process uses `cmpfun` and
+ * `bndfun` as the list's callbacks, which have to order the elements the same
+ * way as the callbacks of every other process that uses the list.
+ */
+slablist_t *
+slablist_shm_attach(char *shm, slablist_cmp_t cmpfun, slablist_bnd_t bndfun)
+{
+	int fd = shm_open(shm, O_RDWR, 0);
+	if (fd < 0) {
+		return (NULL);
+	}
+	slablist_shm_t hdr;
+	slablist_shm_t *seg = MAP_FAILED;
+	if (pread(fd, &hdr, sizeof (hdr), 0) == sizeof (hdr) &&
+	    bcmp(hdr.shm_magic, SL_SHM_MAGIC, sizeof (hdr.shm_magic)) == 0) {
+		seg = mmap(NULL, hdr.shm_size, PROT_READ | PROT_WRITE,
+		    MAP_SHARED, fd, 0);
+	}
+	(void) close(fd);
+	if (seg == MAP_FAILED) {
+		return (NULL);
+	}
+	slablist_t *sl = SHM_AT(seg, hdr.shm_list);
+	if (SLIST_SORTED(sl->sl_flags) && (cmpfun == NULL || bndfun == NULL)) {
+		(void) munmap((void *)seg, hdr.shm_size);
+		return (NULL);
+	}
+	(void) shm_map(seg, cmpfun, bndfun);
+	return (sl);
+}
+
+/*
+ * Unmaps a shared list from the calling process, without destroying it.
+ */
+void
+slablist_shm_detach(slablist_t *sl)
+{
+	shm_unmap(shm_map_of(sl));
+}
+
+void
+slablist_shm_rdlock(slablist_t *sl)
+{
+	(void) shm_enter(sl, 0);
+}
+
+void
+slablist_shm_wrlock(slablist_t *sl)
+{
+	(void) shm_enter(sl, 1);
+}
+
+void
+slablist_shm_unlock(slablist_t *sl)
+{
+	shm_exit(sl, 1);
+}
+
+/*
+ * Cloned Lists
+ *
+ * These functions let the handles of a family share slabs and subslabs, and
+ * give a handle its own copy of the nodes that it's about to modify. See
+ * slablist_cow_t in slablist_impl.h for the details.
+ */
+
+uint32_t cow_nfwd;
+static __thread slablist_t *cow_held;
+
+#define	FWD_MIN	16
+
+/*
+ * Makes `sl` the handle whose forwarding map LNK() uses in the calling thread,
+ * and returns the one that was in use. See cow_enter(), which every public
+ * function that looks at the nodes of a cloned list calls first.
+ */
+slablist_t *
+cow_swap(slablist_t *sl)
+{
+	slablist_t *prev = cow_held;
+	cow_held = sl;
+	return (prev);
+}
+
+static uint64_t
+fwd_slot(cow_fwd_t *f, void *p)
+{
+	uint64_t h = (uint64_t)(uintptr_t)p * 0x9e3779b97f4a7c15ULL;
+	return ((h >> 32) & (f->fw_cap - 1));
+}
+
+/*
+ * Returns the slot of `p` in the map `f`, or the empty slot where it would go.
+ */
+static uint64_t
+fwd_find(cow_fwd_t *f, void *p)
+{
+	uint64_t i = fwd_slot(f, p);
+	while (f->fw_key[i] != NULL && f->fw_key[i] != p) {
+		i = (i + 1) & (f->fw_cap - 1);
+	}
+	return (i);
+}
+
+/*
+ * Returns the copy that the handle in use forwards `p` to, or `p` itself.
+ */
+void *
+cow_ptr(void *p)
+{
+	slablist_t *sl = cow_held;
+	if (p == NULL || sl == NULL || sl->sl_fwd == NULL) {
+		return (p);
+	}
+	cow_fwd_t *f = sl->sl_fwd;
+	uint64_t i = fwd_find(f, p);
+	return (f->fw_key[i] == NULL ? p : f->fw_val[i]);
+}
+
+static void
+fwd_alloc(cow_fwd_t *f, uint64_t cap)
+{
+	f->fw_cap = cap;
+	f->fw_key = mk_zbuf(cap * sizeof (void *));
+	f->fw_val = mk_zbuf(cap * sizeof (void *));
+	f->fw_layer = mk_zbuf(cap);
+}
+
+static void
+fwd_free(cow_fwd_t *f)
+{
+	rm_buf(f->fw_key, f->fw_cap * sizeof (void *));
+	rm_buf(f->fw_val, f->fw_cap * sizeof (void *));
+	rm_buf(f->fw_layer, f->fw_cap);
+}
+
+static void
+fwd_resize(cow_fwd_t *f, uint64_t cap)
+{
+	cow_fwd_t o = *f;
+	fwd_alloc(f, cap);
+	uint64_t i = 0;
+	while (i < o.fw_cap) {
+		if (o.fw_key[i] != NULL) {
+			uint64_t j = fwd_find(f, o.fw_key[i]);
+			f->fw_key[j] = o.fw_key[i];
+			f->fw_val[j] = o.fw_val[i];
+			f->fw_layer[j] = o.fw_layer[i];
+		}
+		i++;
+	}
+	fwd_free(&o);
+}
+
+/*
+ * The number of references to node `n` of layer `layer`, beyond the first.
+ */
+static uint32_t *
+cow_refs(void *n, int layer)
+{
+	if (layer == 0) {
+		return (&((slab_t *)n)->s_refs);
+	}
+	return (&((subslab_t *)n)->ss_refs);
+}
+
+/*
+ * Drops a reference to node `n` of layer `layer`. If that was the last one, `n`
+ * is freed, along with the children that it held the last references to, and
+ * `cb` is called on the elements of the slabs that are freed, if it's not NULL.
+ * A parent holds a reference to the child that it points at, and not to the
+ * copy that the child may be forwarded to, so the children of `n` are
+ * unreferenced as they are, rather than through LNK().
+ */
+static void
+cow_unref(void *n, int layer, slablist_rem_cb_t cb)
+{
+	uint32_t *r = cow_refs(n, layer);
+	if (*r > 0) {
+		(*r)--;
+		return;
+	}
+	if (layer == 0) {
+		slab_t *s = n;
+		int j = 0;
+		while (cb != NULL && j < s->s_elems) {
+			cb(SLAB_ELEM(s, j));
+			j++;
+		}
+		if (SLAB_IS_COLD(s)) {
+			rm_buf(s, COLD_SLAB_BYTES(s->s_elems, s->s_bits));
+		} else {
+			rm_slab(s, SLIST_SLAB_BYTES(LNK(s->s_list)));
+		}
+		return;
+	}
+	subslab_t *ss = n;
+	int j = 0;
+	while (j < ss->ss_elems) {
+		cow_unref(SUBSLAB_ELEMS(ss)[j], layer - 1, cb);
+		j++;
+	}
+	rm_subslab_arr(ss);
+}
+
+/*
+ * Makes `sl` forward `key`, a node of layer `layer`, to `val`. The map holds a
+ * reference to `key`, so that it stays around for as long as the entry does.
+ * If `key` is already forwarded, it's just forwarded to `val` instead.
+ */
+static void
+fwd_put(slablist_t *sl, void *key, void *val, int layer)
+{
+	cow_fwd_t *f = sl->sl_fwd;
+	if (f == NULL) {
+		f = mk_zbuf(sizeof (cow_fwd_t));
+		fwd_alloc(f, FWD_MIN);
+		sl->sl_fwd = f;
+		(void) __atomic_add_fetch(&cow_nfwd, 1, __ATOMIC_RELAXED);
+	} else if ((f->fw_n + 1) * 4 > f->fw_cap * 3) {
+		fwd_prune(sl);
+		f = sl->sl_fwd;
+		if (f == NULL) {
+			fwd_put(sl, key, val, layer);
+			return;
+		}
+		if ((f->fw_n + 1) * 4 > f->fw_cap * 3) {
+			fwd_resize(f, f->fw_cap * 2);
+		}
+	}
+	uint64_t i = fwd_find(f, key);
+	if (f->fw_key[i] == NULL) {
+		f->fw_key[i] = key;
+		f->fw_layer[i] = layer;
+		f->fw_n++;
+		(*cow_refs(key, layer))++;
+	}
+	f->fw_val[i] = val;
+	if (layer == 0) {
+		((slab_t *)val)->s_fwd = 1;
+	} else {
+		((subslab_t *)val)->ss_fwd = 1;
+	}
+}
+
+/*
+ * Takes the entry in slot `i` out of the map of `sl`, and drops its reference
+ * to the node that it forwards. Entries that come after it in the same run of
+ * slots are shifted back, so that lookups still find them.
+ */
+static void
+fwd_del(slablist_t *sl, uint64_t i)
+{
+	cow_fwd_t *f = sl->sl_fwd;
+	void *key = f->fw_key[i];
+	int layer = f->fw_layer[i];
+	uint64_t m = f->fw_cap - 1;
+	uint64_t j = i;
+	for (;;) {
+		j = (j + 1) & m;
+		if (f->fw_key[j] == NULL) {
+			break;
+		}
+		uint64_t h = fwd_slot(f, f->fw_key[j]);
+		if (((j - h) & m) >= ((j - i) & m)) {
+			f->fw_key[i] = f->fw_key[j];
+			f->fw_val[i] = f->fw_val[j];
+			f->fw_layer[i] = f->fw_layer[j];
+			i = j;
+		}
+	}
+	f->fw_key[i] = NULL;
+	f->fw_val[i] = NULL;
+	f->fw_n--;
+	if (f->fw_n == 0) {
+		fwd_free(f);
+		rm_buf(f, sizeof (cow_fwd_t));
+		sl->sl_fwd = NULL;
+		(void) __atomic_sub_fetch(&cow_nfwd, 1, __ATOMIC_RELAXED);
+	}
+	cow_unref(key, layer, NULL);
+}
+
+/*
+ * Empties the map of `sl`.
+ */
+static void
+fwd_clear(slablist_t *sl)
+{
+	uint64_t i = 0;
+	while (sl->sl_fwd != NULL) {
+		cow_fwd_t *f = sl->sl_fwd;
+		if (f->fw_key[i] == NULL) {
+			i = (i + 1) & (f->fw_cap - 1);
+			continue;
+		}
+		/*
+		 * The deletion may shift a later entry into slot `i`.
+		 */
+		fwd_del(sl, i);
+	}
+}
+
+/*
+ * Makes the entries of the map of `sl` that forward to `o` forward to `n`
+ * instead, since `n` has taken the place of `o`.
+ */
+void
+cow_moved(slablist_t *sl, void *o, void *n)
+{
+	cow_fwd_t *f = sl->sl_fwd;
+	uint64_t i = 0;
+	while (f != NULL && i < f->fw_cap) {
+		if (f->fw_key[i] != NULL && f->fw_val[i] == o) {
+			f->fw_val[i] = n;
+		}
+		i++;
+	}
+}
+
+/*
+ * Drops the entries of the map of `sl` that forward to `n`, which is leaving
+ * the list.
+ */
+void
+cow_freed(slablist_t *sl, void *n)
+{
+	uint64_t i = 0;
+	while (sl->sl_fwd != NULL && i < sl->sl_fwd->fw_cap) {
+		if (sl->sl_fwd->fw_key[i] != NULL &&
+		    sl->sl_fwd->fw_val[i] == n) {
+			/*
+			 * The deletion may shift a later entry into slot `i`.
+			 */
+			fwd_del(sl, i);
+			continue;
+		}
+		i++;
+	}
+}
+
+static void *
+cow_next(void *n, int layer)
+{
+	if (layer == 0) {
+		return (LNK(((slab_t *)n)->s_next));
+	}
+	return (LNK(((subslab_t *)n)->ss_next));
+}
+
+static void *
+cow_prev(void *n, int layer)
+{
+	if (layer == 0) {
+		return (LNK(((slab_t *)n)->s_prev));
+	}
+	return (LNK(((subslab_t *)n)->ss_prev));
+}
+
+/*
+ * The readers of an MVCC list's versions can be following a link while
+ * cow_relink() points it elsewhere, so links are stored in one go.
+ */
+static void
+cow_set_next(void *n, void *x, int layer)
+{
+	if (layer == 0) {
+		__atomic_store_n(&((slab_t *)n)->s_next, MKLNK((slab_t *)x),
+		    __ATOMIC_RELAXED);
+	} else {
+		__atomic_store_n(&((subslab_t *)n)->ss_next,
+		    MKLNK((subslab_t *)x), __ATOMIC_RELAXED);
+	}
+}
+
+static void
+cow_set_prev(void *n, void *x, int layer)
+{
+	if (layer == 0) {
+		__atomic_store_n(&((slab_t *)n)->s_prev, MKLNK((slab_t *)x),
+		    __ATOMIC_RELAXED);
+	} else {
+		__atomic_store_n(&((subslab_t *)n)->ss_prev,
+		    MKLNK((subslab_t *)x), __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * Drops the entries of the map of `sl` that nothing uses anymore. Only the
+ * nodes on either side of a copy (and the head and end of its layer) can link
+ * to the original, and once those have been copied too, their links point at
+ * the copy itself. The map only ever grows when it's full, and we call this
+ * first, so the map stays about as big as the number of links that still need
+ * forwarding, rather than the number of nodes that were ever copied.
+ */
+static void
+fwd_prune(slablist_t *sl)
+{
+	slablist_t *lays[SL_REQ_MAX + 1];
+	slablist_t *lay = sl;
+	while (lay != NULL) {
+		lays[lay->sl_layer] = lay;
+		lay = LNK(lay->sl_sublayer);
+	}
+	slablist_t *held = cow_enter(sl);
+	uint64_t i = 0;
+	while (sl->sl_fwd != NULL && i < sl->sl_fwd->fw_cap) {
+		cow_fwd_t *f = sl->sl_fwd;
+		void *k = f->fw_key[i];
+		if (k == NULL) {
+			i++;
+			continue;
+		}
+		void *v = f->fw_val[i];
+		int layer = f->fw_layer[i];
+		lay = lays[layer];
+		void *p = cow_prev(v, layer);
+		void *n = cow_next(v, layer);
+		void *pr = p == NULL ? lay->sl_head : layer == 0 ?
+		    (void *)((slab_t *)p)->s_next :
+		    (void *)((subslab_t *)p)->ss_next;
+		void *nr = n == NULL ? lay->sl_end : layer == 0 ?
+		    (void *)((slab_t *)n)->s_prev :
+		    (void *)((subslab_t *)n)->ss_prev;
+		if (pr == k || nr == k) {
+			i++;
+			continue;
+		}
+		/*
+		 * The deletion may shift a later entry into slot `i`.
+		 */
+		fwd_del(sl, i);
+	}
+	cow_exit(held);
+}
+
+/*
+ * Makes node `n` of layer `layer` private to the handle `sl`, whose slablist_t
+ * for that layer is `lay`. The parent of `n` is the private subslab `p`, in
+ * which `n` is at index `i`, or NULL if `n` is in the baselayer. If `n` is
+ * shared, it's copied, and the copy takes its place in `p`. Returns the
+ * private node.
+ */
+static void *
+cow_own_node(slablist_t *sl, slablist_t *lay, void *n, int layer,
+    subslab_t *p, int i)
+{
+	void *c = n;
+	if (*cow_refs(n, layer) > 0) {
+		if (layer == 0) {
+			slab_t *s = n;
+			size_t sz = SLIST_SLAB_BYTES(lay);
+			if (SLAB_IS_COLD(s)) {
+				sz = COLD_SLAB_BYTES(s->s_elems, s->s_bits);
+				c = mk_buf(sz);
+			} else {
+				c = mk_slab(sz);
+			}
+			bcopy(s, c, sz);
+			((slab_t *)c)->s_refs = 0;
+		} else {
+			subslab_t *ss = n;
+			subslab_t *cs = mk_subslab_arr();
+			subarr_t *sa = LNK(cs->ss_arr);
+			bcopy(ss, cs, sizeof (subslab_t));
+			cs->ss_arr = MKLNK(sa);
+			cs->ss_refs = 0;
+			int j = 0;
+			while (j < ss->ss_elems) {
+				sa->sa_data[j] = SUBSLAB_ELEMS(ss)[j];
+				(*cow_refs(sa->sa_data[j], layer - 1))++;
+				j++;
+			}
+			c = cs;
+			sl->sl_cow->cw_stale = 1;
+		}
+		(*cow_refs(n, layer))--;
+		/*
+		 * The copy keeps the s_fwd (ss_fwd) of `n`, since the entries
+		 * of our map that forward to `n` now forward to it.
+		 */
+		if (layer == 0 ? ((slab_t *)n)->s_fwd :
+		    ((subslab_t *)n)->ss_fwd) {
+			cow_moved(sl, n, c);
+		}
+	}
+	if (layer == 0) {
+		((slab_t *)c)->s_list = MKLNK(lay);
+		((slab_t *)c)->s_below = MKLNK(p);
+	} else {
+		((subslab_t *)c)->ss_list = MKLNK(lay);
+		((subslab_t *)c)->ss_below = MKLNK(p);
+	}
+	if (p != NULL) {
+		SET_SUBSLAB_ELEM(p, c, i);
+	}
+	return (c);
+}
+
+/*
+ * The nodes of one layer that cow_own() is making private, in list order,
+ * along with their parents and their indices in those parents. A node that
+ * isn't shared can still be seen by other handles, if its parent is shared,
+ * so the nodes on either side of the run can only be written to in place if
+ * their parents are private too (`cr_lown`, `cr_rown`).
+ */
+typedef struct cow_run {
+	uint64_t		cr_n;
+	uint64_t		cr_cap;
+	void			**cr_nd;
+	subslab_t		**cr_par;
+	int			*cr_slot;
+	uint8_t			cr_lown;	/* left neighbour is ours */
+	uint8_t			cr_rown;	/* right neighbour is ours */
+} cow_run_t;
+
+static void
+run_free(cow_run_t *r)
+{
+	if (r->cr_cap > 0) {
+		rm_buf(r->cr_nd, r->cr_cap * sizeof (void *));
+		rm_buf(r->cr_par, r->cr_cap * sizeof (subslab_t *));
+		rm_buf(r->cr_slot, r->cr_cap * sizeof (int));
+	}
+	bzero(r, sizeof (cow_run_t));
+}
+
+static void
+run_push(cow_run_t *r, void *n, subslab_t *p, int i)
+{
+	if (r->cr_n == r->cr_cap) {
+		cow_run_t o = *r;
+		r->cr_cap = o.cr_cap == 0 ? FWD_MIN : o.cr_cap * 2;
+		r->cr_nd = mk_buf(r->cr_cap * sizeof (void *));
+		r->cr_par = mk_buf(r->cr_cap * sizeof (subslab_t *));
+		r->cr_slot = mk_buf(r->cr_cap * sizeof (int));
+		if (o.cr_n > 0) {
+			bcopy(o.cr_nd, r->cr_nd, o.cr_n * sizeof (void *));
+			bcopy(o.cr_par, r->cr_par,
+			    o.cr_n * sizeof (subslab_t *));
+			bcopy(o.cr_slot, r->cr_slot, o.cr_n * sizeof (int));
+		}
+		run_free(&o);
+	}
+	r->cr_nd[r->cr_n] = n;
+	r->cr_par[r->cr_n] = p;
+	r->cr_slot[r->cr_n] = i;
+	r->cr_n++;
+}
+
+/*
+ * Keeps only the `n` nodes of `r` that start at index `a`. The nodes that
+ * were cut off have private parents, so if there are any on one side, the
+ * neighbour on that side is ours.
+ */
+static void
+run_trim(cow_run_t *r, uint64_t a, uint64_t n)
+{
+	r->cr_lown = a > 0;
+	r->cr_rown = a + n < r->cr_n;
+	uint64_t i = 0;
+	while (i < n) {
+		r->cr_nd[i] = r->cr_nd[a + i];
+		r->cr_par[i] = r->cr_par[a + i];
+		r->cr_slot[i] = r->cr_slot[a + i];
+		i++;
+	}
+	r->cr_n = n;
+}
+
+/*
+ * The number of nodes on either side of the path to an element that a
+ * modification can write to, in layer `layer`. Removing a slab from a subslab
+ * can merge that subslab into one of its neighbours, and unlink it, which
+ * writes to the neighbour of that neighbour. A slab that gets an element
+ * added or removed can spill into, or merge with, the slab next to it, which
+ * only ever reaches two slabs away.
+ */
+#define	COW_REACH(layer)	((layer) == 0 ? 2 : 3)
+
+/*
+ * Makes the private node `c` of layer `layer` the neighbour of `nb`, which is
+ * on its left (or, if `right`, on its right). If `nb` is NULL, `c` is at the
+ * head (or end) of `lay`. If `nb` is shared, or might be seen by other
+ * handles (unless `own`), it keeps pointing at the node that `c` replaced,
+ * and `sl` forwards that node to `c`.
+ */
+static void
+cow_link(slablist_t *sl, slablist_t *lay, void *nb, void *c, int layer,
+    int right, int own)
+{
+	if (nb == NULL) {
+		if (right) {
+			lay->sl_end = MKLNK(c);
+		} else {
+			lay->sl_head = MKLNK(c);
+		}
+		return;
+	}
+	if (own && *cow_refs(nb, layer) == 0) {
+		if (right) {
+			cow_set_prev(nb, c, layer);
+		} else {
+			cow_set_next(nb, c, layer);
+		}
+		return;
+	}
+	void *raw;
+	if (layer == 0) {
+		slab_t *s = nb;
+		raw = right ? s->s_prev : s->s_next;
+	} else {
+		subslab_t *ss = nb;
+		raw = right ? ss->ss_prev : ss->ss_next;
+	}
+	if (LNK(raw) != c) {
+		fwd_put(sl, raw, c, layer);
+	}
+}
+
+/*
+ * Makes every node in the run `r` of layer `layer` private to `sl`, whose
+ * slablist_t for that layer is `lay`, and links the copies up with each other
+ * and with the nodes on either side of the run. Returns the number of nodes
+ * that had to be copied.
+ */
+static uint64_t
+cow_own_run(slablist_t *sl, slablist_t *lay, int layer, cow_run_t *r)
+{
+	uint64_t n = r->cr_n;
+	if (n == 0) {
+		return (0);
+	}
+	void *l = cow_prev(r->cr_nd[0], layer);
+	void *rt = cow_next(r->cr_nd[n - 1], layer);
+	uint64_t copies = 0;
+	uint64_t i = 0;
+	while (i < n) {
+		void *c = cow_own_node(sl, lay, r->cr_nd[i], layer,
+		    r->cr_par[i], r->cr_slot[i]);
+		if (c != r->cr_nd[i]) {
+			copies++;
+		}
+		r->cr_nd[i] = c;
+		i++;
+	}
+	i = 0;
+	while (i < n) {
+		cow_set_prev(r->cr_nd[i], i == 0 ? l : r->cr_nd[i - 1], layer);
+		cow_set_next(r->cr_nd[i], i == n - 1 ? rt : r->cr_nd[i + 1],
+		    layer);
+		i++;
+	}
+	cow_link(sl, lay, l, r->cr_nd[0], layer, 0, r->cr_lown);
+	cow_link(sl, lay, rt, r->cr_nd[n - 1], layer, 1, r->cr_rown);
+	return (copies);
+}
+
+/*
+ * Returns the index of the child of `p` (a subslab of layer `layer`) that the
+ * search for `e` goes down to.
+ */
+static int
+cow_child(subslab_t *p, int layer, slablist_elem_t e)
+{
+	int x = layer == 1 ? subslab_bin_srch_top(e, p) :
+	    subslab_bin_srch(e, p);
+	if (x > p->ss_elems - 1) {
+		x = p->ss_elems - 1;
+	}
+	return (x);
+}
+
+/*
+ * Makes the nodes of the baselayer of `sl` that cow_own() needs into the run
+ * `r`, and returns the indices of the paths to `lo` and `hi` in `pl` and `ph`.
+ */
+static void
+cow_roots(slablist_t *sl, slablist_t *ly, int top, int how,
+    slablist_elem_t lo, slablist_elem_t hi, cow_run_t *r, uint64_t *pl,
+    uint64_t *ph)
+{
+	void *n = LNK(ly->sl_head);
+	if (how == COW_ALL) {
+		while (n != NULL) {
+			run_push(r, n, NULL, 0);
+			n = cow_next(n, top);
+		}
+		*pl = 0;
+		*ph = r->cr_n - 1;
+		return;
+	}
+
+	void *a;
+	void *b;
+	if (how == COW_RANGE && top > 0) {
+		subslab_t *ss;
+		(void) sub_find_linear_scan(ly, lo, &ss);
+		a = ss;
+		(void) sub_find_linear_scan(ly, hi, &ss);
+		b = ss;
+	} else if (how == COW_RANGE) {
+		slab_t *s;
+		(void) find_linear_scan(sl, lo, &s);
+		a = s;
+		(void) find_linear_scan(sl, hi, &s);
+		b = s;
+	} else {
+		uint64_t off;
+		a = how == COW_POS ? slab_get_elem_pos(sl, lo.sle_u, &off) :
+		    NULL;
+		if (a == NULL) {
+			a = LNK(sl->sl_end);
+		}
+		b = a;
+	}
+
+	int m = COW_REACH(top);
+	int k = 0;
+	n = a;
+	while (k < m && cow_prev(n, top) != NULL) {
+		n = cow_prev(n, top);
+		k++;
+	}
+	*pl = k;
+	*ph = k;
+	int after = -1;
+	while (n != NULL && after < m) {
+		run_push(r, n, NULL, 0);
+		if (after >= 0) {
+			after++;
+		} else if (n == b && r->cr_n > *pl) {
+			*ph = r->cr_n - 1;
+			after = 0;
+		}
+		n = cow_next(n, top);
+	}
+}
+
+/*
+ * Makes sure that every node of `sl` that a modification can write to is
+ * private to `sl`, by copying the shared ones, along with the paths down to
+ * them. `how` says what the modification is going to touch: the elements in
+ * the range [`lo`, `hi`] (COW_RANGE), the element at position `lo` (COW_POS),
+ * the end of the list (COW_END), or everything (COW_ALL). Every function that
+ * modifies a cloned list calls this first. Lists that were never cloned are
+ * left alone.
+ */
+void
+cow_own(slablist_t *sl, int how, slablist_elem_t lo, slablist_elem_t hi)
+{
+	slablist_cow_t *cw = sl->sl_cow;
+	if (cw == NULL) {
+		return;
+	}
+	/*
+	 * The nodes that we are about to write to are going to point back at
+	 * `sl`.
+	 */
+	sl->sl_home = 1;
+	if (IS_SMALL_LIST(sl) || (cw->cw_refs == 1 && sl->sl_fwd == NULL)) {
+		return;
+	}
+	int top = sl->sl_sublayers;
+	if ((how == COW_RANGE && SLIST_ORDERED(sl->sl_flags)) ||
+	    (how != COW_RANGE && top > 0)) {
+		how = COW_ALL;
+	}
+	if (how == COW_RANGE && SL_CMPF(sl)(lo, hi) > 0) {
+		hi = lo;
+	}
+	slablist_t *held = cow_enter(sl);
+	slablist_t *ly = top > 0 ? LNK(sl->sl_baselayer) : sl;
+	cow_run_t run;
+	bzero(&run, sizeof (cow_run_t));
+	/*
+	 * The references to the nodes of the baselayer are the handles' own,
+	 * so the ones that aren't shared are ours.
+	 */
+	run.cr_lown = 1;
+	run.cr_rown = 1;
+	uint64_t pl;
+	uint64_t ph;
+	cow_roots(sl, ly, top, how, lo, hi, &run, &pl, &ph);
+	uint64_t copies = cow_own_run(sl, ly, top, &run);
+
+	int layer = top;
+	while (layer > 0) {
+		cow_run_t kids;
+		bzero(&kids, sizeof (cow_run_t));
+		uint64_t npl = 0;
+		uint64_t nph = 0;
+		uint64_t j = 0;
+		while (j < run.cr_n) {
+			subslab_t *p = run.cr_nd[j];
+			if (j == pl) {
+				npl = kids.cr_n + cow_child(p, layer, lo);
+			}
+			if (j == ph) {
+				nph = kids.cr_n + cow_child(p, layer, hi);
+			}
+			int x = 0;
+			while (x < p->ss_elems) {
+				run_push(&kids, GET_SUBSLAB_ELEM(p, x), p, x);
+				x++;
+			}
+			j++;
+		}
+		layer--;
+		if (how != COW_ALL) {
+			uint64_t m = COW_REACH(layer);
+			uint64_t a = npl > m ? npl - m : 0;
+			uint64_t b = nph + m < kids.cr_n ? nph + m :
+			    kids.cr_n - 1;
+			run_trim(&kids, a, b - a + 1);
+			pl = npl - a;
+			ph = nph - a;
+		}
+		ly = LNK(ly->sl_superlayer);
+		copies += cow_own_run(sl, ly, layer, &kids);
+		run_free(&run);
+		run = kids;
+	}
+	run_free(&run);
+
+	if (how == COW_ALL) {
+		fwd_clear(sl);
+	}
+	if (copies > 0) {
+		sl->sl_last = NULL;
+		sl->sl_base_gen++;
+		SLABLIST_COW_BREAK(sl);
+	}
+	if (SLABLIST_TEST_CLONE_ENABLED()) {
+		SLABLIST_TEST_CLONE(test_clone(sl));
+	}
+	cow_exit(held);
+}
+
+/*
+ * Makes every node of `sl` private, for modifications that can touch all of
+ * them.
+ */
+void
+cow_own_all(slablist_t *sl)
+{
+	slablist_elem_t z;
+	z.sle_u = 0;
+	cow_own(sl, COW_ALL, z, z);
+}
+
+/*
+ * Frees the slablist_t of `sl`, and those of its sublayers, including the ones
+ * that it detached.
+ */
+static void
+cow_free_handle(slablist_t *sl)
+{
+	slablist_t *sub = LNK(sl->sl_sublayer);
+	slablist_t *next;
+	while (sub != NULL) {
+		next = LNK(sub->sl_sublayer);
+		rm_slablist(sub);
+		sub = next;
+	}
+	sub = sl->sl_retired;
+	while (sub != NULL) {
+		next = sub->sl_retired;
+		rm_slablist(sub);
+		sub = next;
+	}
+	if (sl->sl_name_alloc) {
+		rm_buf(sl->sl_name, strlen(sl->sl_name) + 1);
+	}
+	rm_slablist(sl);
+}
+
+/*
+ * Points the nodes that `sl` forwards from at the nodes that they are forwarded
+ * to, and drops the map. The nodes may still be shared, as long as every
+ * other handle that sees them forwards them the same way, since those handles
+ * then get to the same nodes before and after.
+ */
+static void
+cow_relink(slablist_t *sl)
+{
+	cow_fwd_t *f = sl->sl_fwd;
+	slablist_t *held = cow_enter(sl);
+	uint64_t i = 0;
+	while (f != NULL && i < f->fw_cap) {
+		if (f->fw_key[i] != NULL) {
+			void *t = f->fw_val[i];
+			int layer = f->fw_layer[i];
+			void *p = cow_prev(t, layer);
+			void *n = cow_next(t, layer);
+			if (p != NULL) {
+				cow_set_next(p, t, layer);
+			}
+			if (n != NULL) {
+				cow_set_prev(n, t, layer);
+			}
+		}
+		i++;
+	}
+	cow_exit(held);
+	fwd_clear(sl);
+}
+
+/*
+ * Called once `sl` is the only handle left in its family. None of its nodes
+ * are shared anymore, so the nodes that it forwards from can be pointed at
+ * the nodes that they are forwarded to, and the map can go. The children of
+ * subslabs that were copied are pointed at their parents.
+ */
+static void
+cow_settle(slablist_t *sl)
+{
+	cow_relink(sl);
+	slablist_t *held = cow_enter(sl);
+	slablist_t *lay = LNK(sl->sl_sublayer);
+	while (sl->sl_cow->cw_stale && lay != NULL) {
+		subslab_t *ss = LNK(lay->sl_head);
+		while (ss != NULL) {
+			int j = 0;
+			while (j < ss->ss_elems) {
+				void *c = GET_SUBSLAB_ELEM(ss, j);
+				if (lay->sl_layer == 1) {
+					((slab_t *)c)->s_below = MKLNK(ss);
+				} else {
+					((subslab_t *)c)->ss_below = MKLNK(ss);
+				}
+				j++;
+			}
+			ss = LNK(ss->ss_next);
+		}
+		lay = LNK(lay->sl_sublayer);
+	}
+	sl->sl_cow->cw_stale = 0;
+	cow_exit(held);
+}
+
+/*
+ * Takes `sl` out of its family, when it gets destroyed. Its nodes lose a
+ * reference, and the ones that no other handle uses are freed, with `cb`
+ * called on their elements. If other nodes still point back at `sl`, it
+ * sticks around until the rest of the family is gone.
+ */
+static void
+cow_leave(slablist_t *sl, slablist_rem_cb_t cb)
+{
+	slablist_cow_t *cw = sl->sl_cow;
+	slablist_t *held = cow_enter(sl);
+	if (IS_SMALL_LIST(sl)) {
+		small_list_t *sml = LNK(sl->sl_head);
+		small_list_t *smln;
+		uint64_t i = 0;
+		while (i < sl->sl_elems) {
+			smln = LNK(sml->sml_next);
+			if (cb != NULL) {
+				cb(sml->sml_data);
+			}
+			rm_sml_node(sml);
+			sml = smln;
+			i++;
+		}
+	} else {
+		int top = sl->sl_sublayers;
+		slablist_t *ly = top > 0 ? LNK(sl->sl_baselayer) : sl;
+		cow_run_t run;
+		bzero(&run, sizeof (cow_run_t));
+		void *n = LNK(ly->sl_head);
+		while (n != NULL) {
+			run_push(&run, n, NULL, 0);
+			n = cow_next(n, top);
+		}
+		fwd_clear(sl);
+		uint64_t i = 0;
+		while (i < run.cr_n) {
+			cow_unref(run.cr_nd[i], top, cb);
+			i++;
+		}
+		run_free(&run);
+	}
+	cow_exit(held);
+	rm_spares(sl);
+
+	slablist_t **pp = &cw->cw_live;
+	while (*pp != sl) {
+		pp = &(*pp)->sl_cow_next;
+	}
+	*pp = sl->sl_cow_next;
+	cw->cw_refs--;
+	if (cw->cw_refs == 0) {
+		cow_free_handle(sl);
+		while (cw->cw_gone != NULL) {
+			slablist_t *g = cw->cw_gone;
+			cw->cw_gone = g->sl_cow_next;
+			cow_free_handle(g);
+		}
+		rm_buf(cw, sizeof (slablist_cow_t));
+		return;
+	}
+	if (sl->sl_home) {
+		sl->sl_cow_next = cw->cw_gone;
+		cw->cw_gone = sl;
+	} else {
+		cow_free_handle(sl);
+	}
+	if (cw->cw_refs == 1) {
+		cow_settle(cw->cw_live);
+	}
+}
+
+/*
+ * Frees the nodes of the baselayer `sub` of a cloned list, which is being
+ * detached, and hands the references that they held to their children, which
+ * are the new baselayer. Nodes that other handles still use stay around.
+ */
+void
+cow_drop_layer(slablist_t *sub)
+{
+	slablist_t *o = spare_owner(sub);
+	subslab_t *ss = LNK(sub->sl_head);
+	subslab_t *ssn;
+	uint64_t i = 0;
+	while (i < sub->sl_slabs) {
+		ssn = LNK(ss->ss_next);
+		if (ss->ss_fwd) {
+			cow_freed(o, ss);
+		}
+		if (ss->ss_refs > 0) {
+			ss->ss_refs--;
+			int j = 0;
+			while (j < ss->ss_elems) {
+				(*cow_refs(GET_SUBSLAB_ELEM(ss, j),
+				    sub->sl_layer - 1))++;
+				j++;
+			}
+		} else {
+			rm_subslab_arr(ss);
+		}
+		ss = ssn;
+		i++;
+	}
+}
+
+/*
+ * Returns a new handle to `sl`, which shares all of the slabs and subslabs of
+ * `sl`. Only the baselayer gets a reference from the clone, so a clone costs
+ * as much as walking the baselayer, which is just the slabs, for lists that
+ * are ordered, or that have no sublayers. The clone can be used like any
+ * other list. A write through any handle only copies the few nodes that it
+ * touches (and the path that leads to them), so none of the other handles
+ * ever see the change, and the handles only ever use as much more memory as
+ * they have nodes that differ. The clone is destroyed with slablist_destroy(),
+ * which only calls its callback on the elements that no other handle still
+ * shares.
+ *
+ * The clone is named after `sl`, and doesn't inherit its write-ahead log.
+ * Mapped and shared lists can't be cloned, and neither can the versions of
+ * MVCC lists, which only the writer may add handles to.
+ */
+slablist_t *
+slablist_clone(slablist_t *sl)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SHM_LIST(sl) || IS_MVCC_VER(sl)) {
+		return (NULL);
+	}
+	slablist_t *held = cow_enter(sl);
+	slablist_cow_t *cw = sl->sl_cow;
+	if (cw == NULL) {
+		cw = mk_zbuf(sizeof (slablist_cow_t));
+		cw->cw_refs = 1;
+		cw->cw_live = sl;
+		sl->sl_cow = cw;
+	}
+	sl->sl_home = 1;
+	slablist_t *c = mk_slablist();
+	bcopy(sl, c, sizeof (slablist_t));
+	if (sl->sl_name != NULL) {
+		c->sl_name = mk_buf(strlen(sl->sl_name) + 1);
+		(void) strcpy(c->sl_name, sl->sl_name);
+		c->sl_name_alloc = 1;
+	}
+	c->sl_spare_slabs = NULL;
+	c->sl_spare_subslabs = NULL;
+	c->sl_nspare_slabs = 0;
+	c->sl_nspare_subslabs = 0;
+	c->sl_log = NULL;
+	c->sl_mvcc = NULL;
+	if (c->sl_bloom != NULL) {
+		c->sl_bloom->bf_refs++;
+	}
+	c->sl_rix = NULL;
+	c->sl_last = NULL;
+	c->sl_last_hits = 0;
+	c->sl_last_misses = 0;
+	c->sl_home = 0;
+	c->sl_retired = NULL;
+	c->sl_fwd = NULL;
+	c->sl_cow_next = cw->cw_live;
+	cw->cw_live = c;
+	cw->cw_refs++;
+
+	if (IS_SMALL_LIST(sl)) {
+		small_list_t *o = LNK(sl->sl_head);
+		small_list_t *p = NULL;
+		c->sl_head = NULL;
+		uint64_t i = 0;
+		while (i < sl->sl_elems) {
+			small_list_t *n = mk_sml_node();
+			n->sml_data = o->sml_data;
+			n->sml_next = NULL;
+			if (p == NULL) {
+				c->sl_head = MKLNK(n);
+			} else {
+				p->sml_next = MKLNK(n);
+			}
+			p = n;
+			o = LNK(o->sml_next);
+			i++;
+		}
+		if (LNK(sl->sl_end) != NULL) {
+			c->sl_end = MKLNK(p);
+		}
+		SLABLIST_CLONE(sl, c);
+		cow_exit(held);
+		return (c);
+	}
+
+	/*
+	 * The clone gets its own slablist_t for each sublayer, and a reference
+	 * to every node of the baselayer.
+	 */
+	slablist_t *sup = c;
+	slablist_t *osub = LNK(sl->sl_sublayer);
+	while (osub != NULL) {
+		slablist_t *nsub = mk_slablist();
+		bcopy(osub, nsub, sizeof (slablist_t));
+		nsub->sl_superlayer = MKLNK(sup);
+		sup->sl_sublayer = MKLNK(nsub);
+		sup = nsub;
+		osub = LNK(osub->sl_sublayer);
+	}
+	slablist_t *lay = c;
+	while (lay != NULL) {
+		if (LNK(lay->sl_baselayer) != NULL) {
+			lay->sl_baselayer = MKLNK(sup);
+		}
+		lay = LNK(lay->sl_sublayer);
+	}
+	int top = sl->sl_sublayers;
+	slablist_t *ly = top > 0 ? LNK(sl->sl_baselayer) : sl;
+	void *n = LNK(ly->sl_head);
+	while (n != NULL) {
+		(*cow_refs(n, top))++;
+		n = cow_next(n, top);
+	}
+
+	/*
+	 * The clone sees what `sl` sees, so it forwards what `sl` forwards.
+	 */
+	cow_fwd_t *f = sl->sl_fwd;
+	if (f != NULL) {
+		cow_fwd_t *cf = mk_zbuf(sizeof (cow_fwd_t));
+		fwd_alloc(cf, f->fw_cap);
+		bcopy(f->fw_key, cf->fw_key, f->fw_cap * sizeof (void *));
+		bcopy(f->fw_val, cf->fw_val, f->fw_cap * sizeof (void *));
+		bcopy(f->fw_layer, cf->fw_layer, f->fw_cap);
+		cf->fw_n = f->fw_n;
+		uint64_t i = 0;
+		while (i < f->fw_cap) {
+			if (f->fw_key[i] != NULL) {
+				(*cow_refs(f->fw_key[i], f->fw_layer[i]))++;
+			}
+			i++;
+		}
+		c->sl_fwd = cf;
+		(void) __atomic_add_fetch(&cow_nfwd, 1, __ATOMIC_RELAXED);
+	}
+	SLABLIST_CLONE(sl, c);
+	cow_exit(held);
+	return (c);
+}
+
+/*
+ * Versioned Lists
+ *
+ * These functions put a list into MVCC mode, and let readers in other threads
+ * pin and unpin versions of it. See slablist_mvcc_t in slablist_impl.h.
+ *
+ * slablist_add(), slablist_rem(), and slablist_rem_range() take the lock of
+ * a list in MVCC mode, if the calling thread doesn't already hold it, and
+ * publish a new version when they are done. Any other modification (sorting,
+ * reversing, mapping, reaping, compressing, checkpointing) has to be
+ * bracketed by slablist_mvcc_lock() and slablist_mvcc_unlock(), and is
+ * published by the latter. A thread can hold the lock of only one list at a
+ * time. Only the writer may use the list itself; readers only ever use the
+ * versions that they have pinned.
+ */
+
+static __thread slablist_mvcc_t *mvcc_held;
+
+/*
+ * Takes the lock of `sl`, if it's in MVCC mode and the calling thread doesn't
+ * already hold it. Returns 1 if the lock was taken, so that mvcc_exit() knows
+ * to publish `sl` and drop the lock.
+ */
+int
+mvcc_enter(slablist_t *sl)
+{
+	slablist_mvcc_t *mv = sl->sl_mvcc;
+	if (mv == NULL || mvcc_held == mv) {
+		return (0);
+	}
+	(void) pthread_mutex_lock(&mv->mv_lock);
+	mvcc_held = mv;
+	return (1);
+}
+
+/*
+ * Frees the version `vr`, which no one has pinned anymore.
+ */
+static void
+ver_free(slablist_ver_t *vr)
+{
+	slablist_destroy(vr->vr_list, NULL);
+	rm_buf(vr, sizeof (slablist_ver_t));
+}
+
+/*
+ * Frees the versions that readers have given back since we last looked.
+ */
+static void
+ver_reap(slablist_mvcc_t *mv)
+{
+	slablist_ver_t *vr = __atomic_exchange_n(&mv->mv_dead, NULL,
+	    __ATOMIC_ACQUIRE);
+	while (vr != NULL) {
+		slablist_ver_t *next = vr->vr_next;
+		ver_free(vr);
+		vr = next;
+	}
+}
+
+/*
+ * Makes `sl`, as it is now, the current version of itself. The version that
+ * it replaces is freed, unless readers still pin it, in which case the last
+ * of them hands it back to us (see slablist_unpin()).
+ */
+static void
+mvcc_publish(slablist_t *sl)
+{
+	slablist_mvcc_t *mv = sl->sl_mvcc;
+	slablist_ver_t *vr = mk_zbuf(sizeof (slablist_ver_t));
+	vr->vr_list = slablist_clone(sl);
+	vr->vr_list->sl_ver = vr;
+	uint64_t w = __atomic_exchange_n(&mv->mv_cur, (uint64_t)(uintptr_t)vr,
+	    __ATOMIC_ACQ_REL);
+	slablist_ver_t *old = MV_VER(w);
+	if (old != NULL && __atomic_add_fetch(&old->vr_pins, MV_PINS(w),
+	    __ATOMIC_ACQ_REL) == 0) {
+		ver_free(old);
+	}
+	ver_reap(mv);
+	/*
+	 * If no old version is left, the one that we just published is the
+	 * only other handle in the family.
+	 */
+	if (sl->sl_cow->cw_refs == 2) {
+		cow_relink(sl);
+	}
+	SLABLIST_MVCC_PUBLISH(sl, vr->vr_list);
+}
+
+void
+mvcc_exit(slablist_t *sl, int took)
+{
+	if (!took) {
+		return;
+	}
+	mvcc_publish(sl);
+	mvcc_held = NULL;
+	(void) pthread_mutex_unlock(&sl->sl_mvcc->mv_lock);
+}
+
+/*
+ * Puts `sl` into MVCC mode, and publishes its first version. Mapped lists are
+ * never modified, shared lists have their own lock, and versions are never
+ * modified either, so none of them can be put into MVCC mode. Neither can a
+ * list that has been cloned, since the writer points the links of the nodes
+ * that it shares with its versions at its own copies, which its other clones
+ * wouldn't expect.
+ */
+int
+slablist_mvcc_enable(slablist_t *sl)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SHM_LIST(sl) || IS_MVCC_VER(sl)) {
+		return (SL_ERDONLY);
+	}
+	if (IS_MVCC_LIST(sl)) {
+		return (SL_EDUP);
+	}
+	if (IS_COW_LIST(sl) && sl->sl_cow->cw_refs > 1) {
+		return (SL_ERDONLY);
+	}
+	slablist_mvcc_t *mv = mk_zbuf(sizeof (slablist_mvcc_t));
+	(void) pthread_mutex_init(&mv->mv_lock, NULL);
+	sl->sl_mvcc = mv;
+	mvcc_publish(sl);
+	return (SL_SUCCESS);
+}
+
+/*
+ * Frees the versions of `sl`, which is being destroyed, and takes it out of
+ * MVCC mode.
+ */
+static void
+mvcc_destroy(slablist_t *sl)
+{
+	slablist_mvcc_t *mv = sl->sl_mvcc;
+	ver_free(MV_VER(mv->mv_cur));
+	ver_reap(mv);
+	(void) pthread_mutex_destroy(&mv->mv_lock);
+	rm_buf(mv, sizeof (slablist_mvcc_t));
+	sl->sl_mvcc = NULL;
+}
+
+/*
+ * Returns the current version of `sl`, which stays the same no matter what
+ * the writer does to `sl`, until it's given back with slablist_unpin(). The
+ * version is a list in its own right, and can be searched, folded over, and
+ * iterated with bookmarks, but not modified, cloned, or destroyed. Readers
+ * that pin `sl` between two modifications all get the same version, so they
+ * can use it at the same time. This never takes a lock, or waits for the
+ * writer. Every version has to be unpinned before `sl` is destroyed, and no
+ * more than 65535 pins of the current version can be held at once.
+ */
+slablist_t *
+slablist_pin(slablist_t *sl)
+{
+	if (!IS_MVCC_LIST(sl)) {
+		return (NULL);
+	}
+	uint64_t w = __atomic_fetch_add(&sl->sl_mvcc->mv_cur, MV_PIN,
+	    __ATOMIC_ACQUIRE);
+	slablist_t *v = MV_VER(w)->vr_list;
+	SLABLIST_MVCC_PIN(sl, v);
+	return (v);
+}
+
+/*
+ * Gives back the version `v` of `sl`. If it's still the current version, its
+ * pin comes off the count in `mv_cur`. Otherwise, it comes off the version's
+ * own count, and if that was the last pin, the version goes on `mv_dead`, for
+ * the writer to free. This never takes a lock, or waits for the writer.
+ */
+void
+slablist_unpin(slablist_t *sl, slablist_t *v)
+{
+	slablist_mvcc_t *mv = sl->sl_mvcc;
+	slablist_ver_t *vr = v->sl_ver;
+	SLABLIST_MVCC_UNPIN(sl, v);
+	uint64_t w = __atomic_load_n(&mv->mv_cur, __ATOMIC_RELAXED);
+	while (MV_VER(w) == vr) {
+		if (__atomic_compare_exchange_n(&mv->mv_cur, &w, w - MV_PIN,
+		    1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			return;
+		}
+	}
+	if (__atomic_sub_fetch(&vr->vr_pins, 1, __ATOMIC_ACQ_REL) > 0) {
+		return;
+	}
+	slablist_ver_t *d = __atomic_load_n(&mv->mv_dead, __ATOMIC_RELAXED);
+	do {
+		vr->vr_next = d;
+	} while (!__atomic_compare_exchange_n(&mv->mv_dead, &d, vr, 1,
+	    __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void
+slablist_mvcc_lock(slablist_t *sl)
+{
+	(void) mvcc_enter(sl);
 }
 
+void
+slablist_mvcc_unlock(slablist_t *sl)
+{
+	mvcc_exit(sl, sl->sl_mvcc != NULL && mvcc_held == sl->sl_mvcc);
+}
 
 /*
  * This function detaches the sublayer that is immediately attached `sl`, and
@@ -486,41 +2779,56 @@ slablist_destroy(slablist_t *sl, slablist_rem_cb_t cb)
 void
 detach_sublayer(slablist_t *sl)
 {
-	slablist_t *sub = sl->sl_sublayer;
+	slablist_t *sub = LNK(sl->sl_sublayer);
 	SLABLIST_DETACH_SUBLAYER(sl, sub);
 
 
 	uint64_t i = 0;
-	slab_t *s = sl->sl_head;
-	subslab_t *ss = sl->sl_head;
+	slab_t *s = LNK(sl->sl_head);
+	subslab_t *ss = LNK(sl->sl_head);
 	if (sl->sl_layer == 0) {
 		while (i < sl->sl_slabs) {
 			s->s_below = NULL;
-			s = s->s_next;
+			s = LNK(s->s_next);
 			i++;
 		}
 	} else {
 		while (i < sl->sl_slabs) {
 			ss->ss_below = NULL;
-			ss = ss->ss_next;
+			ss = LNK(ss->ss_next);
 			i++;
 		}
 	}
 
-	remove_subslabs(sub);
+	/*
+	 * The nodes of a cloned list may still be shared, and point back at
+	 * `sub`, which sticks around until they are gone.
+	 */
+	slablist_t *o = spare_owner(sl);
+	if (IS_COW_LIST(o)) {
+		cow_drop_layer(sub);
+	} else {
+		remove_subslabs(sub);
+	}
 
 	sl->sl_sublayer = NULL;
 
 	SLABLIST_SL_DEC_ELEMS(sub);
 
-	rm_slablist(sub);
+	if (IS_COW_LIST(o)) {
+		sub->sl_retired = o->sl_retired;
+		o->sl_retired = sub;
+	} else {
+		rm_slablist(sub);
+	}
 	slablist_t *sup = sl;
 	/* Update the sublayer counter in all the superlayers. */
 	while (sup != NULL) {
-		sup->sl_baselayer = sl;
+		sup->sl_baselayer = MKLNK(sl);
 		sup->sl_sublayers--;
-		sup = sup->sl_superlayer;
+		sup = LNK(sup->sl_superlayer);
 	}
+	spare_owner(sl)->sl_base_gen++;
 }
 
 /*
@@ -531,39 +2839,54 @@ detach_sublayer(slablist_t *sl)
 void
 attach_sublayer(slablist_t *sl)
 {
-	slablist_t *sub = mk_slablist();
+	/*
+	 * A cloned list reuses the slablist_t of the sublayer that it last
+	 * detached, which some shared nodes may still point at.
+	 */
+	slablist_t *o = spare_owner(sl);
+	slablist_t *sub = o->sl_retired;
+	if (sub != NULL) {
+		o->sl_retired = sub->sl_retired;
+	} else {
+		sub = mk_slablist();
+	}
 	SLABLIST_ATTACH_SUBLAYER(sl, sub);
 	sub->sl_req_sublayer = sl->sl_req_sublayer;
 	bcopy(sl, sub, sizeof (slablist_t));
-	sl->sl_sublayer = sub;
-	sl->sl_baselayer = sub;
+	/* The spares stay with the toplayer. */
+	sub->sl_spare_slabs = NULL;
+	sub->sl_spare_subslabs = NULL;
+	sub->sl_nspare_slabs = 0;
+	sub->sl_nspare_subslabs = 0;
+	sl->sl_sublayer = MKLNK(sub);
+	sl->sl_baselayer = MKLNK(sub);
 
-	sub->sl_head = mk_subslab();
+	sub->sl_head = MKLNK(get_spare_subslab(sl));
+	sub->sl_end = MKLNK(LNK(sub->sl_head));
 
 	SLABLIST_SLAB_MK(sub);
 
-	subslab_t *sh = sub->sl_head;
+	subslab_t *sh = LNK(sub->sl_head);
 	sh->ss_elems = sl->sl_slabs;
-	sh->ss_list = sub;
-	sh->ss_arr = mk_subarr();
+	sh->ss_list = MKLNK(sub);
 
-	slab_t *h = sl->sl_head;
-	subslab_t *hh = sl->sl_head;
+	slab_t *h = LNK(sl->sl_head);
+	subslab_t *hh = LNK(sl->sl_head);
 
 	sub->sl_slabs = 1;
 	sub->sl_elems = sl->sl_slabs;
-	sub->sl_superlayer = sl;
+	sub->sl_superlayer = MKLNK(sl);
 	sub->sl_layer++;
 	SLABLIST_SL_INC_LAYER(sub);
 
-	slablist_t *sup = sub->sl_superlayer;
+	slablist_t *sup = LNK(sub->sl_superlayer);
 
 	/* Update the sublayer counter in all the superlayers */
 	while (sup != NULL) {
 		sup->sl_sublayers++;
-		sup->sl_baselayer = sub;
+		sup->sl_baselayer = MKLNK(sub);
 		SLABLIST_SL_INC_SUBLAYERS(sup);
-		sup = sup->sl_superlayer;
+		sup = LNK(sup->sl_superlayer);
 	}
 
 	subslab_t *sc = hh;
@@ -578,9 +2901,9 @@ attach_sublayer(slablist_t *sl)
 		while (i < sl->sl_slabs) {
 			SLABLIST_SUBSLAB_AI(sub, sh, NULL, sc);
 			SET_SUBSLAB_ELEM(sh, (void *)sc, i);
-			sc->ss_below = sh;
+			sc->ss_below = MKLNK(sh);
 			sh->ss_usr_elems += sc->ss_usr_elems;
-			sc = sc->ss_next;
+			sc = LNK(sc->ss_next);
 			i++;
 		}
 		/* Set the max and the min of head subslab */
@@ -596,9 +2919,9 @@ attach_sublayer(slablist_t *sl)
 		while (i < sl->sl_slabs) {
 			SLABLIST_SUBSLAB_AI(sub, sh, c, NULL);
 			SET_SUBSLAB_ELEM(sh, (void *)c, i);
-			c->s_below = sh;
+			c->s_below = MKLNK(sh);
 			sh->ss_usr_elems += c->s_elems;
-			c = c->s_next;
+			c = LNK(c->s_next);
 			i++;
 		}
 		/* Set the max and the min of head subslab */
@@ -610,6 +2933,7 @@ attach_sublayer(slablist_t *sl)
 		sh->ss_max = (l->s_max);
 		SLABLIST_SUBSLAB_SET_MAX(sh);
 	}
+	spare_owner(sl)->sl_base_gen++;
 }
 
 /*
@@ -627,7 +2951,11 @@ int small_list_add(slablist_t *, slablist_elem_t, int, slablist_elem_t *);
 void
 slab_to_small_list(slablist_t *sl)
 {
-	slab_t *h = sl->sl_head;
+	/*
+	 * The slab is about to be freed, so it can't be shared.
+	 */
+	cow_own_all(sl);
+	slab_t *h = LNK(sl->sl_head);
 	sl->sl_head = NULL;
 	sl->sl_elems = 0;
 	uint64_t i = 0;
@@ -636,7 +2964,7 @@ slab_to_small_list(slablist_t *sl)
 	 * into a singly linked list.
 	 */
 	while (i < h->s_elems) {
-		small_list_add(sl, h->s_arr[i], 0, NULL);
+		small_list_add(sl, SLAB_ELEM(h, i), 0, NULL);
 		i++;
 	}
 
@@ -645,8 +2973,10 @@ slab_to_small_list(slablist_t *sl)
 		int f = test_slab_to_sml(sl, h);
 		SLABLIST_TEST_SLAB_TO_SML(f);
 	}
-	rm_slab(h);
+	put_spare_slab(sl, h);
 	SLABLIST_SLAB_RM(sl);
+	/* A small list has no use for spare slabs. */
+	rm_spares(sl);
 	SLABLIST_TO_SMALL_LIST(sl);
 }
 
@@ -655,29 +2985,37 @@ small_list_to_slab(slablist_t *sl)
 {
 	SLABLIST_TO_SLAB(sl);
 	slab_t *s = NULL;
-	s = mk_slab();
+	s = get_spare_slab(sl);
 	SLABLIST_SLAB_MK(sl);
-	s->s_list = sl;
-	small_list_t *sml = sl->sl_head;
+	s->s_list = MKLNK(sl);
+	small_list_t *sml = LNK(sl->sl_head);
 	small_list_t *smlp = NULL;
 	uint64_t i = 0;
 	while (i < sl->sl_elems) {
-		s->s_arr[i] = sml->sml_data;
+		SLAB_SET(s, i, sml->sml_data);
+		SLAB_SET_PFX(s, i, sml->sml_data);
 		smlp = sml;
-		sml = sml->sml_next;
+		sml = LNK(sml->sml_next);
 		rm_sml_node(smlp);
 		s->s_elems++;
 		i++;
 	}
 
 	SLABLIST_SLAB_INC_ELEMS(s);
-	sl->sl_head = s;
-	sl->sl_end = s;
+	sl->sl_head = MKLNK(s);
+	sl->sl_end = MKLNK(s);
 	sl->sl_slabs = 1;
 	SLABLIST_SL_INC_SLABS(sl);
 
-	s->s_min = s->s_arr[0];
-	s->s_max = s->s_arr[(s->s_elems - 1)];
+	/*
+	 * A key-value list becomes a slab list while it is still empty, and
+	 * the slab gets its extrema from its first element instead.
+	 */
+	if (s->s_elems == 0) {
+		return;
+	}
+	s->s_min = SLAB_GET(s, 0);
+	s->s_max = SLAB_GET(s, (s->s_elems - 1));
 	SLABLIST_SET_HEAD(sl, s->s_min);
 	SLABLIST_SET_END(sl, s->s_max);
 
@@ -692,7 +3030,7 @@ small_list_to_slab(slablist_t *sl)
 void
 try_reap(slablist_t *sl)
 {
-	uint64_t slabs_saveable = sl->sl_slabs - (sl->sl_elems / SELEM_MAX);
+	uint64_t slabs_saveable = sl->sl_slabs - (sl->sl_elems / sl->sl_selem_max);
 	float percntg_slabs_saveable = ((float)slabs_saveable) /
 	    ((float)sl->sl_slabs);
 	float req_percntg = ((float)(sl->sl_mpslabs))/100.0;
@@ -722,7 +3060,7 @@ slablist_map_sml(slablist_t *sl, slablist_map_t f)
 {
 	uint64_t nodes = sl->sl_elems;
 	uint64_t node = 0;
-	small_list_t *s = (small_list_t *)sl->sl_head;
+	small_list_t *s = (small_list_t *)LNK(sl->sl_head);
 	/*
 	 * We place the elems in an array, to avoid calling `f` more than we
 	 * have to.
@@ -730,7 +3068,7 @@ slablist_map_sml(slablist_t *sl, slablist_map_t f)
 	slablist_elem_t elems[SMELEM_MAX];
 	while (node < nodes) {
 		elems[node] = s->sml_data;
-		s = s->sml_next;
+		s = LNK(s->sml_next);
 		node++;
 	}
 	f(elems, nodes);
@@ -742,7 +3080,7 @@ slablist_map_range_sml(slablist_t *sl, slablist_map_t f, slablist_elem_t min,
 {
 	uint64_t nodes = sl->sl_elems;
 	uint64_t node = 0;
-	small_list_t *s = (small_list_t *)sl->sl_head;
+	small_list_t *s = (small_list_t *)LNK(sl->sl_head);
 	/*
 	 * We place the elems in an array, to avoid calling `f` more than we
 	 * have to.
@@ -750,15 +3088,15 @@ slablist_map_range_sml(slablist_t *sl, slablist_map_t f, slablist_elem_t min,
 	slablist_elem_t elems[SMELEM_MAX];
 	while (node < nodes) {
 		elems[node] = s->sml_data;
-		s = s->sml_next;
+		s = LNK(s->sml_next);
 		node++;
 	}
 	int i = 0;
 	int j = nodes - 1;
-	while (sl->sl_cmp_elem(elems[i], min) < 0) {
+	while (SL_CMPF(sl)(elems[i], min) < 0) {
 		i++;
 	}
-	while (sl->sl_cmp_elem(elems[j], max) > 0) {
+	while (SL_CMPF(sl)(elems[j], max) > 0) {
 		j--;
 	}
 	if (j < i) {
@@ -771,54 +3109,75 @@ slablist_map_range_sml(slablist_t *sl, slablist_map_t f, slablist_elem_t min,
 /*
  * Map a function to every element in the slab list. If this function is called
  * on a sorted slab list, and it invalidates the sorting of the elements in any
- * way, it _will_ have undefined results.
+ * way, it _will_ have undefined results. A mapped list is read-only, so
+ * mapping over one does nothing.
  */
 void
 slablist_map(slablist_t *sl, slablist_map_t f)
 {
+	if (IS_MAPPED_LIST(sl)) {
+		return;
+	}
+	slablist_t *held = cow_enter(sl);
+	cow_own_all(sl);
 	if (IS_SMALL_LIST(sl)) {
 		slablist_map_sml(sl, f);
+		bloom_rebuild(sl);
+		cow_exit(held);
 		return;
 	}
 	uint64_t slabs = sl->sl_slabs;
 	uint64_t slab = 0;
-	slab_t *s = (slab_t *)sl->sl_head;
+	slab_t *s = (slab_t *)LNK(sl->sl_head);
+	slablist_elem_t *buf = mk_decode_buf(sl);
 	while (slab < slabs) {
-		f(s->s_arr, s->s_elems);
-		s = s->s_next;
+		f(slab_elems(s, buf), s->s_elems);
+		slab_reset_pfxs(s);
+		SLAB_SET_DIRTY(s);
+		s = LNK(s->s_next);
 		slab++;
 	}
+	rm_decode_buf(sl, buf);
+	bloom_rebuild(sl);
+	agg_flush(sl);
+	cow_exit(held);
 }
 
+/*
+ * Maps `f` over the elements of `sl` that are within [min, max], one slab's
+ * worth at a time. We let a span (see slablist_span_begin()) find the runs,
+ * and dirty each slab after `f` has had a go at it. `sl` has to be sorted.
+ */
 void
 slablist_map_range(slablist_t *sl, slablist_map_t f, slablist_elem_t min,
     slablist_elem_t max)
 {
+	if (IS_MAPPED_LIST(sl) || !SLIST_SORTED(sl->sl_flags)) {
+		return;
+	}
+	slablist_t *held = cow_enter(sl);
+	cow_own(sl, COW_RANGE, min, max);
 	if (IS_SMALL_LIST(sl)) {
 		slablist_map_range_sml(sl, f, min, max);
+		bloom_rebuild(sl);
+		cow_exit(held);
 		return;
 	}
-	slab_t *smin = NULL;
-	slab_t *smax = NULL;
-	find_bubble_up(sl, min, &smin);
-	find_bubble_up(sl, max, &smax);
-	int i;
-	int j;
-	if (smin == smax) {
-		i = slab_bin_srch(min, smin);
-		j = slab_bin_srch(max, smin);
-		f((smin->s_arr)+i, j-i);
-	}
-	slab_t *slab = smin;
-	i = slab_bin_srch(min, smin);
-	f((slab->s_arr)+i, (slab->s_elems)-i);
-	slab = slab->s_next;
-	while (slab != smax) {
-		f(slab->s_arr, slab->s_elems);
-		slab = slab->s_next;
+	slablist_span_t *it;
+	slablist_elem_t *run;
+	uint64_t len;
+	(void) slablist_span_begin(sl, min, max, &it);
+	slab_t *s = it->sp_bm.sb_node;
+	while (slablist_span_next(it, &run, &len) == 0) {
+		f(run, len);
+		slab_reset_pfxs(s);
+		SLAB_SET_DIRTY(s);
+		s = it->sp_bm.sb_node;
 	}
-	i = slab_bin_srch(max, slab);
-	f(slab->s_arr, i+1);
+	slablist_span_end(it);
+	bloom_rebuild(sl);
+	agg_flush(sl);
+	cow_exit(held);
 }
 
 
@@ -830,7 +3189,7 @@ slablist_fold_sml(slablist_t *sl, slablist_fold_t f, slablist_elem_t zero)
 {
 	uint64_t nodes = sl->sl_elems;
 	uint64_t node = 0;
-	small_list_t *s = (small_list_t *)sl->sl_head;
+	small_list_t *s = (small_list_t *)LNK(sl->sl_head);
 	slablist_elem_t accumulator = zero;
 	/*
 	 * We place the elems in an array, to avoid calling `f` more than we
@@ -840,7 +3199,7 @@ slablist_fold_sml(slablist_t *sl, slablist_fold_t f, slablist_elem_t zero)
 	slablist_elem_t elems[SMELEM_MAX];
 	while (node < nodes) {
 		elems[node] = s->sml_data;
-		s = s->sml_next;
+		s = LNK(s->sml_next);
 		node++;
 	}
 	accumulator = f(accumulator, elems, nodes);
@@ -856,7 +3215,7 @@ slablist_fold_range_sml(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
 {
 	uint64_t nodes = sl->sl_elems;
 	uint64_t node = 0;
-	small_list_t *s = (small_list_t *)sl->sl_head;
+	small_list_t *s = (small_list_t *)LNK(sl->sl_head);
 	slablist_elem_t accumulator = zero;
 	/*
 	 * We place the elems in an array, to avoid calling `f` more than we
@@ -866,16 +3225,16 @@ slablist_fold_range_sml(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
 	slablist_elem_t elems[SMELEM_MAX];
 	while (node < nodes) {
 		elems[node] = s->sml_data;
-		s = s->sml_next;
+		s = LNK(s->sml_next);
 		node++;
 	}
 
 	int i = 0;
 	int j = nodes - 1;
-	while (i < nodes && sl->sl_cmp_elem(elems[i], min) < 0) {
+	while (i < nodes && SL_CMPF(sl)(elems[i], min) < 0) {
 		i++;
 	}
-	while (j >= 0 && sl->sl_cmp_elem(elems[j], max) > 0) {
+	while (j >= 0 && SL_CMPF(sl)(elems[j], max) > 0) {
 		j--;
 	}
 	/*
@@ -890,6 +3249,97 @@ slablist_fold_range_sml(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
 	return (accumulator);
 }
 
+/*
+ * Folds over a mapped list, right out of the mapping. So `f` must not write
+ * to the arrays that it is given. Folds from the end if `left` is set.
+ */
+static slablist_elem_t
+slablist_fold_mapped(slablist_t *sl, slablist_fold_t f, slablist_elem_t zero,
+    int left)
+{
+	slablist_elem_t accumulator = zero;
+	if (sl->sl_elems == 0) {
+		return (accumulator);
+	}
+	mslab_t *s;
+	if (left) {
+		s = MAPPED_SLAB(sl, sl->sl_slabs - 1);
+	} else {
+		s = MAPPED_SLAB(sl, 0);
+	}
+	while (s != NULL) {
+		accumulator = f(accumulator, MSLAB_ARR(s), s->ms_elems);
+		if (left) {
+			s = mapped_slab_prev(sl, s);
+		} else {
+			s = mapped_slab_next(sl, s);
+		}
+	}
+	return (accumulator);
+}
+
+/*
+ * Folds over the elements of a mapped list that are within `min` and `max`,
+ * inclusive.
+ */
+static slablist_elem_t
+slablist_fold_range_mapped(slablist_t *sl, slablist_fold_t f,
+    slablist_elem_t min, slablist_elem_t max, slablist_elem_t zero, int left)
+{
+	slablist_elem_t accumulator = zero;
+	if (sl->sl_elems == 0 || SL_CMPF(sl)(min, max) > 0) {
+		return (accumulator);
+	}
+	mslab_t *smin = mapped_find_slab(sl, min);
+	mslab_t *smax = mapped_find_slab(sl, max);
+	/*
+	 * The range starts at index `i` of smin, and ends right before index
+	 * `j` of smax.
+	 */
+	uint64_t i = mapped_slab_srch(sl, smin, min);
+	uint64_t j = mapped_slab_srch(sl, smax, max);
+	if (j < smax->ms_elems &&
+	    SL_CMPF(sl)(max, MSLAB_ARR(smax)[j]) == 0) {
+		j++;
+	}
+	if (smin == smax) {
+		if (j > i) {
+			accumulator = f(accumulator, MSLAB_ARR(smin) + i,
+			    j - i);
+		}
+		return (accumulator);
+	}
+	mslab_t *s;
+	if (left) {
+		if (j > 0) {
+			accumulator = f(accumulator, MSLAB_ARR(smax), j);
+		}
+		s = mapped_slab_prev(sl, smax);
+		while (s != smin) {
+			accumulator = f(accumulator, MSLAB_ARR(s), s->ms_elems);
+			s = mapped_slab_prev(sl, s);
+		}
+		if (i < smin->ms_elems) {
+			accumulator = f(accumulator, MSLAB_ARR(smin) + i,
+			    smin->ms_elems - i);
+		}
+		return (accumulator);
+	}
+	if (i < smin->ms_elems) {
+		accumulator = f(accumulator, MSLAB_ARR(smin) + i,
+		    smin->ms_elems - i);
+	}
+	s = mapped_slab_next(sl, smin);
+	while (s != smax) {
+		accumulator = f(accumulator, MSLAB_ARR(s), s->ms_elems);
+		s = mapped_slab_next(sl, s);
+	}
+	if (j > 0) {
+		accumulator = f(accumulator, MSLAB_ARR(smax), j);
+	}
+	return (accumulator);
+}
+
 /*
  * Folds a function from start to end of a slab list. The function itself folds
  * from the start to the end of _slab_. This function expects an accumulator,
@@ -903,19 +3353,26 @@ slablist_fold_range_sml(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
 slablist_elem_t
 slablist_foldr(slablist_t *sl, slablist_fold_t f, slablist_elem_t zero)
 {
+	if (IS_MAPPED_LIST(sl)) {
+		return (slablist_fold_mapped(sl, f, zero, 0));
+	}
 	if (IS_SMALL_LIST(sl)) {
 		slablist_elem_t ret = slablist_fold_sml(sl, f, zero);
 		return (ret);
 	}
+	slablist_t *held = cow_enter(sl);
 	uint64_t slabs = sl->sl_slabs;
 	uint64_t slab = 0;
-	slab_t *s = (slab_t *)sl->sl_head;
+	slab_t *s = (slab_t *)LNK(sl->sl_head);
 	slablist_elem_t accumulator = zero;
+	slablist_elem_t *buf = mk_decode_buf(sl);
 	while (slab < slabs) {
-		accumulator = f(accumulator, s->s_arr, s->s_elems);
-		s = s->s_next;
+		accumulator = f(accumulator, slab_elems(s, buf), s->s_elems);
+		s = LNK(s->s_next);
 		slab++;
 	}
+	rm_decode_buf(sl, buf);
+	cow_exit(held);
 	return (accumulator);
 }
 
@@ -930,19 +3387,26 @@ slablist_foldr(slablist_t *sl, slablist_fold_t f, slablist_elem_t zero)
 slablist_elem_t
 slablist_foldl(slablist_t *sl, slablist_fold_t f, slablist_elem_t zero)
 {
+	if (IS_MAPPED_LIST(sl)) {
+		return (slablist_fold_mapped(sl, f, zero, 1));
+	}
 	if (IS_SMALL_LIST(sl)) {
 		slablist_elem_t ret = slablist_fold_sml(sl, f, zero);
 		return (ret);
 	}
+	slablist_t *held = cow_enter(sl);
 	uint64_t slabs = sl->sl_slabs;
 	uint64_t slab = 0;
-	slab_t *s = (slab_t *)sl->sl_end;
+	slab_t *s = (slab_t *)LNK(sl->sl_end);
 	slablist_elem_t accumulator = zero;
+	slablist_elem_t *buf = mk_decode_buf(sl);
 	while (slab < slabs) {
-		accumulator = f(accumulator, s->s_arr, s->s_elems);
-		s = s->s_prev;
+		accumulator = f(accumulator, slab_elems(s, buf), s->s_elems);
+		s = LNK(s->s_prev);
 		slab++;
 	}
+	rm_decode_buf(sl, buf);
+	cow_exit(held);
 	return (accumulator);
 }
 
@@ -951,11 +3415,15 @@ slablist_foldr_range(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
     slablist_elem_t max, slablist_elem_t zero)
 {
 	slablist_elem_t accumulator = zero;
+	if (IS_MAPPED_LIST(sl)) {
+		return (slablist_fold_range_mapped(sl, f, min, max, zero, 0));
+	}
 	if (IS_SMALL_LIST(sl)) {
 		slablist_elem_t ret = slablist_fold_range_sml(sl, f, min, max,
 		    zero);
 		return (ret);
 	}
+	slablist_t *held = cow_enter(sl);
 	slab_t *smin = NULL;
 	slab_t *smax = NULL;
 	if (sl->sl_sublayers > 0) {
@@ -967,19 +3435,24 @@ slablist_foldr_range(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
 	}
 	int i;
 	int j;
+	slablist_elem_t *buf = mk_decode_buf(sl);
 	if (smin == smax) {
 		i = slab_bin_srch(min, smin);
 		j = slab_bin_srch(max, smin);
-		accumulator = f(accumulator, (smin->s_arr)+i, j-i);
+		accumulator = f(accumulator, slab_elems(smin, buf)+i, j-i);
+		rm_decode_buf(sl, buf);
+		cow_exit(held);
 		return (accumulator);
 	}
 	slab_t *slab = smin;
 	i = slab_bin_srch(min, smin);
-	accumulator = f(accumulator, (slab->s_arr)+i, (slab->s_elems)-i);
-	slab = slab->s_next;
+	accumulator = f(accumulator, slab_elems(slab, buf)+i,
+	    (slab->s_elems)-i);
+	slab = LNK(slab->s_next);
 	while (slab != smax) {
-		accumulator = f(accumulator, slab->s_arr, slab->s_elems);
-		slab = slab->s_next;
+		accumulator = f(accumulator, slab_elems(slab, buf),
+		    slab->s_elems);
+		slab = LNK(slab->s_next);
 	}
 	i = slab_bin_srch(max, slab);
 	/*
@@ -991,12 +3464,15 @@ slablist_foldr_range(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
 	 * of the slab, we set the size to 1 greater than the index.
 	 */
 	if (i == slab->s_elems) {
-		accumulator = f(accumulator, slab->s_arr, slab->s_elems);
-	} else if (i == 0 && (sl->sl_cmp_elem(slab->s_arr[i], max) <= 0)) {
-		accumulator = f(accumulator, slab->s_arr, 1);
+		accumulator = f(accumulator, slab_elems(slab, buf),
+		    slab->s_elems);
+	} else if (i == 0 && (SL_CMPF(sl)(SLAB_ELEM(slab, i), max) <= 0)) {
+		accumulator = f(accumulator, slab_elems(slab, buf), 1);
 	} else if (i != 0) {
-		accumulator = f(accumulator, slab->s_arr, i+1);
+		accumulator = f(accumulator, slab_elems(slab, buf), i+1);
 	}
+	rm_decode_buf(sl, buf);
+	cow_exit(held);
 	return (accumulator);
 }
 
@@ -1005,11 +3481,15 @@ slablist_foldl_range(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
     slablist_elem_t max, slablist_elem_t zero)
 {
 	slablist_elem_t accumulator = zero;
+	if (IS_MAPPED_LIST(sl)) {
+		return (slablist_fold_range_mapped(sl, f, min, max, zero, 1));
+	}
 	if (IS_SMALL_LIST(sl)) {
 		slablist_elem_t ret = slablist_fold_range_sml(sl, f, min, max,
 		    zero);
 		return (ret);
 	}
+	slablist_t *held = cow_enter(sl);
 	slab_t *smin = NULL;
 	slab_t *smax = NULL;
 	if (sl->sl_sublayers > 0) {
@@ -1021,21 +3501,472 @@ slablist_foldl_range(slablist_t *sl, slablist_fold_t f, slablist_elem_t min,
 	}
 	int i;
 	int j;
+	slablist_elem_t *buf = mk_decode_buf(sl);
 	if (smin == smax) {
 		i = slab_bin_srch(min, smin);
 		j = slab_bin_srch(max, smin);
-		accumulator = f(accumulator, (smin->s_arr)+i, j-i);
+		accumulator = f(accumulator, slab_elems(smin, buf)+i, j-i);
+		rm_decode_buf(sl, buf);
+		cow_exit(held);
 		return (accumulator);
 	}
 	slab_t *slab = smax;
 	i = slab_bin_srch(max, smax);
-	accumulator = f(accumulator, slab->s_arr, i+1);
-	slab = slab->s_prev;
+	accumulator = f(accumulator, slab_elems(slab, buf), i+1);
+	slab = LNK(slab->s_prev);
 	while (slab != smin) {
-		accumulator = f(accumulator, slab->s_arr, slab->s_elems);
-		slab = slab->s_prev;
+		accumulator = f(accumulator, slab_elems(slab, buf),
+		    slab->s_elems);
+		slab = LNK(slab->s_prev);
 	}
 	i = slab_bin_srch(min, slab);
-	accumulator = f(accumulator, slab->s_arr+i, slab->s_elems - i);
+	accumulator = f(accumulator, slab_elems(slab, buf)+i,
+	    slab->s_elems - i);
+	rm_decode_buf(sl, buf);
+	cow_exit(held);
+	return (accumulator);
+}
+
+/*
+ * Folds a function `f` over `sl` the way that slablist_foldr() does, or
+ * slablist_foldl() if `left` is set, until `f` tells us to stop, so that
+ * searches don't have to visit every slab after they have their answer.
+ */
+static slablist_elem_t
+fold_until(slablist_t *sl, slablist_fold_until_t f, slablist_elem_t zero,
+    int left)
+{
+	slablist_elem_t accumulator = zero;
+	int stop = 0;
+	if (sl->sl_elems == 0) {
+		return (accumulator);
+	}
+	if (IS_MAPPED_LIST(sl)) {
+		mslab_t *ms;
+		if (left) {
+			ms = MAPPED_SLAB(sl, sl->sl_slabs - 1);
+		} else {
+			ms = MAPPED_SLAB(sl, 0);
+		}
+		while (ms != NULL && !stop) {
+			accumulator = f(accumulator, MSLAB_ARR(ms),
+			    ms->ms_elems, &stop);
+			if (left) {
+				ms = mapped_slab_prev(sl, ms);
+			} else {
+				ms = mapped_slab_next(sl, ms);
+			}
+		}
+		return (accumulator);
+	}
+	if (IS_SMALL_LIST(sl)) {
+		slablist_elem_t elems[SMELEM_MAX];
+		small_list_t *sml = LNK(sl->sl_head);
+		uint64_t node = 0;
+		while (node < sl->sl_elems) {
+			elems[node] = sml->sml_data;
+			sml = LNK(sml->sml_next);
+			node++;
+		}
+		return (f(accumulator, elems, node, &stop));
+	}
+	slablist_t *held = cow_enter(sl);
+	slab_t *s;
+	if (left) {
+		s = LNK(sl->sl_end);
+	} else {
+		s = LNK(sl->sl_head);
+	}
+	slablist_elem_t *buf = mk_decode_buf(sl);
+	while (s != NULL && !stop) {
+		accumulator = f(accumulator, slab_elems(s, buf), s->s_elems,
+		    &stop);
+		if (left) {
+			s = LNK(s->s_prev);
+		} else {
+			s = LNK(s->s_next);
+		}
+	}
+	rm_decode_buf(sl, buf);
+	cow_exit(held);
+	return (accumulator);
+}
+
+/*
+ * Folds `f` over the elements of `sl` that are within [min, max], forward or
+ * backward, until `f` tells us to stop. A span (see slablist_span_begin())
+ * finds the runs for us. `sl` has to be sorted.
+ */
+static slablist_elem_t
+fold_range_until(slablist_t *sl, slablist_fold_until_t f, slablist_elem_t min,
+    slablist_elem_t max, slablist_elem_t zero, int left)
+{
+	slablist_elem_t accumulator = zero;
+	slablist_span_t *it;
+	slablist_elem_t *run;
+	uint64_t len;
+	int stop = 0;
+	if (span_begin(sl, min, max, left, &it) != SL_SUCCESS) {
+		return (accumulator);
+	}
+	while (!stop && slablist_span_next(it, &run, &len) == 0) {
+		accumulator = f(accumulator, run, len, &stop);
+	}
+	slablist_span_end(it);
 	return (accumulator);
 }
+
+/*
+ * These are like slablist_foldr(), slablist_foldl(), and their ranged
+ * variants, except that the function can stop the fold by setting the int
+ * that its last argument points to. The slab that it stopped in is the last
+ * one that it sees. The ranged variants require a sorted list.
+ */
+slablist_elem_t
+slablist_foldr_until(slablist_t *sl, slablist_fold_until_t f,
+    slablist_elem_t zero)
+{
+	return (fold_until(sl, f, zero, 0));
+}
+
+slablist_elem_t
+slablist_foldl_until(slablist_t *sl, slablist_fold_until_t f,
+    slablist_elem_t zero)
+{
+	return (fold_until(sl, f, zero, 1));
+}
+
+slablist_elem_t
+slablist_foldr_range_until(slablist_t *sl, slablist_fold_until_t f,
+    slablist_elem_t min, slablist_elem_t max, slablist_elem_t zero)
+{
+	return (fold_range_until(sl, f, min, max, zero, 0));
+}
+
+slablist_elem_t
+slablist_foldl_range_until(slablist_t *sl, slablist_fold_until_t f,
+    slablist_elem_t min, slablist_elem_t max, slablist_elem_t zero)
+{
+	return (fold_range_until(sl, f, min, max, zero, 1));
+}
+
+/*
+ * Range Aggregates
+ *
+ * A sorted list can be given an aggregate: a fold function and a combine
+ * function that together form a monoid over the elements. Combining the
+ * aggregates of two adjacent runs of elements has to give the aggregate of
+ * both runs, `zero` has to be the aggregate of no elements, and folding a run
+ * into an accumulator has to give the same thing as combining the accumulator
+ * with the fold of the run into `zero`. Sums, counts, minimums, and maximums
+ * all qualify.
+ *
+ * Every slab and subslab keeps the aggregate of all of the elements beneath it
+ * (see the comments above `struct slab` and `struct subslab`).
+ * slablist_aggregate_range() combines the aggregates of the subslabs that lie
+ * entirely within the range, and only descends into the subslabs that
+ * straddle one of its ends, of which there are at most two per layer. Beneath
+ * those, it combines the aggregates of the slabs that are in the range, and
+ * folds the elements of the two slabs at its ends. So an aggregate costs about
+ * as much as two lookups, no matter how big the range is.
+ *
+ * The aggregates are kept up to date by the modifications themselves: each
+ * one marks the slabs and subslabs that it touches as stale, and calls
+ * agg_flush() when it is done, which recombines only the stale ones. Queries
+ * never write to the list, so every handle that can read it (clones, pinned
+ * versions of MVCC lists) uses the aggregates as they are.
+ *
+ * Small lists and mapped lists have no slabs to keep aggregates in, so theirs
+ * are folded from the elements every time.
+ */
+
+/*
+ * Marks the aggregates of `ss` and of the subslabs below it as stale.
+ */
+void
+agg_dirty(subslab_t *ss)
+{
+	while (ss != NULL) {
+		ss->ss_agg_ok = 0;
+		ss = LNK(ss->ss_below);
+	}
+}
+
+/*
+ * Marks the aggregates of all of the slabs and subslabs of `sl` as stale.
+ */
+static void
+agg_reset(slablist_t *sl)
+{
+	slab_t *s = LNK(sl->sl_head);
+	uint64_t i = 0;
+	while (i < sl->sl_slabs) {
+		s->s_agg_ok = 0;
+		s = LNK(s->s_next);
+		i++;
+	}
+	slablist_t *sub = LNK(sl->sl_sublayer);
+	while (sub != NULL) {
+		subslab_t *ss = LNK(sub->sl_head);
+		i = 0;
+		while (i < sub->sl_slabs) {
+			ss->ss_agg_ok = 0;
+			ss = LNK(ss->ss_next);
+			i++;
+		}
+		sub = LNK(sub->sl_sublayer);
+	}
+}
+
+/*
+ * Folds the elements of `s` that are within [min, max] into `acc`, or all of
+ * its elements if `all` is set.
+ */
+static slablist_elem_t
+agg_slab(slablist_t *sl, slab_t *s, slablist_elem_t min, slablist_elem_t max,
+    int all, slablist_elem_t acc, slablist_elem_t *buf)
+{
+	if (all && s->s_agg_ok) {
+		if (SLABLIST_TEST_AGGREGATE_ENABLED()) {
+			SLABLIST_TEST_AGGREGATE(test_slab_agg(sl, s));
+		}
+		return (sl->sl_agg_comb(acc, s->s_agg));
+	}
+	int i = 0;
+	int j = s->s_elems;
+	slablist_elem_t *arr = slab_elems(s, buf);
+	if (!all) {
+		/*
+		 * The binary search can land anywhere in a run of duplicates,
+		 * so we walk to the ends of the run.
+		 */
+		i = slab_bin_srch(min, s);
+		while (i > 0 && SL_CMPF(sl)(arr[i - 1], min) >= 0) {
+			i--;
+		}
+		j = slab_bin_srch(max, s);
+		while (j < s->s_elems && SL_CMPF(sl)(arr[j], max) <= 0) {
+			j++;
+		}
+	}
+	if (j > i) {
+		acc = sl->sl_agg_fold(acc, arr + i, j - i);
+	}
+	return (acc);
+}
+
+/*
+ * Recomputes the aggregate of `s`, if it is stale.
+ */
+static void
+agg_fix_slab(slablist_t *sl, slab_t *s, slablist_elem_t *buf)
+{
+	if (s->s_agg_ok) {
+		return;
+	}
+	slablist_elem_t zero = sl->sl_agg_zero;
+	s->s_agg = agg_slab(sl, s, zero, zero, 1, zero, buf);
+	s->s_agg_ok = 1;
+}
+
+/*
+ * Recomputes the aggregate of the stale subslab `ss`, by recomputing its stale
+ * slabs or subslabs first, and then combining the aggregates of all of them.
+ */
+static void
+agg_fix(slablist_t *sl, subslab_t *ss, slablist_elem_t *buf)
+{
+	slablist_elem_t acc = sl->sl_agg_zero;
+	int top = LNK(ss->ss_list)->sl_layer == 1;
+	int i = 0;
+	while (i < ss->ss_elems) {
+		if (top) {
+			slab_t *s = GET_SUBSLAB_ELEM(ss, i);
+			agg_fix_slab(sl, s, buf);
+			acc = sl->sl_agg_comb(acc, s->s_agg);
+		} else {
+			subslab_t *c = GET_SUBSLAB_ELEM(ss, i);
+			if (!c->ss_agg_ok) {
+				agg_fix(sl, c, buf);
+			}
+			acc = sl->sl_agg_comb(acc, c->ss_agg);
+		}
+		i++;
+	}
+	ss->ss_agg = acc;
+	ss->ss_agg_ok = 1;
+}
+
+/*
+ * Brings the aggregates of `sl` up to date, at the end of a modification.
+ * Only the stale slabs and subslabs are visited, so this costs about as much
+ * as the paths that the modification touched.
+ */
+void
+agg_flush(slablist_t *sl)
+{
+	if (sl->sl_agg_fold == NULL || IS_SMALL_LIST(sl) ||
+	    IS_MAPPED_LIST(sl)) {
+		return;
+	}
+	slablist_elem_t *buf = mk_decode_buf(sl);
+	uint64_t i = 0;
+	if (sl->sl_sublayers == 0) {
+		slab_t *s = LNK(sl->sl_head);
+		while (i < sl->sl_slabs) {
+			agg_fix_slab(sl, s, buf);
+			s = LNK(s->s_next);
+			i++;
+		}
+	} else {
+		slablist_t *base = LNK(sl->sl_baselayer);
+		subslab_t *ss = LNK(base->sl_head);
+		while (i < base->sl_slabs) {
+			if (!ss->ss_agg_ok) {
+				agg_fix(sl, ss, buf);
+			}
+			ss = LNK(ss->ss_next);
+			i++;
+		}
+	}
+	rm_decode_buf(sl, buf);
+}
+
+/*
+ * Combines the aggregate of the elements beneath `ss` that are within
+ * [min, max] into `acc`.
+ */
+static slablist_elem_t
+agg_subslab_range(slablist_t *sl, subslab_t *ss, slablist_elem_t min,
+    slablist_elem_t max, slablist_elem_t acc, slablist_elem_t *buf)
+{
+	if (SL_CMPF(sl)(min, ss->ss_min) <= 0 &&
+	    SL_CMPF(sl)(ss->ss_max, max) <= 0) {
+		if (SLABLIST_TEST_AGGREGATE_ENABLED()) {
+			SLABLIST_TEST_AGGREGATE(test_subslab_agg(sl, ss));
+		}
+		return (sl->sl_agg_comb(acc, ss->ss_agg));
+	}
+	int top = LNK(ss->ss_list)->sl_layer == 1;
+	int i = 0;
+	while (i < ss->ss_elems) {
+		slablist_elem_t cmin;
+		slablist_elem_t cmax;
+		void *c = GET_SUBSLAB_ELEM(ss, i);
+		if (top) {
+			cmin = ((slab_t *)c)->s_min;
+			cmax = ((slab_t *)c)->s_max;
+		} else {
+			cmin = ((subslab_t *)c)->ss_min;
+			cmax = ((subslab_t *)c)->ss_max;
+		}
+		i++;
+		if (SL_CMPF(sl)(cmax, min) < 0) {
+			continue;
+		}
+		if (SL_CMPF(sl)(cmin, max) > 0) {
+			break;
+		}
+		if (top) {
+			int all = SL_CMPF(sl)(min, cmin) <= 0 &&
+			    SL_CMPF(sl)(cmax, max) <= 0;
+			acc = agg_slab(sl, c, min, max, all, acc, buf);
+		} else {
+			acc = agg_subslab_range(sl, c, min, max, acc, buf);
+		}
+	}
+	return (acc);
+}
+
+/*
+ * Makes `sl`, which has to be sorted, keep the aggregate that is made up of
+ * the fold function `f`, the combine function `c`, and the identity `zero`
+ * (see above), so that slablist_aggregate_range() can compute it over any
+ * range without visiting every element. The aggregates of the whole list are
+ * computed here, once. Passing a NULL `f` drops the aggregate. A shared list
+ * can be used by other processes, which can't call our functions, so it can't
+ * have one.
+ */
+int
+slablist_set_aggregate(slablist_t *sl, slablist_fold_t *f, slablist_comb_t *c,
+    slablist_elem_t zero)
+{
+	if (IS_SHM_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	if (!SLIST_SORTED(sl->sl_flags)) {
+		return (SL_ARGORD);
+	}
+	int took = mvcc_enter(sl);
+	slablist_t *held = cow_enter(sl);
+	if (f != NULL && !IS_MAPPED_LIST(sl)) {
+		cow_own_all(sl);
+		agg_reset(sl);
+	}
+	sl->sl_agg_fold = f;
+	sl->sl_agg_comb = c;
+	sl->sl_agg_zero = zero;
+	agg_flush(sl);
+	cow_exit(held);
+	mvcc_exit(sl, took);
+	return (SL_SUCCESS);
+}
+
+/*
+ * Computes the aggregate of the elements of `sl` that are within [min, max]
+ * and stores it in `agg`. Returns SL_ARGNULL if `sl` has no aggregate.
+ */
+int
+slablist_aggregate_range(slablist_t *sl, slablist_elem_t min,
+    slablist_elem_t max, slablist_elem_t *agg)
+{
+	if (sl->sl_agg_fold == NULL) {
+		return (SL_ARGNULL);
+	}
+	SLABLIST_AGGREGATE_BEGIN(sl);
+	slablist_t *held = cow_enter(sl);
+	slablist_elem_t acc = sl->sl_agg_zero;
+	if (sl->sl_elems == 0 || SL_CMPF(sl)(min, max) > 0) {
+		/* The range is empty */
+	} else if (IS_MAPPED_LIST(sl)) {
+		acc = slablist_fold_range_mapped(sl, sl->sl_agg_fold, min, max,
+		    acc, 0);
+	} else if (IS_SMALL_LIST(sl)) {
+		acc = slablist_fold_range_sml(sl, sl->sl_agg_fold, min, max,
+		    acc);
+	} else if (sl->sl_sublayers == 0) {
+		slablist_elem_t *buf = mk_decode_buf(sl);
+		slab_t *s = LNK(sl->sl_head);
+		while (s != NULL && SL_CMPF(sl)(s->s_min, max) <= 0) {
+			if (SL_CMPF(sl)(s->s_max, min) >= 0) {
+				int all = SL_CMPF(sl)(min, s->s_min) <= 0 &&
+				    SL_CMPF(sl)(s->s_max, max) <= 0;
+				acc = agg_slab(sl, s, min, max, all, acc, buf);
+			}
+			s = LNK(s->s_next);
+		}
+		rm_decode_buf(sl, buf);
+	} else {
+		slablist_elem_t *buf = mk_decode_buf(sl);
+		slablist_t *base = LNK(sl->sl_baselayer);
+		subslab_t *ss = LNK(base->sl_head);
+		uint64_t i = 0;
+		while (i < base->sl_slabs &&
+		    SL_CMPF(sl)(ss->ss_min, max) <= 0) {
+			if (SL_CMPF(sl)(ss->ss_max, min) >= 0) {
+				acc = agg_subslab_range(sl, ss, min, max, acc,
+				    buf);
+			}
+			ss = LNK(ss->ss_next);
+			i++;
+		}
+		rm_decode_buf(sl, buf);
+	}
+	if (SLABLIST_TEST_AGGREGATE_ENABLED()) {
+		SLABLIST_TEST_AGGREGATE(test_aggregate(sl, min, max, acc));
+	}
+	cow_exit(held);
+	*agg = acc;
+	SLABLIST_AGGREGATE_END(acc);
+	return (SL_SUCCESS);
+}
@@ -34,3 +34,20 @@ extern void attach_sublayer(slablist_t *);
 extern void detach_sublayer(slablist_t *);
 extern void try_reap(slablist_t *);
 extern void try_reap_all(slablist_t *);
+extern slab_t *get_spare_slab(slablist_t *);
+extern subslab_t *get_spare_subslab(slablist_t *);
+extern void put_spare_slab(slablist_t *, slab_t *);
+extern void free_slab(slablist_t *, slab_t *);
+extern void put_spare_subslab(slablist_t *, subslab_t *);
+extern void rm_spares(slablist_t *);
+extern slablist_elem_t cold_slab_elem(slab_t *, int);
+extern slablist_elem_t narrow_elem(uint32_t);
+extern slablist_elem_t slab_val(slab_t *, int);
+extern void slab_move(slab_t *, uint64_t, slab_t *, uint64_t, uint64_t);
+extern void set_caps(slablist_t *);
+extern slablist_elem_t *slab_elems(slab_t *, slablist_elem_t *);
+extern slablist_elem_t *mk_decode_buf(slablist_t *);
+extern void rm_decode_buf(slablist_t *, slablist_elem_t *);
+extern slab_t *thaw_slab(slab_t *);
+extern slab_t *thaw_slab_nbrs(slab_t *);
+extern void thaw_slabs(slablist_t *);
@@ -34,7 +34,7 @@
 slab_t *
 slab_get_elem_pos_old(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 {
-	slab_t *slab = sl->sl_head;
+	slab_t *slab = LNK(sl->sl_head);
 	uint64_t i;
 	uint64_t ecnt = 0;
 	uint64_t mod;
@@ -77,7 +77,7 @@ slab_get_elem_pos_old(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 			return (slab);
 		}
 
-		slab = slab->s_next;
+		slab = LNK(slab->s_next);
 		i++;
 	}
 	return (slab);
@@ -93,7 +93,7 @@ slab_t *
 slab_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 {
 	SLABLIST_GET_POS_BEGIN(sl, pos);
-	slab_t *slab = sl->sl_head;
+	slab_t *slab = LNK(sl->sl_head);
 	/* get the slab that contains the value at this position */
 	uint64_t act_pos;
 
@@ -115,7 +115,7 @@ slab_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 
 	if (act_pos == 0) {
 		*off_pos = 0;
-		return (sl->sl_head);
+		return (LNK(sl->sl_head));
 	}
 
 	uint64_t sum_usr_elems = 0;
@@ -126,20 +126,20 @@ slab_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 		while (i < sl->sl_slabs) {
 			sum_usr_elems += slab->s_elems;
 
-			if (sum_usr_elems >= act_pos) {
+			if (sum_usr_elems > act_pos) {
 				elems_skipped = sum_usr_elems - slab->s_elems;
 				*off_pos = act_pos - elems_skipped;
 				return (slab);
 			}
 
 			SLABLIST_GET_POS_TOP_WALK(slab);
-			slab = slab->s_next;
+			slab = LNK(slab->s_next);
 			i++;
 		}
 	}
 
-	slablist_t *bl = sl->sl_baselayer;
-	subslab_t *b = bl->sl_head;
+	slablist_t *bl = LNK(sl->sl_baselayer);
+	subslab_t *b = LNK(bl->sl_head);
 	uint16_t layers = bl->sl_layer;
 	uint16_t layer = 0;
 	/*
@@ -149,7 +149,7 @@ slab_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 	while (sum_usr_elems < act_pos) {
 		sum_usr_elems += b->ss_usr_elems;
 		SLABLIST_GET_POS_BASE_WALK(b);
-		b = b->ss_next;
+		b = LNK(b->ss_next);
 	}
 
 	/*
@@ -172,7 +172,7 @@ slab_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 		while (sum_usr_elems < act_pos) {
 			sum_usr_elems += c->ss_usr_elems;
 			SLABLIST_GET_POS_SUB_WALK(c);
-			c = c->ss_next;
+			c = LNK(c->ss_next);
 		}
 		b = c;
 		elems_skipped = sum_usr_elems - b->ss_usr_elems;
@@ -188,7 +188,7 @@ slab_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 	while (sum_usr_elems < act_pos) {
 		sum_usr_elems += s->s_elems;
 		SLABLIST_GET_POS_TOP_WALK(s);
-		s = s->s_next;
+		s = LNK(s->s_next);
 	}
 
 	elems_skipped = sum_usr_elems - s->s_elems;
@@ -208,14 +208,14 @@ slab_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
 slab_t *
 slab_get_pos(slablist_t *sl, uint64_t pos)
 {
-	slab_t *slab = sl->sl_head;
+	slab_t *slab = LNK(sl->sl_head);
 	uint64_t i;
 	uint64_t mod;
 
 	/* get the slab that is of this number */
 
 	if (pos == 0) {
-		return (sl->sl_head);
+		return (LNK(sl->sl_head));
 	}
 
 	if (sl->sl_slabs < pos && !SLIST_IS_CIRCULAR(sl->sl_flags)) {
@@ -229,7 +229,7 @@ slab_get_pos(slablist_t *sl, uint64_t pos)
 	}
 
 	for (i = 0; i < mod; i++) {
-		slab = slab->s_next;
+		slab = LNK(slab->s_next);
 	}
 
 	return (slab);
@@ -258,16 +258,175 @@ sml_node_get(slablist_t *sl, uint64_t pos)
 		mod = pos % sl->sl_elems;
 	}
 
-	small_list_t *s = sl->sl_head;
+	small_list_t *s = LNK(sl->sl_head);
 
 	uint64_t i;
 	for (i = 0; i < mod; i++) {
-		s = s->sml_next;
+		s = LNK(s->sml_next);
 	}
 
 	return (s);
 }
 
+/*
+ * Mapped Lists
+ *
+ * These are the read paths for lists opened with slablist_open_mapped(). See
+ * slablist_mhdr_t in slablist_impl.h for the layout that they walk. The slabs
+ * are stored back to back, so stepping to an adjacent slab is just pointer
+ * arithmetic.
+ */
+
+mslab_t *
+mapped_slab_next(slablist_t *sl, mslab_t *s)
+{
+	if (s == MAPPED_SLAB(sl, sl->sl_slabs - 1)) {
+		return (NULL);
+	}
+	return ((mslab_t *)((char *)s + MSLAB_BYTES(sl->sl_map->sm_selem_max)));
+}
+
+mslab_t *
+mapped_slab_prev(slablist_t *sl, mslab_t *s)
+{
+	if (s == MAPPED_SLAB(sl, 0)) {
+		return (NULL);
+	}
+	return ((mslab_t *)((char *)s - MSLAB_BYTES(sl->sl_map->sm_selem_max)));
+}
+
+/*
+ * Returns the index of the first element in `s` that is not less than `elem`.
+ * This is `ms_elems` if there is no such element.
+ */
+uint64_t
+mapped_slab_srch(slablist_t *sl, mslab_t *s, slablist_elem_t elem)
+{
+	slablist_elem_t *arr = MSLAB_ARR(s);
+	uint64_t min = 0;
+	uint64_t max = s->ms_elems;
+	while (min < max) {
+		uint64_t mid = (min + max) >> 1;
+		if (SL_CMPF(sl)(elem, arr[mid]) > 0) {
+			min = mid + 1;
+		} else {
+			max = mid;
+		}
+	}
+	return (min);
+}
+
+/*
+ * Returns the offset of the first slab or subslab referenced by `ss`, whose
+ * maximum is not less than `elem`, or of the last one if there is no such slab.
+ * Both kinds of slab start with their extrema, so we don't care which we have.
+ */
+static uint64_t
+mapped_subslab_srch(slablist_t *sl, msubslab_t *ss, slablist_elem_t elem)
+{
+	uint64_t *offs = MSUBSLAB_OFFS(ss);
+	uint64_t min = 0;
+	uint64_t max = ss->mss_elems - 1;
+	while (min < max) {
+		uint64_t mid = (min + max) >> 1;
+		mslab_t *s = MAPPED_AT(sl, offs[mid]);
+		if (SL_CMPF(sl)(elem, s->ms_max) > 0) {
+			min = mid + 1;
+		} else {
+			max = mid;
+		}
+	}
+	return (offs[min]);
+}
+
+/*
+ * Finds the slab into which `elem` could fit. Just like find_bubble_up(), we
+ * scan the baselayer and do a binary search in each layer above it.
+ */
+mslab_t *
+mapped_find_slab(slablist_t *sl, slablist_elem_t elem)
+{
+	slablist_mhdr_t *m = sl->sl_map;
+	uint64_t i = 0;
+	if (m->sm_layers == 0) {
+		mslab_t *s = MAPPED_SLAB(sl, 0);
+		while (i < m->sm_slabs - 1 &&
+		    SL_CMPF(sl)(elem, s->ms_max) > 0) {
+			s = mapped_slab_next(sl, s);
+			i++;
+		}
+		return (s);
+	}
+	uint64_t stride = MSUBSLAB_BYTES(m->sm_subelem_max);
+	msubslab_t *ss = MAPPED_AT(sl, m->sm_base_off);
+	while (i < m->sm_base_slabs - 1 &&
+	    SL_CMPF(sl)(elem, ss->mss_max) > 0) {
+		ss = (msubslab_t *)((char *)ss + stride);
+		i++;
+	}
+	int layer = m->sm_layers;
+	while (layer > 1) {
+		ss = MAPPED_AT(sl, mapped_subslab_srch(sl, ss, elem));
+		layer--;
+	}
+	return (MAPPED_AT(sl, mapped_subslab_srch(sl, ss, elem)));
+}
+
+/*
+ * Finds the slab that holds the element at position `pos`, and the offset of
+ * that element in the slab, using the element counts in the index.
+ */
+static mslab_t *
+mapped_get_elem_pos(slablist_t *sl, uint64_t pos, uint64_t *off_pos)
+{
+	slablist_mhdr_t *m = sl->sl_map;
+	/*
+	 * Positions past the end are only meaningful for circular lists, but
+	 * we wrap them either way, instead of reading past the mapping.
+	 */
+	if (pos >= m->sm_elems) {
+		pos %= m->sm_elems;
+	}
+	mslab_t *s;
+	if (m->sm_layers == 0) {
+		s = MAPPED_SLAB(sl, 0);
+		while (pos >= s->ms_elems) {
+			pos -= s->ms_elems;
+			s = mapped_slab_next(sl, s);
+		}
+		*off_pos = pos;
+		return (s);
+	}
+	uint64_t stride = MSUBSLAB_BYTES(m->sm_subelem_max);
+	msubslab_t *ss = MAPPED_AT(sl, m->sm_base_off);
+	while (pos >= ss->mss_usr_elems) {
+		pos -= ss->mss_usr_elems;
+		ss = (msubslab_t *)((char *)ss + stride);
+	}
+	uint64_t i;
+	int layer = m->sm_layers;
+	while (layer > 1) {
+		i = 0;
+		msubslab_t *up = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[i]);
+		while (pos >= up->mss_usr_elems) {
+			pos -= up->mss_usr_elems;
+			i++;
+			up = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[i]);
+		}
+		ss = up;
+		layer--;
+	}
+	i = 0;
+	s = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[i]);
+	while (pos >= s->ms_elems) {
+		pos -= s->ms_elems;
+		i++;
+		s = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[i]);
+	}
+	*off_pos = pos;
+	return (s);
+}
+
 /*
  * NOTE: the lowest possible value for `pos` is 0
  */
@@ -278,13 +437,20 @@ slablist_get(slablist_t *sl, uint64_t pos)
 	uint64_t off_pos = 0;
 	slab_t *s;
 	small_list_t *sml = NULL;
-	if (IS_SMALL_LIST(sl)) {
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	if (IS_MAPPED_LIST(sl)) {
+		mslab_t *ms = mapped_get_elem_pos(sl, pos, &off_pos);
+		ret = MSLAB_ARR(ms)[off_pos];
+	} else if (IS_SMALL_LIST(sl)) {
 		sml = sml_node_get(sl, pos);
 		ret = sml->sml_data;
 	} else {
 		s = slab_get_elem_pos(sl, pos, &off_pos);
-		ret = s->s_arr[off_pos];
+		ret = SLAB_ELEM(s, off_pos);
 	}
+	cow_exit(held);
+	shm_exit(sl, took);
 
 	return (ret);
 }
@@ -293,13 +459,17 @@ slablist_elem_t
 slablist_head(slablist_t *sl)
 {
 	slablist_elem_t ret;
-	if (IS_SMALL_LIST(sl)) {
-		small_list_t *sh = sl->sl_head;
+	slablist_t *held = cow_enter(sl);
+	if (IS_MAPPED_LIST(sl)) {
+		ret = MAPPED_SLAB(sl, 0)->ms_min;
+	} else if (IS_SMALL_LIST(sl)) {
+		small_list_t *sh = LNK(sl->sl_head);
 		ret = sh->sml_data;
 	} else {
-		slab_t *h = sl->sl_head;
+		slab_t *h = LNK(sl->sl_head);
 		ret = h->s_min;
 	}
+	cow_exit(held);
 	return (ret);
 }
 
@@ -307,19 +477,30 @@ slablist_elem_t
 slablist_end(slablist_t *sl)
 {
 	slablist_elem_t ret;
-	if (IS_SMALL_LIST(sl)) {
-		small_list_t *sh = sl->sl_end;
+	slablist_t *held = cow_enter(sl);
+	if (IS_MAPPED_LIST(sl)) {
+		ret = MAPPED_SLAB(sl, sl->sl_slabs - 1)->ms_max;
+	} else if (IS_SMALL_LIST(sl)) {
+		small_list_t *sh = LNK(sl->sl_end);
 		ret = sh->sml_data;
 	} else {
-		slab_t *h = sl->sl_end;
+		slab_t *h = LNK(sl->sl_end);
 		ret = h->s_max;
 	}
+	cow_exit(held);
 	return (ret);
 }
 
 int
 slablist_cur(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
 {
+	if (IS_MAPPED_LIST(sl)) {
+		if (b->sb_node != NULL) {
+			*e = MSLAB_ARR((mslab_t *)b->sb_node)[b->sb_index];
+			return (0);
+		}
+		return (-1);
+	}
 	if (IS_SMALL_LIST(sl)) {
 		if (b->sb_node != NULL) {
 			small_list_t *sm = b->sb_node;
@@ -329,38 +510,93 @@ slablist_cur(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
 	}
 	if (b->sb_node != NULL) {
 		slab_t *s = b->sb_node;
-		*e = s->s_arr[(uint64_t)(b->sb_index)];
+		*e = SLAB_ELEM(s, (uint64_t)(b->sb_index));
 		return (0);
 	}
 	return (-1);
 }
 
+static int
+mapped_next(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
+{
+	mslab_t *s = b->sb_node;
+	if (sl->sl_elems == 0) {
+		return (-1);
+	}
+	if (s == NULL) {
+		s = MAPPED_SLAB(sl, 0);
+		b->sb_index = 0;
+	} else {
+		b->sb_index++;
+		if ((uint64_t)b->sb_index == s->ms_elems) {
+			s = mapped_slab_next(sl, s);
+			b->sb_index = 0;
+		}
+	}
+	b->sb_node = s;
+	if (s == NULL) {
+		return (-1);
+	}
+	*e = MSLAB_ARR(s)[b->sb_index];
+	return (0);
+}
+
+static int
+mapped_prev(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
+{
+	mslab_t *s = b->sb_node;
+	if (sl->sl_elems == 0) {
+		return (-1);
+	}
+	if (s == NULL) {
+		s = MAPPED_SLAB(sl, sl->sl_slabs - 1);
+		b->sb_index = s->ms_elems - 1;
+	} else {
+		b->sb_index--;
+		if (b->sb_index < 0) {
+			s = mapped_slab_prev(sl, s);
+			if (s != NULL) {
+				b->sb_index = s->ms_elems - 1;
+			}
+		}
+	}
+	b->sb_node = s;
+	if (s == NULL) {
+		return (-1);
+	}
+	*e = MSLAB_ARR(s)[b->sb_index];
+	return (0);
+}
+
 /*
  * 0 is success, -1 is end.
  */
-int
-slablist_next(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
+static int
+next_impl(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
 {
 	b->sb_list = sl;
 	slab_t *s;
 	small_list_t *sml;
 	int i;
+	if (IS_MAPPED_LIST(sl)) {
+		return (mapped_next(sl, b, e));
+	}
 	if (b->sb_node == NULL) {
 		if (IS_SMALL_LIST(sl)) {
-			sml = sl->sl_head;
+			sml = LNK(sl->sl_head);
 			b->sb_node = sml;
 			*e = sml->sml_data;
 		} else {
-			s = sl->sl_head;
+			s = LNK(sl->sl_head);
 			b->sb_node = s;
 			b->sb_index = 0;
-			*e = s->s_arr[0];
+			*e = SLAB_ELEM(s, 0);
 		}
 		return (0);
 	}
 	if (IS_SMALL_LIST(sl)) {
 		sml = b->sb_node;
-		b->sb_node = sml->sml_next;
+		b->sb_node = LNK(sml->sml_next);
 		if (b->sb_node == NULL) {
 			return (-1);
 		}
@@ -372,40 +608,52 @@ slablist_next(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
 		b->sb_index++;
 		i = b->sb_index;
 		if (b->sb_index == s->s_elems) {
-			b->sb_node = s->s_next;
-			s = s->s_next;
+			b->sb_node = LNK(s->s_next);
+			s = LNK(s->s_next);
 			b->sb_index = 0;
 			i = 0;
 			if (s == NULL) {
 				return (-1);
 			}
 		}
-		*e = s->s_arr[i];
+		*e = SLAB_ELEM(s, i);
 		return (0);
 	}
 }
 
 int
-slablist_prev(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
+slablist_next(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
+{
+	slablist_t *held = cow_enter(sl);
+	int r = next_impl(sl, b, e);
+	cow_exit(held);
+	return (r);
+}
+
+static int
+prev_impl(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
 {
 	b->sb_list = sl;
 	slab_t *s;
 	small_list_t *prev = NULL;
 	small_list_t *sml = NULL;
 	int i;
+	if (IS_MAPPED_LIST(sl)) {
+		return (mapped_prev(sl, b, e));
+	}
 	if (b->sb_node == NULL) {
 		if (IS_SMALL_LIST(sl)) {
-			sml = sl->sl_end;
+			sml = LNK(sl->sl_end);
 			b->sb_node = sml;
 			*e = sml->sml_data;
 		} else {
-			s = sl->sl_end;
+			s = LNK(sl->sl_end);
 			b->sb_node = s;
 			b->sb_index = s->s_elems - 1;
 			/*
 			 * Unless we cast the index to type `int`, GCC will
 			 * spew some warnings about a subscript of type 'char'.
-			 * The subcript is of type int8_t, and GCC is warning
+			 * The subcript is of type int16_t, and GCC is warning
 			 * us that we might end up with a negative index. We
 			 * use the negative index later on in the code to
 			 * determine if we've passed the beginning of a slab.
@@ -413,18 +661,18 @@ slablist_prev(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
 			 * non-issue. We're just tricking it into thinking that
 			 * everything is OK.
 			 */
-			*e = s->s_arr[(int)(b->sb_index)];
+			*e = SLAB_ELEM(s, (int)(b->sb_index));
 		}
 		return (0);
 	}
 	if (IS_SMALL_LIST(sl)) {
-		if (sl->sl_elems == 1 && sl->sl_head == b->sb_node) {
+		if (sl->sl_elems == 1 && LNK(sl->sl_head) == b->sb_node) {
 			return (-1);
 		}
-		sml = sl->sl_head;
+		sml = LNK(sl->sl_head);
 		while (sml != b->sb_node) {
 			prev = sml;
-			sml = sml->sml_next;
+			sml = LNK(sml->sml_next);
 		}
 		b->sb_node = prev;
 		if (prev == NULL) {
@@ -437,22 +685,32 @@ slablist_prev(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
 		b->sb_index--;
 		i = b->sb_index;
 		if (b->sb_index < 0) {
-			b->sb_node = s->s_prev;
-			s = s->s_prev;
+			b->sb_node = LNK(s->s_prev);
+			s = LNK(s->s_prev);
 			if (s == NULL) {
 				return (-1);
 			}
 			i = s->s_elems - 1;
 			b->sb_index = i;
 		}
-		*e = s->s_arr[i];
+		*e = SLAB_ELEM(s, i);
 		return (0);
 	}
 }
 
+int
+slablist_prev(slablist_t *sl, slablist_bm_t *b, slablist_elem_t *e)
+{
+	slablist_t *held = cow_enter(sl);
+	int r = prev_impl(sl, b, e);
+	cow_exit(held);
+	return (r);
+}
+
 
 
 extern void link_slab(slab_t *, slab_t *, int);
+extern int find_bubble_up(slablist_t *, slablist_elem_t, slab_t **);
 
 /*
  * Searching A Slab
@@ -490,10 +748,10 @@ subslab_t *
 list_get_last_subslab(slablist_t *sl, slablist_elem_t elem, subslab_t *s)
 {
 	subslab_t *tmp = s;
-	while (tmp->ss_next != NULL &&
-	    sl->sl_bnd_elem(elem, tmp->ss_next->ss_min,
-	    tmp->ss_next->ss_max) >= 0) {
-		tmp = tmp->ss_next;
+	while (LNK(tmp->ss_next) != NULL &&
+	    SL_BNDF(sl)(elem, LNK(tmp->ss_next)->ss_min,
+	    LNK(tmp->ss_next)->ss_max) >= 0) {
+		tmp = LNK(tmp->ss_next);
 	}
 	return (tmp);
 }
@@ -505,10 +763,10 @@ slab_t *
 list_get_last_slab(slablist_t *sl, slablist_elem_t elem, slab_t *s)
 {
 	slab_t *tmp = s;
-	while (tmp->s_next != NULL &&
-	    sl->sl_bnd_elem(elem, tmp->s_next->s_min,
-	    tmp->s_next->s_max) >= 0) {
-		tmp = tmp->s_next;
+	while (LNK(tmp->s_next) != NULL &&
+	    SL_BNDF(sl)(elem, LNK(tmp->s_next)->s_min,
+	    LNK(tmp->s_next)->s_max) >= 0) {
+		tmp = LNK(tmp->s_next);
 	}
 	return (tmp);
 }
@@ -528,7 +786,7 @@ subslab_get_last_subslab(slablist_t *sl, slablist_elem_t elem, subslab_t *s,
 	int j = i;
 	while (j < s->ss_elems) {
 		subslab_t *ss = GET_SUBSLAB_ELEM(s, j);
-		if (sl->sl_bnd_elem(elem, ss->ss_min, ss->ss_max) < 0) {
+		if (SL_BNDF(sl)(elem, ss->ss_min, ss->ss_max) < 0) {
 			break;
 		}
 		j++;
@@ -556,7 +814,7 @@ subslab_get_last_slab(slablist_t *sl, slablist_elem_t elem, subslab_t *s,
 	int j = i;
 	while (j < s->ss_elems) {
 		slab_t *ss = GET_SUBSLAB_ELEM(s, j);
-		if (sl->sl_bnd_elem(elem, ss->s_min, ss->s_max) < 0) {
+		if (SL_BNDF(sl)(elem, ss->s_min, ss->s_max) < 0) {
 			break;
 		}
 		j++;
@@ -580,12 +838,82 @@ int
 slab_get_last_elem(slablist_t *sl, slablist_elem_t elem, slab_t *s, int i)
 {
 	int j = i;
-	while (j < s->s_elems && sl->sl_cmp_elem(elem, s->s_arr[j]) >= 0) {
+	while (j < s->s_elems && SL_CMPF(sl)(elem, SLAB_ELEM(s, j)) >= 0) {
 		j++;
 	}
 	return (j);
 }
 
+/*
+ * A list with prefixes (see slablist_set_prefix()) compares an element `elem`,
+ * whose prefix is `ep`, to another element by comparing their prefixes first.
+ * Since prefixes never disagree with the comparison function, the comparison
+ * function only has to be called if the prefixes are equal. The extrema of a
+ * slab are its first and last elements, so the prefixes of those elements can
+ * do the same for bounds checks. A subslab has the extrema of its first and
+ * last slabs, which we get to without touching any of the elements.
+ */
+static int
+pfx_cmp(slablist_t *sl, slablist_elem_t elem, uint64_t ep, slab_t *s, int i)
+{
+	if (SLIST_HAS_PFX(sl)) {
+		uint64_t p = SLAB_PFX(s, i);
+		if (ep != p) {
+			return (ep < p ? -1 : 1);
+		}
+	}
+	return (SL_CMPF(sl)(elem, SLAB_ELEM(s, i)));
+}
+
+static int
+slab_bnd(slablist_t *sl, slablist_elem_t elem, uint64_t ep, slab_t *s)
+{
+	if (SLIST_HAS_PFX(sl) && s->s_elems > 0) {
+		uint64_t lo = SLAB_PFX(s, 0);
+		uint64_t hi = SLAB_PFX(s, s->s_elems - 1);
+		if (ep < lo) {
+			return (FS_UNDER_RANGE);
+		}
+		if (ep > hi) {
+			return (FS_OVER_RANGE);
+		}
+		if (lo < ep && ep < hi) {
+			return (FS_IN_RANGE);
+		}
+	}
+	return (SL_BNDF(sl)(elem, s->s_min, s->s_max));
+}
+
+static slab_t *
+subslab_edge(subslab_t *ss, int last)
+{
+	while (LNK(ss->ss_list)->sl_layer > 1) {
+		ss = GET_SUBSLAB_ELEM(ss, last ? ss->ss_elems - 1 : 0);
+	}
+	return (GET_SUBSLAB_ELEM(ss, last ? ss->ss_elems - 1 : 0));
+}
+
+static int
+subslab_bnd(slablist_t *sl, slablist_elem_t elem, uint64_t ep, subslab_t *ss)
+{
+	if (SLIST_HAS_PFX(sl) && ss->ss_elems > 0) {
+		slab_t *f = subslab_edge(ss, 0);
+		slab_t *l = subslab_edge(ss, 1);
+		uint64_t lo = SLAB_PFX(f, 0);
+		uint64_t hi = SLAB_PFX(l, l->s_elems - 1);
+		if (ep < lo) {
+			return (FS_UNDER_RANGE);
+		}
+		if (ep > hi) {
+			return (FS_OVER_RANGE);
+		}
+		if (lo < ep && ep < hi) {
+			return (FS_IN_RANGE);
+		}
+	}
+	return (SL_BNDF(sl)(elem, ss->ss_min, ss->ss_max));
+}
+
 /*
  * Binary search for `elem` in slab `s`.
  */
@@ -595,13 +923,13 @@ slab_bin_srch(slablist_elem_t elem, slab_t *s)
 	int min = 0;
 	int max = s->s_elems - 1;
 	int c = 0;
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
+	uint64_t ep = ELEM_PFX(sl, elem);
 	while (max >= min) {
 		int mid = (min + max) >> 1;
-		slablist_elem_t mid_elem = s->s_arr[mid];
-		SLABLIST_SLAB_BIN_SRCH(s, mid_elem, mid);
-		c = sl->sl_cmp_elem(elem, mid_elem);
+		SLABLIST_SLAB_BIN_SRCH(s, SLAB_ELEM(s, mid), mid);
+		c = pfx_cmp(sl, elem, ep, s, mid);
 		if (c > 0) {
 			min = mid + 1;
 			continue;
@@ -633,7 +961,7 @@ slab_bin_srch(slablist_elem_t elem, slab_t *s)
 	 * be larger. This is because all of our code insertion code assumes
 	 * that we return the index that we want to insert `elem` _at_.
 	 */
-	if (sl->sl_cmp_elem(elem, s->s_arr[min]) > 0) {
+	if (pfx_cmp(sl, elem, ep, s, min) > 0) {
 		if (sorting) {
 			return (slab_get_last_elem(sl, elem, s, min + 1));
 		}
@@ -652,11 +980,11 @@ slab_bin_srch(slablist_elem_t elem, slab_t *s)
 int
 slab_lin_srch(slablist_elem_t elem, slab_t *s)
 {
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 	int i = 0;
 	while (i < s->s_elems &&
-	    sl->sl_cmp_elem(elem, s->s_arr[i]) > 0) {
+	    SL_CMPF(sl)(elem, SLAB_ELEM(s, i)) > 0) {
 		i++;
 	}
 	if (sorting) {
@@ -674,14 +1002,14 @@ subslab_bin_srch(slablist_elem_t elem, subslab_t *s)
 	int min = 0;
 	int max = s->ss_elems - 1;
 	int c = 0;
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
+	uint64_t ep = ELEM_PFX(sl, elem);
 	while (max >= min) {
 		int mid = (min + max) >> 1;
 		void *mid_elem = GET_SUBSLAB_ELEM(s, mid);
 		SLABLIST_SUBSLAB_BIN_SRCH(s, (subslab_t *)mid_elem, mid);
-		c = sl->sl_bnd_elem(elem, ((subslab_t *)mid_elem)->ss_min,
-			((subslab_t *)mid_elem)->ss_max);
+		c = subslab_bnd(sl, elem, ep, (subslab_t *)mid_elem);
 		if (c > 0) {
 			min = mid + 1;
 			continue;
@@ -709,7 +1037,7 @@ subslab_bin_srch(slablist_elem_t elem, subslab_t *s)
 	}
 
 	subslab_t *minss = GET_SUBSLAB_ELEM(s, min);
-	c = sl->sl_bnd_elem(elem, minss->ss_min, minss->ss_max);
+	c = subslab_bnd(sl, elem, ep, minss);
 	/*
 	 * If the binary search took us to an element that is smaller than
 	 * `elem`, we return the index of the next element, which is likely to
@@ -740,10 +1068,10 @@ subslab_lin_srch(slablist_elem_t elem, subslab_t *s)
 	slablist_elem_t e;
 	e.sle_p = GET_SUBSLAB_ELEM(s, i);
 	subslab_t *eptr = e.sle_p;
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 	while (i < s->ss_elems &&
-	    sl->sl_bnd_elem(elem, eptr->ss_min, eptr->ss_max) > 0) {
+	    SL_BNDF(sl)(elem, eptr->ss_min, eptr->ss_max) > 0) {
 		e.sle_p = GET_SUBSLAB_ELEM(s, i);
 		eptr = e.sle_p;
 		i++;
@@ -763,16 +1091,16 @@ subslab_bin_srch_top(slablist_elem_t elem, subslab_t *s)
 	int min = 0;
 	int max = s->ss_elems - 1;
 	int c = 0;
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
-	void **arr = s->ss_arr->sa_data;
+	void **arr = LNK(s->ss_arr)->sa_data;
+	uint64_t ep = ELEM_PFX(sl, elem);
 	if (!sorting) {
 		while (max >= min) {
 			int mid = (min + max) >> 1;
-			void *mid_elem = arr[mid];
+			void *mid_elem = LNK(arr[mid]);
 			slab_t *mid_slab = (slab_t *)mid_elem;
-			c = sl->sl_bnd_elem(elem, mid_slab->s_min,
-				mid_slab->s_max);
+			c = slab_bnd(sl, elem, ep, mid_slab);
 			if (c > 0) {
 				min = mid + 1;
 				continue;
@@ -786,9 +1114,9 @@ subslab_bin_srch_top(slablist_elem_t elem, subslab_t *s)
 	} else {
 		while (max >= min) {
 			int mid = (min + max) >> 1;
-			void *mid_elem = arr[mid];
+			void *mid_elem = LNK(arr[mid]);
 			slab_t *mid_slab = (slab_t *)mid_elem;
-			c = sl->sl_bnd_elem(elem, mid_slab->s_min,
+			c = SL_BNDF(sl)(elem, mid_slab->s_min,
 				mid_slab->s_max);
 			if (c > 0) {
 				min = mid + 1;
@@ -819,7 +1147,7 @@ subslab_bin_srch_top(slablist_elem_t elem, subslab_t *s)
 	 * be larger. This is because all of our code insertion code assumes
 	 * that we return the index that we want to insert `elem` _at_.
 	 */
-	if (sl->sl_bnd_elem(elem, tmp->s_min, tmp->s_max) > 0) {
+	if (slab_bnd(sl, elem, ep, tmp) > 0) {
 		if (sorting) {
 			return (subslab_get_last_slab(sl, elem, s, min + 1));
 		}
@@ -842,10 +1170,10 @@ subslab_lin_srch_top(slablist_elem_t elem, subslab_t *s)
 	slablist_elem_t e;
 	e.sle_p = GET_SUBSLAB_ELEM(s, i);
 	slab_t *eptr = e.sle_p;
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 	while (i < s->ss_elems &&
-	    sl->sl_bnd_elem(elem, eptr->s_min, eptr->s_max) > 0) {
+	    SL_BNDF(sl)(elem, eptr->s_min, eptr->s_max) > 0) {
 		e.sle_p = GET_SUBSLAB_ELEM(s, i);
 		eptr = e.sle_p;
 		i++;
@@ -867,7 +1195,7 @@ find_subslab_in_subslab(subslab_t *s, slablist_elem_t elem, subslab_t **found)
 {
 	int x = 0;
 	x = subslab_bin_srch(elem, s);
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 	/*
 	 * If we get an index `x` that is larger than the index of the last
@@ -887,9 +1215,9 @@ find_subslab_in_subslab(subslab_t *s, slablist_elem_t elem, subslab_t **found)
 
 	subslab_t *found2 = GET_SUBSLAB_ELEM(s, x);
 
-	int r = sl->sl_bnd_elem(elem, found2->ss_min, found2->ss_max);
+	int r = subslab_bnd(sl, elem, ELEM_PFX(sl, elem), found2);
 	if (sorting && r == FS_IN_RANGE) {
-		if (sl->sl_cmp_elem(elem, found2->ss_max) == 0) {
+		if (SL_CMPF(sl)(elem, found2->ss_max) == 0) {
 			r = FS_OVER_RANGE;
 		}
 	}
@@ -904,7 +1232,7 @@ find_slab_in_subslab(subslab_t *s, slablist_elem_t elem, slab_t **found)
 {
 	int x = 0;
 	x = subslab_bin_srch_top(elem, s);
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 	/*
 	 * If we get an index `x` that is larger than the index of the last
@@ -926,9 +1254,9 @@ find_slab_in_subslab(subslab_t *s, slablist_elem_t elem, slab_t **found)
 
 	*found = next;
 
-	int r = sl->sl_bnd_elem(elem, next->s_min, next->s_max);
+	int r = slab_bnd(sl, elem, ELEM_PFX(sl, elem), next);
 	if (sorting && r == FS_IN_RANGE) {
-		if (sl->sl_cmp_elem(elem, next->s_max) == 0) {
+		if (SL_CMPF(sl)(elem, next->s_max) == 0) {
 			r = FS_OVER_RANGE;
 		}
 	}
@@ -943,8 +1271,9 @@ sub_find_linear_scan(slablist_t *sl, slablist_elem_t elem, subslab_t **found)
 
 	SLABLIST_SUB_LINEAR_SCAN_BEGIN(sl);
 	uint64_t i = 0;
-	subslab_t *s = sl->sl_head;
-	int r = sl->sl_bnd_elem(elem, s->ss_min, s->ss_max);
+	subslab_t *s = LNK(sl->sl_head);
+	uint64_t ep = ELEM_PFX(sl, elem);
+	int r = subslab_bnd(sl, elem, ep, s);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 
 	/*
@@ -960,12 +1289,12 @@ sub_find_linear_scan(slablist_t *sl, slablist_elem_t elem, subslab_t **found)
 
 	while (i < sl->sl_slabs) {
 		SLABLIST_SUB_LINEAR_SCAN(sl, s);
-		r = sl->sl_bnd_elem(elem, s->ss_min, s->ss_max);
+		r = subslab_bnd(sl, elem, ep, s);
 		if (r != FS_OVER_RANGE) {
 			goto end;
 		} else {
-			if (s->ss_next != NULL) {
-				s = s->ss_next;
+			if (LNK(s->ss_next) != NULL) {
+				s = LNK(s->ss_next);
 			} else {
 				goto end;
 			}
@@ -994,8 +1323,9 @@ find_linear_scan(slablist_t *sl, slablist_elem_t elem, slab_t **sbptr)
 
 	SLABLIST_LINEAR_SCAN_BEGIN(sl);
 	uint64_t i = 0;
-	slab_t *s = sl->sl_head;
-	int r = sl->sl_bnd_elem(elem, s->s_min, s->s_max);
+	slab_t *s = LNK(sl->sl_head);
+	uint64_t ep = ELEM_PFX(sl, elem);
+	int r = slab_bnd(sl, elem, ep, s);
 	int sorting = SLIST_IS_SORTING_TEMP(sl->sl_flags);
 
 	/*
@@ -1011,12 +1341,12 @@ find_linear_scan(slablist_t *sl, slablist_elem_t elem, slab_t **sbptr)
 
 	while (i < sl->sl_slabs) {
 		SLABLIST_LINEAR_SCAN(sl, s);
-		r = sl->sl_bnd_elem(elem, s->s_min, s->s_max);
+		r = slab_bnd(sl, elem, ep, s);
 		if (r != FS_OVER_RANGE) {
 			goto end;
 		} else {
-			if (s->s_next != NULL) {
-				s = s->s_next;
+			if (LNK(s->s_next) != NULL) {
+				s = LNK(s->s_next);
 			} else {
 				goto end;
 			}
@@ -1034,7 +1364,7 @@ end:;
 	if (sorting && r == FS_IN_RANGE) {
 		s = list_get_last_slab(sl, elem, s);
 		SLABLIST_LINEAR_SCAN(sl, s);
-		if (sl->sl_cmp_elem(elem, s->s_max) == 0) {
+		if (SL_CMPF(sl)(elem, s->s_max) == 0) {
 			r = FS_OVER_RANGE;
 		}
 	}
@@ -1046,6 +1376,235 @@ end:;
 
 
 
+/*
+ * Root Index
+ *
+ * These functions look up the baselayer subslab from which find_bubble_up()
+ * starts, in a list that has a key function. See slablist_rix_t in
+ * slablist_impl.h.
+ */
+
+void
+rix_destroy(slablist_t *sl)
+{
+	slablist_rix_t *ix = sl->sl_rix;
+	if (ix == NULL) {
+		return;
+	}
+	if (ix->rx_cap > 0) {
+		rm_buf(ix->rx_node, ix->rx_cap * sizeof (subslab_t *));
+		rm_buf(ix->rx_key, ix->rx_cap * sizeof (double));
+	}
+	rm_buf(ix, sizeof (slablist_rix_t));
+	sl->sl_rix = NULL;
+}
+
+static void
+rix_build(slablist_t *sl)
+{
+	slablist_rix_t *ix = sl->sl_rix;
+	slablist_t *base = LNK(sl->sl_baselayer);
+	uint64_t n = base->sl_slabs;
+	if (n > ix->rx_cap) {
+		if (ix->rx_cap > 0) {
+			rm_buf(ix->rx_node, ix->rx_cap * sizeof (subslab_t *));
+			rm_buf(ix->rx_key, ix->rx_cap * sizeof (double));
+		}
+		ix->rx_node = mk_buf(n * sizeof (subslab_t *));
+		ix->rx_key = mk_buf(n * sizeof (double));
+		ix->rx_cap = n;
+	}
+	subslab_t *ss = LNK(base->sl_head);
+	uint64_t i = 0;
+	while (i < n) {
+		ix->rx_node[i] = ss;
+		ix->rx_key[i] = sl->sl_key(ss->ss_min);
+		ss = LNK(ss->ss_next);
+		i++;
+	}
+	ix->rx_nodes = n;
+	ix->rx_gen = sl->sl_base_gen;
+	SLABLIST_ROOT_INDEX_BUILD(sl, n);
+}
+
+/*
+ * Returns the first baselayer subslab whose maximum isn't less than `elem`
+ * (or the last subslab, if there is no such subslab), which is what
+ * sub_find_linear_scan() would return.
+ */
+static subslab_t *
+rix_find(slablist_t *sl, slablist_elem_t elem)
+{
+	if (sl->sl_rix == NULL) {
+		sl->sl_rix = mk_zbuf(sizeof (slablist_rix_t));
+	}
+	slablist_rix_t *ix = sl->sl_rix;
+	if (ix->rx_nodes == 0 || ix->rx_gen != sl->sl_base_gen) {
+		rix_build(sl);
+	}
+	uint64_t n = ix->rx_nodes;
+	double *key = ix->rx_key;
+	double k = sl->sl_key(elem);
+	uint64_t g;
+	if (k <= key[0]) {
+		g = 0;
+	} else if (k >= key[n - 1]) {
+		g = n - 1;
+	} else {
+		g = (uint64_t)(((k - key[0]) / (key[n - 1] - key[0])) *
+		    (n - 1));
+		if (g >= n) {
+			g = n - 1;
+		}
+	}
+
+	/*
+	 * The guess is corrected against the keys that we have, which leaves
+	 * us at the last subslab whose minimum was no greater than `elem`.
+	 */
+	uint64_t j = g;
+	while (j + 1 < n && key[j + 1] <= k) {
+		j++;
+	}
+	while (j > 0 && key[j] > k) {
+		j--;
+	}
+
+	/*
+	 * The extrema may have changed since the index was built, so we make
+	 * sure with the bounds function, moving right past subslabs that are
+	 * entirely below `elem`, or left while the previous subslab isn't.
+	 */
+	subslab_t *ss = ix->rx_node[j];
+	while (LNK(ss->ss_next) != NULL &&
+	    SL_BNDF(sl)(elem, ss->ss_min, ss->ss_max) == FS_OVER_RANGE) {
+		ss = LNK(ss->ss_next);
+	}
+	subslab_t *sp;
+	while ((sp = LNK(ss->ss_prev)) != NULL &&
+	    SL_BNDF(sl)(elem, sp->ss_min, sp->ss_max) != FS_OVER_RANGE) {
+		ss = sp;
+	}
+	SLABLIST_ROOT_INDEX_FIND(sl, g, j);
+	return (ss);
+}
+
+/*
+ * Finds the baselayer subslab from which to start bubbling up. The root index
+ * is built lazily by whoever searches first, so the versions of MVCC lists,
+ * which many readers search at once, scan instead.
+ */
+static void
+find_baseslab(slablist_t *sl, slablist_elem_t elem, subslab_t **found)
+{
+	if (sl->sl_key == NULL || SLIST_IS_SORTING_TEMP(sl->sl_flags) ||
+	    IS_MVCC_VER(sl)) {
+		sub_find_linear_scan(LNK(sl->sl_baselayer), elem, found);
+		return;
+	}
+	*found = rix_find(sl, elem);
+	if (SLABLIST_TEST_ROOT_INDEX_ENABLED()) {
+		SLABLIST_TEST_ROOT_INDEX(test_root_index(sl, elem, *found));
+	}
+}
+
+/*
+ * Makes lookups in `sl` start from a root index over its baselayer, instead
+ * of scanning the baselayer from its head. `k` has to map the elements of `sl`
+ * to numbers in the same order as the comparison function (like the identity
+ * function on integers), so that the index can interpolate between them. The
+ * closer the elements are to being evenly spread out, the closer the first
+ * guess is. Passing a NULL `k` drops the index. Mapped lists have an index of
+ * their own, and the index can't be shared between processes, so neither
+ * mapped nor shared lists can have one.
+ */
+int
+slablist_set_key(slablist_t *sl, slablist_key_t *k)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SHM_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	rix_destroy(sl);
+	sl->sl_key = k;
+	return (SL_SUCCESS);
+}
+
+/*
+ * Makes `sl` keep the prefix of each element, as made by `p`, next to the
+ * element, so that searches can compare most elements by their prefixes alone
+ * (see pfx_cmp()), and only call the comparison function on elements that have
+ * the same prefix as the element that is being searched for. In a list of
+ * pointers to strings, this saves a pointer chase (and likely a cache miss)
+ * per comparison. Prefixes take up 8 bytes per element, so the slabs of `sl`
+ * will hold fewer elements, which is also why `sl` has to be empty, or else
+ * SL_ENEMPTY is returned. Passing a NULL `p` drops the prefixes. Mapped and
+ * shared lists can't have prefixes, and neither can lists that aren't sorted.
+ * Nor can an emptied clone whose old slabs are still used by the rest of its
+ * family, since those slabs go by its settings (see slablist_cow_t). The
+ * compression of a list with prefixes does nothing.
+ */
+int
+slablist_set_prefix(slablist_t *sl, slablist_pfx_t *p)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SHM_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	if (IS_COW_LIST(sl) && sl->sl_cow->cw_refs > 1 && sl->sl_home) {
+		return (SL_ERDONLY);
+	}
+	if (!SLIST_SORTED(sl->sl_flags)) {
+		return (SL_ARGORD);
+	}
+	if (sl->sl_elems != 0 || !IS_SMALL_LIST(sl)) {
+		return (SL_ENEMPTY);
+	}
+	int took = mvcc_enter(sl);
+	/* The spares are the size of the old slabs. */
+	rm_spares(sl);
+	sl->sl_pfx = p;
+	set_caps(sl);
+	mvcc_exit(sl, took);
+	return (SL_SUCCESS);
+}
+
+/*
+ * Finds the slab into which `elem` could fit, like find_bubble_up() and
+ * find_linear_scan() do. Since slab ranges don't overlap, if `elem` is within
+ * the range of the last slab that we found (`sl_last`), that slab is the one,
+ * and we skip the search. This pays off when consecutive operations touch
+ * nearby elements. Everything that frees or replaces a slab makes sure that
+ * `sl_last` doesn't point at it anymore.
+ *
+ * Lists that are being sorted can have runs of duplicates that span slabs, so
+ * they always search. So do shared lists and the versions of MVCC lists,
+ * which are searched by many readers at once.
+ */
+int
+find_slab(slablist_t *sl, slablist_elem_t elem, slab_t **sbptr)
+{
+	int cache = !SLIST_IS_SORTING_TEMP(sl->sl_flags) && !IS_SHM_LIST(sl) &&
+	    !IS_MVCC_VER(sl);
+	slab_t *s = sl->sl_last;
+	if (cache && s != NULL &&
+	    slab_bnd(sl, elem, ELEM_PFX(sl, elem), s) == FS_IN_RANGE) {
+		sl->sl_last_hits++;
+		SLABLIST_LAST_SLAB_HIT(sl, s);
+		*sbptr = s;
+		return (FS_IN_RANGE);
+	}
+	int r;
+	if (sl->sl_sublayers) {
+		r = find_bubble_up(sl, elem, sbptr);
+	} else {
+		r = find_linear_scan(sl, elem, sbptr);
+	}
+	if (cache) {
+		sl->sl_last_misses++;
+		sl->sl_last = *sbptr;
+	}
+	return (r);
+}
+
 /*
  * Finds the slab into which `elem` could fit, by using the base-layer as a
  * starting point.
@@ -1067,7 +1626,7 @@ find_bubble_up(slablist_t *sl, slablist_elem_t elem, slab_t **sbptr)
 	if (sl->sl_sublayers > 1) {
 
 		/* find the baseslab from which to start bubbling up */
-		sub_find_linear_scan(sl->sl_baselayer, elem, &found);
+		find_baseslab(sl, elem, &found);
 		SLABLIST_BUBBLE_UP(sl, found);
 
 		/* Bubble up through all of the sublayers */
@@ -1107,7 +1666,7 @@ find_bubble_up(slablist_t *sl, slablist_elem_t elem, slab_t **sbptr)
 		SLABLIST_BUBBLE_UP_TOP(sl, *sbptr);
 	}
 	if (sl->sl_sublayers == 1) {
-		sub_find_linear_scan(sl->sl_sublayer, elem, &found);
+		find_baseslab(sl, elem, &found);
 		fs = find_slab_in_subslab(found, elem, sbptr);
 		SLABLIST_BUBBLE_UP_TOP(sl, *sbptr);
 	}
@@ -1117,6 +1676,29 @@ find_bubble_up(slablist_t *sl, slablist_elem_t elem, slab_t **sbptr)
 	return (fs);
 }
 
+/*
+ * Does what slablist_range_min() and slablist_range_max() do, on a mapped
+ * list. `elem` is the end of the range that we are looking for.
+ */
+static int
+mapped_range(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t elem,
+    slablist_elem_t min, slablist_elem_t max, slablist_elem_t *ret)
+{
+	if (sl->sl_elems == 0) {
+		return (FS_UNDER_RANGE);
+	}
+	mslab_t *s = mapped_find_slab(sl, elem);
+	uint64_t i = mapped_slab_srch(sl, s, elem);
+	if (i >= s->ms_elems) {
+		i = s->ms_elems - 1;
+	}
+	bm->sb_list = sl;
+	bm->sb_node = s;
+	bm->sb_index = i;
+	*ret = MSLAB_ARR(s)[i];
+	return (SL_BNDF(sl)(*ret, min, max));
+}
+
 /*
  * This function, finds the smallest element within a range, and stores it in
  * `ret`, while also storing a reference to in the bookmark `bm`. This function
@@ -1132,12 +1714,15 @@ int
 slablist_range_min(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t min,
     slablist_elem_t max, slablist_elem_t *ret)
 {
+	if (IS_MAPPED_LIST(sl)) {
+		return (mapped_range(sl, bm, min, min, max, ret));
+	}
 	if (IS_SMALL_LIST(sl)) {
 		int smlret = 0;
 		int smlbnd;
 		while (smlret == 0) {
 			smlret = slablist_next(sl, bm, ret);
-			smlbnd = sl->sl_bnd_elem(*ret, min, max);
+			smlbnd = SL_BNDF(sl)(*ret, min, max);
 			/*
 			 * We have reached the rage. And by virtue of using
 			 * slablist_next, we've filled out the bookmark and the
@@ -1157,6 +1742,7 @@ slablist_range_min(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t min,
 	}
 	slab_t *smin = NULL;
 	int i;
+	slablist_t *held = cow_enter(sl);
 	if (sl->sl_sublayers > 0) {
 		find_bubble_up(sl, min, &smin);
 	} else {
@@ -1175,8 +1761,9 @@ slablist_range_min(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t min,
 	}
 	bm->sb_node = smin;
 	bm->sb_index = i;
-	*ret = smin->s_arr[i];
-	return (sl->sl_bnd_elem(smin->s_arr[i], min, max));
+	*ret = SLAB_ELEM(smin, i);
+	cow_exit(held);
+	return (SL_BNDF(sl)(SLAB_ELEM(smin, i), min, max));
 }
 
 /*
@@ -1186,12 +1773,15 @@ int
 slablist_range_max(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t min,
     slablist_elem_t max, slablist_elem_t *ret)
 {
+	if (IS_MAPPED_LIST(sl)) {
+		return (mapped_range(sl, bm, max, min, max, ret));
+	}
 	if (IS_SMALL_LIST(sl)) {
 		int smlret = 0;
 		int smlbnd;
 		while (smlret == 0) {
 			smlret = slablist_next(sl, bm, ret);
-			smlbnd = sl->sl_bnd_elem(*ret, min, max);
+			smlbnd = SL_BNDF(sl)(*ret, min, max);
 			/*
 			 * We have reached the rage. And by virtue of using
 			 * slablist_next, we've filled out the bookmark and the
@@ -1211,6 +1801,7 @@ slablist_range_max(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t min,
 	}
 	slab_t *smax = NULL;
 	int i;
+	slablist_t *held = cow_enter(sl);
 	if (sl->sl_sublayers > 0) {
 		find_bubble_up(sl, max, &smax);
 	} else {
@@ -1229,52 +1820,880 @@ slablist_range_max(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t min,
 	}
 	bm->sb_node = smax;
 	bm->sb_index = i;
-	*ret = smax->s_arr[i];
-	return (sl->sl_bnd_elem(smax->s_arr[i], min, max));
+	*ret = SLAB_ELEM(smax, i);
+	cow_exit(held);
+	return (SL_BNDF(sl)(SLAB_ELEM(smax, i), min, max));
 }
 
 /*
- * Function tries to find `key` in `sl`, and records the found elem into the
- * user-supplied backpointer `found`.
+ * Ranks
+ *
+ * Every subslab knows how many elements lie beneath it (`ss_usr_elems`), so we
+ * can count the elements that come before a key without looking at them. We
+ * descend the way find_bubble_up() does, but at each subslab we walk its
+ * children from the left, adding up the counts of those whose maximum comes
+ * before the key, and descend into the first one whose maximum doesn't. At
+ * the bottom we do a binary search in a single slab. This costs one pass over
+ * the baselayer plus one pass over a subslab per layer, instead of a pass
+ * over the elements.
+ *
+ * An element comes before `key` if it is less than `key`, or if `incl` is set,
+ * if it is not greater than `key`. That way the same descent can count the
+ * elements on either side of a run of duplicates.
  */
-int
-slablist_find(slablist_t *sl, slablist_elem_t key, slablist_elem_t *found)
-{
+#define	RANK_BEFORE(sl, e, key, incl)	(SL_CMPF((sl))((e), (key)) < (incl))
 
-	SLABLIST_FIND_BEGIN(sl, key);
-	slab_t *potential = NULL;
-	uint64_t i = 0;
-	slablist_elem_t ret;
-	if (IS_SMALL_LIST(sl) && SLIST_SORTED(sl->sl_flags)) {
-		small_list_t *sml = sl->sl_head;
-		while (i < sl->sl_elems &&
-		    sl->sl_cmp_elem(key, sml->sml_data) != 0) {
-			sml = sml->sml_next;
-			i++;
-		}
-		if (sml != NULL) {
-			*found = sml->sml_data;
-			SLABLIST_FIND_END(SL_SUCCESS, *found);
-			return (SL_SUCCESS);
+/*
+ * Returns the number of elements in `s` that come before `key`.
+ */
+static uint64_t
+rank_slab(slablist_t *sl, slab_t *s, slablist_elem_t key, int incl)
+{
+	int min = 0;
+	int max = s->s_elems;
+	while (min < max) {
+		int mid = (min + max) >> 1;
+		if (RANK_BEFORE(sl, SLAB_ELEM(s, mid), key, incl)) {
+			min = mid + 1;
 		} else {
-			SLABLIST_FIND_END(SL_ENFOUND, *found);
-			return (SL_ENFOUND);
+			max = mid;
 		}
 	}
+	return (min);
+}
 
-	if (SLIST_SORTED(sl->sl_flags)) {
-
-		if (sl->sl_sublayers) {
-			find_bubble_up(sl, key, &potential);
+/*
+ * Same as rank_slab(), but for a slab of a mapped list.
+ */
+static uint64_t
+mapped_rank_slab(slablist_t *sl, mslab_t *s, slablist_elem_t key, int incl)
+{
+	slablist_elem_t *arr = MSLAB_ARR(s);
+	uint64_t min = 0;
+	uint64_t max = s->ms_elems;
+	while (min < max) {
+		uint64_t mid = (min + max) >> 1;
+		if (RANK_BEFORE(sl, arr[mid], key, incl)) {
+			min = mid + 1;
 		} else {
-			find_linear_scan(sl, key, &potential);
+			max = mid;
 		}
-
+	}
+	return (min);
+}
+
+/*
+ * Counts the elements of a mapped list that come before `key`, using the
+ * element counts in the index, like mapped_get_elem_pos() does.
+ */
+static uint64_t
+mapped_rank(slablist_t *sl, slablist_elem_t key, int incl)
+{
+	slablist_mhdr_t *m = sl->sl_map;
+	uint64_t r = 0;
+	uint64_t i = 0;
+	mslab_t *s;
+	if (m->sm_layers == 0) {
+		s = MAPPED_SLAB(sl, 0);
+		while (i < m->sm_slabs - 1 &&
+		    RANK_BEFORE(sl, s->ms_max, key, incl)) {
+			r += s->ms_elems;
+			s = mapped_slab_next(sl, s);
+			i++;
+		}
+		return (r + mapped_rank_slab(sl, s, key, incl));
+	}
+	uint64_t stride = MSUBSLAB_BYTES(m->sm_subelem_max);
+	msubslab_t *ss = MAPPED_AT(sl, m->sm_base_off);
+	while (i < m->sm_base_slabs - 1 &&
+	    RANK_BEFORE(sl, ss->mss_max, key, incl)) {
+		r += ss->mss_usr_elems;
+		ss = (msubslab_t *)((char *)ss + stride);
+		i++;
+	}
+	int layer = m->sm_layers;
+	while (layer > 1) {
+		msubslab_t *up = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[0]);
+		i = 0;
+		while (i < ss->mss_elems - 1 &&
+		    RANK_BEFORE(sl, up->mss_max, key, incl)) {
+			r += up->mss_usr_elems;
+			i++;
+			up = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[i]);
+		}
+		ss = up;
+		layer--;
+	}
+	s = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[0]);
+	i = 0;
+	while (i < ss->mss_elems - 1 &&
+	    RANK_BEFORE(sl, s->ms_max, key, incl)) {
+		r += s->ms_elems;
+		i++;
+		s = MAPPED_AT(sl, MSUBSLAB_OFFS(ss)[i]);
+	}
+	return (r + mapped_rank_slab(sl, s, key, incl));
+}
+
+/*
+ * Counts the elements of `sl` that come before `key`.
+ */
+static uint64_t
+rank_impl(slablist_t *sl, slablist_elem_t key, int incl)
+{
+	uint64_t r = 0;
+	uint64_t i = 0;
+	if (sl->sl_elems == 0 || !SLIST_SORTED(sl->sl_flags)) {
+		return (0);
+	}
+	if (IS_MAPPED_LIST(sl)) {
+		return (mapped_rank(sl, key, incl));
+	}
+	if (IS_SMALL_LIST(sl)) {
+		small_list_t *sml = LNK(sl->sl_head);
+		while (i < sl->sl_elems &&
+		    RANK_BEFORE(sl, sml->sml_data, key, incl)) {
+			sml = LNK(sml->sml_next);
+			i++;
+		}
+		return (i);
+	}
+	slab_t *s;
+	if (sl->sl_sublayers == 0) {
+		s = LNK(sl->sl_head);
+		while (i < sl->sl_slabs - 1 &&
+		    RANK_BEFORE(sl, s->s_max, key, incl)) {
+			r += s->s_elems;
+			s = LNK(s->s_next);
+			i++;
+		}
+		return (r + rank_slab(sl, s, key, incl));
+	}
+	slablist_t *base = LNK(sl->sl_baselayer);
+	subslab_t *ss = LNK(base->sl_head);
+	while (i < base->sl_slabs - 1 &&
+	    RANK_BEFORE(sl, ss->ss_max, key, incl)) {
+		r += ss->ss_usr_elems;
+		ss = LNK(ss->ss_next);
+		i++;
+	}
+	while (LNK(ss->ss_list)->sl_layer > 1) {
+		subslab_t *up = GET_SUBSLAB_ELEM(ss, 0);
+		i = 0;
+		while (i < (uint64_t)ss->ss_elems - 1 &&
+		    RANK_BEFORE(sl, up->ss_max, key, incl)) {
+			r += up->ss_usr_elems;
+			i++;
+			up = GET_SUBSLAB_ELEM(ss, i);
+		}
+		ss = up;
+	}
+	s = GET_SUBSLAB_ELEM(ss, 0);
+	i = 0;
+	while (i < (uint64_t)ss->ss_elems - 1 &&
+	    RANK_BEFORE(sl, s->s_max, key, incl)) {
+		r += s->s_elems;
+		i++;
+		s = GET_SUBSLAB_ELEM(ss, i);
+	}
+	return (r + rank_slab(sl, s, key, incl));
+}
+
+/*
+ * Returns the number of elements in `sl` that are less than `key`, which is
+ * also the position at which slablist_get() would find `key` if it is in the
+ * list. `sl` has to be sorted; an unsorted list has no ranks, and we return 0.
+ */
+uint64_t
+slablist_rank(slablist_t *sl, slablist_elem_t key)
+{
+	SLABLIST_RANK_BEGIN(sl, key);
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	uint64_t r = rank_impl(sl, key, 0);
+	if (SLABLIST_TEST_RANK_ENABLED()) {
+		SLABLIST_TEST_RANK(test_rank(sl, key, 0, r));
+	}
+	cow_exit(held);
+	shm_exit(sl, took);
+	SLABLIST_RANK_END(r);
+	return (r);
+}
+
+/*
+ * Returns the number of elements in `sl` that are within [min, max]. That is
+ * the number of elements that are not greater than `max`, minus the number
+ * that are less than `min`, so it takes two descents.
+ */
+uint64_t
+slablist_count_range(slablist_t *sl, slablist_elem_t min, slablist_elem_t max)
+{
+	SLABLIST_RANK_BEGIN(sl, min);
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	uint64_t r = 0;
+	if (SL_CMPF(sl)(min, max) <= 0) {
+		uint64_t below = rank_impl(sl, min, 0);
+		uint64_t upto = rank_impl(sl, max, 1);
+		if (SLABLIST_TEST_RANK_ENABLED()) {
+			SLABLIST_TEST_RANK(test_rank(sl, min, 0, below));
+			SLABLIST_TEST_RANK(test_rank(sl, max, 1, upto));
+		}
+		r = upto - below;
+	}
+	cow_exit(held);
+	shm_exit(sl, took);
+	SLABLIST_RANK_END(r);
+	return (r);
+}
+
+/*
+ * Bounds
+ *
+ * These find the first element that doesn't come before a key (in the sense
+ * of RANK_BEFORE above), and leave a bookmark on it, so that the caller can
+ * keep going with slablist_next() or slablist_prev(). Since slab ranges don't
+ * overlap, that element is either in the slab that find_slab() gives us, or
+ * it is the first element of the next slab. So unlike the rank queries, we
+ * get to use the root index and the cache of the last slab found.
+ *
+ * If there is no such element, the bookmark is left unpositioned, which means
+ * that slablist_prev() starts from the last element of the list. The floor is
+ * the element right before the one we find, so we get it the same way.
+ */
+static void
+bound_pos(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t key, int incl)
+{
+	bm->sb_list = sl;
+	bm->sb_node = NULL;
+	bm->sb_index = 0;
+	if (sl->sl_elems == 0 || !SLIST_SORTED(sl->sl_flags)) {
+		return;
+	}
+	if (IS_MAPPED_LIST(sl)) {
+		mslab_t *ms = mapped_find_slab(sl, key);
+		uint64_t i = mapped_rank_slab(sl, ms, key, incl);
+		if (i == ms->ms_elems) {
+			ms = mapped_slab_next(sl, ms);
+			i = 0;
+		}
+		bm->sb_node = ms;
+		bm->sb_index = i;
+	} else if (IS_SMALL_LIST(sl)) {
+		small_list_t *sml = LNK(sl->sl_head);
+		while (sml != NULL &&
+		    RANK_BEFORE(sl, sml->sml_data, key, incl)) {
+			sml = LNK(sml->sml_next);
+		}
+		bm->sb_node = sml;
+	} else {
+		slab_t *s = NULL;
+		(void) find_slab(sl, key, &s);
+		uint64_t i = rank_slab(sl, s, key, incl);
+		if (i == s->s_elems) {
+			s = LNK(s->s_next);
+			i = 0;
+		}
+		bm->sb_node = s;
+		bm->sb_index = i;
+	}
+}
+
+/*
+ * Positions `bm` like bound_pos() does, and stores the element that it lands
+ * on in `ret`, or the one before it, if `back` is set.
+ */
+static int
+bound_impl(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t key, int incl,
+    int back, slablist_elem_t *ret)
+{
+	SLABLIST_BOUND_BEGIN(sl, key);
+	int r = -1;
+	bound_pos(sl, bm, key, incl);
+	if (sl->sl_elems == 0 || !SLIST_SORTED(sl->sl_flags)) {
+		SLABLIST_BOUND_END(r, *ret);
+		return (r);
+	}
+	if (back) {
+		r = slablist_prev(sl, bm, ret);
+	} else if (bm->sb_node != NULL) {
+		r = slablist_cur(sl, bm, ret);
+	}
+	if (SLABLIST_TEST_BOUND_ENABLED()) {
+		SLABLIST_TEST_BOUND(test_bound(sl, key, incl, back, r, *ret));
+	}
+	SLABLIST_BOUND_END(r, *ret);
+	return (r);
+}
+
+/*
+ * Each of these stores an element of `sl` in `ret`, and positions `bm` on it.
+ * They return 0 if there is such an element, or -1 if there isn't.
+ *
+ * slablist_lower_bound() and slablist_ceil() find the smallest element that is
+ * not less than `key`, and slablist_upper_bound() finds the smallest element
+ * that is greater than `key`. slablist_floor() finds the largest element that
+ * is not greater than `key`. The bookmark of a lower bound that comes up empty
+ * is still useful: slablist_prev() on it gives the largest element that is
+ * less than `key`.
+ */
+int
+slablist_lower_bound(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t key,
+    slablist_elem_t *ret)
+{
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	int r = bound_impl(sl, bm, key, 0, 0, ret);
+	cow_exit(held);
+	shm_exit(sl, took);
+	return (r);
+}
+
+int
+slablist_upper_bound(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t key,
+    slablist_elem_t *ret)
+{
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	int r = bound_impl(sl, bm, key, 1, 0, ret);
+	cow_exit(held);
+	shm_exit(sl, took);
+	return (r);
+}
+
+int
+slablist_floor(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t key,
+    slablist_elem_t *ret)
+{
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	int r = bound_impl(sl, bm, key, 1, 1, ret);
+	cow_exit(held);
+	shm_exit(sl, took);
+	return (r);
+}
+
+int
+slablist_ceil(slablist_t *sl, slablist_bm_t *bm, slablist_elem_t key,
+    slablist_elem_t *ret)
+{
+	return (slablist_lower_bound(sl, bm, key, ret));
+}
+
+/*
+ * Spans
+ *
+ * A span hands out the elements of a range as runs of consecutive elements,
+ * one run per slab, pointing straight into the slabs. Elements that aren't
+ * stored as arrays (those of cold slabs and of small lists) are copied into
+ * a buffer that belongs to the span, and handed out from there.
+ *
+ * The folds that can stop early (see slablist_foldl_range_until()) also walk
+ * ranges backward, from `max` to `min`, with spans that have `sp_left` set.
+ * The bookmark of such a span is on the element right after the next run,
+ * and the run ends in the slab that the bookmark is on, unless the bookmark's
+ * index is 0, in which case it is the whole of the previous slab.
+ */
+
+/*
+ * Starts a span over the elements of `sl` that are within [min, max], going
+ * backward if `left` is set.
+ */
+int
+span_begin(slablist_t *sl, slablist_elem_t min, slablist_elem_t max, int left,
+    slablist_span_t **itp)
+{
+	if (!SLIST_SORTED(sl->sl_flags)) {
+		return (SL_ARGORD);
+	}
+	SLABLIST_SPAN_BEGIN(sl);
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	slablist_span_t *it = mk_zbuf(sizeof (slablist_span_t));
+	slablist_bm_t *bm = &it->sp_bm;
+	it->sp_min = min;
+	it->sp_max = max;
+	it->sp_left = left;
+	if (IS_SMALL_LIST(sl)) {
+		/* The whole range is a single run, whichever way we go */
+		it->sp_left = 0;
+		left = 0;
+	}
+	if (left) {
+		bound_pos(sl, bm, max, 1);
+		if (bm->sb_node == NULL && sl->sl_elems > 0) {
+			/* The range runs to the end of the list */
+			if (IS_MAPPED_LIST(sl)) {
+				mslab_t *ms = MAPPED_SLAB(sl, sl->sl_slabs - 1);
+				bm->sb_node = ms;
+				bm->sb_index = ms->ms_elems;
+			} else {
+				slab_t *s = LNK(sl->sl_end);
+				bm->sb_node = s;
+				bm->sb_index = s->s_elems;
+			}
+		}
+	} else {
+		bound_pos(sl, bm, min, 0);
+	}
+	if (SL_CMPF(sl)(min, max) > 0) {
+		bm->sb_node = NULL;
+	}
+	if (IS_MAPPED_LIST(sl)) {
+		/* The slabs of a mapped list are always arrays */
+	} else if (IS_SMALL_LIST(sl)) {
+		it->sp_bufsz = SMELEM_MAX * sizeof (slablist_elem_t);
+	} else if (sl->sl_cold_slabs > 0 || SLIST_IS_NARROW(sl->sl_flags)) {
+		it->sp_bufsz = sl->sl_selem_max * sizeof (slablist_elem_t);
+	}
+	if (it->sp_bufsz > 0) {
+		it->sp_buf = mk_buf(it->sp_bufsz);
+	}
+	cow_exit(held);
+	shm_exit(sl, took);
+	*itp = it;
+	return (SL_SUCCESS);
+}
+
+/*
+ * Starts a span over the elements of `sl` that are within [min, max], and
+ * stores it in `itp`. The span starts out where slablist_lower_bound() would
+ * put a bookmark. Like a bookmark, the span is only good for as long as `sl`
+ * doesn't change, and the runs that it hands out are only good until the next
+ * call to slablist_span_next(). They must not be written to.
+ */
+int
+slablist_span_begin(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
+    slablist_span_t **itp)
+{
+	return (span_begin(sl, min, max, 0, itp));
+}
+
+/*
+ * Finds the next run of a span that goes backward. Returns the slab (or mapped
+ * slab) that it is in, and stores its bounds in `i` and `j`.
+ */
+static void *
+span_prev(slablist_span_t *it, uint64_t *i, uint64_t *j)
+{
+	slablist_bm_t *bm = &it->sp_bm;
+	slablist_t *sl = bm->sb_list;
+	slablist_elem_t min = it->sp_min;
+	*i = 0;
+	if (IS_MAPPED_LIST(sl)) {
+		mslab_t *ms = bm->sb_node;
+		*j = bm->sb_index;
+		if (*j == 0) {
+			ms = mapped_slab_prev(sl, ms);
+			if (ms == NULL) {
+				bm->sb_node = NULL;
+				return (NULL);
+			}
+			*j = ms->ms_elems;
+		}
+		bm->sb_node = mapped_slab_prev(sl, ms);
+		if (SL_CMPF(sl)(ms->ms_min, min) < 0) {
+			*i = mapped_rank_slab(sl, ms, min, 0);
+			bm->sb_node = NULL;
+		} else if (bm->sb_node != NULL) {
+			bm->sb_index = ((mslab_t *)bm->sb_node)->ms_elems;
+		}
+		return (ms);
+	}
+	slab_t *s = bm->sb_node;
+	*j = bm->sb_index;
+	if (*j == 0) {
+		s = LNK(s->s_prev);
+		if (s == NULL) {
+			bm->sb_node = NULL;
+			return (NULL);
+		}
+		*j = s->s_elems;
+	}
+	bm->sb_node = LNK(s->s_prev);
+	if (SL_CMPF(sl)(s->s_min, min) < 0) {
+		*i = rank_slab(sl, s, min, 0);
+		bm->sb_node = NULL;
+	} else if (bm->sb_node != NULL) {
+		bm->sb_index = LNK(s->s_prev)->s_elems;
+	}
+	return (s);
+}
+
+/*
+ * Stores the next run of the span `it` in `run`, and its length in `len`.
+ * Returns 0 if there is such a run, or -1 if the span is done.
+ */
+int
+slablist_span_next(slablist_span_t *it, slablist_elem_t **run, uint64_t *len)
+{
+	slablist_bm_t *bm = &it->sp_bm;
+	slablist_t *sl = bm->sb_list;
+	if (bm->sb_node == NULL) {
+		return (-1);
+	}
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	slablist_elem_t max = it->sp_max;
+	slablist_elem_t *arr = NULL;
+	uint64_t i = bm->sb_index;
+	uint64_t j = 0;
+	void *next = NULL;
+	if (it->sp_left) {
+		void *s = span_prev(it, &i, &j);
+		if (s == NULL) {
+			/* There is nothing left */
+		} else if (IS_MAPPED_LIST(sl)) {
+			arr = MSLAB_ARR((mslab_t *)s);
+		} else {
+			arr = slab_elems(s, it->sp_buf);
+		}
+	} else if (IS_MAPPED_LIST(sl)) {
+		mslab_t *ms = bm->sb_node;
+		arr = MSLAB_ARR(ms);
+		j = ms->ms_elems;
+		if (SL_CMPF(sl)(ms->ms_max, max) > 0) {
+			j = mapped_rank_slab(sl, ms, max, 1);
+		} else {
+			next = mapped_slab_next(sl, ms);
+		}
+	} else if (IS_SMALL_LIST(sl)) {
+		small_list_t *sml = bm->sb_node;
+		arr = it->sp_buf;
+		while (sml != NULL && RANK_BEFORE(sl, sml->sml_data, max, 1)) {
+			arr[j] = sml->sml_data;
+			sml = LNK(sml->sml_next);
+			j++;
+		}
+	} else {
+		slab_t *s = bm->sb_node;
+		arr = slab_elems(s, it->sp_buf);
+		j = s->s_elems;
+		if (SL_CMPF(sl)(s->s_max, max) > 0) {
+			j = rank_slab(sl, s, max, 1);
+		} else {
+			next = LNK(s->s_next);
+		}
+	}
+	if (!it->sp_left) {
+		bm->sb_node = next;
+		bm->sb_index = 0;
+	}
+	cow_exit(held);
+	shm_exit(sl, took);
+	if (j <= i) {
+		bm->sb_node = NULL;
+		return (-1);
+	}
+	*run = arr + i;
+	*len = j - i;
+	if (SLABLIST_TEST_SPAN_ENABLED()) {
+		SLABLIST_TEST_SPAN(test_span(sl, *run, *len, it->sp_min, max));
+	}
+	SLABLIST_SPAN_RUN(*len);
+	return (0);
+}
+
+void
+slablist_span_end(slablist_span_t *it)
+{
+	if (it->sp_buf != NULL) {
+		rm_buf(it->sp_buf, it->sp_bufsz);
+	}
+	rm_buf(it, sizeof (slablist_span_t));
+}
+
+/*
+ * Filters
+ *
+ * These functions keep the Bloom filter of a list that has a hash function up
+ * to date. See slablist_bloom_t in slablist_impl.h.
+ */
+
+static __thread slablist_bloom_t *bloom_building;
+
+/*
+ * The user's hash function may be weak (the identity function is a common
+ * choice for integers), so we mix its bits before we use them.
+ */
+static uint64_t
+bloom_mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (h);
+}
+
+/*
+ * Returns the block that `e` hashes to, and sets `bits` to a second hash,
+ * whose low SL_BLOOM_K groups of 9 bits pick the bits of `e` in that block.
+ */
+static uint64_t *
+bloom_block(slablist_bloom_t *bf, slablist_elem_t e, uint64_t *bits)
+{
+	uint64_t h = bloom_mix(bf->bf_hash(e));
+	*bits = bloom_mix(h ^ 0x9e3779b97f4a7c15ULL);
+	return (&bf->bf_bits[(h & (bf->bf_nblocks - 1)) * SL_BLOOM_WORDS]);
+}
+
+static void
+bloom_set(slablist_bloom_t *bf, slablist_elem_t e)
+{
+	uint64_t bits;
+	uint64_t *blk = bloom_block(bf, e, &bits);
+	int k = 0;
+	while (k < SL_BLOOM_K) {
+		uint64_t b = bits & (SL_BLOOM_BLOCK - 1);
+		blk[b >> 6] |= 1ULL << (b & 63);
+		bits >>= 9;
+		k++;
+	}
+}
+
+/*
+ * Returns 0 if `e` is definitely not in the list, and 1 if it may be.
+ */
+static int
+bloom_test(slablist_bloom_t *bf, slablist_elem_t e)
+{
+	uint64_t bits;
+	uint64_t *blk = bloom_block(bf, e, &bits);
+	int k = 0;
+	while (k < SL_BLOOM_K) {
+		uint64_t b = bits & (SL_BLOOM_BLOCK - 1);
+		if (!(blk[b >> 6] & (1ULL << (b & 63)))) {
+			return (0);
+		}
+		bits >>= 9;
+		k++;
+	}
+	return (1);
+}
+
+static slablist_elem_t
+bloom_fold(slablist_elem_t acc, slablist_elem_t *arr, uint64_t elems)
+{
+	uint64_t i = 0;
+	while (i < elems) {
+		bloom_set(bloom_building, arr[i]);
+		i++;
+	}
+	return (acc);
+}
+
+void
+bloom_release(slablist_bloom_t *bf)
+{
+	if (bf == NULL) {
+		return;
+	}
+	bf->bf_refs--;
+	if (bf->bf_refs > 0) {
+		return;
+	}
+	rm_buf(bf->bf_bits, bf->bf_nblocks * SL_BLOOM_WORDS *
+	    sizeof (uint64_t));
+	rm_buf(bf, sizeof (slablist_bloom_t));
+}
+
+/*
+ * Gives `sl` a new filter that hashes with `h`, and that has room for twice
+ * as many elements as `sl` has right now.
+ */
+void
+bloom_build(slablist_t *sl, slablist_hash_t *h)
+{
+	uint64_t nblocks = 1;
+	while (nblocks * SL_BLOOM_BLOCK < 2 * sl->sl_elems * SL_BLOOM_BITS) {
+		nblocks <<= 1;
+	}
+	slablist_bloom_t *bf = mk_zbuf(sizeof (slablist_bloom_t));
+	bf->bf_bits = mk_zbuf(nblocks * SL_BLOOM_WORDS * sizeof (uint64_t));
+	bf->bf_nblocks = nblocks;
+	bf->bf_cap = (nblocks * SL_BLOOM_BLOCK) / SL_BLOOM_BITS;
+	bf->bf_adds = sl->sl_elems;
+	bf->bf_refs = 1;
+	bf->bf_hash = h;
+	slablist_elem_t zero;
+	zero.sle_u = 0;
+	bloom_building = bf;
+	(void) slablist_foldr(sl, bloom_fold, zero);
+	bloom_building = NULL;
+	bloom_release(sl->sl_bloom);
+	sl->sl_bloom = bf;
+	SLABLIST_BLOOM_BUILD(sl, nblocks);
+}
+
+/*
+ * Builds the filter of `sl` again, if it has one. This is needed after the
+ * elements of `sl` have been modified in place.
+ */
+void
+bloom_rebuild(slablist_t *sl)
+{
+	if (sl->sl_bloom != NULL) {
+		bloom_build(sl, sl->sl_bloom->bf_hash);
+	}
+}
+
+/*
+ * Gives `sl` a private copy of its filter, if a clone shares it.
+ */
+static void
+bloom_own(slablist_t *sl)
+{
+	slablist_bloom_t *old = sl->sl_bloom;
+	if (old->bf_refs == 1) {
+		return;
+	}
+	size_t sz = old->bf_nblocks * SL_BLOOM_WORDS * sizeof (uint64_t);
+	slablist_bloom_t *bf = mk_buf(sizeof (slablist_bloom_t));
+	bcopy(old, bf, sizeof (slablist_bloom_t));
+	bf->bf_bits = mk_buf(sz);
+	bcopy(old->bf_bits, bf->bf_bits, sz);
+	bf->bf_refs = 1;
+	bloom_release(old);
+	sl->sl_bloom = bf;
+}
+
+/*
+ * Called after `e` has been added to `sl`.
+ */
+void
+bloom_add(slablist_t *sl, slablist_elem_t e)
+{
+	if (sl->sl_bloom == NULL) {
+		return;
+	}
+	if (sl->sl_bloom->bf_adds >= sl->sl_bloom->bf_cap) {
+		bloom_rebuild(sl);
+		return;
+	}
+	bloom_own(sl);
+	sl->sl_bloom->bf_adds++;
+	bloom_set(sl->sl_bloom, e);
+}
+
+/*
+ * Called after elements have been removed from `sl`, which had `before`
+ * elements.
+ */
+void
+bloom_rem(slablist_t *sl, uint64_t before)
+{
+	if (sl->sl_bloom == NULL || before <= sl->sl_elems) {
+		return;
+	}
+	bloom_own(sl);
+	sl->sl_bloom->bf_rems += before - sl->sl_elems;
+	if (sl->sl_bloom->bf_rems > sl->sl_elems) {
+		bloom_rebuild(sl);
+	}
+}
+
+/*
+ * Makes slablist_find() consult a Bloom filter of the elements of `sl`, built
+ * with the hash function `h`, before it searches the list. Lookups of keys
+ * that aren't in the list then usually return SL_ENFOUND without calling the
+ * comparison function at all. The filter takes about 10 bits per element, and
+ * is kept up to date as elements are added and removed. Passing a NULL `h`
+ * drops the filter. A shared list can be modified by other processes, behind
+ * the back of the filter, so it can't have one.
+ */
+int
+slablist_set_hash(slablist_t *sl, slablist_hash_t *h)
+{
+	if (IS_SHM_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	int took = mvcc_enter(sl);
+	if (h == NULL) {
+		bloom_release(sl->sl_bloom);
+		sl->sl_bloom = NULL;
+	} else {
+		bloom_build(sl, h);
+	}
+	mvcc_exit(sl, took);
+	return (SL_SUCCESS);
+}
+
+/*
+ * Function tries to find `key` in `sl`, and records the found elem into the
+ * user-supplied backpointer `found`.
+ */
+static int
+find_impl(slablist_t *sl, slablist_elem_t key, slablist_elem_t *found)
+{
+
+	SLABLIST_FIND_BEGIN(sl, key);
+	slab_t *potential = NULL;
+	uint64_t i = 0;
+	slablist_elem_t ret;
+	/*
+	 * A key that the filter has never seen can't be in the list.
+	 */
+	if (sl->sl_bloom != NULL && SLIST_SORTED(sl->sl_flags) &&
+	    !bloom_test(sl->sl_bloom, key)) {
+		SLABLIST_BLOOM_SKIP(sl, key);
+		if (SLABLIST_TEST_BLOOM_ENABLED()) {
+			SLABLIST_TEST_BLOOM(test_bloom(sl, key));
+		}
+		SLABLIST_FIND_END(SL_ENFOUND, *found);
+		return (SL_ENFOUND);
+	}
+	if (IS_MAPPED_LIST(sl) && SLIST_SORTED(sl->sl_flags)) {
+		if (sl->sl_elems == 0) {
+			SLABLIST_FIND_END(SL_ENFOUND, *found);
+			return (SL_ENFOUND);
+		}
+		mslab_t *ms = mapped_find_slab(sl, key);
+		i = mapped_slab_srch(sl, ms, key);
+		if (i < ms->ms_elems &&
+		    SL_CMPF(sl)(key, MSLAB_ARR(ms)[i]) == 0) {
+			*found = MSLAB_ARR(ms)[i];
+			SLABLIST_FIND_END(SL_SUCCESS, *found);
+			return (SL_SUCCESS);
+		}
+		SLABLIST_FIND_END(SL_ENFOUND, *found);
+		return (SL_ENFOUND);
+	}
+	if (IS_SMALL_LIST(sl) && SLIST_SORTED(sl->sl_flags)) {
+		small_list_t *sml = LNK(sl->sl_head);
+		while (i < sl->sl_elems &&
+		    SL_CMPF(sl)(key, sml->sml_data) != 0) {
+			sml = LNK(sml->sml_next);
+			i++;
+		}
+		if (sml != NULL) {
+			*found = sml->sml_data;
+			SLABLIST_FIND_END(SL_SUCCESS, *found);
+			return (SL_SUCCESS);
+		} else {
+			SLABLIST_FIND_END(SL_ENFOUND, *found);
+			return (SL_ENFOUND);
+		}
+	}
+
+	if (SLIST_SORTED(sl->sl_flags)) {
+
+		find_slab(sl, key, &potential);
+
 		i = slab_bin_srch(key, potential);
-		ret = potential->s_arr[i];
+		/*
+		 * An `i` past the last elem means that `key` is larger than
+		 * all of the elems in `potential`.
+		 */
+		if (i >= potential->s_elems) {
+			SLABLIST_FIND_END(SL_ENFOUND, *found);
+			return (SL_ENFOUND);
+		}
+		ret = SLAB_ELEM(potential, i);
 
 		*found  = ret;
-		if (sl->sl_cmp_elem(key, ret) == 0) {
+		if (SL_CMPF(sl)(key, ret) == 0) {
 			SLABLIST_FIND_END(SL_SUCCESS, *found);
 			return (SL_SUCCESS);
 		} else {
@@ -1287,105 +2706,466 @@ slablist_find(slablist_t *sl, slablist_elem_t key, slablist_elem_t *found)
 	}
 }
 
-#define	NO_MATCH	0
-#define	PARTIAL_MATCH	1
-#define	FULL_MATCH	2
-typedef struct subseq {
-	char		sseq_match;
-	uint64_t	sseq_matched;
-	uint64_t	sseq_matchable;
-	slablist_t	*sseq_sub1;
-	slablist_elem_t	*sseq_sub2;
-} subseq_t;
+int
+slablist_find(slablist_t *sl, slablist_elem_t key, slablist_elem_t *found)
+{
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	int ret = find_impl(sl, key, found);
+	cow_exit(held);
+	shm_exit(sl, took);
+	return (ret);
+}
 
 /*
- * XXX THIS code doesn't pass the static analyzer and needs some serious
- * fixing. DO NOT USE!
+ * Finds `key` in the key-value list `sl`, and sets `sp` and `ip` to the slab
+ * that holds it, and its index in that slab.
  */
-slablist_elem_t
-subseq_cb(slablist_elem_t acc, slablist_elem_t *arr, uint64_t elems)
+int
+kv_find(slablist_t *sl, slablist_elem_t key, slab_t **sp, int *ip)
 {
-	(void) acc;
-	(void) arr;
-	(void) elems;
+	if (IS_SMALL_LIST(sl)) {
+		return (SL_ENFOUND);
+	}
+	if (sl->sl_bloom != NULL && !bloom_test(sl->sl_bloom, key)) {
+		SLABLIST_BLOOM_SKIP(sl, key);
+		return (SL_ENFOUND);
+	}
+	slab_t *s;
+	find_slab(sl, key, &s);
+	int i = slab_bin_srch(key, s);
+	if (i == s->s_elems || SL_CMPF(sl)(key, SLAB_GET(s, i)) != 0) {
+		return (SL_ENFOUND);
+	}
+	*sp = s;
+	*ip = i;
+	return (SL_SUCCESS);
+}
+
 /*
- * Because this code sets off clang analyzer warnings, we make is 'hidden' or
- * 'ignored' via the undefined macro below.
+ * Looks up `key` in the key-value list `sl`, and stores its value in `val`.
+ * Only the keys are searched, so this costs the same as slablist_find().
  */
-#ifdef SUBSEQ_NO_IGNORE
-	subseq_t *seq = acc.sle_p;
-	slablist_t *sl = seq->sseq_sub1;
-	slablist_elem_t *seq_arr = seq->sseq_sub2;
+int
+slablist_get_value(slablist_t *sl, slablist_elem_t key, slablist_elem_t *val)
+{
+	if (!SLIST_IS_KV(sl->sl_flags)) {
+		return (SL_EKV);
+	}
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	SLABLIST_FIND_BEGIN(sl, key);
+	slab_t *s;
+	int i;
+	int ret = kv_find(sl, key, &s, &i);
+	if (ret == SL_SUCCESS) {
+		*val = SLAB_VAL(s, i);
+	}
+	SLABLIST_FIND_END(ret, key);
+	cow_exit(held);
+	shm_exit(sl, took);
+	return (ret);
+}
+
+/*
+ * Batched Lookups
+ *
+ * A lookup spends most of its time waiting on cache misses, one for each step
+ * of the binary search in each layer, and each miss depends on the one before
+ * it. slablist_find_many() runs up to FIND_MANY_GROUP lookups at once, in
+ * lockstep, so that the misses of all of them are in flight together. At each
+ * step, it prefetches the slot in the subslab that each lookup compares
+ * against next, then the slab or subslab that the slot points to, and only
+ * then does any of the comparisons. Once every lookup has found its slab, the
+ * searches of the slabs are interleaved in the same way.
+ *
+ * A sorted batch shares most of its descents. A lookup whose key falls within
+ * the range of the slab that the previous lookup found, or between it and the
+ * slab after it, uses that slab and doesn't descend at all. The lookups that
+ * do descend share a baseslab whenever their keys fall within the same one.
+ */
+#define	FIND_MANY_GROUP	32
+
+#define	FM_SKIP		0	/* rejected by the filter */
+#define	FM_DESC		1	/* still descending */
+#define	FM_TOP		2	/* has found its slab */
+
+#define	PREFETCH(p)	__builtin_prefetch((p))
+
+/*
+ * Compares `e` against the range of `c`, which is a slab if `top` is set, and
+ * a subslab otherwise.
+ */
+static int
+find_many_bnd(slablist_t *sl, slablist_elem_t e, void *c, int top)
+{
+	if (top) {
+		slab_t *s = c;
+		return (SL_BNDF(sl)(e, s->s_min, s->s_max));
+	}
+	subslab_t *s = c;
+	return (SL_BNDF(sl)(e, s->ss_min, s->ss_max));
+}
+
+/*
+ * Searches cur[k] for keys[k], for every lookup that is still descending, and
+ * puts the slab or subslab (depending on `top`) into which the key would fit
+ * into next[k]. This picks the same one that find_slab_in_subslab() or
+ * find_subslab_in_subslab() would, but interleaves the steps of all of the
+ * searches. The searches that are still going are kept at the front of `act`.
+ */
+static void
+find_many_layer(slablist_t *sl, slablist_elem_t *keys, uint64_t n, int *state,
+    subslab_t **cur, void **next, int top)
+{
+	int lo[FIND_MANY_GROUP];
+	int hi[FIND_MANY_GROUP];
+	int mid[FIND_MANY_GROUP];
+	int act[FIND_MANY_GROUP];
+	int nact = 0;
+	int j;
+	uint64_t k;
+
+	k = 0;
+	while (k < n) {
+		if (state[k] == FM_DESC) {
+			lo[k] = 0;
+			hi[k] = cur[k]->ss_elems - 1;
+			act[nact] = k;
+			nact++;
+		}
+		k++;
+	}
+	int ndesc = nact;
+
+	while (nact > 0) {
+		j = 0;
+		while (j < nact) {
+			k = act[j];
+			mid[k] = (lo[k] + hi[k]) >> 1;
+			PREFETCH(&SUBSLAB_ELEMS(cur[k])[mid[k]]);
+			j++;
+		}
+		j = 0;
+		while (j < nact) {
+			k = act[j];
+			PREFETCH(GET_SUBSLAB_ELEM(cur[k], mid[k]));
+			j++;
+		}
+		j = 0;
+		while (j < nact) {
+			k = act[j];
+			int c = find_many_bnd(sl, keys[k],
+			    GET_SUBSLAB_ELEM(cur[k], mid[k]), top);
+			if (c > 0) {
+				lo[k] = mid[k] + 1;
+			} else if (c < 0) {
+				hi[k] = mid[k] - 1;
+			} else {
+				lo[k] = mid[k];
+				hi[k] = -1;
+			}
+			if (hi[k] < lo[k]) {
+				nact--;
+				act[j] = act[nact];
+				act[nact] = k;
+				continue;
+			}
+			j++;
+		}
+	}
+
 	/*
-	 * If we have a full match already, we don't bother searching for more
-	 * matches, and just keep returning acc until the fold finishes.
-	 *
-	 * TODO: There should be some way of breaking out of a fold.
+	 * Like subslab_bin_srch(), we turn the insertion point into the index
+	 * of the nearest slab or subslab. The finished searches have been
+	 * swapped to the back of `act`, so all of them are still there.
 	 */
-	if (seq->sseq_match == FULL_MATCH) {
-		return (acc);
+	j = 0;
+	while (j < ndesc) {
+		k = act[j];
+		int last = cur[k]->ss_elems - 1;
+		int x = lo[k];
+		if (x > last) {
+			x = last;
+		}
+		if (x < last && find_many_bnd(sl, keys[k],
+		    GET_SUBSLAB_ELEM(cur[k], x), top) > 0) {
+			x++;
+		}
+		next[k] = GET_SUBSLAB_ELEM(cur[k], x);
+		j++;
 	}
-	uint64_t i = 0;
-	uint64_t j = 1;
-	if (seq->sseq_match == NO_MATCH) {
-		/* find head of sequence */
-		slablist_elem_t f;
-		if (sl != NULL) {
-			f = slablist_get(sl, 0);
-		} else {
-			f = seq_arr[0];
+}
+
+/*
+ * Searches top[k] for keys[k], for every lookup that has found its slab, like
+ * slab_bin_srch() does, but interleaves the steps of all of the searches.
+ */
+static void
+find_many_slab(slablist_t *sl, slablist_elem_t *keys, uint64_t n, int *state,
+    slab_t **top, slablist_elem_t *out, int *status)
+{
+	int lo[FIND_MANY_GROUP];
+	int hi[FIND_MANY_GROUP];
+	int mid[FIND_MANY_GROUP];
+	int act[FIND_MANY_GROUP];
+	int nact = 0;
+	int j;
+	uint64_t k;
+
+	k = 0;
+	while (k < n) {
+		if (state[k] == FM_TOP) {
+			lo[k] = 0;
+			hi[k] = top[k]->s_elems - 1;
+			status[k] = SL_ENFOUND;
+			act[nact] = k;
+			nact++;
 		}
-		while (i < elems) {
-			if (sl->sl_cmp_elem(arr[i], f) == 0) {
-				seq->sseq_matched++;
-				seq->sseq_match = PARTIAL_MATCH;
-				break;
+		k++;
+	}
+
+	while (nact > 0) {
+		j = 0;
+		while (j < nact) {
+			k = act[j];
+			mid[k] = (lo[k] + hi[k]) >> 1;
+			if (!SLAB_IS_COLD(top[k])) {
+				PREFETCH(SLAB_ADDR(top[k], mid[k]));
 			}
-			i++;
+			j++;
+		}
+		j = 0;
+		while (j < nact) {
+			k = act[j];
+			slablist_elem_t e = SLAB_ELEM(top[k], mid[k]);
+			int c = SL_CMPF(sl)(keys[k], e);
+			if (c > 0) {
+				lo[k] = mid[k] + 1;
+			} else if (c < 0) {
+				hi[k] = mid[k] - 1;
+			} else {
+				out[k] = e;
+				status[k] = SL_SUCCESS;
+				hi[k] = -1;
+			}
+			if (hi[k] < lo[k]) {
+				nact--;
+				act[j] = act[nact];
+				continue;
+			}
+			j++;
 		}
 	}
-	if (seq->sseq_match == PARTIAL_MATCH) {
-		j = seq->sseq_matched;
-		/* find the tail of the sequence */
-		if (sl != NULL) {
-			while (j < seq->sseq_matchable) {
-				slablist_elem_t c = slablist_get(sl, j);
-				if (sl->sl_cmp_elem(arr[i], c) == 0) {
-					seq->sseq_matched++;
-				} else {
-					break;
-				}
-				i++;
-				j++;
+}
+
+static void
+find_many_group(slablist_t *sl, slablist_elem_t *keys, uint64_t n,
+    slablist_elem_t *out, int *status, slab_t **hint)
+{
+	subslab_t *cur[FIND_MANY_GROUP];
+	void *next[FIND_MANY_GROUP];
+	slab_t *top[FIND_MANY_GROUP];
+	int state[FIND_MANY_GROUP];
+	subslab_t *base = NULL;
+	slab_t *last = *hint;
+	uint64_t k;
+	int layer;
+
+	k = 0;
+	while (k < n) {
+		int r = FS_UNDER_RANGE;
+		if (last != NULL) {
+			r = SL_BNDF(sl)(keys[k], last->s_min, last->s_max);
+		}
+		if (r == FS_OVER_RANGE && LNK(last->s_next) != NULL &&
+		    SL_BNDF(sl)(keys[k], LNK(last->s_next)->s_min,
+		    LNK(last->s_next)->s_max) != FS_OVER_RANGE) {
+			last = LNK(last->s_next);
+			r = FS_IN_RANGE;
+		}
+		if (sl->sl_bloom != NULL &&
+		    !bloom_test(sl->sl_bloom, keys[k])) {
+			SLABLIST_BLOOM_SKIP(sl, keys[k]);
+			if (SLABLIST_TEST_BLOOM_ENABLED()) {
+				SLABLIST_TEST_BLOOM(test_bloom(sl, keys[k]));
 			}
+			state[k] = FM_SKIP;
+			status[k] = SL_ENFOUND;
+		} else if (r == FS_IN_RANGE) {
+			state[k] = FM_TOP;
+			top[k] = last;
 		} else {
-			while (j < seq->sseq_matchable) {
-				slablist_elem_t c = seq_arr[j];
-				if (sl->sl_cmp_elem(arr[i], c) == 0) {
-					seq->sseq_matched++;
-				} else {
-					break;
-				}
-				i++;
-				j++;
+			state[k] = FM_DESC;
+			if (base == NULL || SL_BNDF(sl)(keys[k],
+			    base->ss_min, base->ss_max) != FS_IN_RANGE) {
+				find_baseslab(sl, keys[k], &base);
 			}
+			cur[k] = base;
 		}
-		if (seq->sseq_matched == seq->sseq_matchable) {
-			seq->sseq_match = FULL_MATCH;
-			return (acc);
+		k++;
+	}
+
+	/*
+	 * We go up the sublayers, from the baselayer to the one right below
+	 * the toplayer, and then into the toplayer.
+	 */
+	layer = 1;
+	while (layer <= sl->sl_sublayers) {
+		int istop = layer == sl->sl_sublayers;
+		find_many_layer(sl, keys, n, state, cur, next, istop);
+		k = 0;
+		while (k < n) {
+			if (state[k] == FM_DESC && istop) {
+				top[k] = next[k];
+				state[k] = FM_TOP;
+			} else if (state[k] == FM_DESC) {
+				cur[k] = next[k];
+			}
+			k++;
 		}
-		if (seq->sseq_matched < seq->sseq_matchable &&
-		    i < elems) {
-			seq->sseq_match = NO_MATCH;
+		layer++;
+	}
+
+	find_many_slab(sl, keys, n, state, top, out, status);
+
+	/* The next group starts from the last slab that we found */
+	k = n;
+	while (k > 0) {
+		k--;
+		if (state[k] == FM_TOP) {
+			*hint = top[k];
+			break;
 		}
 	}
+}
+
+/*
+ * Looks up the `n` keys in `keys`, as if by calling slablist_find() on each
+ * of them, but overlaps the cache misses of the lookups (see above). The
+ * result of the i'th lookup goes into `status[i]` and, if the key was found,
+ * into `out[i]`. The keys don't have to be sorted, but lookups of sorted keys
+ * are cheaper. Returns SL_ARGORD if `sl` isn't sorted.
+ */
+int
+slablist_find_many(slablist_t *sl, slablist_elem_t *keys, uint64_t n,
+    slablist_elem_t *out, int *status)
+{
+	uint64_t i = 0;
+	slab_t *hint = NULL;
+	if (!SLIST_SORTED(sl->sl_flags)) {
+		return (SL_ARGORD);
+	}
+	SLABLIST_FIND_MANY_BEGIN(sl, n);
+	int took = shm_enter(sl, 0);
+	slablist_t *held = cow_enter(sl);
+	/*
+	 * Small lists, lists without sublayers, and mapped lists are searched
+	 * one key at a time, since there is no descent to overlap. So are lists
+	 * that are being sorted, which can have runs of duplicates that span
+	 * slabs.
+	 */
+	if (IS_MAPPED_LIST(sl) || IS_SMALL_LIST(sl) || sl->sl_sublayers == 0 ||
+	    SLIST_IS_SORTING_TEMP(sl->sl_flags)) {
+		while (i < n) {
+			status[i] = find_impl(sl, keys[i], &out[i]);
+			i++;
+		}
+	} else {
+		while (i < n) {
+			uint64_t g = n - i;
+			if (g > FIND_MANY_GROUP) {
+				g = FIND_MANY_GROUP;
+			}
+			find_many_group(sl, keys + i, g, out + i, status + i,
+			    &hint);
+			i += g;
+		}
+	}
+	cow_exit(held);
+	shm_exit(sl, took);
+	SLABLIST_FIND_MANY_END(n);
+	return (SL_SUCCESS);
+}
+
+/*
+ * Subsequences
+ *
+ * slablist_subseq() looks for a run of consecutive elements that matches a
+ * pattern, in a single pass over the slabs. It runs the Knuth-Morris-Pratt
+ * automaton of the pattern over the elements. `sseq_fail[k]` is the length of
+ * the longest proper prefix of the first `k + 1` elements of the pattern that
+ * is also a suffix of them, so after a mismatch we fall back to it, instead of
+ * going back over elements that we have already seen. The state of the
+ * automaton is just the number of elements matched so far, so it carries over
+ * from one slab to the next, and the fold stops as soon as the whole pattern
+ * has matched.
+ */
+typedef struct subseq {
+	slablist_t	*sseq_list;
+	slablist_elem_t	*sseq_pat;
+	uint64_t	*sseq_fail;
+	uint64_t	sseq_len;
+	uint64_t	sseq_matched;
+} subseq_t;
+
+/*
+ * Feeds the elements in `arr` to the automaton in `acc`.
+ */
+static slablist_elem_t
+subseq_cb(slablist_elem_t acc, slablist_elem_t *arr, uint64_t elems,
+    int *stop)
+{
+	subseq_t *seq = acc.sle_p;
+	slablist_t *sl = seq->sseq_list;
+	slablist_elem_t *pat = seq->sseq_pat;
+	uint64_t k = seq->sseq_matched;
+	uint64_t i = 0;
+	while (i < elems) {
+		while (k > 0 && SL_CMPF(sl)(arr[i], pat[k]) != 0) {
+			k = seq->sseq_fail[k - 1];
+		}
+		if (SL_CMPF(sl)(arr[i], pat[k]) == 0) {
+			k++;
+		}
+		if (k == seq->sseq_len) {
+			*stop = 1;
+			break;
+		}
+		i++;
+	}
+	seq->sseq_matched = k;
 	return (acc);
-#endif
+}
+
+/*
+ * Fills in the failure function of the pattern in `seq`.
+ */
+static void
+subseq_fail(subseq_t *seq)
+{
+	slablist_t *sl = seq->sseq_list;
+	slablist_elem_t *pat = seq->sseq_pat;
+	uint64_t k = 0;
+	uint64_t i = 1;
+	seq->sseq_fail[0] = 0;
+	while (i < seq->sseq_len) {
+		while (k > 0 && SL_CMPF(sl)(pat[i], pat[k]) != 0) {
+			k = seq->sseq_fail[k - 1];
+		}
+		if (SL_CMPF(sl)(pat[i], pat[k]) == 0) {
+			k++;
+		}
+		seq->sseq_fail[i] = k;
+		i++;
+	}
 }
 
 /*
  * This function determines if `sl` has a subsequence, which is either stored
- * in the slablist `sub1` or in the array `sub2` of length `len`.
+ * in the slablist `sub1` or in the array `sub2` of length `len`. Elements are
+ * compared with the comparison function of `sl`. A pattern that is stored in
+ * a slablist gets copied into an array first.
  */
 int
 slablist_subseq(slablist_t *sl, slablist_t *sub1, slablist_elem_t *sub2,
@@ -1394,25 +3174,46 @@ slablist_subseq(slablist_t *sl, slablist_t *sub1, slablist_elem_t *sub2,
 	if (sub1 == NULL && sub2 == NULL) {
 		return (0);
 	}
+	if (sub1 != NULL) {
+		len = slablist_get_elems(sub1);
+	}
+	if (len > slablist_get_elems(sl)) {
+		return (0);
+	}
+	if (len == 0) {
+		return (1);
+	}
+	SLABLIST_SUBSEQ_BEGIN(sl, len);
+	slablist_t *held = cow_enter(sl);
 	subseq_t seq;
+	seq.sseq_list = sl;
+	seq.sseq_len = len;
+	seq.sseq_matched = 0;
+	seq.sseq_pat = sub2;
 	if (sub1 != NULL) {
-		seq.sseq_match = 0;
-		seq.sseq_matched = 0;
-		seq.sseq_matchable = slablist_get_elems(sl);
-		seq.sseq_sub1 = sub1;
-		seq.sseq_sub2 = NULL;
-	} else {
-		seq.sseq_match = 0;
-		seq.sseq_matched = 0;
-		seq.sseq_matchable = len;
-		seq.sseq_sub1 = NULL;
-		seq.sseq_sub2 = sub2;
+		seq.sseq_pat = mk_buf(len * sizeof (slablist_elem_t));
+		slablist_bm_t bm;
+		bzero(&bm, sizeof (slablist_bm_t));
+		uint64_t i = 0;
+		while (i < len &&
+		    slablist_next(sub1, &bm, &seq.sseq_pat[i]) == 0) {
+			i++;
+		}
 	}
+	seq.sseq_fail = mk_buf(len * sizeof (uint64_t));
+	subseq_fail(&seq);
 	slablist_elem_t acc;
 	acc.sle_p = &seq;
-	(void) slablist_foldr(sl, subseq_cb, acc);
-	if (seq.sseq_match == FULL_MATCH) {
-		return (1);
+	(void) slablist_foldr_until(sl, subseq_cb, acc);
+	int r = seq.sseq_matched == len;
+	if (SLABLIST_TEST_SUBSEQ_ENABLED()) {
+		SLABLIST_TEST_SUBSEQ(test_subseq(sl, seq.sseq_pat, len, r));
 	}
-	return (0);
+	rm_buf(seq.sseq_fail, len * sizeof (uint64_t));
+	if (sub1 != NULL) {
+		rm_buf(seq.sseq_pat, len * sizeof (slablist_elem_t));
+	}
+	cow_exit(held);
+	SLABLIST_SUBSEQ_END(r);
+	return (r);
 }
@@ -39,5 +39,15 @@ extern int subslab_bin_srch_top(slablist_elem_t, subslab_t *);
 extern int slab_lin_srch(slablist_elem_t, slab_t *);
 extern int subslab_lin_srch(slablist_elem_t, subslab_t *);
 extern int subslab_lin_srch_top(slablist_elem_t, subslab_t *);
+extern int find_slab(slablist_t *, slablist_elem_t, slab_t **);
+extern int kv_find(slablist_t *, slablist_elem_t, slab_t **, int *);
 extern int find_bubble_up(slablist_t *, slablist_elem_t, slab_t **);
 extern int find_linear_scan(slablist_t *, slablist_elem_t, slab_t **);
+extern int sub_find_linear_scan(slablist_t *, slablist_elem_t,
+    subslab_t **);
+extern mslab_t *mapped_slab_next(slablist_t *, mslab_t *);
+extern mslab_t *mapped_slab_prev(slablist_t *, mslab_t *);
+extern uint64_t mapped_slab_srch(slablist_t *, mslab_t *, slablist_elem_t);
+extern mslab_t *mapped_find_slab(slablist_t *, slablist_elem_t);
+extern int span_begin(slablist_t *, slablist_elem_t, slablist_elem_t, int,
+    slablist_span_t **);
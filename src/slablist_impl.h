@@ -32,6 +32,7 @@
 
 
 #include <stdint.h>
+#include <stddef.h>
 #include <pthread.h>
 #include "slablist.h"
 
@@ -112,18 +113,131 @@
 
 #define	SL_REQ_MAX	(255)
 #define	SUBELEM_MAX	(512)
+#define	SUBELEM_MIN	(16)
 #define	SELEM_MAX	(121)
 #define	SMELEM_MAX	(60)
 
+/*
+ * The capacity of the slabs and subslabs is chosen per list, and stored in the
+ * slablist_t. SELEM_MAX is the capacity of the default 1K slab, SUBELEM_MAX is
+ * the default (and largest possible) subslab fan-out, and SMELEM_MAX is the
+ * largest that a small list can ever grow. The capacity of a slab is however
+ * many elements of width `w` fit in what is left over after the meta-data, in
+ * a slab of a given size. See the SL_SLAB_* flags in slablist.h.
+ */
+#define	SLAB_BYTES(n, w)	(sizeof (slab_t) + ((n) * (w)))
+#define	SLAB_NELEMS(b, w)	(((b) - sizeof (slab_t)) / (w))
+#define	SLAB_ELEM_MAX(s)	(LNK((s)->s_list)->sl_selem_max)
+#define	SUBSLAB_ELEM_MAX(s)	(LNK((s)->ss_list)->sl_subelem_max)
+
+/*
+ * The elements of a list created with SL_ELEM_32 are stored in its slabs as
+ * 32-bit integers, so that a slab of a given size holds twice as many of them.
+ * Everything outside of the slabs (the extrema, the small list, the callbacks)
+ * still sees whole slablist_elem_t's, with the element in the low 32 bits of
+ * sle_u, and the rest zeroed.
+ *
+ * SLAB_GET() and SLAB_SET() read and write the i'th element of a hot slab, and
+ * SLAB_ADDR() is the address of the i'th element, for shifting and copying runs
+ * of elements with bcopy(). A run of `n` elements is SLAB_RUN(s, n) bytes long.
+ */
+#define	SLIST_IS_NARROW(x)	((x) & SL_ELEM_32)
+#define	SLAB_IS_NARROW(s)	SLIST_IS_NARROW(LNK((s)->s_list)->sl_flags)
+#define	SLIST_ELEM_SZ(sl)	(SLIST_IS_NARROW((sl)->sl_flags) ?\
+	sizeof (uint32_t) : sizeof (slablist_elem_t))
+#define	SLAB_ELEM_SZ(s)		SLIST_ELEM_SZ(LNK((s)->s_list))
+#define	SLIST_SLAB_BYTES(sl)\
+	SLAB_BYTES((sl)->sl_selem_max, SLIST_ENTRY_SZ(sl))
+#define	SLAB_RUN(s, n)		((size_t)(n) * SLAB_ELEM_SZ(s))
+#define	SLAB_NARROW_ARR(s)	((uint32_t *)(void *)(s)->s_arr)
+#define	SLAB_ADDR(s, i)\
+	((void *)((char *)(s)->s_arr + SLAB_RUN((s), (i))))
+#define	SLAB_GET(s, i)		(SLAB_IS_NARROW(s) ?\
+	narrow_elem(SLAB_NARROW_ARR(s)[(i)]) : (s)->s_arr[(i)])
+#define	SLAB_SET(s, i, e)	(SLAB_IS_NARROW(s) ?\
+	(void) (SLAB_NARROW_ARR(s)[(i)] = (uint32_t)(e).sle_u) :\
+	(void) ((s)->s_arr[(i)] = (e)))
+
+/*
+ * The slabs of a list created with SL_KV hold the keys first, in s_arr, like
+ * any other slab, and then an array of SLAB_ELEM_MAX() values, so that the
+ * searches of a slab only ever touch its keys. The i'th value belongs to the
+ * i'th key, so anything that moves keys around has to move the values with
+ * them (see slab_move()). A narrow key-value list has an even number of
+ * elements per slab, which keeps the values 8-byte aligned.
+ *
+ * SLAB_VAL() is the i'th value of a key-value slab, and slab_val() is the same
+ * thing for any slab, with a value of 0 for slabs without values.
+ * SLAB_SET_VAL() does nothing to slabs without values.
+ */
+#define	SLIST_IS_KV(x)		((x) & SL_KV)
+#define	SLAB_IS_KV(s)		SLIST_IS_KV(LNK((s)->s_list)->sl_flags)
+#define	SLIST_ENTRY_SZ(sl)	(SLIST_ELEM_SZ(sl) +\
+	(SLIST_IS_KV((sl)->sl_flags) ? sizeof (slablist_elem_t) : 0) +\
+	(SLIST_HAS_PFX(sl) ? sizeof (uint64_t) : 0))
+#define	SLAB_VALS(s)\
+	((slablist_elem_t *)SLAB_ADDR((s), SLAB_ELEM_MAX(s)))
+#define	SLAB_VAL(s, i)		(SLAB_VALS(s)[(i)])
+#define	SLAB_SET_VAL(s, i, v)	(SLAB_IS_KV(s) ?\
+	(void) (SLAB_VALS(s)[(i)] = (v)) : (void) 0)
+
+/*
+ * A list with a prefix function (see slablist_set_prefix()) keeps the prefix
+ * of each element in its slabs, in an array that comes after the keys (and
+ * after the values, if any). Like values, prefixes are moved around by
+ * slab_move(), and the prefix of a newly written element is set with
+ * SLAB_SET_PFX(). ELEM_PFX() is the prefix of an element that is being
+ * searched for. A narrow list with prefixes also has an even number of
+ * elements per slab.
+ */
+#define	SLIST_HAS_PFX(sl)	((sl)->sl_pfx != NULL)
+#define	SLAB_PFXS(s)		((uint64_t *)(void *)((char *)SLAB_VALS(s) +\
+	(SLAB_IS_KV(s) ? SLAB_ELEM_MAX(s) * sizeof (slablist_elem_t) : 0)))
+#define	SLAB_PFX(s, i)		(SLAB_PFXS(s)[(i)])
+#define	SLAB_SET_PFX(s, i, e)	(SLIST_HAS_PFX(LNK((s)->s_list)) ?\
+	(void) (SLAB_PFXS(s)[(i)] = LNK((s)->s_list)->sl_pfx(e)) : (void) 0)
+#define	ELEM_PFX(sl, e)		(SLIST_HAS_PFX(sl) ? (sl)->sl_pfx(e) : 0)
+
+#define	SLIST_SLAB_SIZE(x)\
+	(x & 0x60)
+
 /*
  * These are used in the removal code (slablist_rem.c) and testing code
  * (slablist_test.c) to determine how much free space a (sub)slab has.
  */
-#define	SLAB_FREE_SPACE(s)	((uint64_t)(SELEM_MAX - s->s_elems))
-#define	SUBSLAB_FREE_SPACE(s)	((uint64_t)(SUBELEM_MAX - s->ss_elems))
+#define	SLAB_FREE_SPACE(s)	((uint64_t)(SLAB_ELEM_MAX(s) - s->s_elems))
+#define	SUBSLAB_FREE_SPACE(s)	((uint64_t)(SUBSLAB_ELEM_MAX(s) - s->ss_elems))
 
-#define	GET_SUBSLAB_ELEM(s, e)		(s->ss_arr->sa_data[e])
-#define	SET_SUBSLAB_ELEM(s, e, i)	(s->ss_arr->sa_data[i] = e)
+/*
+ * A slab that has not been written to since the last call to
+ * slablist_compress() is _cold_. If the elements of a cold slab are close
+ * together, as clustered or monotonic integer keys are, the slab gets
+ * re-encoded in frame-of-reference form: s_arr[0] holds the numerically
+ * smallest element, and the rest of s_arr holds each element's distance from
+ * it, packed into s_bits bits. The cold slab is allocated at its packed size.
+ * For example, a full 1K slab whose elements are all within 2^12 of each other
+ * shrinks to 56 + 8 + 184 = 248 bytes.
+ *
+ * A packed element can be decoded on its own, so we can do binary searches on
+ * cold slabs without unpacking them. SLAB_ELEM() is how code that only reads
+ * a slab gets at its elements. Code that writes to a slab has to thaw it
+ * first (see thaw_slab() in slablist_cons.c). Thawing and freezing a slab
+ * moves it to a new allocation, so it invalidates any pointers to it.
+ *
+ * s_bits is 0 for slabs that aren't cold. The frame-of-reference encoding only
+ * looks at the bits of an element, so it is lossless for any kind of element,
+ * but it only pays off for integers.
+ */
+#define	SLAB_IS_COLD(s)		((s)->s_bits != 0)
+#define	COLD_WORDS(n, b)	(1 + ((((uint64_t)(n) * (b)) + 63) / 64))
+#define	COLD_SLAB_BYTES(n, b)\
+	(sizeof (slab_t) + (COLD_WORDS(n, b) * sizeof (slablist_elem_t)))
+#define	SLAB_ELEM(s, i)\
+	(SLAB_IS_COLD(s) ? cold_slab_elem((s), (i)) : SLAB_GET((s), (i)))
+
+#define	SUBSLAB_ELEMS(s)		(LNK((s)->ss_arr)->sa_data)
+#define	GET_SUBSLAB_ELEM(s, e)		LNK(SUBSLAB_ELEMS(s)[e])
+#define	SET_SUBSLAB_ELEM(s, e, i)	(SUBSLAB_ELEMS(s)[i] = MKLNK(e))
 
 typedef struct slab slab_t;
 typedef struct subslab subslab_t;
@@ -219,8 +333,14 @@ typedef struct small_list {
  *
  * As far as memory efficiency goes, a slab_t's meta-data takes up 56 bytes,
  * while the user-data takes up 968 bytes. This makes the efficiency of a full
- * slab 968/1024 = 94.5%. It has been found empirically that 1K-slabs result in
- * better performance than larger-sized slabs.
+ * 1K slab 968/1024 = 94.5%. It has been found empirically that 1K-slabs result
+ * in better performance than larger-sized slabs, on the machines and workloads
+ * we measured. Since that need not hold everywhere, the slab size can be
+ * chosen per list, when creating it (512 bytes, 1K, 4K, or 16K). The user-data
+ * array is the last member of the slab_t, and is as large as the chosen size
+ * allows. Run the `sl_sweep_bench` target (which passes the `slab*` and
+ * `fanout=` options to drv_gen) to find the best size for a given machine and
+ * key distribution.
  *
  * Large numbers of random insertions and removals, result in the proliferation
  * of partially-full slabs. If it goes on for long enough, the memory savings
@@ -256,21 +376,71 @@ typedef struct small_list {
  * search on the slab's embedded array. If not inserting to the end of the
  * slab, we have to shift all elements that follow `E` down by one, using
  * bcopy(). Slabs never have any gaps.
+ *
+ * Every slab of a list has an id (s_id) that stays the same for as long as the
+ * slab is part of the list, even if it gets frozen or thawed, and a flag
+ * (s_dirty) that gets set whenever the slab is created or its elements change.
+ * These let slablist_checkpoint_incremental() save only the slabs that have
+ * changed since the last checkpoint. Ids are handed out from the list's
+ * sl_slab_id, and are renumbered from 1, in list order, by every full
+ * checkpoint and load.
+ *
+ * If the list has an aggregate (see slablist_set_aggregate()), each slab also
+ * keeps the aggregate of its elements in `s_agg`, which is valid while
+ * `s_agg_ok` is set. Setting the dirty flag clears `s_agg_ok`, and marks the
+ * aggregates of the subslabs below the slab as stale, so that agg_flush() can
+ * find and recompute them at the end of the modification.
+ */
+#define	SLAB_SET_DIRTY(s)	((s)->s_dirty = 1, (s)->s_agg_ok = 0,\
+	LNK((s)->s_below) == NULL || LNK((s)->s_list)->sl_agg_fold == NULL ?\
+	(void) 0 : agg_dirty(LNK((s)->s_below)))
+
+#ifdef SL_COMPACT_LAYOUT
+/*
+ * In the compact layout, everything that a bounds-check or a step to the next
+ * slab needs (the extrema, the element count, and the sibling pointers) comes
+ * first, and slabs are allocated on a cache-line boundary. So checking a slab
+ * costs exactly one cache miss. The members that are only needed when we
+ * modify the list (s_below, s_list, s_agg, s_refs) come after.
  */
 struct slab {
 	slablist_elem_t		s_min;
 	slablist_elem_t		s_max;
+	uint16_t		s_elems;
+	uint8_t			s_bits;		/* packed width, if cold */
+	uint8_t			s_hot:1;	/* written to since compress */
+	uint8_t			s_dirty:1;	/* written since checkpoint */
+	uint8_t			s_agg_ok:1;	/* s_agg is valid */
+	uint8_t			s_fwd:1;	/* forwarded to, by a clone */
+	uint32_t		s_id;		/* stable id, for checkpoints */
 	slab_t			*s_next;
 	slab_t 			*s_prev;
 	subslab_t		*s_below;
 	slablist_t		*s_list;
-#if SELEM_MAX < 256
-	uint8_t			s_elems;
+	slablist_elem_t		s_agg;		/* aggregate of elems */
+	uint32_t		s_refs;		/* extra refs, if cloned */
+	slablist_elem_t		s_arr[];
+};
 #else
+struct slab {
+	slablist_elem_t		s_min;
+	slablist_elem_t		s_max;
+	slab_t			*s_next;
+	slab_t 			*s_prev;
+	subslab_t		*s_below;
+	slablist_t		*s_list;
 	uint16_t		s_elems;
-#endif
-	slablist_elem_t		s_arr[SELEM_MAX];
+	uint8_t			s_bits;		/* packed width, if cold */
+	uint8_t			s_hot:1;	/* written to since compress */
+	uint8_t			s_dirty:1;	/* written since checkpoint */
+	uint8_t			s_agg_ok:1;	/* s_agg is valid */
+	uint8_t			s_fwd:1;	/* forwarded to, by a clone */
+	uint32_t		s_id;		/* stable id, for checkpoints */
+	slablist_elem_t		s_agg;		/* aggregate of elems */
+	uint32_t		s_refs;		/* extra refs, if cloned */
+	slablist_elem_t		s_arr[];
 };
+#endif
 
 /*
  * Unlike normal slabs (slab_t's), subslabs meta-data is disembodied from the
@@ -316,7 +486,52 @@ typedef struct subarr {
  * instead of traversing the toplayer. Speeds us up by some constant factor.
  * Naturally this member has to be updated after adds and removals. Grep around
  * slablist_add.c and slablist_rem.c for instances where we do this.
+ *
+ * If the list has an aggregate (see slablist_set_aggregate()), each subslab
+ * also keeps the aggregate of the user-data it references in `ss_agg`, which
+ * is valid while `ss_agg_ok` is set. Everything that changes `ss_usr_elems`
+ * marks the aggregate as stale along with it, and so does SLAB_SET_DIRTY().
+ * A stale subslab always has stale subslabs below it, all the way down to the
+ * baselayer, so agg_flush() can find every stale subslab by descending from
+ * the baselayer into the stale ones only. It recombines them from the
+ * aggregates of their slabs or subslabs as it comes back up, which is done at
+ * the end of every modification, so the aggregates are always valid between
+ * modifications.
  */
+#ifdef SL_COMPACT_LAYOUT
+struct subslab {
+	slablist_elem_t		ss_min;
+	slablist_elem_t		ss_max;
+	uint16_t		ss_elems;
+	uint8_t			ss_agg_ok;	/* ss_agg is valid */
+	uint8_t			ss_fwd;		/* forwarded to, by a clone */
+	uint32_t		ss_refs;	/* extra refs, if cloned */
+	subarr_t		*ss_arr;
+	subslab_t		*ss_next;
+	subslab_t		*ss_prev;
+	subslab_t		*ss_below;
+	slablist_t		*ss_list;
+	uint64_t		ss_usr_elems;
+	slablist_elem_t		ss_agg;		/* aggregate of usr elems */
+};
+
+/*
+ * The separate subarr_t means that each layer we descend through in
+ * find_bubble_up() costs us two unrelated cache misses: one for the subslab
+ * and one for its array. In the compact layout the subslabs that belong to a
+ * list are allocated together with their array, in a single cache-aligned
+ * subslab_co_t. `ss_arr` still points to the array, so that the rest of the
+ * code (and the test code, which makes detached copies of subslabs) does not
+ * have to care which layout is in use. These are always allocated and freed
+ * with mk_subslab_arr() and rm_subslab_arr().
+ */
+typedef struct subslab_co {
+	subslab_t		sc_ss;
+	subarr_t		sc_arr;
+} subslab_co_t;
+
+#define	SL_CACHE_LINE	64
+#else
 struct subslab {
 	slablist_elem_t		ss_min;
 	slablist_elem_t		ss_max;
@@ -325,9 +540,14 @@ struct subslab {
 	subslab_t		*ss_below;
 	slablist_t		*ss_list;
 	uint16_t		ss_elems;
+	uint8_t			ss_agg_ok;	/* ss_agg is valid */
+	uint8_t			ss_fwd;		/* forwarded to, by a clone */
+	uint32_t		ss_refs;	/* extra refs, if cloned */
 	uint64_t		ss_usr_elems;
 	subarr_t		*ss_arr;
+	slablist_elem_t		ss_agg;		/* aggregate of usr elems */
 };
+#endif
 
 /*
  * When adding into a slab or subslab, our functions return a context
@@ -338,7 +558,8 @@ struct subslab {
  * previous slab, (4) into the slab before the current slab, (5) into the slab
  * after the current slab. An element can also FAIL to be added due to the
  * presence of an equivalent/duplicate element --- equivalence is determined by
- * the user-provided comparison function.
+ * the user-provided comparison function --- or it can replace such an element,
+ * in which case the number of elements doesn't change.
  */
 #define	AC_HOW_INTO		0
 #define	AC_HOW_SP_NX		1
@@ -346,6 +567,7 @@ struct subslab {
 #define	AC_HOW_BEFORE		3
 #define	AC_HOW_AFTER		4
 #define	AC_HOW_EDUP		5
+#define	AC_HOW_REP		6
 
 /*
  * Additionally, if a new slab or subslab was created as a result of an
@@ -424,10 +646,507 @@ typedef struct rem_ctx {
 struct slablist_bm {
 	slablist_t		*sb_list;
 	void			*sb_node;
-	int8_t			sb_index;
+	int16_t			sb_index;
+};
+
+/*
+ * A span walks the elements of a range, a run at a time (see
+ * slablist_span_begin()). The bookmark is on the first element of the next
+ * run, or right after the next run if the span goes backward (`sp_left`).
+ * `sp_buf` holds the elements of the current run, if they had to be copied.
+ */
+struct slablist_span {
+	slablist_bm_t		sp_bm;
+	slablist_elem_t		sp_min;
+	slablist_elem_t		sp_max;
+	int			sp_left;
+	slablist_elem_t		*sp_buf;
+	size_t			sp_bufsz;
 };
 
 #define IS_SMALL_LIST(sl) (sl->sl_slabs == 0)
+
+/*
+ * This is the header of a slab list saved by slablist_save(). It is followed
+ * by the list's name (sh_namelen bytes, not NUL-terminated), and then by a
+ * table of sh_blocks uint16_t's, which holds the number of elements in each
+ * block. The blocks come last, in list order. Each block is the contents of
+ * one slab (or the entire small list), written out as is. If the list was
+ * saved with a serialize callback, each block is instead a uint64_t length
+ * followed by that many bytes, holding a uint32_t length and the serialized
+ * bytes for each element.
+ *
+ * Everything is in the byte order of the machine that saved the list, so these
+ * files are not portable across architectures.
+ *
+ * Version 2 added sh_lsn, the last logged operation that the saved list
+ * reflects (see slablist_log_t). Version 1 headers end right before it.
+ */
+#define	SL_SAVE_MAGIC	"SLABLIST"
+#define	SL_SAVE_VERSION	2
+#define	SL_SAVE_HDR_V1	(offsetof(slablist_hdr_t, sh_lsn))
+
+typedef struct slablist_hdr {
+	char			sh_magic[8];	/* SL_SAVE_MAGIC */
+	uint32_t		sh_version;	/* SL_SAVE_VERSION */
+	uint8_t			sh_flags;	/* the list's sl_flags */
+	uint8_t			sh_req_sublayer; /* the list's sl_req_sublayer */
+	uint8_t			sh_small;	/* saved from a small list */
+	uint8_t			sh_ser;		/* saved with serialize cb */
+	uint16_t		sh_selem_max;	/* elems per slab */
+	uint16_t		sh_subelem_max;	/* elems per subslab */
+	uint16_t		sh_namelen;	/* bytes in the name */
+	uint64_t		sh_elems;	/* tot elems in list */
+	uint64_t		sh_blocks;	/* num of blocks */
+	uint64_t		sh_lsn;		/* last op in the list */
+} slablist_hdr_t;
+
+/*
+ * An image saved by slablist_checkpoint_incremental() holds only what changed
+ * since the previous checkpoint (full or incremental) of the same list, and
+ * can only be applied on top of the list as of that checkpoint. ih_seq counts
+ * the incrementals since the last full checkpoint, so that a missing or
+ * reordered image is caught.
+ *
+ * The header is followed by the manifest: one slablist_ment_t for each slab of
+ * the list, in list order. Then come the elements of the slabs that are
+ * marked as dirty in the manifest, one block per slab, in the same order. A
+ * clean slab is the slab with the same id in the list that the image gets
+ * applied to. The slabs that are not in the manifest are gone. If the list was
+ * a small list, there is no manifest, and ih_elems elements follow the header.
+ */
+#define	SL_INCR_MAGIC	"SLABINCR"
+#define	SL_INCR_VERSION	1
+
+typedef struct slablist_ihdr {
+	char			ih_magic[8];	/* SL_INCR_MAGIC */
+	uint32_t		ih_version;	/* SL_INCR_VERSION */
+	uint8_t			ih_flags;	/* the list's sl_flags */
+	uint8_t			ih_small;	/* saved from a small list */
+	uint16_t		ih_pad;
+	uint64_t		ih_seq;		/* incrementals since full */
+	uint64_t		ih_prev_lsn;	/* LSN of the previous one */
+	uint64_t		ih_lsn;		/* last op in the list */
+	uint64_t		ih_elems;	/* tot elems in list */
+	uint64_t		ih_slabs;	/* entries in the manifest */
+	uint64_t		ih_slab_id;	/* the list's sl_slab_id */
+} slablist_ihdr_t;
+
+typedef struct slablist_ment {
+	uint32_t		me_id;		/* the slab's s_id */
+	uint16_t		me_elems;	/* elems in the slab */
+	uint8_t			me_dirty;	/* elems follow the manifest */
+	uint8_t			me_pad;
+} slablist_ment_t;
+
+/*
+ * A list can have a write-ahead log (see slablist_log_attach()), to which
+ * every successful slablist_add(), slablist_rem(), and slablist_rem_range()
+ * appends a record before returning. Each record gets the next log sequence
+ * number (LSN). A list saved by slablist_checkpoint() carries the LSN of the
+ * last record that it reflects, so that recovering the list is a matter of
+ * loading the latest checkpoint and replaying the records after it.
+ *
+ * Records are collected in memory and written out lg_batch at a time, with a
+ * single write(), so that many operations share the cost of one write (and
+ * of one fsync(), depending on lg_sync). The log file starts with a
+ * slablist_lhdr_t. A record whose checksum doesn't match marks the end of the
+ * log, since a crash can leave a torn record behind.
+ */
+#define	SL_LOG_MAGIC	"SLABWLOG"
+#define	SL_LOG_VERSION	1
+#define	SL_LOG_BATCH_DEF	64
+
+#define	SL_LOG_ADD	1
+#define	SL_LOG_REM	2
+#define	SL_LOG_REM_RANGE	3
+
+typedef struct slablist_lhdr {
+	char			lh_magic[8];	/* SL_LOG_MAGIC */
+	uint32_t		lh_version;	/* SL_LOG_VERSION */
+	uint32_t		lh_pad;
+} slablist_lhdr_t;
+
+typedef struct slablist_lrec {
+	uint64_t		lr_lsn;		/* sequence number */
+	uint8_t			lr_op;		/* SL_LOG_* */
+	uint8_t			lr_rep;		/* `rep` of an add */
+	uint16_t		lr_pad;
+	uint32_t		lr_sum;		/* checksum of the record */
+	slablist_elem_t		lr_a;		/* the elem, or range min */
+	slablist_elem_t		lr_b;		/* the pos, or range max */
+} slablist_lrec_t;
+
+typedef struct slablist_log {
+	int			lg_fd;		/* the log file */
+	uint8_t			lg_sync;	/* SL_LOG_* sync policy */
+	uint32_t		lg_batch;	/* records per write */
+	uint32_t		lg_nrecs;	/* records not yet written */
+	slablist_lrec_t		*lg_recs;	/* the unwritten records */
+} slablist_log_t;
+
+/*
+ * A list saved by slablist_save_mapped() is laid out so that it can be
+ * searched right where it lies, in a read-only mapping of the file that is
+ * shared by every process that opens it (see slablist_open_mapped()). There is
+ * no load step, so the file can't contain any pointers.
+ *
+ * The file starts with a slablist_mhdr_t and the NUL-terminated name. Then
+ * come the slabs, as mslab_t's, one after the other and in list order. Each
+ * mslab_t is followed by room for sm_selem_max elements (of which ms_elems are
+ * used), so that we can step to the next or previous slab without a pointer.
+ *
+ * In place of the sublayers, there is an index of msubslab_t's, which is built
+ * from scratch when the list is saved, with every subslab but the last in each
+ * layer full. Each msubslab_t is followed by room for sm_subelem_max offsets,
+ * from the start of the file, to the slabs or subslabs above it. The index
+ * layers are stored one after the other, from the one right below the slabs
+ * down to the baselayer. Only the baselayer has to be found from the header.
+ *
+ * Like the format of slablist_save(), this is in native byte order.
+ */
+#define	SL_MAP_MAGIC	"SLABMAPD"
+#define	SL_MAP_VERSION	1
+
+typedef struct slablist_mhdr {
+	char			sm_magic[8];	/* SL_MAP_MAGIC */
+	uint32_t		sm_version;	/* SL_MAP_VERSION */
+	uint8_t			sm_flags;	/* the list's sl_flags */
+	uint8_t			sm_layers;	/* num of index layers */
+	uint16_t		sm_selem_max;	/* elems per slab */
+	uint16_t		sm_subelem_max;	/* elems per subslab */
+	uint16_t		sm_namelen;	/* bytes in the name, with NUL */
+	uint64_t		sm_elems;	/* tot elems in list */
+	uint64_t		sm_slabs;	/* num of slabs */
+	uint64_t		sm_slab_off;	/* offset of first slab */
+	uint64_t		sm_base_off;	/* offset of first baseslab */
+	uint64_t		sm_base_slabs;	/* num of baseslabs */
+} slablist_mhdr_t;
+
+typedef struct mslab {
+	slablist_elem_t		ms_min;
+	slablist_elem_t		ms_max;
+	uint64_t		ms_elems;
+} mslab_t;
+
+typedef struct msubslab {
+	slablist_elem_t		mss_min;
+	slablist_elem_t		mss_max;
+	uint64_t		mss_elems;
+	uint64_t		mss_usr_elems;
+} msubslab_t;
+
+#define	MSLAB_BYTES(n)	(sizeof (mslab_t) + ((n) * sizeof (slablist_elem_t)))
+#define	MSUBSLAB_BYTES(n)	(sizeof (msubslab_t) + ((n) * sizeof (uint64_t)))
+#define	MSLAB_ARR(s)		((slablist_elem_t *)((s) + 1))
+#define	MSUBSLAB_OFFS(s)	((uint64_t *)((s) + 1))
+
+#define	IS_MAPPED_LIST(sl)	((sl)->sl_map != NULL)
+#define	MAPPED_AT(sl, off)	((void *)((char *)(sl)->sl_map + (off)))
+#define	MAPPED_SLAB(sl, i)\
+	((mslab_t *)MAPPED_AT((sl), (sl)->sl_map->sm_slab_off +\
+	    ((i) * MSLAB_BYTES((sl)->sl_map->sm_selem_max))))
+
+/*
+ * Random insertions and removals around slab boundaries tend to create a slab
+ * (via a spill into a new adjacent slab) only to free it again a few
+ * operations later (via a merge into the adjacent slabs), and so on. To keep
+ * this churn away from the allocator, every slab list keeps a small pool of
+ * empty slabs and empty subslabs (with their subarr_t still attached). Freed
+ * slabs go into the pool, and new slabs come out of it. We only touch the
+ * allocator when the pool is full (on free) or empty (on create). The pool
+ * belongs to the toplayer, even for subslabs created in the sublayers.
+ *
+ * The number of spares of each kind is capped by `sl_spare_max`, which can be
+ * changed by the user. Setting it to 0 disables the pool. The pool is
+ * drained whenever the slab list is reaped, destroyed, or turned back into a
+ * small list.
+ */
+#define	SL_SPARE_MAX_DEF	4
+
+/*
+ * A slab list can be created in a shared memory segment (see
+ * slablist_shm_create() in slablist_cons.c), so that several processes can
+ * use one copy of it. Everything that belongs to the list --- the slablist_t's
+ * of all its layers, its slabs, subslabs, subarr_t's, small list nodes, and
+ * its name --- is then carved out of the segment, instead of the heap. The
+ * segment starts with this header.
+ *
+ * Each process can map the segment at a different address, so the links
+ * between the parts of a shared list (the list's head and end, the sibling,
+ * below, and list pointers of slabs and subslabs, the pointers in subarr_t's,
+ * and so on) are stored as offsets from the start of the segment. An offset
+ * is tagged by setting its low bit, which is always clear in a pointer to a
+ * slab, subslab, subarr_t, small list node, or slablist_t. The links are read
+ * through LNK(), which turns an offset back into a pointer into the segment
+ * that the calling thread holds the lock of (see shm_enter()), and written
+ * through MKLNK(), which turns a pointer into that segment into an offset.
+ * Both leave the pointers of lists that aren't shared alone, and MKLNK()
+ * doesn't even look at them until the process has mapped a segment. (LNK()
+ * also forwards the links of cloned lists; see slablist_cow_t.) The
+ * offsets that only the segment itself uses, like those of the list and of
+ * the free lists, are stored untagged.
+ *
+ * The comparison and bounds callbacks can be at different addresses in
+ * different processes too, so a shared list doesn't store them. Each process
+ * passes its own to slablist_shm_create() or slablist_shm_attach(), and they
+ * are kept in the process's shm_map_t for the segment. The callbacks are
+ * called through SL_CMPF() and SL_BNDF(), which fall back on those of the
+ * segment that the calling thread holds the lock of. The other callbacks
+ * (hashes, keys, prefixes, and aggregates) can't be given to a shared list.
+ *
+ * The segment is carved up by a bump allocator, and freed chunks go on a free
+ * list for their size (a shm_free_t), so that slabs and subslabs are recycled.
+ * The segment does not grow; once it is nearly full, slablist_add() fails with
+ * SL_ENOSPC.
+ *
+ * Any number of processes can read the list at once, but only one can modify
+ * it, which is what the process-shared `shm_lock` is for.
+ */
+#define	SL_SHM_MAGIC	"SLABSHMS"
+#define	SL_SHM_NAME_MAX	64
+
+typedef struct shm_free {
+	uint64_t		sf_size;	/* size of the chunks */
+	uint64_t		sf_head;	/* offset of first free chunk */
+	uint64_t		sf_next;	/* offset of next size */
+} shm_free_t;
+
+typedef struct slablist_shm {
+	char			shm_magic[8];	/* SL_SHM_MAGIC */
+	uint64_t		shm_size;	/* size of the segment */
+	uint64_t		shm_brk;	/* offset of the free space */
+	uint64_t		shm_free;	/* offset of freed chunks */
+	uint64_t		shm_list;	/* offset of the list */
+	pthread_rwlock_t	shm_lock;	/* one writer, many readers */
+	char			shm_name[SL_SHM_NAME_MAX]; /* for shm_open */
+} slablist_shm_t;
+
+/*
+ * Every segment that a process has mapped has one of these, in the process's
+ * own memory.
+ */
+typedef struct shm_map {
+	slablist_shm_t		*sm_seg;	/* where we mapped it */
+	slablist_cmp_t		*sm_cmp;	/* our comparison callback */
+	slablist_bnd_t		*sm_bnd;	/* our bounds callback */
+	struct shm_map		*sm_next;	/* next mapped segment */
+} shm_map_t;
+
+#define	IS_SHM_LIST(sl)	((sl)->sl_shm != NULL)
+#define	SHM_AT(shm, off)	((void *)((char *)(shm) + (off)))
+#define	SHM_OFF(shm, p)		((uint64_t)((char *)(p) - (char *)(shm)))
+
+extern uint32_t shm_nmaps;
+extern uint32_t cow_nfwd;
+void *shm_ptr(uintptr_t);
+void *cow_ptr(void *);
+void *shm_off(void *);
+slablist_cmp_t *shm_cmp(void);
+slablist_bnd_t *shm_bnd(void);
+
+static inline void *
+lnk_get(void *p)
+{
+	if (((uintptr_t)p & 1) != 0) {
+		return (shm_ptr((uintptr_t)p));
+	}
+	return (__atomic_load_n(&cow_nfwd, __ATOMIC_RELAXED) == 0 ? p :
+	    cow_ptr(p));
+}
+
+static inline void *
+lnk_mk(void *p)
+{
+	return (shm_nmaps == 0 ? p : shm_off(p));
+}
+
+#define	LNK(p)		((__typeof__(p))lnk_get((void *)(p)))
+#define	MKLNK(p)	((__typeof__(p))lnk_mk((void *)(p)))
+#define	SL_CMPF(sl)	((sl)->sl_cmp_elem != NULL ? (sl)->sl_cmp_elem :\
+	shm_cmp())
+#define	SL_BNDF(sl)	((sl)->sl_bnd_elem != NULL ? (sl)->sl_bnd_elem :\
+	shm_bnd())
+#define	SL_NAME(sl)	(IS_SHM_LIST(sl) ? LNK((sl)->sl_name) : (sl)->sl_name)
+
+/*
+ * slablist_clone() gives us a second handle to a list, which starts out
+ * sharing every slab and subslab with the first one. The handles that share
+ * nodes with each other make up a family, which is tracked by a
+ * slablist_cow_t. Every handle has its own slablist_t for each of its layers,
+ * and its own copy of any small list, so only the nodes are ever shared.
+ *
+ * A node that more than one parent (or, for the nodes of the baselayer, more
+ * than one handle) refers to has a non-zero `s_refs` (`ss_refs`), which counts
+ * the references beyond the first. Before a handle modifies its list, it makes
+ * sure that every node that the modification can touch is its own, by walking
+ * down from the baselayer and copying each shared node on the way, along with
+ * the path that leads to it (see cow_own() in slablist_cons.c). A copied
+ * subslab refers to the same children as the original, so the children gain
+ * a reference, and the nodes that the modification doesn't touch stay shared.
+ * So a clone costs a copy of the baselayer's references, and each write costs
+ * a copy of the few nodes around its path, once, after which the handle can
+ * write to them in place. Memory only grows with the nodes that the handles
+ * have changed.
+ *
+ * The nodes next to a copied node still point at the original, through their
+ * `s_next` and `s_prev` (`ss_next` and `ss_prev`). Those nodes are shared, so
+ * we can't fix them, and the handle instead keeps a map (`sl_fwd`, a cow_fwd_t)
+ * from the original to its copy. LNK() looks up every link in the map of the
+ * handle that is being used (see cow_enter()), as long as any handle has a
+ * map. The map holds a reference to each original, and each copy in the map
+ * has `s_fwd` (`ss_fwd`) set, so that moving or freeing it knows to update the
+ * map. When a family is down to one handle, the nodes next to its copies
+ * aren't shared with anyone, and we fix them, and drop the map.
+ *
+ * The same goes for the children of a copied subslab, which still point down
+ * at the original through their `s_below` (`ss_below`). Only the nodes that a
+ * modification touches need those to be right, and cow_own() sets them. But a
+ * handle that is on its own doesn't call cow_own() anymore, so at that point
+ * we set them all, if any subslab was copied (`cw_stale`).
+ *
+ * Nodes point back at the slablist_t of the handle (or layer) that made them
+ * (s_list, ss_list), which we call their home. Other handles only ever look at
+ * the home's callbacks and flags, which are the same throughout the family.
+ * So a home that gets destroyed (or a sublayer that gets detached) sticks
+ * around, on `cw_gone` (or `sl_retired`), until the family is gone.
+ */
+typedef struct slablist_cow {
+	uint64_t		cw_refs;	/* handles in the family */
+	slablist_t		*cw_live;	/* those handles */
+	slablist_t		*cw_gone;	/* destroyed homes */
+	uint8_t			cw_stale;	/* a subslab was copied */
+} slablist_cow_t;
+
+typedef struct cow_fwd {
+	uint64_t		fw_n;		/* entries in use */
+	uint64_t		fw_cap;		/* slots, a power of 2 */
+	void			**fw_key;	/* originals */
+	void			**fw_val;	/* their copies */
+	uint8_t			*fw_layer;	/* layer of each original */
+} cow_fwd_t;
+
+#define	IS_COW_LIST(sl)	((sl)->sl_cow != NULL)
+
+/*
+ * What a modification is about to touch, as far as cow_own() is concerned.
+ */
+#define	COW_RANGE	0	/* the elems in a range */
+#define	COW_POS		1	/* the elem at a position */
+#define	COW_END		2	/* the end of the list */
+#define	COW_ALL		3	/* everything */
+
+/*
+ * A list in MVCC mode (see slablist_mvcc_enable()) has one writer, and any
+ * number of readers in other threads. At the end of each modification, the
+ * writer publishes the list as it is: it clones the list, which shares every
+ * node (see slablist_cow_t) and costs a reference to each node of the
+ * baselayer, and swaps the clone into `mv_cur` with one atomic exchange.
+ * Since the writer copies the nodes that it shares with a version, and the
+ * paths down to them, before it modifies them, a version never changes, and
+ * readers can use it for as long as they like.
+ *
+ * A reader pins the current version with slablist_pin(), which is a single
+ * atomic add, and gives it back with slablist_unpin(), which is an atomic
+ * compare-and-swap or subtraction. Neither takes a lock, or waits for the
+ * writer. The pins of the current version are counted in the top 16 bits of
+ * `mv_cur` itself, next to the pointer to the version (user space pointers
+ * fit in the low 48 bits), so that reading the pointer and pinning the
+ * version are one step, and the writer can't free the version in between.
+ * When the writer swaps a version out, it adds that count to the version's
+ * `vr_pins`, which readers that unpin it afterwards decrement. Whoever brings
+ * it to 0 is the last one to use the version. If that's the writer, it frees
+ * the version then and there. If it's a reader, the reader pushes it on
+ * `mv_dead`, and the writer frees it at the end of its next modification,
+ * since only the writer may touch the reference counts of the nodes.
+ *
+ * As long as old versions are pinned, the writer forwards every node that it
+ * has copied (see slablist_cow_t), and publishing a version copies that map.
+ * But once they're all gone, the only other handle in the family is the
+ * version that was just published, which forwards everything that the writer
+ * does. So the writer can point the links of the shared nodes at the copies,
+ * which that version's readers see either way, and drop its map (see
+ * cow_relink()).
+ *
+ * The writer holds `mv_lock` for the duration of each modification, so that
+ * writers in different threads take turns. Readers never take it.
+ */
+typedef struct slablist_ver {
+	slablist_t		*vr_list;	/* the version itself */
+	int64_t			vr_pins;	/* pins, once swapped out */
+	struct slablist_ver	*vr_next;	/* next in mv_dead */
+} slablist_ver_t;
+
+typedef struct slablist_mvcc {
+	pthread_mutex_t		mv_lock;	/* see above */
+	uint64_t		mv_cur;		/* current version, and pins */
+	slablist_ver_t		*mv_dead;	/* versions no one pins */
+} slablist_mvcc_t;
+
+#define	MV_PIN			(1ULL << 48)
+#define	MV_VER(w)		((slablist_ver_t *)(uintptr_t)((w) & (MV_PIN - 1)))
+#define	MV_PINS(w)		((int64_t)((w) >> 48))
+#define	IS_MVCC_LIST(sl)	((sl)->sl_mvcc != NULL)
+#define	IS_MVCC_VER(sl)		((sl)->sl_ver != NULL)
+
+/*
+ * A list that has a hash function (see slablist_set_hash()) keeps a blocked
+ * Bloom filter of its elements, so that slablist_find() can turn away most of
+ * the keys that aren't in the list without descending the list, and without
+ * calling the comparison function. The filter is an array of blocks that are
+ * the size of a cache line. The hash of an element picks a block, and then
+ * SL_BLOOM_K bits within it, so looking up a key touches a single cache line.
+ *
+ * A removed element can't have its bits cleared, since other elements may
+ * share them, so removals only make the filter less selective. Once the
+ * removals since the filter was built outnumber the elements in the list, or
+ * more elements have been added than the filter was sized for, we build it
+ * again from the list. Both cost time linear in the size of the list, which
+ * is amortized over the removals or additions that led up to them.
+ *
+ * Clones share the filter of the list that they were cloned from (`bf_refs`
+ * counts the handles), and whichever of them modifies it first gets a copy.
+ */
+#define	SL_BLOOM_K	6	/* bits per element */
+#define	SL_BLOOM_BITS	10	/* bits of filter per element */
+#define	SL_BLOOM_WORDS	8	/* words per block */
+#define	SL_BLOOM_BLOCK	(SL_BLOOM_WORDS * 64)	/* bits per block */
+
+typedef struct slablist_bloom {
+	uint64_t		*bf_bits;	/* the blocks */
+	uint64_t		bf_nblocks;	/* num of blocks (power of 2) */
+	uint64_t		bf_cap;		/* elems it was sized for */
+	uint64_t		bf_adds;	/* elems added since built */
+	uint64_t		bf_rems;	/* elems removed since built */
+	uint64_t		bf_refs;	/* handles using it */
+	slablist_hash_t		*bf_hash;	/* user's hash function */
+} slablist_bloom_t;
+
+/*
+ * A list that has a key function (see slablist_set_key()) keeps a root index
+ * over its baselayer, which find_bubble_up() uses instead of scanning the
+ * baselayer from its head. The index is an array of the baselayer's subslabs,
+ * in order, along with the key of the minimum of each as it was when the
+ * index was built. A lookup interpolates between the first and last keys to
+ * guess where the element is, walks the array of keys to correct the guess,
+ * and then checks the subslab that it lands on (and its neighbours, if the
+ * minimums have moved since) with the bounds function.
+ *
+ * The index only holds pointers to subslabs, which go away when subslabs are
+ * unlinked from the baselayer, or when sublayers are attached or detached.
+ * Every such change bumps `sl_base_gen` in the toplayer, and a lookup that
+ * finds that the index was built at an older generation builds it again
+ * first. The baselayer never has more than SL_REQ_MAX subslabs, so this is
+ * cheap.
+ */
+typedef struct slablist_rix {
+	uint64_t		rx_gen;		/* sl_base_gen when built */
+	uint64_t		rx_nodes;	/* num of baseslabs */
+	uint64_t		rx_cap;		/* room in the arrays */
+	subslab_t		**rx_node;	/* the baseslabs */
+	double			*rx_key;	/* keys of their minimums */
+} slablist_rix_t;
+
 /*
  * This is the handle that stores the state of the slablist. It contains bounds
  * and comparison functions supplied by the user. Every sublayer has one of
@@ -456,6 +1175,42 @@ struct slablist {
 					slablist_elem_t); /* cmp callback */
 	int			(*sl_bnd_elem)(slablist_elem_t, slablist_elem_t,
 					slablist_elem_t); /* bounds callback */
+	slab_t			*sl_spare_slabs; /* empty slabs for reuse */
+	subslab_t		*sl_spare_subslabs; /* empty subslabs+subarrs */
+	uint8_t			sl_nspare_slabs; /* num spare slabs */
+	uint8_t			sl_nspare_subslabs; /* num spare subslabs */
+	uint8_t			sl_spare_max;	/* max num of spares of each */
+	uint16_t		sl_selem_max;	/* elems per slab */
+	uint16_t		sl_subelem_max;	/* elems per subslab */
+	uint16_t		sl_smelem_max;	/* elems before using slabs */
+	uint64_t		sl_cold_slabs;	/* num of cold slabs */
+	uint8_t			sl_name_alloc;	/* sl_name is ours to free */
+	slablist_mhdr_t		*sl_map;	/* file, if mapped read-only */
+	uint64_t		sl_map_len;	/* bytes mapped */
+	slablist_shm_t		*sl_shm;	/* segment, if shared */
+	slablist_log_t		*sl_log;	/* write-ahead log, if any */
+	uint64_t		sl_lsn;		/* last logged operation */
+	uint64_t		sl_slab_id;	/* next slab id */
+	uint64_t		sl_ckpt_seq;	/* incrementals since full */
+	uint64_t		sl_ckpt_lsn;	/* LSN of last checkpoint */
+	slablist_cow_t		*sl_cow;	/* family, if cloned */
+	slablist_t		*sl_cow_next;	/* next in the family */
+	slablist_t		*sl_retired;	/* detached, but still home */
+	cow_fwd_t		*sl_fwd;	/* forwarded nodes, if any */
+	uint8_t			sl_home;	/* nodes may point here */
+	slablist_mvcc_t		*sl_mvcc;	/* if in MVCC mode */
+	slablist_ver_t		*sl_ver;	/* if an MVCC version */
+	slablist_bloom_t	*sl_bloom;	/* filter, if hashed */
+	slablist_key_t		*sl_key;	/* key function, if any */
+	slablist_rix_t		*sl_rix;	/* root index, if keyed */
+	slablist_pfx_t		*sl_pfx;	/* prefix function, if any */
+	uint64_t		sl_base_gen;	/* bumped on baselayer change */
+	slab_t			*sl_last;	/* slab found last, if any */
+	uint64_t		sl_last_hits;	/* searches it saved */
+	uint64_t		sl_last_misses;	/* searches it didn't */
+	slablist_fold_t		*sl_agg_fold;	/* aggregate, if any */
+	slablist_comb_t		*sl_agg_comb;	/* combines aggregates */
+	slablist_elem_t		sl_agg_zero;	/* aggregate of nothing */
 };
 
 /*
@@ -498,12 +1253,14 @@ mt_slablist_t *mk_mt_slablist(void);
 void rm_mt_slablist(mt_slablist_t *);
 lk_slablist_t *mk_lk_slablist(void);
 void rm_lk_slablist(lk_slablist_t *);
-slab_t *mk_slab(void);
+slab_t *mk_slab(size_t);
 subslab_t *mk_subslab(void);
 subarr_t *mk_subarr(void);
-void rm_slab(slab_t *);
+void rm_slab(slab_t *, size_t);
 void rm_subslab(subslab_t *);
 void rm_subarr(subarr_t *);
+subslab_t *mk_subslab_arr(void);
+void rm_subslab_arr(subslab_t *);
 void *mk_buf(size_t);
 void *mk_zbuf(size_t);
 void rm_buf(void*, size_t);
@@ -511,3 +1268,52 @@ small_list_t *mk_sml_node(void);
 void rm_sml_node(small_list_t *);
 add_ctx_t *mk_add_ctx(void);
 void rm_add_ctx(add_ctx_t *);
+slablist_shm_t *shm_set_arena(slablist_shm_t *);
+int shm_full(slablist_t *);
+int shm_enter(slablist_t *, int);
+void shm_exit(slablist_t *, int);
+int log_append(slablist_t *, uint8_t, slablist_elem_t, slablist_elem_t,
+    uint8_t);
+void log_cancel(slablist_t *);
+void log_destroy(slablist_t *);
+slablist_t *cow_swap(slablist_t *);
+void cow_own(slablist_t *, int, slablist_elem_t, slablist_elem_t);
+void cow_own_all(slablist_t *);
+void cow_moved(slablist_t *, void *, void *);
+void cow_freed(slablist_t *, void *);
+void cow_drop_layer(slablist_t *);
+int mvcc_enter(slablist_t *);
+void mvcc_exit(slablist_t *, int);
+void bloom_build(slablist_t *, slablist_hash_t *);
+void bloom_rebuild(slablist_t *);
+void bloom_release(slablist_bloom_t *);
+void bloom_add(slablist_t *, slablist_elem_t);
+void bloom_rem(slablist_t *, uint64_t);
+void rix_destroy(slablist_t *);
+void agg_dirty(subslab_t *);
+void agg_flush(slablist_t *);
+
+/*
+ * Makes `sl` the handle whose forwarding map LNK() uses in the calling thread,
+ * and returns the one that was in use, to be handed back to cow_exit(). A
+ * list that was never cloned has no nodes in anyone's map, so we leave the
+ * handle in use alone for it, and return COW_UNHELD, which cow_exit() ignores.
+ */
+#define	COW_UNHELD	((slablist_t *)-1)
+
+static inline slablist_t *
+cow_enter(slablist_t *sl)
+{
+	if (!IS_COW_LIST(sl)) {
+		return (COW_UNHELD);
+	}
+	return (cow_swap(sl));
+}
+
+static inline void
+cow_exit(slablist_t *prev)
+{
+	if (prev != COW_UNHELD) {
+		(void) cow_swap(prev);
+	}
+}
@@ -0,0 +1,1816 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/LIBSLABLIST.LICENSE
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/LIBSLABLIST.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*
+ * Copyright 2012 Nicholas Zivkovic. All rights reserved.
+ * Use is subject to license terms.
+ */
+
+/*
+ * This file contains the routines that save slab lists to, and load them
+ * from, file descriptors. See slablist_hdr_t in slablist_impl.h for the
+ * format.
+ *
+ * A slab's elements are already a contiguous array, so we hand the arrays
+ * straight to writev(), many slabs at a time, and on the way back in we
+ * readv() straight into freshly allocated slabs. The slab boundaries of the
+ * saved list are kept, and the sublayers are rebuilt bottom-up from the
+ * loaded slabs, instead of being grown one slablist_add() at a time.
+ *
+ * This file also contains the write-ahead logs, which, together with the
+ * snapshots taken by slablist_checkpoint(), make a list durable.
+ */
+
+#include <stdlib.h>
+#include <strings.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "slablist_impl.h"
+#include "slablist_provider.h"
+#include "slablist_cons.h"
+#include "slablist_find.h"
+#include "slablist_test.h"
+
+/*
+ * The maximum number of slabs we give to a single writev() or readv(). POSIX
+ * only guarantees an IOV_MAX of 16, but every system we build on allows at
+ * least 1024.
+ */
+#define	SL_IOV_BATCH	64
+
+/*
+ * Writes all of the buffers in `iov`, picking up where a short write left off.
+ * This modifies `iov`.
+ */
+static int
+writev_all(int fd, struct iovec *iov, int cnt)
+{
+	while (cnt > 0) {
+		ssize_t w = writev(fd, iov, cnt);
+		if (w < 0) {
+			return (SL_EIO);
+		}
+		while (cnt > 0 && (size_t)w >= iov->iov_len) {
+			w -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char *)iov->iov_base + w;
+			iov->iov_len -= w;
+		}
+	}
+	return (SL_SUCCESS);
+}
+
+/*
+ * Fills all of the buffers in `iov`. Running out of file is an error. This
+ * modifies `iov`.
+ */
+static int
+readv_all(int fd, struct iovec *iov, int cnt)
+{
+	while (cnt > 0) {
+		ssize_t r = readv(fd, iov, cnt);
+		if (r <= 0) {
+			return (SL_EIO);
+		}
+		while (cnt > 0 && (size_t)r >= iov->iov_len) {
+			r -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char *)iov->iov_base + r;
+			iov->iov_len -= r;
+		}
+	}
+	return (SL_SUCCESS);
+}
+
+static int
+read_all(int fd, void *buf, uint64_t len)
+{
+	struct iovec iov;
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	return (readv_all(fd, &iov, 1));
+}
+
+/*
+ * Grows the buffer `*buf` of `*sz` bytes, so that it can hold at least `need`
+ * bytes. The first `keep` bytes are preserved.
+ */
+static void
+grow_buf(char **buf, uint64_t *sz, uint64_t need, uint64_t keep)
+{
+	if (need <= *sz) {
+		return;
+	}
+	uint64_t nsz = *sz == 0 ? 1024 : *sz;
+	while (nsz < need) {
+		nsz *= 2;
+	}
+	char *nbuf = mk_buf(nsz);
+	if (keep > 0) {
+		bcopy(*buf, nbuf, keep);
+	}
+	if (*buf != NULL) {
+		rm_buf(*buf, *sz);
+	}
+	*buf = nbuf;
+	*sz = nsz;
+}
+
+/*
+ * Serializes the `n` elements in `arr` into one block, and writes it out.
+ */
+static int
+save_ser_block(int fd, slablist_elem_t *arr, uint64_t n, slablist_ser_t ser,
+    char **buf, uint64_t *sz)
+{
+	uint64_t off = 0;
+	uint64_t i = 0;
+	while (i < n) {
+		grow_buf(buf, sz, off + sizeof (uint32_t), off);
+		uint64_t avail = *sz - off - sizeof (uint32_t);
+		uint64_t need = ser(arr[i], *buf + off + sizeof (uint32_t),
+		    avail);
+		if (need > avail) {
+			grow_buf(buf, sz, off + sizeof (uint32_t) + need, off);
+			(void) ser(arr[i], *buf + off + sizeof (uint32_t), need);
+		}
+		uint32_t len = need;
+		bcopy(&len, *buf + off, sizeof (uint32_t));
+		off += sizeof (uint32_t) + need;
+		i++;
+	}
+	struct iovec iov[2];
+	iov[0].iov_base = &off;
+	iov[0].iov_len = sizeof (uint64_t);
+	iov[1].iov_base = *buf;
+	iov[1].iov_len = off;
+	return (writev_all(fd, iov, 2));
+}
+
+/*
+ * Writes out the elements of every slab in `sl`, one block per slab.
+ */
+static int
+save_slabs(slablist_t *sl, int fd, slablist_ser_t ser)
+{
+	struct iovec iov[SL_IOV_BATCH];
+	int cnt = 0;
+	int ret = SL_SUCCESS;
+	char *sbuf = NULL;
+	uint64_t ssz = 0;
+	slablist_elem_t *dbuf = mk_decode_buf(sl);
+	slab_t *s = LNK(sl->sl_head);
+	while (s != NULL && ret == SL_SUCCESS) {
+		if (ser != NULL) {
+			ret = save_ser_block(fd, slab_elems(s, dbuf),
+			    s->s_elems, ser, &sbuf, &ssz);
+		} else if (SLAB_IS_COLD(s) || SLAB_IS_NARROW(s)) {
+			/*
+			 * There is only one decode buffer, so we have to flush
+			 * the batch before we can decode into it.
+			 */
+			ret = writev_all(fd, iov, cnt);
+			cnt = 0;
+			iov[0].iov_base = slab_elems(s, dbuf);
+			iov[0].iov_len = s->s_elems * sizeof (slablist_elem_t);
+			if (ret == SL_SUCCESS) {
+				ret = writev_all(fd, iov, 1);
+			}
+		} else {
+			iov[cnt].iov_base = s->s_arr;
+			iov[cnt].iov_len = s->s_elems * sizeof (slablist_elem_t);
+			cnt++;
+			if (cnt == SL_IOV_BATCH) {
+				ret = writev_all(fd, iov, cnt);
+				cnt = 0;
+			}
+		}
+		s = LNK(s->s_next);
+	}
+	if (ret == SL_SUCCESS && cnt > 0) {
+		ret = writev_all(fd, iov, cnt);
+	}
+	rm_decode_buf(sl, dbuf);
+	if (sbuf != NULL) {
+		rm_buf(sbuf, ssz);
+	}
+	return (ret);
+}
+
+/*
+ * Writes out the elements of the small list `sl` as a single block.
+ */
+static int
+save_small_list(slablist_t *sl, int fd, slablist_ser_t ser)
+{
+	uint64_t sz = sl->sl_elems * sizeof (slablist_elem_t);
+	slablist_elem_t *arr = mk_buf(sz);
+	small_list_t *sml = LNK(sl->sl_head);
+	uint64_t i = 0;
+	while (i < sl->sl_elems) {
+		arr[i] = sml->sml_data;
+		sml = LNK(sml->sml_next);
+		i++;
+	}
+	int ret;
+	if (ser != NULL) {
+		char *sbuf = NULL;
+		uint64_t ssz = 0;
+		ret = save_ser_block(fd, arr, sl->sl_elems, ser, &sbuf, &ssz);
+		if (sbuf != NULL) {
+			rm_buf(sbuf, ssz);
+		}
+	} else {
+		struct iovec iov;
+		iov.iov_base = arr;
+		iov.iov_len = sz;
+		ret = writev_all(fd, &iov, 1);
+	}
+	rm_buf(arr, sz);
+	return (ret);
+}
+
+/*
+ * Same as save_slabs(), but for a mapped list.
+ */
+static int
+save_mapped_slabs(slablist_t *sl, int fd, slablist_ser_t ser)
+{
+	struct iovec iov[SL_IOV_BATCH];
+	int cnt = 0;
+	int ret = SL_SUCCESS;
+	char *sbuf = NULL;
+	uint64_t ssz = 0;
+	mslab_t *s = MAPPED_SLAB(sl, 0);
+	while (s != NULL && ret == SL_SUCCESS) {
+		if (ser != NULL) {
+			ret = save_ser_block(fd, MSLAB_ARR(s), s->ms_elems, ser,
+			    &sbuf, &ssz);
+		} else {
+			iov[cnt].iov_base = MSLAB_ARR(s);
+			iov[cnt].iov_len = s->ms_elems * sizeof (slablist_elem_t);
+			cnt++;
+			if (cnt == SL_IOV_BATCH) {
+				ret = writev_all(fd, iov, cnt);
+				cnt = 0;
+			}
+		}
+		s = mapped_slab_next(sl, s);
+	}
+	if (ret == SL_SUCCESS && cnt > 0) {
+		ret = writev_all(fd, iov, cnt);
+	}
+	if (sbuf != NULL) {
+		rm_buf(sbuf, ssz);
+	}
+	return (ret);
+}
+
+static int
+save_impl(slablist_t *sl, int fd, slablist_ser_t ser)
+{
+	if (SLIST_IS_KV(sl->sl_flags)) {
+		return (SL_EKV);
+	}
+	SLABLIST_SAVE_BEGIN(sl);
+	slablist_hdr_t hdr;
+	bzero(&hdr, sizeof (hdr));
+	bcopy(SL_SAVE_MAGIC, hdr.sh_magic, sizeof (hdr.sh_magic));
+	hdr.sh_version = SL_SAVE_VERSION;
+	hdr.sh_flags = sl->sl_flags;
+	hdr.sh_req_sublayer = sl->sl_req_sublayer;
+	hdr.sh_small = IS_SMALL_LIST(sl);
+	hdr.sh_ser = (ser != NULL);
+	hdr.sh_selem_max = sl->sl_selem_max;
+	hdr.sh_subelem_max = sl->sl_subelem_max;
+	hdr.sh_namelen = SL_NAME(sl) == NULL ? 0 : strlen(SL_NAME(sl));
+	hdr.sh_elems = sl->sl_elems;
+	hdr.sh_lsn = sl->sl_lsn;
+	if (IS_SMALL_LIST(sl)) {
+		hdr.sh_blocks = (sl->sl_elems > 0);
+	} else {
+		hdr.sh_blocks = sl->sl_slabs;
+	}
+
+	uint64_t csz = hdr.sh_blocks * sizeof (uint16_t);
+	uint16_t *counts = NULL;
+	if (csz > 0) {
+		counts = mk_buf(csz);
+	}
+	if (IS_SMALL_LIST(sl) && hdr.sh_blocks > 0) {
+		counts[0] = sl->sl_elems;
+	} else if (IS_MAPPED_LIST(sl)) {
+		mslab_t *ms = MAPPED_SLAB(sl, 0);
+		uint64_t i = 0;
+		while (i < hdr.sh_blocks) {
+			counts[i] = ms->ms_elems;
+			ms = mapped_slab_next(sl, ms);
+			i++;
+		}
+	} else if (!IS_SMALL_LIST(sl)) {
+		slab_t *s = LNK(sl->sl_head);
+		uint64_t i = 0;
+		while (i < hdr.sh_blocks) {
+			counts[i] = s->s_elems;
+			s = LNK(s->s_next);
+			i++;
+		}
+	}
+
+	struct iovec iov[3];
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof (hdr);
+	iov[1].iov_base = SL_NAME(sl);
+	iov[1].iov_len = hdr.sh_namelen;
+	iov[2].iov_base = counts;
+	iov[2].iov_len = csz;
+	int ret = writev_all(fd, iov, 3);
+	if (counts != NULL) {
+		rm_buf(counts, csz);
+	}
+
+	if (ret == SL_SUCCESS && hdr.sh_blocks > 0) {
+		if (IS_SMALL_LIST(sl)) {
+			ret = save_small_list(sl, fd, ser);
+		} else if (IS_MAPPED_LIST(sl)) {
+			ret = save_mapped_slabs(sl, fd, ser);
+		} else {
+			ret = save_slabs(sl, fd, ser);
+		}
+	}
+	SLABLIST_SAVE_END(ret);
+	return (ret);
+}
+
+/*
+ * Saves the slablist `sl` to the file descriptor `fd`, from its current
+ * offset. The elements are saved as they are, so this is only meaningful for
+ * lists of values. Lists of pointers have to use slablist_save_ser().
+ */
+int
+slablist_save(slablist_t *sl, int fd)
+{
+	slablist_t *held = cow_enter(sl);
+	int ret = save_impl(sl, fd, NULL);
+	cow_exit(held);
+	return (ret);
+}
+
+/*
+ * Saves the slablist `sl` to `fd`, using `ser` to turn each element into a
+ * sequence of bytes.
+ */
+int
+slablist_save_ser(slablist_t *sl, int fd, slablist_ser_t ser)
+{
+	slablist_t *held = cow_enter(sl);
+	int ret = save_impl(sl, fd, ser);
+	cow_exit(held);
+	return (ret);
+}
+
+/*
+ * Reads one serialized block, and deserializes its `n` elements into `arr`.
+ */
+static int
+load_ser_block(int fd, slablist_elem_t *arr, uint64_t n,
+    slablist_deser_t deser, char **buf, uint64_t *sz)
+{
+	uint64_t len;
+	if (read_all(fd, &len, sizeof (uint64_t)) != SL_SUCCESS) {
+		return (SL_EIO);
+	}
+	grow_buf(buf, sz, len, 0);
+	if (len > 0 && read_all(fd, *buf, len) != SL_SUCCESS) {
+		return (SL_EIO);
+	}
+	uint64_t off = 0;
+	uint64_t i = 0;
+	while (i < n) {
+		uint32_t elen;
+		if (off + sizeof (uint32_t) > len) {
+			return (SL_EIO);
+		}
+		bcopy(*buf + off, &elen, sizeof (uint32_t));
+		off += sizeof (uint32_t);
+		if (off + elen > len) {
+			return (SL_EIO);
+		}
+		arr[i] = deser(*buf + off, elen);
+		off += elen;
+		i++;
+	}
+	return (SL_SUCCESS);
+}
+
+/*
+ * Reads the single block of a saved small list, and links its elements
+ * together into the small list `sl`.
+ */
+static int
+load_small_list(slablist_t *sl, int fd, uint64_t n, slablist_deser_t deser)
+{
+	uint64_t sz = n * sizeof (slablist_elem_t);
+	slablist_elem_t *arr = mk_buf(sz);
+	int ret;
+	if (deser != NULL) {
+		char *sbuf = NULL;
+		uint64_t ssz = 0;
+		ret = load_ser_block(fd, arr, n, deser, &sbuf, &ssz);
+		if (sbuf != NULL) {
+			rm_buf(sbuf, ssz);
+		}
+	} else {
+		ret = read_all(fd, arr, sz);
+	}
+	small_list_t *prev = NULL;
+	uint64_t i = 0;
+	while (ret == SL_SUCCESS && i < n) {
+		small_list_t *sml = mk_sml_node();
+		sml->sml_data = arr[i];
+		if (prev == NULL) {
+			sl->sl_head = MKLNK(sml);
+		} else {
+			prev->sml_next = MKLNK(sml);
+		}
+		sl->sl_end = MKLNK(sml);
+		sl->sl_elems++;
+		prev = sml;
+		i++;
+	}
+	rm_buf(arr, sz);
+	return (ret);
+}
+
+/*
+ * Narrows the first `n` elements of `buf` into the slab `s`, which belongs to
+ * a narrow (SL_ELEM_32) list. Files always hold whole slablist_elem_t's.
+ */
+static void
+narrow_slab_from(slab_t *s, slablist_elem_t *buf, uint64_t n)
+{
+	uint64_t i = 0;
+	while (i < n) {
+		SLAB_SET(s, i, buf[i]);
+		i++;
+	}
+}
+
+/*
+ * Allocates one slab for each entry in `counts`, links them into `sl`, and
+ * reads their elements straight into them. The slabs of a narrow list are
+ * read one at a time, through a buffer.
+ */
+static int
+load_slabs(slablist_t *sl, int fd, uint16_t *counts, uint64_t nblocks,
+    slablist_deser_t deser)
+{
+	struct iovec iov[SL_IOV_BATCH];
+	int cnt = 0;
+	int ret = SL_SUCCESS;
+	char *sbuf = NULL;
+	uint64_t ssz = 0;
+	slablist_elem_t *nbuf = NULL;
+	if (SLIST_IS_NARROW(sl->sl_flags)) {
+		nbuf = mk_buf(sl->sl_selem_max * sizeof (slablist_elem_t));
+	}
+	slab_t *prev = NULL;
+	uint64_t i = 0;
+	while (i < nblocks && ret == SL_SUCCESS) {
+		if (counts[i] == 0 || counts[i] > sl->sl_selem_max) {
+			ret = SL_EIO;
+			break;
+		}
+		slab_t *s = get_spare_slab(sl);
+		SLABLIST_SLAB_MK(sl);
+		s->s_list = MKLNK(sl);
+		s->s_elems = counts[i];
+		s->s_prev = MKLNK(prev);
+		if (prev == NULL) {
+			sl->sl_head = MKLNK(s);
+		} else {
+			prev->s_next = MKLNK(s);
+		}
+		sl->sl_end = MKLNK(s);
+		sl->sl_slabs++;
+		sl->sl_elems += s->s_elems;
+		prev = s;
+		if (nbuf != NULL) {
+			if (deser != NULL) {
+				ret = load_ser_block(fd, nbuf, s->s_elems,
+				    deser, &sbuf, &ssz);
+			} else {
+				ret = read_all(fd, nbuf,
+				    s->s_elems * sizeof (slablist_elem_t));
+			}
+			narrow_slab_from(s, nbuf, s->s_elems);
+		} else if (deser != NULL) {
+			ret = load_ser_block(fd, s->s_arr, s->s_elems, deser,
+			    &sbuf, &ssz);
+		} else {
+			iov[cnt].iov_base = s->s_arr;
+			iov[cnt].iov_len = s->s_elems * sizeof (slablist_elem_t);
+			cnt++;
+			if (cnt == SL_IOV_BATCH) {
+				ret = readv_all(fd, iov, cnt);
+				cnt = 0;
+			}
+		}
+		i++;
+	}
+	if (ret == SL_SUCCESS && cnt > 0) {
+		ret = readv_all(fd, iov, cnt);
+	}
+	if (sbuf != NULL) {
+		rm_buf(sbuf, ssz);
+	}
+	if (nbuf != NULL) {
+		rm_buf(nbuf, sl->sl_selem_max * sizeof (slablist_elem_t));
+	}
+
+	slab_t *s = LNK(sl->sl_head);
+	while (ret == SL_SUCCESS && s != NULL) {
+		s->s_min = SLAB_GET(s, 0);
+		s->s_max = SLAB_GET(s, (s->s_elems - 1));
+		s = LNK(s->s_next);
+	}
+	return (ret);
+}
+
+/*
+ * Builds a sublayer under the layer `up`, packing as many of the slabs (or
+ * subslabs) in `up` into each subslab as will fit. `sl` is the toplayer.
+ */
+static slablist_t *
+load_sublayer(slablist_t *sl, slablist_t *up)
+{
+	slablist_t *sub = mk_slablist();
+	SLABLIST_ATTACH_SUBLAYER(up, sub);
+	bcopy(up, sub, sizeof (slablist_t));
+	sub->sl_spare_slabs = NULL;
+	sub->sl_spare_subslabs = NULL;
+	sub->sl_nspare_slabs = 0;
+	sub->sl_nspare_subslabs = 0;
+	sub->sl_cold_slabs = 0;
+	sub->sl_name_alloc = 0;
+	sub->sl_sublayer = NULL;
+	sub->sl_baselayer = NULL;
+	sub->sl_superlayer = MKLNK(up);
+	sub->sl_sublayers = 0;
+	sub->sl_layer = up->sl_layer + 1;
+	SLABLIST_SL_INC_LAYER(sub);
+	sl->sl_base_gen++;
+	sub->sl_head = NULL;
+	sub->sl_end = NULL;
+	sub->sl_slabs = 0;
+	sub->sl_elems = up->sl_slabs;
+	up->sl_sublayer = MKLNK(sub);
+
+	slablist_t *sup = up;
+	while (sup != NULL) {
+		sup->sl_sublayers++;
+		sup->sl_baselayer = MKLNK(sub);
+		SLABLIST_SL_INC_SUBLAYERS(sup);
+		sup = LNK(sup->sl_superlayer);
+	}
+
+	void *c = LNK(up->sl_head);
+	subslab_t *ss = NULL;
+	uint64_t i = 0;
+	while (i < up->sl_slabs) {
+		if (ss == NULL || ss->ss_elems == sub->sl_subelem_max) {
+			subslab_t *n = get_spare_subslab(sl);
+			SLABLIST_SLAB_MK(sub);
+			n->ss_list = MKLNK(sub);
+			n->ss_prev = MKLNK(ss);
+			if (ss == NULL) {
+				sub->sl_head = MKLNK(n);
+			} else {
+				ss->ss_next = MKLNK(n);
+			}
+			sub->sl_end = MKLNK(n);
+			sub->sl_slabs++;
+			ss = n;
+		}
+		SET_SUBSLAB_ELEM(ss, c, ss->ss_elems);
+		if (up->sl_layer == 0) {
+			slab_t *s = c;
+			s->s_below = MKLNK(ss);
+			ss->ss_usr_elems += s->s_elems;
+			if (ss->ss_elems == 0) {
+				ss->ss_min = s->s_min;
+			}
+			ss->ss_max = s->s_max;
+			c = LNK(s->s_next);
+		} else {
+			subslab_t *s = c;
+			s->ss_below = MKLNK(ss);
+			ss->ss_usr_elems += s->ss_usr_elems;
+			if (ss->ss_elems == 0) {
+				ss->ss_min = s->ss_min;
+			}
+			ss->ss_max = s->ss_max;
+			c = LNK(s->ss_next);
+		}
+		ss->ss_elems++;
+		i++;
+	}
+	return (sub);
+}
+
+/*
+ * Only sorted lists have sublayers. We attach them the same way slablist_add()
+ * would have, but fill them up all at once.
+ */
+static void
+load_sublayers(slablist_t *sl)
+{
+	slablist_t *up = sl;
+	while (SLIST_SORTED(sl->sl_flags) && sl->sl_req_sublayer &&
+	    up->sl_slabs >= sl->sl_req_sublayer) {
+		up = load_sublayer(sl, up);
+	}
+}
+
+/*
+ * Numbers the slabs of `sl` from 1, in list order, and marks them as clean.
+ * This is what the slabs of a full checkpoint are implicitly numbered as, so
+ * `sl` becomes the base of the next incremental checkpoint.
+ */
+static void
+renumber_slabs(slablist_t *sl)
+{
+	sl->sl_slab_id = 0;
+	sl->sl_ckpt_seq = 0;
+	sl->sl_ckpt_lsn = sl->sl_lsn;
+	if (IS_SMALL_LIST(sl) || IS_MAPPED_LIST(sl)) {
+		return;
+	}
+	slab_t *s = LNK(sl->sl_head);
+	while (s != NULL) {
+		sl->sl_slab_id++;
+		s->s_id = sl->sl_slab_id;
+		s->s_dirty = 0;
+		s = LNK(s->s_next);
+	}
+}
+
+static slablist_t *
+load_impl(int fd, slablist_cmp_t cmp, slablist_bnd_t bnd,
+    slablist_deser_t deser)
+{
+	SLABLIST_LOAD_BEGIN(fd);
+	slablist_hdr_t hdr;
+	bzero(&hdr, sizeof (hdr));
+	int bad = read_all(fd, &hdr, SL_SAVE_HDR_V1) != SL_SUCCESS ||
+	    bcmp(hdr.sh_magic, SL_SAVE_MAGIC, sizeof (hdr.sh_magic)) != 0 ||
+	    hdr.sh_version < 1 || hdr.sh_version > SL_SAVE_VERSION;
+	if (!bad && hdr.sh_version > 1) {
+		bad = read_all(fd, (char *)&hdr + SL_SAVE_HDR_V1,
+		    sizeof (hdr) - SL_SAVE_HDR_V1) != SL_SUCCESS;
+	}
+	if (bad || (hdr.sh_ser && deser == NULL) ||
+	    (hdr.sh_small && hdr.sh_blocks > 1)) {
+		SLABLIST_LOAD_END(SL_EIO);
+		return (NULL);
+	}
+	if (!hdr.sh_ser) {
+		deser = NULL;
+	}
+
+	char *name = NULL;
+	if (hdr.sh_namelen > 0) {
+		name = mk_buf(hdr.sh_namelen + 1);
+		name[hdr.sh_namelen] = '\0';
+	}
+	slablist_t *sl = slablist_create(name, cmp, bnd, hdr.sh_flags);
+	sl->sl_name_alloc = (name != NULL);
+	sl->sl_req_sublayer = hdr.sh_req_sublayer;
+	sl->sl_lsn = hdr.sh_lsn;
+	slablist_set_subslab_fanout(sl, hdr.sh_subelem_max);
+
+	uint64_t csz = hdr.sh_blocks * sizeof (uint16_t);
+	uint16_t *counts = NULL;
+	if (csz > 0) {
+		counts = mk_buf(csz);
+	}
+	int ret = SL_SUCCESS;
+	if (name != NULL) {
+		ret = read_all(fd, name, hdr.sh_namelen);
+	}
+	if (ret == SL_SUCCESS && counts != NULL) {
+		ret = read_all(fd, counts, csz);
+	}
+
+	if (ret == SL_SUCCESS && hdr.sh_blocks > 0) {
+		if (hdr.sh_small) {
+			ret = load_small_list(sl, fd, counts[0], deser);
+		} else {
+			ret = load_slabs(sl, fd, counts, hdr.sh_blocks, deser);
+		}
+	}
+	if (counts != NULL) {
+		rm_buf(counts, csz);
+	}
+	if (ret == SL_SUCCESS && sl->sl_elems != hdr.sh_elems) {
+		ret = SL_EIO;
+	}
+	if (ret != SL_SUCCESS) {
+		slablist_destroy(sl, NULL);
+		SLABLIST_LOAD_END(ret);
+		return (NULL);
+	}
+
+	load_sublayers(sl);
+	renumber_slabs(sl);
+	if (SLABLIST_TEST_LOAD_ENABLED()) {
+		SLABLIST_TEST_LOAD(test_load(sl));
+	}
+	SLABLIST_LOAD_END(SL_SUCCESS);
+	return (sl);
+}
+
+/*
+ * Loads a slablist that was saved by slablist_save(), from the current offset
+ * of `fd`. The list has to be given the same comparison and bounds functions
+ * that it had when it was saved. Returns NULL if the file is not a saved
+ * slablist, or if it can't be read in full.
+ */
+slablist_t *
+slablist_load(int fd, slablist_cmp_t cmp, slablist_bnd_t bnd)
+{
+	return (load_impl(fd, cmp, bnd, NULL));
+}
+
+/*
+ * Loads a slablist that was saved by slablist_save_ser(), using `deser` to
+ * turn each element's bytes back into an element.
+ */
+slablist_t *
+slablist_load_deser(int fd, slablist_cmp_t cmp, slablist_bnd_t bnd,
+    slablist_deser_t deser)
+{
+	return (load_impl(fd, cmp, bnd, deser));
+}
+
+/*
+ * This is the state that slablist_save_mapped() keeps while writing out the
+ * slabs of a list. Each slab goes out as three iovecs: its mslab_t, its
+ * elements, and enough zeroes to pad it to the full size of a slab. We also
+ * remember the extrema and size of every slab, to build the index with.
+ */
+typedef struct mslab_wr {
+	int			mw_fd;
+	int			mw_cnt;		/* iovecs in the batch */
+	uint64_t		mw_slabs;	/* slabs written so far */
+	uint16_t		mw_max;		/* elems per slab */
+	slablist_elem_t		*mw_zero;	/* the padding */
+	msubslab_t		*mw_sum;	/* extrema and size of each */
+	struct iovec		mw_iov[SL_IOV_BATCH];
+	mslab_t			mw_hdr[SL_IOV_BATCH / 3];
+} mslab_wr_t;
+
+static int
+mslab_flush(mslab_wr_t *w)
+{
+	int ret = writev_all(w->mw_fd, w->mw_iov, w->mw_cnt);
+	w->mw_cnt = 0;
+	return (ret);
+}
+
+/*
+ * Adds the slab of `n` elements in `arr` to the batch. If `arr` is a buffer
+ * that the caller is going to reuse, `flush` has to be set.
+ */
+static int
+mslab_put(mslab_wr_t *w, slablist_elem_t *arr, uint64_t n, int flush)
+{
+	mslab_t *h = &w->mw_hdr[w->mw_cnt / 3];
+	h->ms_min = arr[0];
+	h->ms_max = arr[n - 1];
+	h->ms_elems = n;
+	msubslab_t *sum = &w->mw_sum[w->mw_slabs];
+	sum->mss_min = h->ms_min;
+	sum->mss_max = h->ms_max;
+	sum->mss_usr_elems = n;
+	w->mw_slabs++;
+
+	struct iovec *iov = &w->mw_iov[w->mw_cnt];
+	iov[0].iov_base = h;
+	iov[0].iov_len = sizeof (mslab_t);
+	iov[1].iov_base = arr;
+	iov[1].iov_len = n * sizeof (slablist_elem_t);
+	iov[2].iov_base = w->mw_zero;
+	iov[2].iov_len = (w->mw_max - n) * sizeof (slablist_elem_t);
+	w->mw_cnt += 3;
+	if (flush || w->mw_cnt + 3 > SL_IOV_BATCH) {
+		return (mslab_flush(w));
+	}
+	return (SL_SUCCESS);
+}
+
+static int
+save_mapped_slabs_impl(slablist_t *sl, mslab_wr_t *w)
+{
+	int ret = SL_SUCCESS;
+	uint64_t i = 0;
+	if (IS_SMALL_LIST(sl)) {
+		uint64_t sz = sl->sl_elems * sizeof (slablist_elem_t);
+		slablist_elem_t *arr = mk_buf(sz);
+		small_list_t *sml = LNK(sl->sl_head);
+		while (i < sl->sl_elems) {
+			arr[i] = sml->sml_data;
+			sml = LNK(sml->sml_next);
+			i++;
+		}
+		i = 0;
+		while (i < sl->sl_elems && ret == SL_SUCCESS) {
+			uint64_t n = sl->sl_elems - i;
+			if (n > w->mw_max) {
+				n = w->mw_max;
+			}
+			ret = mslab_put(w, arr + i, n, 1);
+			i += n;
+		}
+		rm_buf(arr, sz);
+		return (ret);
+	}
+	slablist_elem_t *dbuf = mk_decode_buf(sl);
+	slab_t *s = LNK(sl->sl_head);
+	while (s != NULL && ret == SL_SUCCESS) {
+		ret = mslab_put(w, slab_elems(s, dbuf), s->s_elems,
+		    SLAB_IS_COLD(s) || SLAB_IS_NARROW(s));
+		s = LNK(s->s_next);
+	}
+	if (ret == SL_SUCCESS && w->mw_cnt > 0) {
+		ret = mslab_flush(w);
+	}
+	rm_decode_buf(sl, dbuf);
+	return (ret);
+}
+
+/*
+ * Returns the number of subslabs in the index layer below a layer of `n`
+ * slabs or subslabs, or 0 if we don't need another layer.
+ */
+static uint64_t
+mapped_layer_size(slablist_t *sl, uint64_t n)
+{
+	if (n < 2 || sl->sl_req_sublayer == 0 || n < sl->sl_req_sublayer) {
+		return (0);
+	}
+	return ((n + sl->sl_subelem_max - 1) / sl->sl_subelem_max);
+}
+
+/*
+ * Writes out one layer of the index, right below the `n` slabs or subslabs
+ * summarized in `sum`, which start at offset `off` of the file and are
+ * `stride` bytes apart. Returns the summary of the new layer in `nsum`.
+ */
+static int
+save_mapped_layer(slablist_t *sl, int fd, msubslab_t *sum, uint64_t n,
+    uint64_t off, uint64_t stride, msubslab_t *nsum, uint64_t nsub)
+{
+	uint64_t sstride = MSUBSLAB_BYTES(sl->sl_subelem_max);
+	char *buf = mk_zbuf(nsub * sstride);
+	uint64_t i = 0;
+	while (i < n) {
+		uint64_t k = i / sl->sl_subelem_max;
+		msubslab_t *ss = (msubslab_t *)(buf + (k * sstride));
+		if (ss->mss_elems == 0) {
+			ss->mss_min = sum[i].mss_min;
+		}
+		ss->mss_max = sum[i].mss_max;
+		ss->mss_usr_elems += sum[i].mss_usr_elems;
+		MSUBSLAB_OFFS(ss)[ss->mss_elems] = off + (i * stride);
+		ss->mss_elems++;
+		nsum[k] = *ss;
+		i++;
+	}
+	struct iovec iov;
+	iov.iov_base = buf;
+	iov.iov_len = nsub * sstride;
+	int ret = writev_all(fd, &iov, 1);
+	rm_buf(buf, nsub * sstride);
+	return (ret);
+}
+
+/*
+ * Saves the list `sl` to `fd`, in the format that slablist_open_mapped()
+ * expects (see slablist_mhdr_t in slablist_impl.h). Like slablist_save(),
+ * this is only meaningful for lists of values. The file has to be written
+ * from offset 0, because it refers to its own contents by offset.
+ */
+int
+slablist_save_mapped(slablist_t *sl, int fd)
+{
+	if (SLIST_IS_KV(sl->sl_flags)) {
+		return (SL_EKV);
+	}
+	SLABLIST_SAVE_BEGIN(sl);
+	int ret;
+	struct iovec iov[3];
+	if (IS_MAPPED_LIST(sl)) {
+		iov[0].iov_base = sl->sl_map;
+		iov[0].iov_len = sl->sl_map_len;
+		ret = writev_all(fd, iov, 1);
+		SLABLIST_SAVE_END(ret);
+		return (ret);
+	}
+
+	slablist_mhdr_t hdr;
+	bzero(&hdr, sizeof (hdr));
+	bcopy(SL_MAP_MAGIC, hdr.sm_magic, sizeof (hdr.sm_magic));
+	hdr.sm_version = SL_MAP_VERSION;
+	hdr.sm_flags = sl->sl_flags;
+	hdr.sm_selem_max = sl->sl_selem_max;
+	hdr.sm_subelem_max = sl->sl_subelem_max;
+	hdr.sm_namelen = SL_NAME(sl) == NULL ? 0 : strlen(SL_NAME(sl)) + 1;
+	hdr.sm_elems = sl->sl_elems;
+	if (IS_SMALL_LIST(sl)) {
+		hdr.sm_slabs = (sl->sl_elems + sl->sl_selem_max - 1) /
+		    sl->sl_selem_max;
+	} else {
+		hdr.sm_slabs = sl->sl_slabs;
+	}
+
+	/*
+	 * We know the size of every layer of the index up front, so we can
+	 * figure out where the baselayer goes before we write anything.
+	 */
+	uint64_t pad = (8 - ((sizeof (hdr) + hdr.sm_namelen) % 8)) % 8;
+	hdr.sm_slab_off = sizeof (hdr) + hdr.sm_namelen + pad;
+	uint64_t stride = MSLAB_BYTES(sl->sl_selem_max);
+	uint64_t sstride = MSUBSLAB_BYTES(sl->sl_subelem_max);
+	uint64_t off = hdr.sm_slab_off + (hdr.sm_slabs * stride);
+	uint64_t n = hdr.sm_slabs;
+	uint64_t nsub = mapped_layer_size(sl, n);
+	while (nsub > 0) {
+		hdr.sm_base_off = off;
+		hdr.sm_base_slabs = nsub;
+		hdr.sm_layers++;
+		off += nsub * sstride;
+		n = nsub;
+		nsub = mapped_layer_size(sl, n);
+	}
+
+	uint64_t zero = 0;
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof (hdr);
+	iov[1].iov_base = SL_NAME(sl);
+	iov[1].iov_len = hdr.sm_namelen;
+	iov[2].iov_base = &zero;
+	iov[2].iov_len = pad;
+	ret = writev_all(fd, iov, 3);
+
+	mslab_wr_t *w = mk_zbuf(sizeof (mslab_wr_t));
+	w->mw_fd = fd;
+	w->mw_max = sl->sl_selem_max;
+	w->mw_zero = mk_zbuf(stride);
+	uint64_t sumsz = (hdr.sm_slabs + 1) * sizeof (msubslab_t);
+	w->mw_sum = mk_buf(sumsz);
+	if (ret == SL_SUCCESS) {
+		slablist_t *held = cow_enter(sl);
+		ret = save_mapped_slabs_impl(sl, w);
+		cow_exit(held);
+	}
+
+	msubslab_t *sum = w->mw_sum;
+	n = hdr.sm_slabs;
+	off = hdr.sm_slab_off;
+	nsub = mapped_layer_size(sl, n);
+	while (ret == SL_SUCCESS && nsub > 0) {
+		uint64_t nsumsz = nsub * sizeof (msubslab_t);
+		msubslab_t *nsum = mk_buf(nsumsz);
+		ret = save_mapped_layer(sl, fd, sum, n, off, stride, nsum,
+		    nsub);
+		rm_buf(sum, sumsz);
+		sum = nsum;
+		sumsz = nsumsz;
+		off += n * stride;
+		stride = sstride;
+		n = nsub;
+		nsub = mapped_layer_size(sl, n);
+	}
+	rm_buf(sum, sumsz);
+	rm_buf(w->mw_zero, MSLAB_BYTES(sl->sl_selem_max));
+	rm_buf(w, sizeof (mslab_wr_t));
+	SLABLIST_SAVE_END(ret);
+	return (ret);
+}
+
+/*
+ * Opens a list that was saved by slablist_save_mapped(), by mapping the file
+ * `fd` read-only, and returns a slablist_t that searches it in place. Only the
+ * header is checked, so this takes constant time, and the pages of the file
+ * are shared with every other process that has it mapped. We trust the rest
+ * of the file to be as slablist_save_mapped() left it.
+ *
+ * slablist_find(), slablist_get(), the folds, and the bookmark and range
+ * functions work as usual. Anything that would modify the list fails with
+ * SL_ERDONLY (or does nothing, if it can't return an error), and folds must
+ * not write to the arrays that they're given. The list has to be given the
+ * comparison and bounds functions that it was saved with. slablist_destroy()
+ * unmaps the file. `fd` itself can be closed right after this returns.
+ */
+slablist_t *
+slablist_open_mapped(int fd, slablist_cmp_t cmp, slablist_bnd_t bnd)
+{
+	SLABLIST_OPEN_MAPPED_BEGIN(fd);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (uint64_t)st.st_size <
+	    sizeof (slablist_mhdr_t)) {
+		SLABLIST_OPEN_MAPPED_END(SL_EIO);
+		return (NULL);
+	}
+	uint64_t len = st.st_size;
+	void *base = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED) {
+		SLABLIST_OPEN_MAPPED_END(SL_EIO);
+		return (NULL);
+	}
+	slablist_mhdr_t *m = base;
+	char *name = (char *)(m + 1);
+	int bad = bcmp(m->sm_magic, SL_MAP_MAGIC, sizeof (m->sm_magic)) != 0 ||
+	    m->sm_version != SL_MAP_VERSION || m->sm_selem_max == 0 ||
+	    (m->sm_slabs == 0) != (m->sm_elems == 0) ||
+	    sizeof (slablist_mhdr_t) + m->sm_namelen > m->sm_slab_off ||
+	    m->sm_slab_off > len ||
+	    (len - m->sm_slab_off) / MSLAB_BYTES(m->sm_selem_max) <
+	    m->sm_slabs;
+	if (!bad && m->sm_namelen > 0) {
+		bad = name[m->sm_namelen - 1] != '\0';
+	}
+	if (!bad && m->sm_layers > 0) {
+		bad = m->sm_subelem_max < 2 || m->sm_base_slabs == 0 ||
+		    m->sm_base_off > len ||
+		    (len - m->sm_base_off) /
+		    MSUBSLAB_BYTES(m->sm_subelem_max) < m->sm_base_slabs;
+	}
+	if (bad) {
+		(void) munmap(base, len);
+		SLABLIST_OPEN_MAPPED_END(SL_EIO);
+		return (NULL);
+	}
+
+	slablist_t *sl = slablist_create(m->sm_namelen > 0 ? name : NULL,
+	    cmp, bnd, m->sm_flags);
+	sl->sl_map = m;
+	sl->sl_map_len = len;
+	sl->sl_elems = m->sm_elems;
+	sl->sl_slabs = m->sm_slabs;
+	sl->sl_selem_max = m->sm_selem_max;
+	sl->sl_subelem_max = m->sm_subelem_max;
+	if (SLABLIST_TEST_MAPPED_ENABLED()) {
+		SLABLIST_TEST_MAPPED(test_mapped(sl));
+	}
+	SLABLIST_OPEN_MAPPED_END(SL_SUCCESS);
+	return (sl);
+}
+
+/*
+ * Write-Ahead Logs
+ *
+ * See slablist_log_t in slablist_impl.h for the format.
+ */
+
+/*
+ * The checksum of a record is the FNV-1a hash of its bytes, with lr_sum zeroed.
+ */
+static uint32_t
+log_sum(slablist_lrec_t *r)
+{
+	slablist_lrec_t c = *r;
+	c.lr_sum = 0;
+	uint8_t *p = (uint8_t *)&c;
+	uint32_t h = 2166136261U;
+	size_t i = 0;
+	while (i < sizeof (c)) {
+		h = (h ^ p[i]) * 16777619U;
+		i++;
+	}
+	return (h);
+}
+
+/*
+ * Writes out all of the records that have been collected so far, with a
+ * single write, and syncs them to disk if `sync` is set.
+ */
+static int
+log_write(slablist_t *sl, int sync)
+{
+	slablist_log_t *lg = sl->sl_log;
+	int ret = SL_SUCCESS;
+	if (lg->lg_nrecs > 0) {
+		SLABLIST_LOG_WRITE(sl, lg->lg_nrecs);
+		struct iovec iov;
+		iov.iov_base = lg->lg_recs;
+		iov.iov_len = lg->lg_nrecs * sizeof (slablist_lrec_t);
+		ret = writev_all(lg->lg_fd, &iov, 1);
+		lg->lg_nrecs = 0;
+	}
+	if (ret == SL_SUCCESS && sync && fsync(lg->lg_fd) != 0) {
+		ret = SL_EIO;
+	}
+	return (ret);
+}
+
+/*
+ * Appends a record of the operation `op` to the log of `sl`, before the
+ * operation is applied. The record only reaches the file once the batch is
+ * full, or the log is flushed. If writing the batch out fails, the caller
+ * must not apply the operation.
+ */
+int
+log_append(slablist_t *sl, uint8_t op, slablist_elem_t a, slablist_elem_t b,
+    uint8_t rep)
+{
+	slablist_log_t *lg = sl->sl_log;
+	slablist_lrec_t *r = &lg->lg_recs[lg->lg_nrecs];
+	bzero(r, sizeof (slablist_lrec_t));
+	sl->sl_lsn++;
+	r->lr_lsn = sl->sl_lsn;
+	r->lr_op = op;
+	r->lr_rep = rep;
+	r->lr_a = a;
+	r->lr_b = b;
+	r->lr_sum = log_sum(r);
+	lg->lg_nrecs++;
+	if (lg->lg_nrecs < lg->lg_batch) {
+		return (SL_SUCCESS);
+	}
+	int ret = log_write(sl, lg->lg_sync != SL_SYNC_NONE);
+	if (ret != SL_SUCCESS) {
+		sl->sl_lsn--;
+	}
+	return (ret);
+}
+
+/*
+ * Takes back the record made by the last log_append(), when the operation it
+ * describes turned out to fail (a duplicate add, say). If the record has
+ * already been written out, it stays in the log. That's harmless, because
+ * replaying it fails in the same way, and leaves the list as it is.
+ */
+void
+log_cancel(slablist_t *sl)
+{
+	slablist_log_t *lg = sl->sl_log;
+	if (lg->lg_nrecs > 0) {
+		lg->lg_nrecs--;
+		sl->sl_lsn--;
+	}
+}
+
+/*
+ * Applies the records in the log `fd` that come after the last operation that
+ * `sl` reflects, and cuts off the torn record that a crash may have left at
+ * the end. If the log is empty, we give it a header.
+ */
+static int
+log_replay(slablist_t *sl, int fd)
+{
+	slablist_lhdr_t hdr;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		return (SL_EIO);
+	}
+	if (st.st_size == 0) {
+		bzero(&hdr, sizeof (hdr));
+		bcopy(SL_LOG_MAGIC, hdr.lh_magic, sizeof (hdr.lh_magic));
+		hdr.lh_version = SL_LOG_VERSION;
+		if (pwrite(fd, &hdr, sizeof (hdr), 0) != sizeof (hdr) ||
+		    lseek(fd, sizeof (hdr), SEEK_SET) < 0) {
+			return (SL_EIO);
+		}
+		return (SL_SUCCESS);
+	}
+	if (pread(fd, &hdr, sizeof (hdr), 0) != sizeof (hdr) ||
+	    bcmp(hdr.lh_magic, SL_LOG_MAGIC, sizeof (hdr.lh_magic)) != 0 ||
+	    hdr.lh_version != SL_LOG_VERSION) {
+		return (SL_EIO);
+	}
+
+	slablist_lrec_t recs[SL_LOG_BATCH_DEF];
+	off_t off = sizeof (hdr);
+	uint64_t nrecs = 0;
+	int ret = SL_SUCCESS;
+	int done = 0;
+	while (!done) {
+		ssize_t got = pread(fd, recs, sizeof (recs), off);
+		if (got < 0) {
+			return (SL_EIO);
+		}
+		uint64_t n = got / sizeof (slablist_lrec_t);
+		done = (n < SL_LOG_BATCH_DEF);
+		uint64_t i = 0;
+		while (i < n) {
+			slablist_lrec_t *r = &recs[i];
+			if (r->lr_sum != log_sum(r)) {
+				done = 1;
+				break;
+			}
+			/*
+			 * A gap between the list and the log means that records
+			 * are missing, most likely because the list is older
+			 * than the latest checkpoint.
+			 */
+			if (r->lr_lsn > sl->sl_lsn + 1) {
+				ret = SL_EIO;
+				done = 1;
+				break;
+			}
+			if (r->lr_lsn == sl->sl_lsn + 1) {
+				switch (r->lr_op) {
+				case SL_LOG_ADD:
+					(void) slablist_add(sl, r->lr_a,
+					    r->lr_rep);
+					break;
+				case SL_LOG_REM:
+					(void) slablist_rem(sl, r->lr_a,
+					    r->lr_b.sle_u, NULL);
+					break;
+				case SL_LOG_REM_RANGE:
+					(void) slablist_rem_range(sl, r->lr_a,
+					    r->lr_b, NULL);
+					break;
+				}
+				sl->sl_lsn = r->lr_lsn;
+				nrecs++;
+			}
+			off += sizeof (slablist_lrec_t);
+			i++;
+		}
+	}
+	if (ret == SL_SUCCESS && (ftruncate(fd, off) != 0 ||
+	    lseek(fd, off, SEEK_SET) < 0)) {
+		ret = SL_EIO;
+	}
+	SLABLIST_LOG_REPLAY(sl, nrecs);
+	return (ret);
+}
+
+/*
+ * Gives `sl` the write-ahead log `fd`, which has to be open for reading and
+ * writing. Any records in the log that come after the last operation that `sl`
+ * reflects are replayed first, so a list can be recovered by loading its
+ * latest checkpoint (or creating it, if there is none yet), and attaching its
+ * log to it.
+ *
+ * From then on, every slablist_add(), slablist_rem(), and slablist_rem_range()
+ * is logged before it is applied, and an operation whose record can't be
+ * written out fails with SL_EIO without changing the list. The records are
+ * written out `batch` at a time (SL_LOG_BATCH_DEF if `batch` is 0), and with
+ * SL_SYNC_BATCH, each batch is also synced to disk. SL_SYNC_EACH writes and
+ * syncs every record before the operation is applied. With SL_SYNC_NONE,
+ * syncing is left to the system. Either way, the records collected since the
+ * last write can be lost in a crash, unless slablist_log_flush() is called.
+ *
+ * The elements are logged as they are, so logs are only meaningful for lists
+ * of values. Operations other than the three above (like slablist_sort() or
+ * slablist_xtract()) are not logged, so they have to be followed by a
+ * checkpoint. Mapped, shared and key-value lists can't have logs.
+ */
+int
+slablist_log_attach(slablist_t *sl, int fd, uint8_t sync, uint32_t batch)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SHM_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	if (SLIST_IS_KV(sl->sl_flags)) {
+		return (SL_EKV);
+	}
+	if (sl->sl_log != NULL) {
+		return (SL_EDUP);
+	}
+	slablist_t *held = cow_enter(sl);
+	cow_own_all(sl);
+	int ret = log_replay(sl, fd);
+	cow_exit(held);
+	if (ret != SL_SUCCESS) {
+		return (ret);
+	}
+	if (batch == 0) {
+		batch = SL_LOG_BATCH_DEF;
+	}
+	if (sync == SL_SYNC_EACH) {
+		batch = 1;
+	}
+	slablist_log_t *lg = mk_zbuf(sizeof (slablist_log_t));
+	lg->lg_fd = fd;
+	lg->lg_sync = sync;
+	lg->lg_batch = batch;
+	lg->lg_recs = mk_buf(batch * sizeof (slablist_lrec_t));
+	sl->sl_log = lg;
+	return (SL_SUCCESS);
+}
+
+/*
+ * Writes out the records that haven't been written yet, and syncs the log to
+ * disk. Every operation that returned before this call is durable after it.
+ */
+int
+slablist_log_flush(slablist_t *sl)
+{
+	if (sl->sl_log == NULL) {
+		return (SL_SUCCESS);
+	}
+	return (log_write(sl, 1));
+}
+
+void
+log_destroy(slablist_t *sl)
+{
+	slablist_log_t *lg = sl->sl_log;
+	rm_buf(lg->lg_recs, lg->lg_batch * sizeof (slablist_lrec_t));
+	rm_buf(lg, sizeof (slablist_log_t));
+	sl->sl_log = NULL;
+}
+
+/*
+ * Flushes the log of `sl`, and stops logging. The caller still owns the file
+ * descriptor.
+ */
+int
+slablist_log_detach(slablist_t *sl)
+{
+	int ret = slablist_log_flush(sl);
+	if (sl->sl_log != NULL) {
+		log_destroy(sl);
+	}
+	return (ret);
+}
+
+uint64_t
+slablist_get_lsn(slablist_t *sl)
+{
+	return (sl->sl_lsn);
+}
+
+/*
+ * Empties the log of `sl`, once a checkpoint reflects all of its records.
+ */
+static int
+log_reset(slablist_t *sl)
+{
+	if (sl->sl_log == NULL) {
+		return (SL_SUCCESS);
+	}
+	int lfd = sl->sl_log->lg_fd;
+	if (ftruncate(lfd, sizeof (slablist_lhdr_t)) != 0 ||
+	    lseek(lfd, sizeof (slablist_lhdr_t), SEEK_SET) < 0 ||
+	    fsync(lfd) != 0) {
+		return (SL_EIO);
+	}
+	return (SL_SUCCESS);
+}
+
+/*
+ * Saves a full snapshot of `sl` to `fd` (like slablist_save()), syncs it to
+ * disk, and then empties the log, whose records the snapshot now reflects.
+ * Overwriting the only snapshot in place is not crash-safe, so `fd` should be
+ * a new file, which the caller renames over the previous snapshot once this
+ * returns. If we crash before the log is emptied, the records that it still
+ * holds are simply skipped when the new snapshot is recovered.
+ */
+int
+slablist_checkpoint(slablist_t *sl, int fd)
+{
+	SLABLIST_CHECKPOINT_BEGIN(sl);
+	slablist_t *held = cow_enter(sl);
+	int ret = slablist_log_flush(sl);
+	if (ret == SL_SUCCESS) {
+		ret = save_impl(sl, fd, NULL);
+	}
+	if (ret == SL_SUCCESS && fsync(fd) != 0) {
+		ret = SL_EIO;
+	}
+	if (ret == SL_SUCCESS) {
+		cow_own_all(sl);
+		renumber_slabs(sl);
+		ret = log_reset(sl);
+	}
+	cow_exit(held);
+	SLABLIST_CHECKPOINT_END(ret);
+	return (ret);
+}
+
+/*
+ * Writes the elements of the dirty slabs of `sl`, in list order.
+ */
+static int
+save_dirty_slabs(slablist_t *sl, int fd)
+{
+	struct iovec iov[SL_IOV_BATCH];
+	int cnt = 0;
+	int ret = SL_SUCCESS;
+	slablist_elem_t *buf = mk_decode_buf(sl);
+	slab_t *s = LNK(sl->sl_head);
+	while (s != NULL && ret == SL_SUCCESS) {
+		if (!s->s_dirty) {
+			s = LNK(s->s_next);
+			continue;
+		}
+		/*
+		 * A cold or narrow slab gets decoded into `buf`, which we
+		 * can't reuse until it's been written.
+		 */
+		int dec = SLAB_IS_COLD(s) || SLAB_IS_NARROW(s);
+		if (dec && cnt > 0) {
+			ret = writev_all(fd, iov, cnt);
+			cnt = 0;
+		}
+		iov[cnt].iov_base = slab_elems(s, buf);
+		iov[cnt].iov_len = s->s_elems * sizeof (slablist_elem_t);
+		cnt++;
+		if (ret == SL_SUCCESS && (cnt == SL_IOV_BATCH || dec)) {
+			ret = writev_all(fd, iov, cnt);
+			cnt = 0;
+		}
+		s = LNK(s->s_next);
+	}
+	if (ret == SL_SUCCESS && cnt > 0) {
+		ret = writev_all(fd, iov, cnt);
+	}
+	rm_decode_buf(sl, buf);
+	return (ret);
+}
+
+/*
+ * Saves the slabs of `sl` that have changed since its last checkpoint (full or
+ * incremental) to `fd`, along with a manifest of all of its slabs, and syncs
+ * them to disk. See slablist_ihdr_t for the format. Like slablist_checkpoint(),
+ * this empties the log. slablist_restore() applies the images to the list's
+ * last full checkpoint, in the order they were taken.
+ *
+ * Slab ids are 32 bits wide, and are only renumbered by full checkpoints, so a
+ * list that has created 2^32 slabs since its last full checkpoint gets
+ * SL_ENOSPC, and needs a full one.
+ */
+int
+slablist_checkpoint_incremental(slablist_t *sl, int fd)
+{
+	if (IS_MAPPED_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	if (SLIST_IS_KV(sl->sl_flags)) {
+		return (SL_EKV);
+	}
+	if (sl->sl_slab_id > UINT32_MAX) {
+		return (SL_ENOSPC);
+	}
+	SLABLIST_CHECKPOINT_BEGIN(sl);
+	int ret = slablist_log_flush(sl);
+	if (ret != SL_SUCCESS) {
+		SLABLIST_CHECKPOINT_END(ret);
+		return (ret);
+	}
+	slablist_t *held = cow_enter(sl);
+	cow_own_all(sl);
+
+	slablist_ihdr_t hdr;
+	bzero(&hdr, sizeof (hdr));
+	bcopy(SL_INCR_MAGIC, hdr.ih_magic, sizeof (hdr.ih_magic));
+	hdr.ih_version = SL_INCR_VERSION;
+	hdr.ih_flags = sl->sl_flags;
+	hdr.ih_small = IS_SMALL_LIST(sl);
+	hdr.ih_seq = sl->sl_ckpt_seq + 1;
+	hdr.ih_prev_lsn = sl->sl_ckpt_lsn;
+	hdr.ih_lsn = sl->sl_lsn;
+	hdr.ih_elems = sl->sl_elems;
+	hdr.ih_slabs = sl->sl_slabs;
+	hdr.ih_slab_id = sl->sl_slab_id;
+
+	uint64_t msz = hdr.ih_small ? sl->sl_elems * sizeof (slablist_elem_t) :
+	    sl->sl_slabs * sizeof (slablist_ment_t);
+	char *m = NULL;
+	if (msz > 0) {
+		m = mk_buf(msz);
+	}
+	if (hdr.ih_small) {
+		slablist_elem_t *arr = (slablist_elem_t *)m;
+		small_list_t *sml = LNK(sl->sl_head);
+		uint64_t i = 0;
+		while (i < sl->sl_elems) {
+			arr[i] = sml->sml_data;
+			sml = LNK(sml->sml_next);
+			i++;
+		}
+	} else {
+		slablist_ment_t *me = (slablist_ment_t *)m;
+		slab_t *s = LNK(sl->sl_head);
+		while (s != NULL) {
+			me->me_id = s->s_id;
+			me->me_elems = s->s_elems;
+			me->me_dirty = s->s_dirty;
+			me->me_pad = 0;
+			me++;
+			s = LNK(s->s_next);
+		}
+	}
+
+	struct iovec iov[2];
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof (hdr);
+	iov[1].iov_base = m;
+	iov[1].iov_len = msz;
+	ret = writev_all(fd, iov, 2);
+	if (m != NULL) {
+		rm_buf(m, msz);
+	}
+	if (ret == SL_SUCCESS && !hdr.ih_small) {
+		ret = save_dirty_slabs(sl, fd);
+	}
+	if (ret == SL_SUCCESS && fsync(fd) != 0) {
+		ret = SL_EIO;
+	}
+	if (ret == SL_SUCCESS) {
+		slab_t *s = hdr.ih_small ? NULL : LNK(sl->sl_head);
+		while (s != NULL) {
+			s->s_dirty = 0;
+			s = LNK(s->s_next);
+		}
+		sl->sl_ckpt_seq = hdr.ih_seq;
+		sl->sl_ckpt_lsn = hdr.ih_lsn;
+		ret = log_reset(sl);
+	}
+	cow_exit(held);
+	SLABLIST_CHECKPOINT_END(ret);
+	return (ret);
+}
+
+static int
+slab_id_cmp(const void *a, const void *b)
+{
+	uint32_t x = (*(slab_t * const *)a)->s_id;
+	uint32_t y = (*(slab_t * const *)b)->s_id;
+	return (x < y ? -1 : x > y);
+}
+
+/*
+ * Reads the elements of the dirty slabs in the manifest `me` into new slabs,
+ * and finds the clean ones among the slabs of `sl`. The slabs end up in
+ * `chain`, in list order. The clean slabs that are used get marked as dirty,
+ * for the benefit of the caller. Nothing in `sl` is linked or unlinked, so if
+ * this fails, the new slabs are freed, and `sl` is as it was.
+ */
+static int
+incr_chain(slablist_t *sl, int fd, slablist_ment_t *me, uint64_t n,
+    slab_t **chain)
+{
+	uint64_t nold = sl->sl_slabs;
+	slab_t **old = NULL;
+	if (nold > 0) {
+		old = mk_buf(nold * sizeof (slab_t *));
+		slab_t *s = LNK(sl->sl_head);
+		uint64_t i = 0;
+		while (i < nold) {
+			old[i] = s;
+			s = LNK(s->s_next);
+			i++;
+		}
+		qsort(old, nold, sizeof (slab_t *), slab_id_cmp);
+	}
+
+	struct iovec iov[SL_IOV_BATCH];
+	int cnt = 0;
+	int ret = SL_SUCCESS;
+	slablist_elem_t *nbuf = NULL;
+	if (SLIST_IS_NARROW(sl->sl_flags)) {
+		nbuf = mk_buf(sl->sl_selem_max * sizeof (slablist_elem_t));
+	}
+	uint64_t i = 0;
+	while (i < n && ret == SL_SUCCESS) {
+		if (me[i].me_elems == 0 || me[i].me_elems > sl->sl_selem_max) {
+			ret = SL_EIO;
+			break;
+		}
+		if (me[i].me_dirty) {
+			slab_t *s = get_spare_slab(sl);
+			SLABLIST_SLAB_MK(sl);
+			s->s_list = MKLNK(sl);
+			s->s_id = me[i].me_id;
+			s->s_elems = me[i].me_elems;
+			chain[i] = s;
+			i++;
+			if (nbuf != NULL) {
+				ret = read_all(fd, nbuf,
+				    s->s_elems * sizeof (slablist_elem_t));
+				narrow_slab_from(s, nbuf, s->s_elems);
+				continue;
+			}
+			iov[cnt].iov_base = s->s_arr;
+			iov[cnt].iov_len = s->s_elems * sizeof (slablist_elem_t);
+			cnt++;
+			if (cnt == SL_IOV_BATCH) {
+				ret = readv_all(fd, iov, cnt);
+				cnt = 0;
+			}
+			continue;
+		}
+		/*
+		 * A clean slab that is already taken, or is the wrong size,
+		 * means that the image doesn't belong on top of `sl`.
+		 */
+		uint64_t lo = 0;
+		uint64_t hi = nold;
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo) / 2;
+			if (old[mid]->s_id < me[i].me_id) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo == nold || old[lo]->s_id != me[i].me_id ||
+		    old[lo]->s_dirty || old[lo]->s_elems != me[i].me_elems) {
+			ret = SL_EIO;
+			break;
+		}
+		SLAB_SET_DIRTY(old[lo]);
+		chain[i] = old[lo];
+		i++;
+	}
+	if (ret == SL_SUCCESS && cnt > 0) {
+		ret = readv_all(fd, iov, cnt);
+	}
+	if (old != NULL) {
+		rm_buf(old, nold * sizeof (slab_t *));
+	}
+	if (nbuf != NULL) {
+		rm_buf(nbuf, sl->sl_selem_max * sizeof (slablist_elem_t));
+	}
+	if (ret == SL_SUCCESS) {
+		return (ret);
+	}
+	uint64_t j = 0;
+	while (j < i) {
+		if (me[j].me_dirty) {
+			put_spare_slab(sl, chain[j]);
+		} else {
+			chain[j]->s_dirty = 0;
+		}
+		j++;
+	}
+	return (ret);
+}
+
+/*
+ * Applies the incremental image in `fd` to `sl`, which has to be the list as
+ * of the checkpoint that the image was taken after.
+ */
+static int
+apply_incremental(slablist_t *sl, int fd)
+{
+	slablist_ihdr_t hdr;
+	if (read_all(fd, &hdr, sizeof (hdr)) != SL_SUCCESS ||
+	    bcmp(hdr.ih_magic, SL_INCR_MAGIC, sizeof (hdr.ih_magic)) != 0 ||
+	    hdr.ih_version != SL_INCR_VERSION ||
+	    hdr.ih_flags != sl->sl_flags ||
+	    hdr.ih_seq != sl->sl_ckpt_seq + 1 ||
+	    hdr.ih_prev_lsn != sl->sl_ckpt_lsn ||
+	    (hdr.ih_small && hdr.ih_elems > sl->sl_smelem_max)) {
+		return (SL_EIO);
+	}
+
+	uint64_t msz = hdr.ih_small ? 0 :
+	    hdr.ih_slabs * sizeof (slablist_ment_t);
+	slablist_ment_t *me = NULL;
+	slab_t **chain = NULL;
+	int ret = SL_SUCCESS;
+	if (msz > 0) {
+		me = mk_buf(msz);
+		chain = mk_buf(hdr.ih_slabs * sizeof (slab_t *));
+		ret = read_all(fd, me, msz);
+		if (ret == SL_SUCCESS) {
+			ret = incr_chain(sl, fd, me, hdr.ih_slabs, chain);
+		}
+	}
+	if (ret != SL_SUCCESS) {
+		goto out;
+	}
+
+	/*
+	 * Now that everything has been read, we take the list apart, free
+	 * whatever isn't in the image, and put the list back together.
+	 */
+	while (sl->sl_sublayers > 0) {
+		detach_sublayer(LNK(LNK(sl->sl_baselayer)->sl_superlayer));
+	}
+	if (IS_SMALL_LIST(sl)) {
+		small_list_t *sml = LNK(sl->sl_head);
+		uint64_t i = 0;
+		while (i < sl->sl_elems) {
+			small_list_t *n = LNK(sml->sml_next);
+			rm_sml_node(sml);
+			sml = n;
+			i++;
+		}
+	} else {
+		slab_t *s = LNK(sl->sl_head);
+		while (s != NULL) {
+			slab_t *n = LNK(s->s_next);
+			if (!s->s_dirty) {
+				put_spare_slab(sl, s);
+				SLABLIST_SLAB_RM(sl);
+			}
+			s = n;
+		}
+	}
+	sl->sl_head = NULL;
+	sl->sl_end = NULL;
+	sl->sl_slabs = 0;
+	sl->sl_elems = 0;
+
+	if (hdr.ih_small) {
+		ret = load_small_list(sl, fd, hdr.ih_elems, NULL);
+	}
+	uint64_t i = 0;
+	while (i < hdr.ih_slabs && !hdr.ih_small) {
+		slab_t *s = chain[i];
+		s->s_prev = MKLNK(i > 0 ? chain[i - 1] : NULL);
+		s->s_next = MKLNK(i + 1 < hdr.ih_slabs ? chain[i + 1] : NULL);
+		s->s_below = NULL;
+		s->s_dirty = 0;
+		if (me[i].me_dirty) {
+			s->s_min = SLAB_GET(s, 0);
+			s->s_max = SLAB_GET(s, (s->s_elems - 1));
+		}
+		sl->sl_elems += s->s_elems;
+		i++;
+	}
+	if (!hdr.ih_small && hdr.ih_slabs > 0) {
+		sl->sl_head = MKLNK(chain[0]);
+		sl->sl_end = MKLNK(chain[hdr.ih_slabs - 1]);
+		sl->sl_slabs = hdr.ih_slabs;
+	}
+	if (ret == SL_SUCCESS && sl->sl_elems != hdr.ih_elems) {
+		ret = SL_EIO;
+	}
+	load_sublayers(sl);
+	sl->sl_slab_id = hdr.ih_slab_id;
+	sl->sl_ckpt_seq = hdr.ih_seq;
+	sl->sl_ckpt_lsn = hdr.ih_lsn;
+	sl->sl_lsn = hdr.ih_lsn;
+
+out:
+	if (me != NULL) {
+		rm_buf(me, msz);
+		rm_buf(chain, hdr.ih_slabs * sizeof (slab_t *));
+	}
+	return (ret);
+}
+
+/*
+ * Rebuilds a list from its last full checkpoint, in `base`, and the `n`
+ * incremental checkpoints taken after it, in `incrs`, which have to be in
+ * the order they were taken. Returns NULL if any of the images is unreadable,
+ * or doesn't follow the one before it. The log, if any, can then be attached
+ * to the list, to replay the operations after the last image.
+ */
+slablist_t *
+slablist_restore(int base, int *incrs, int n, slablist_cmp_t cmp,
+    slablist_bnd_t bnd)
+{
+	slablist_t *sl = slablist_load(base, cmp, bnd);
+	if (sl == NULL) {
+		return (NULL);
+	}
+	int i = 0;
+	while (i < n) {
+		if (apply_incremental(sl, incrs[i]) != SL_SUCCESS) {
+			slablist_destroy(sl, NULL);
+			return (NULL);
+		}
+		i++;
+	}
+	if (SLABLIST_TEST_LOAD_ENABLED()) {
+		SLABLIST_TEST_LOAD(test_load(sl));
+	}
+	return (sl);
+}
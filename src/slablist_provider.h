@@ -29,6 +29,24 @@ extern "C" {
 #define	SLABLIST_ADD_END_ENABLED() \
 	__dtraceenabled_slablist___add_end(0)
 #endif
+#define	SLABLIST_AGGREGATE_BEGIN(arg0) \
+	__dtrace_slablist___aggregate_begin(arg0)
+#ifndef	__sparc
+#define	SLABLIST_AGGREGATE_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___aggregate_begin()
+#else
+#define	SLABLIST_AGGREGATE_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___aggregate_begin(0)
+#endif
+#define	SLABLIST_AGGREGATE_END(arg0) \
+	__dtrace_slablist___aggregate_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_AGGREGATE_END_ENABLED() \
+	__dtraceenabled_slablist___aggregate_end()
+#else
+#define	SLABLIST_AGGREGATE_END_ENABLED() \
+	__dtraceenabled_slablist___aggregate_end(0)
+#endif
 #define	SLABLIST_ATTACH_SUBLAYER(arg0, arg1) \
 	__dtrace_slablist___attach_sublayer(arg0, arg1)
 #ifndef	__sparc
@@ -38,6 +56,42 @@ extern "C" {
 #define	SLABLIST_ATTACH_SUBLAYER_ENABLED() \
 	__dtraceenabled_slablist___attach_sublayer(0)
 #endif
+#define	SLABLIST_BLOOM_BUILD(arg0, arg1) \
+	__dtrace_slablist___bloom_build(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_BLOOM_BUILD_ENABLED() \
+	__dtraceenabled_slablist___bloom_build()
+#else
+#define	SLABLIST_BLOOM_BUILD_ENABLED() \
+	__dtraceenabled_slablist___bloom_build(0)
+#endif
+#define	SLABLIST_BLOOM_SKIP(arg0, arg1) \
+	__dtrace_slablist___bloom_skip(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_BLOOM_SKIP_ENABLED() \
+	__dtraceenabled_slablist___bloom_skip()
+#else
+#define	SLABLIST_BLOOM_SKIP_ENABLED() \
+	__dtraceenabled_slablist___bloom_skip(0)
+#endif
+#define	SLABLIST_BOUND_BEGIN(arg0, arg1) \
+	__dtrace_slablist___bound_begin(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_BOUND_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___bound_begin()
+#else
+#define	SLABLIST_BOUND_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___bound_begin(0)
+#endif
+#define	SLABLIST_BOUND_END(arg0, arg1) \
+	__dtrace_slablist___bound_end(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_BOUND_END_ENABLED() \
+	__dtraceenabled_slablist___bound_end()
+#else
+#define	SLABLIST_BOUND_END_ENABLED() \
+	__dtraceenabled_slablist___bound_end(0)
+#endif
 #define	SLABLIST_BUBBLE_UP(arg0, arg1) \
 	__dtrace_slablist___bubble_up(arg0, arg1)
 #ifndef	__sparc
@@ -92,6 +146,60 @@ extern "C" {
 #define	SLABLIST_BWDSHIFT_END_ENABLED() \
 	__dtraceenabled_slablist___bwdshift_end(0)
 #endif
+#define	SLABLIST_CHECKPOINT_BEGIN(arg0) \
+	__dtrace_slablist___checkpoint_begin(arg0)
+#ifndef	__sparc
+#define	SLABLIST_CHECKPOINT_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___checkpoint_begin()
+#else
+#define	SLABLIST_CHECKPOINT_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___checkpoint_begin(0)
+#endif
+#define	SLABLIST_CHECKPOINT_END(arg0) \
+	__dtrace_slablist___checkpoint_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_CHECKPOINT_END_ENABLED() \
+	__dtraceenabled_slablist___checkpoint_end()
+#else
+#define	SLABLIST_CHECKPOINT_END_ENABLED() \
+	__dtraceenabled_slablist___checkpoint_end(0)
+#endif
+#define	SLABLIST_CLONE(arg0, arg1) \
+	__dtrace_slablist___clone(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_CLONE_ENABLED() \
+	__dtraceenabled_slablist___clone()
+#else
+#define	SLABLIST_CLONE_ENABLED() \
+	__dtraceenabled_slablist___clone(0)
+#endif
+#define	SLABLIST_COMPRESS_BEGIN(arg0) \
+	__dtrace_slablist___compress_begin(arg0)
+#ifndef	__sparc
+#define	SLABLIST_COMPRESS_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___compress_begin()
+#else
+#define	SLABLIST_COMPRESS_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___compress_begin(0)
+#endif
+#define	SLABLIST_COMPRESS_END(arg0) \
+	__dtrace_slablist___compress_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_COMPRESS_END_ENABLED() \
+	__dtraceenabled_slablist___compress_end()
+#else
+#define	SLABLIST_COMPRESS_END_ENABLED() \
+	__dtraceenabled_slablist___compress_end(0)
+#endif
+#define	SLABLIST_COW_BREAK(arg0) \
+	__dtrace_slablist___cow_break(arg0)
+#ifndef	__sparc
+#define	SLABLIST_COW_BREAK_ENABLED() \
+	__dtraceenabled_slablist___cow_break()
+#else
+#define	SLABLIST_COW_BREAK_ENABLED() \
+	__dtraceenabled_slablist___cow_break(0)
+#endif
 #define	SLABLIST_CREATE(arg0) \
 	__dtrace_slablist___create(arg0)
 #ifndef	__sparc
@@ -146,6 +254,24 @@ extern "C" {
 #define	SLABLIST_FIND_END_ENABLED() \
 	__dtraceenabled_slablist___find_end(0)
 #endif
+#define	SLABLIST_FIND_MANY_BEGIN(arg0, arg1) \
+	__dtrace_slablist___find_many_begin(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_FIND_MANY_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___find_many_begin()
+#else
+#define	SLABLIST_FIND_MANY_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___find_many_begin(0)
+#endif
+#define	SLABLIST_FIND_MANY_END(arg0) \
+	__dtrace_slablist___find_many_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_FIND_MANY_END_ENABLED() \
+	__dtraceenabled_slablist___find_many_end()
+#else
+#define	SLABLIST_FIND_MANY_END_ENABLED() \
+	__dtraceenabled_slablist___find_many_end(0)
+#endif
 #define	SLABLIST_FIND_SLAB_POS_BEGIN(arg0) \
 	__dtrace_slablist___find_slab_pos_begin(arg0)
 #ifndef	__sparc
@@ -281,6 +407,15 @@ extern "C" {
 #define	SLABLIST_GOT_HERE_ENABLED() \
 	__dtraceenabled_slablist___got_here(0)
 #endif
+#define	SLABLIST_LAST_SLAB_HIT(arg0, arg1) \
+	__dtrace_slablist___last_slab_hit(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_LAST_SLAB_HIT_ENABLED() \
+	__dtraceenabled_slablist___last_slab_hit()
+#else
+#define	SLABLIST_LAST_SLAB_HIT_ENABLED() \
+	__dtraceenabled_slablist___last_slab_hit(0)
+#endif
 #define	SLABLIST_LINEAR_SCAN(arg0, arg1) \
 	__dtrace_slablist___linear_scan(arg0, arg1)
 #ifndef	__sparc
@@ -353,6 +488,42 @@ extern "C" {
 #define	SLABLIST_LINK_SUBSLAB_BEFORE_ENABLED() \
 	__dtraceenabled_slablist___link_subslab_before(0)
 #endif
+#define	SLABLIST_LOAD_BEGIN(arg0) \
+	__dtrace_slablist___load_begin(arg0)
+#ifndef	__sparc
+#define	SLABLIST_LOAD_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___load_begin()
+#else
+#define	SLABLIST_LOAD_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___load_begin(0)
+#endif
+#define	SLABLIST_LOAD_END(arg0) \
+	__dtrace_slablist___load_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_LOAD_END_ENABLED() \
+	__dtraceenabled_slablist___load_end()
+#else
+#define	SLABLIST_LOAD_END_ENABLED() \
+	__dtraceenabled_slablist___load_end(0)
+#endif
+#define	SLABLIST_LOG_REPLAY(arg0, arg1) \
+	__dtrace_slablist___log_replay(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_LOG_REPLAY_ENABLED() \
+	__dtraceenabled_slablist___log_replay()
+#else
+#define	SLABLIST_LOG_REPLAY_ENABLED() \
+	__dtraceenabled_slablist___log_replay(0)
+#endif
+#define	SLABLIST_LOG_WRITE(arg0, arg1) \
+	__dtrace_slablist___log_write(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_LOG_WRITE_ENABLED() \
+	__dtraceenabled_slablist___log_write()
+#else
+#define	SLABLIST_LOG_WRITE_ENABLED() \
+	__dtraceenabled_slablist___log_write(0)
+#endif
 #define	SLABLIST_MAP_BEGIN(arg0) \
 	__dtrace_slablist___map_begin(arg0)
 #ifndef	__sparc
@@ -371,6 +542,69 @@ extern "C" {
 #define	SLABLIST_MAP_END_ENABLED() \
 	__dtraceenabled_slablist___map_end(0)
 #endif
+#define	SLABLIST_MVCC_PIN(arg0, arg1) \
+	__dtrace_slablist___mvcc_pin(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_MVCC_PIN_ENABLED() \
+	__dtraceenabled_slablist___mvcc_pin()
+#else
+#define	SLABLIST_MVCC_PIN_ENABLED() \
+	__dtraceenabled_slablist___mvcc_pin(0)
+#endif
+#define	SLABLIST_MVCC_UNPIN(arg0, arg1) \
+	__dtrace_slablist___mvcc_unpin(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_MVCC_UNPIN_ENABLED() \
+	__dtraceenabled_slablist___mvcc_unpin()
+#else
+#define	SLABLIST_MVCC_UNPIN_ENABLED() \
+	__dtraceenabled_slablist___mvcc_unpin(0)
+#endif
+#define	SLABLIST_MVCC_PUBLISH(arg0, arg1) \
+	__dtrace_slablist___mvcc_publish(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_MVCC_PUBLISH_ENABLED() \
+	__dtraceenabled_slablist___mvcc_publish()
+#else
+#define	SLABLIST_MVCC_PUBLISH_ENABLED() \
+	__dtraceenabled_slablist___mvcc_publish(0)
+#endif
+#define	SLABLIST_OPEN_MAPPED_BEGIN(arg0) \
+	__dtrace_slablist___open_mapped_begin(arg0)
+#ifndef	__sparc
+#define	SLABLIST_OPEN_MAPPED_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___open_mapped_begin()
+#else
+#define	SLABLIST_OPEN_MAPPED_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___open_mapped_begin(0)
+#endif
+#define	SLABLIST_OPEN_MAPPED_END(arg0) \
+	__dtrace_slablist___open_mapped_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_OPEN_MAPPED_END_ENABLED() \
+	__dtraceenabled_slablist___open_mapped_end()
+#else
+#define	SLABLIST_OPEN_MAPPED_END_ENABLED() \
+	__dtraceenabled_slablist___open_mapped_end(0)
+#endif
+#define	SLABLIST_RANK_BEGIN(arg0, arg1) \
+	__dtrace_slablist___rank_begin(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_RANK_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___rank_begin()
+#else
+#define	SLABLIST_RANK_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___rank_begin(0)
+#endif
+#define	SLABLIST_RANK_END(arg0) \
+	__dtrace_slablist___rank_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_RANK_END_ENABLED() \
+	__dtraceenabled_slablist___rank_end()
+#else
+#define	SLABLIST_RANK_END_ENABLED() \
+	__dtraceenabled_slablist___rank_end(0)
+#endif
 #define	SLABLIST_REAP_BEGIN(arg0) \
 	__dtrace_slablist___reap_begin(arg0)
 #ifndef	__sparc
@@ -461,6 +695,42 @@ extern "C" {
 #define	SLABLIST_RIPPLE_REM_SUBSLAB_ENABLED() \
 	__dtraceenabled_slablist___ripple_rem_subslab(0)
 #endif
+#define	SLABLIST_ROOT_INDEX_BUILD(arg0, arg1) \
+	__dtrace_slablist___root_index_build(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_ROOT_INDEX_BUILD_ENABLED() \
+	__dtraceenabled_slablist___root_index_build()
+#else
+#define	SLABLIST_ROOT_INDEX_BUILD_ENABLED() \
+	__dtraceenabled_slablist___root_index_build(0)
+#endif
+#define	SLABLIST_ROOT_INDEX_FIND(arg0, arg1, arg2) \
+	__dtrace_slablist___root_index_find(arg0, arg1, arg2)
+#ifndef	__sparc
+#define	SLABLIST_ROOT_INDEX_FIND_ENABLED() \
+	__dtraceenabled_slablist___root_index_find()
+#else
+#define	SLABLIST_ROOT_INDEX_FIND_ENABLED() \
+	__dtraceenabled_slablist___root_index_find(0)
+#endif
+#define	SLABLIST_SAVE_BEGIN(arg0) \
+	__dtrace_slablist___save_begin(arg0)
+#ifndef	__sparc
+#define	SLABLIST_SAVE_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___save_begin()
+#else
+#define	SLABLIST_SAVE_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___save_begin(0)
+#endif
+#define	SLABLIST_SAVE_END(arg0) \
+	__dtrace_slablist___save_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_SAVE_END_ENABLED() \
+	__dtraceenabled_slablist___save_end()
+#else
+#define	SLABLIST_SAVE_END_ENABLED() \
+	__dtraceenabled_slablist___save_end(0)
+#endif
 #define	SLABLIST_SET_CRUMB(arg0, arg1, arg2) \
 	__dtrace_slablist___set_crumb(arg0, arg1, arg2)
 #ifndef	__sparc
@@ -497,6 +767,24 @@ extern "C" {
 #define	SLABLIST_SET_USR_ELEMS_ENABLED() \
 	__dtraceenabled_slablist___set_usr_elems(0)
 #endif
+#define	SLABLIST_SHM_LOCK(arg0, arg1) \
+	__dtrace_slablist___shm_lock(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_SHM_LOCK_ENABLED() \
+	__dtraceenabled_slablist___shm_lock()
+#else
+#define	SLABLIST_SHM_LOCK_ENABLED() \
+	__dtraceenabled_slablist___shm_lock(0)
+#endif
+#define	SLABLIST_SHM_UNLOCK(arg0) \
+	__dtrace_slablist___shm_unlock(arg0)
+#ifndef	__sparc
+#define	SLABLIST_SHM_UNLOCK_ENABLED() \
+	__dtraceenabled_slablist___shm_unlock()
+#else
+#define	SLABLIST_SHM_UNLOCK_ENABLED() \
+	__dtraceenabled_slablist___shm_unlock(0)
+#endif
 #define	SLABLIST_SL_DEC_ELEMS(arg0) \
 	__dtrace_slablist___sl_dec_elems(arg0)
 #ifndef	__sparc
@@ -677,6 +965,15 @@ extern "C" {
 #define	SLABLIST_SLAB_DEC_ELEMS_ENABLED() \
 	__dtraceenabled_slablist___slab_dec_elems(0)
 #endif
+#define	SLABLIST_SLAB_FREEZE(arg0, arg1) \
+	__dtrace_slablist___slab_freeze(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_SLAB_FREEZE_ENABLED() \
+	__dtraceenabled_slablist___slab_freeze()
+#else
+#define	SLABLIST_SLAB_FREEZE_ENABLED() \
+	__dtraceenabled_slablist___slab_freeze(0)
+#endif
 #define	SLABLIST_SLAB_INC_ELEMS(arg0) \
 	__dtrace_slablist___slab_inc_elems(arg0)
 #ifndef	__sparc
@@ -767,6 +1064,33 @@ extern "C" {
 #define	SLABLIST_SLAB_SET_MIN_ENABLED() \
 	__dtraceenabled_slablist___slab_set_min(0)
 #endif
+#define	SLABLIST_SLAB_THAW(arg0, arg1) \
+	__dtrace_slablist___slab_thaw(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_SLAB_THAW_ENABLED() \
+	__dtraceenabled_slablist___slab_thaw()
+#else
+#define	SLABLIST_SLAB_THAW_ENABLED() \
+	__dtraceenabled_slablist___slab_thaw(0)
+#endif
+#define	SLABLIST_SPAN_BEGIN(arg0) \
+	__dtrace_slablist___span_begin(arg0)
+#ifndef	__sparc
+#define	SLABLIST_SPAN_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___span_begin()
+#else
+#define	SLABLIST_SPAN_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___span_begin(0)
+#endif
+#define	SLABLIST_SPAN_RUN(arg0) \
+	__dtrace_slablist___span_run(arg0)
+#ifndef	__sparc
+#define	SLABLIST_SPAN_RUN_ENABLED() \
+	__dtraceenabled_slablist___span_run()
+#else
+#define	SLABLIST_SPAN_RUN_ENABLED() \
+	__dtraceenabled_slablist___span_run(0)
+#endif
 #define	SLABLIST_SUB_LINEAR_SCAN(arg0, arg1) \
 	__dtrace_slablist___sub_linear_scan(arg0, arg1)
 #ifndef	__sparc
@@ -830,6 +1154,24 @@ extern "C" {
 #define	SLABLIST_SUBFWDSHIFT_END_ENABLED() \
 	__dtraceenabled_slablist___subfwdshift_end(0)
 #endif
+#define	SLABLIST_SUBSEQ_BEGIN(arg0, arg1) \
+	__dtrace_slablist___subseq_begin(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_SUBSEQ_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___subseq_begin()
+#else
+#define	SLABLIST_SUBSEQ_BEGIN_ENABLED() \
+	__dtraceenabled_slablist___subseq_begin(0)
+#endif
+#define	SLABLIST_SUBSEQ_END(arg0) \
+	__dtrace_slablist___subseq_end(arg0)
+#ifndef	__sparc
+#define	SLABLIST_SUBSEQ_END_ENABLED() \
+	__dtraceenabled_slablist___subseq_end()
+#else
+#define	SLABLIST_SUBSEQ_END_ENABLED() \
+	__dtraceenabled_slablist___subseq_end(0)
+#endif
 #define	SLABLIST_SUBSLAB_AA(arg0, arg1, arg2, arg3) \
 	__dtrace_slablist___subslab_aa(arg0, arg1, arg2, arg3)
 #ifndef	__sparc
@@ -1055,6 +1397,33 @@ extern "C" {
 #define	SLABLIST_TEST_ADD_SLAB_ENABLED() \
 	__dtraceenabled_slablist___test_add_slab(0)
 #endif
+#define	SLABLIST_TEST_AGGREGATE(arg0) \
+	__dtrace_slablist___test_aggregate(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_AGGREGATE_ENABLED() \
+	__dtraceenabled_slablist___test_aggregate()
+#else
+#define	SLABLIST_TEST_AGGREGATE_ENABLED() \
+	__dtraceenabled_slablist___test_aggregate(0)
+#endif
+#define	SLABLIST_TEST_BLOOM(arg0) \
+	__dtrace_slablist___test_bloom(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_BLOOM_ENABLED() \
+	__dtraceenabled_slablist___test_bloom()
+#else
+#define	SLABLIST_TEST_BLOOM_ENABLED() \
+	__dtraceenabled_slablist___test_bloom(0)
+#endif
+#define	SLABLIST_TEST_BOUND(arg0) \
+	__dtrace_slablist___test_bound(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_BOUND_ENABLED() \
+	__dtraceenabled_slablist___test_bound()
+#else
+#define	SLABLIST_TEST_BOUND_ENABLED() \
+	__dtraceenabled_slablist___test_bound(0)
+#endif
 #define	SLABLIST_TEST_BREAD_CRUMBS(arg0, arg1) \
 	__dtrace_slablist___test_bread_crumbs(arg0, arg1)
 #ifndef	__sparc
@@ -1064,6 +1433,15 @@ extern "C" {
 #define	SLABLIST_TEST_BREAD_CRUMBS_ENABLED() \
 	__dtraceenabled_slablist___test_bread_crumbs(0)
 #endif
+#define	SLABLIST_TEST_CLONE(arg0) \
+	__dtrace_slablist___test_clone(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_CLONE_ENABLED() \
+	__dtraceenabled_slablist___test_clone()
+#else
+#define	SLABLIST_TEST_CLONE_ENABLED() \
+	__dtraceenabled_slablist___test_clone(0)
+#endif
 #define	SLABLIST_TEST_FIND_BUBBLE_UP(arg0, arg1, arg2, arg3, arg4) \
 	__dtrace_slablist___test_find_bubble_up(arg0, arg1, arg2, arg3, arg4)
 #ifndef	__sparc
@@ -1100,6 +1478,33 @@ extern "C" {
 #define	SLABLIST_TEST_IS_SML_LIST_ENABLED() \
 	__dtraceenabled_slablist___test_is_sml_list(0)
 #endif
+#define	SLABLIST_TEST_LOAD(arg0) \
+	__dtrace_slablist___test_load(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_LOAD_ENABLED() \
+	__dtraceenabled_slablist___test_load()
+#else
+#define	SLABLIST_TEST_LOAD_ENABLED() \
+	__dtraceenabled_slablist___test_load(0)
+#endif
+#define	SLABLIST_TEST_MAPPED(arg0) \
+	__dtrace_slablist___test_mapped(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_MAPPED_ENABLED() \
+	__dtraceenabled_slablist___test_mapped()
+#else
+#define	SLABLIST_TEST_MAPPED_ENABLED() \
+	__dtraceenabled_slablist___test_mapped(0)
+#endif
+#define	SLABLIST_TEST_RANK(arg0) \
+	__dtrace_slablist___test_rank(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_RANK_ENABLED() \
+	__dtraceenabled_slablist___test_rank()
+#else
+#define	SLABLIST_TEST_RANK_ENABLED() \
+	__dtraceenabled_slablist___test_rank(0)
+#endif
 #define	SLABLIST_TEST_REM_RANGE(arg0, arg1, arg2) \
 	__dtrace_slablist___test_rem_range(arg0, arg1, arg2)
 #ifndef	__sparc
@@ -1154,6 +1559,15 @@ extern "C" {
 #define	SLABLIST_TEST_RIPPLE_UPDATE_EXTREMA_ENABLED() \
 	__dtraceenabled_slablist___test_ripple_update_extrema(0)
 #endif
+#define	SLABLIST_TEST_ROOT_INDEX(arg0) \
+	__dtrace_slablist___test_root_index(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_ROOT_INDEX_ENABLED() \
+	__dtraceenabled_slablist___test_root_index()
+#else
+#define	SLABLIST_TEST_ROOT_INDEX_ENABLED() \
+	__dtraceenabled_slablist___test_root_index(0)
+#endif
 #define	SLABLIST_TEST_SLAB_BIN_SRCH(arg0, arg1, arg2) \
 	__dtrace_slablist___test_slab_bin_srch(arg0, arg1, arg2)
 #ifndef	__sparc
@@ -1163,6 +1577,15 @@ extern "C" {
 #define	SLABLIST_TEST_SLAB_BIN_SRCH_ENABLED() \
 	__dtraceenabled_slablist___test_slab_bin_srch(0)
 #endif
+#define	SLABLIST_TEST_SLAB_FREEZE(arg0, arg1) \
+	__dtrace_slablist___test_slab_freeze(arg0, arg1)
+#ifndef	__sparc
+#define	SLABLIST_TEST_SLAB_FREEZE_ENABLED() \
+	__dtraceenabled_slablist___test_slab_freeze()
+#else
+#define	SLABLIST_TEST_SLAB_FREEZE_ENABLED() \
+	__dtraceenabled_slablist___test_slab_freeze(0)
+#endif
 #define	SLABLIST_TEST_SLAB_MOVE_NEXT(arg0, arg1, arg2, arg3, arg4, arg5) \
 	__dtrace_slablist___test_slab_move_next(arg0, arg1, arg2, arg3, arg4, arg5)
 #ifndef	__sparc
@@ -1208,6 +1631,24 @@ extern "C" {
 #define	SLABLIST_TEST_SMLIST_NELEMS_ENABLED() \
 	__dtraceenabled_slablist___test_smlist_nelems(0)
 #endif
+#define	SLABLIST_TEST_SPAN(arg0) \
+	__dtrace_slablist___test_span(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_SPAN_ENABLED() \
+	__dtraceenabled_slablist___test_span()
+#else
+#define	SLABLIST_TEST_SPAN_ENABLED() \
+	__dtraceenabled_slablist___test_span(0)
+#endif
+#define	SLABLIST_TEST_SUBSEQ(arg0) \
+	__dtrace_slablist___test_subseq(arg0)
+#ifndef	__sparc
+#define	SLABLIST_TEST_SUBSEQ_ENABLED() \
+	__dtraceenabled_slablist___test_subseq()
+#else
+#define	SLABLIST_TEST_SUBSEQ_ENABLED() \
+	__dtraceenabled_slablist___test_subseq(0)
+#endif
 #define	SLABLIST_TEST_SUBSLAB_BIN_SRCH(arg0, arg1, arg2) \
 	__dtrace_slablist___test_subslab_bin_srch(arg0, arg1, arg2)
 #ifndef	__sparc
@@ -1303,12 +1744,48 @@ extern int __dtraceenabled_slablist___add_end(void);
 #else
 extern int __dtraceenabled_slablist___add_end(long);
 #endif
+extern void __dtrace_slablist___aggregate_begin(slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___aggregate_begin(void);
+#else
+extern int __dtraceenabled_slablist___aggregate_begin(long);
+#endif
+extern void __dtrace_slablist___aggregate_end(slablist_elem_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___aggregate_end(void);
+#else
+extern int __dtraceenabled_slablist___aggregate_end(long);
+#endif
 extern void __dtrace_slablist___attach_sublayer(slablist_t *, slablist_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___attach_sublayer(void);
 #else
 extern int __dtraceenabled_slablist___attach_sublayer(long);
 #endif
+extern void __dtrace_slablist___bloom_build(slablist_t *, uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___bloom_build(void);
+#else
+extern int __dtraceenabled_slablist___bloom_build(long);
+#endif
+extern void __dtrace_slablist___bloom_skip(slablist_t *, slablist_elem_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___bloom_skip(void);
+#else
+extern int __dtraceenabled_slablist___bloom_skip(long);
+#endif
+extern void __dtrace_slablist___bound_begin(slablist_t *, slablist_elem_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___bound_begin(void);
+#else
+extern int __dtraceenabled_slablist___bound_begin(long);
+#endif
+extern void __dtrace_slablist___bound_end(int, slablist_elem_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___bound_end(void);
+#else
+extern int __dtraceenabled_slablist___bound_end(long);
+#endif
 extern void __dtrace_slablist___bubble_up(slablist_t *, subslab_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___bubble_up(void);
@@ -1345,6 +1822,42 @@ extern int __dtraceenabled_slablist___bwdshift_end(void);
 #else
 extern int __dtraceenabled_slablist___bwdshift_end(long);
 #endif
+extern void __dtrace_slablist___checkpoint_begin(slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___checkpoint_begin(void);
+#else
+extern int __dtraceenabled_slablist___checkpoint_begin(long);
+#endif
+extern void __dtrace_slablist___checkpoint_end(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___checkpoint_end(void);
+#else
+extern int __dtraceenabled_slablist___checkpoint_end(long);
+#endif
+extern void __dtrace_slablist___clone(slablist_t *, slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___clone(void);
+#else
+extern int __dtraceenabled_slablist___clone(long);
+#endif
+extern void __dtrace_slablist___compress_begin(slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___compress_begin(void);
+#else
+extern int __dtraceenabled_slablist___compress_begin(long);
+#endif
+extern void __dtrace_slablist___compress_end(uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___compress_end(void);
+#else
+extern int __dtraceenabled_slablist___compress_end(long);
+#endif
+extern void __dtrace_slablist___cow_break(slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___cow_break(void);
+#else
+extern int __dtraceenabled_slablist___cow_break(long);
+#endif
 extern void __dtrace_slablist___create(slablist_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___create(void);
@@ -1381,6 +1894,18 @@ extern int __dtraceenabled_slablist___find_end(void);
 #else
 extern int __dtraceenabled_slablist___find_end(long);
 #endif
+extern void __dtrace_slablist___find_many_begin(slablist_t *, uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___find_many_begin(void);
+#else
+extern int __dtraceenabled_slablist___find_many_begin(long);
+#endif
+extern void __dtrace_slablist___find_many_end(uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___find_many_end(void);
+#else
+extern int __dtraceenabled_slablist___find_many_end(long);
+#endif
 extern void __dtrace_slablist___find_slab_pos_begin(int);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___find_slab_pos_begin(void);
@@ -1471,6 +1996,12 @@ extern int __dtraceenabled_slablist___got_here(void);
 #else
 extern int __dtraceenabled_slablist___got_here(long);
 #endif
+extern void __dtrace_slablist___last_slab_hit(slablist_t *, slab_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___last_slab_hit(void);
+#else
+extern int __dtraceenabled_slablist___last_slab_hit(long);
+#endif
 extern void __dtrace_slablist___linear_scan(slablist_t *, slab_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___linear_scan(void);
@@ -1519,6 +2050,30 @@ extern int __dtraceenabled_slablist___link_subslab_before(void);
 #else
 extern int __dtraceenabled_slablist___link_subslab_before(long);
 #endif
+extern void __dtrace_slablist___load_begin(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___load_begin(void);
+#else
+extern int __dtraceenabled_slablist___load_begin(long);
+#endif
+extern void __dtrace_slablist___load_end(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___load_end(void);
+#else
+extern int __dtraceenabled_slablist___load_end(long);
+#endif
+extern void __dtrace_slablist___log_replay(slablist_t *, uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___log_replay(void);
+#else
+extern int __dtraceenabled_slablist___log_replay(long);
+#endif
+extern void __dtrace_slablist___log_write(slablist_t *, uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___log_write(void);
+#else
+extern int __dtraceenabled_slablist___log_write(long);
+#endif
 extern void __dtrace_slablist___map_begin(slablist_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___map_begin(void);
@@ -1531,6 +2086,48 @@ extern int __dtraceenabled_slablist___map_end(void);
 #else
 extern int __dtraceenabled_slablist___map_end(long);
 #endif
+extern void __dtrace_slablist___mvcc_pin(slablist_t *, slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___mvcc_pin(void);
+#else
+extern int __dtraceenabled_slablist___mvcc_pin(long);
+#endif
+extern void __dtrace_slablist___mvcc_unpin(slablist_t *, slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___mvcc_unpin(void);
+#else
+extern int __dtraceenabled_slablist___mvcc_unpin(long);
+#endif
+extern void __dtrace_slablist___mvcc_publish(slablist_t *, slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___mvcc_publish(void);
+#else
+extern int __dtraceenabled_slablist___mvcc_publish(long);
+#endif
+extern void __dtrace_slablist___open_mapped_begin(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___open_mapped_begin(void);
+#else
+extern int __dtraceenabled_slablist___open_mapped_begin(long);
+#endif
+extern void __dtrace_slablist___open_mapped_end(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___open_mapped_end(void);
+#else
+extern int __dtraceenabled_slablist___open_mapped_end(long);
+#endif
+extern void __dtrace_slablist___rank_begin(slablist_t *, slablist_elem_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___rank_begin(void);
+#else
+extern int __dtraceenabled_slablist___rank_begin(long);
+#endif
+extern void __dtrace_slablist___rank_end(uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___rank_end(void);
+#else
+extern int __dtraceenabled_slablist___rank_end(long);
+#endif
 extern void __dtrace_slablist___reap_begin(slablist_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___reap_begin(void);
@@ -1591,6 +2188,30 @@ extern int __dtraceenabled_slablist___ripple_rem_subslab(void);
 #else
 extern int __dtraceenabled_slablist___ripple_rem_subslab(long);
 #endif
+extern void __dtrace_slablist___root_index_build(slablist_t *, uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___root_index_build(void);
+#else
+extern int __dtraceenabled_slablist___root_index_build(long);
+#endif
+extern void __dtrace_slablist___root_index_find(slablist_t *, uint64_t, uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___root_index_find(void);
+#else
+extern int __dtraceenabled_slablist___root_index_find(long);
+#endif
+extern void __dtrace_slablist___save_begin(slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___save_begin(void);
+#else
+extern int __dtraceenabled_slablist___save_begin(long);
+#endif
+extern void __dtrace_slablist___save_end(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___save_end(void);
+#else
+extern int __dtraceenabled_slablist___save_end(long);
+#endif
 extern void __dtrace_slablist___set_crumb(slablist_t *, subslab_t *, int);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___set_crumb(void);
@@ -1615,6 +2236,18 @@ extern int __dtraceenabled_slablist___set_usr_elems(void);
 #else
 extern int __dtraceenabled_slablist___set_usr_elems(long);
 #endif
+extern void __dtrace_slablist___shm_lock(slablist_t *, int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___shm_lock(void);
+#else
+extern int __dtraceenabled_slablist___shm_lock(long);
+#endif
+extern void __dtrace_slablist___shm_unlock(slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___shm_unlock(void);
+#else
+extern int __dtraceenabled_slablist___shm_unlock(long);
+#endif
 extern void __dtrace_slablist___sl_dec_elems(slablist_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___sl_dec_elems(void);
@@ -1735,6 +2368,12 @@ extern int __dtraceenabled_slablist___slab_dec_elems(void);
 #else
 extern int __dtraceenabled_slablist___slab_dec_elems(long);
 #endif
+extern void __dtrace_slablist___slab_freeze(slablist_t *, slab_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___slab_freeze(void);
+#else
+extern int __dtraceenabled_slablist___slab_freeze(long);
+#endif
 extern void __dtrace_slablist___slab_inc_elems(slab_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___slab_inc_elems(void);
@@ -1795,6 +2434,24 @@ extern int __dtraceenabled_slablist___slab_set_min(void);
 #else
 extern int __dtraceenabled_slablist___slab_set_min(long);
 #endif
+extern void __dtrace_slablist___slab_thaw(slablist_t *, slab_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___slab_thaw(void);
+#else
+extern int __dtraceenabled_slablist___slab_thaw(long);
+#endif
+extern void __dtrace_slablist___span_begin(slablist_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___span_begin(void);
+#else
+extern int __dtraceenabled_slablist___span_begin(long);
+#endif
+extern void __dtrace_slablist___span_run(uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___span_run(void);
+#else
+extern int __dtraceenabled_slablist___span_run(long);
+#endif
 extern void __dtrace_slablist___sub_linear_scan(slablist_t *, subslab_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___sub_linear_scan(void);
@@ -1837,6 +2494,18 @@ extern int __dtraceenabled_slablist___subfwdshift_end(void);
 #else
 extern int __dtraceenabled_slablist___subfwdshift_end(long);
 #endif
+extern void __dtrace_slablist___subseq_begin(slablist_t *, uint64_t);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___subseq_begin(void);
+#else
+extern int __dtraceenabled_slablist___subseq_begin(long);
+#endif
+extern void __dtrace_slablist___subseq_end(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___subseq_end(void);
+#else
+extern int __dtraceenabled_slablist___subseq_end(long);
+#endif
 extern void __dtrace_slablist___subslab_aa(slablist_t *, subslab_t *, slab_t *, subslab_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___subslab_aa(void);
@@ -1987,12 +2656,36 @@ extern int __dtraceenabled_slablist___test_add_slab(void);
 #else
 extern int __dtraceenabled_slablist___test_add_slab(long);
 #endif
+extern void __dtrace_slablist___test_aggregate(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_aggregate(void);
+#else
+extern int __dtraceenabled_slablist___test_aggregate(long);
+#endif
+extern void __dtrace_slablist___test_bloom(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_bloom(void);
+#else
+extern int __dtraceenabled_slablist___test_bloom(long);
+#endif
+extern void __dtrace_slablist___test_bound(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_bound(void);
+#else
+extern int __dtraceenabled_slablist___test_bound(long);
+#endif
 extern void __dtrace_slablist___test_bread_crumbs(int, int);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___test_bread_crumbs(void);
 #else
 extern int __dtraceenabled_slablist___test_bread_crumbs(long);
 #endif
+extern void __dtrace_slablist___test_clone(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_clone(void);
+#else
+extern int __dtraceenabled_slablist___test_clone(long);
+#endif
 extern void __dtrace_slablist___test_find_bubble_up(int, slab_t *, subslab_t *, slablist_elem_t, int);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___test_find_bubble_up(void);
@@ -2017,6 +2710,24 @@ extern int __dtraceenabled_slablist___test_is_sml_list(void);
 #else
 extern int __dtraceenabled_slablist___test_is_sml_list(long);
 #endif
+extern void __dtrace_slablist___test_load(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_load(void);
+#else
+extern int __dtraceenabled_slablist___test_load(long);
+#endif
+extern void __dtrace_slablist___test_mapped(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_mapped(void);
+#else
+extern int __dtraceenabled_slablist___test_mapped(long);
+#endif
+extern void __dtrace_slablist___test_rank(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_rank(void);
+#else
+extern int __dtraceenabled_slablist___test_rank(long);
+#endif
 extern void __dtrace_slablist___test_rem_range(int, slab_t *, subslab_t *);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___test_rem_range(void);
@@ -2053,12 +2764,24 @@ extern int __dtraceenabled_slablist___test_ripple_update_extrema(void);
 #else
 extern int __dtraceenabled_slablist___test_ripple_update_extrema(long);
 #endif
+extern void __dtrace_slablist___test_root_index(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_root_index(void);
+#else
+extern int __dtraceenabled_slablist___test_root_index(long);
+#endif
 extern void __dtrace_slablist___test_slab_bin_srch(int, slab_t *, slablist_elem_t);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___test_slab_bin_srch(void);
 #else
 extern int __dtraceenabled_slablist___test_slab_bin_srch(long);
 #endif
+extern void __dtrace_slablist___test_slab_freeze(int, slab_t *);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_slab_freeze(void);
+#else
+extern int __dtraceenabled_slablist___test_slab_freeze(long);
+#endif
 extern void __dtrace_slablist___test_slab_move_next(int, slab_t *, slab_t *, slab_t *, int, int);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___test_slab_move_next(void);
@@ -2089,6 +2812,18 @@ extern int __dtraceenabled_slablist___test_smlist_nelems(void);
 #else
 extern int __dtraceenabled_slablist___test_smlist_nelems(long);
 #endif
+extern void __dtrace_slablist___test_span(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_span(void);
+#else
+extern int __dtraceenabled_slablist___test_span(long);
+#endif
+extern void __dtrace_slablist___test_subseq(int);
+#ifndef	__sparc
+extern int __dtraceenabled_slablist___test_subseq(void);
+#else
+extern int __dtraceenabled_slablist___test_subseq(long);
+#endif
 extern void __dtrace_slablist___test_subslab_bin_srch(int, subslab_t *, slablist_elem_t);
 #ifndef	__sparc
 extern int __dtraceenabled_slablist___test_subslab_bin_srch(void);
@@ -2150,8 +2885,20 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_ADD_BEGIN_ENABLED() (0)
 #define	SLABLIST_ADD_END(arg0)
 #define	SLABLIST_ADD_END_ENABLED() (0)
+#define	SLABLIST_AGGREGATE_BEGIN(arg0)
+#define	SLABLIST_AGGREGATE_BEGIN_ENABLED() (0)
+#define	SLABLIST_AGGREGATE_END(arg0)
+#define	SLABLIST_AGGREGATE_END_ENABLED() (0)
 #define	SLABLIST_ATTACH_SUBLAYER(arg0, arg1)
 #define	SLABLIST_ATTACH_SUBLAYER_ENABLED() (0)
+#define	SLABLIST_BLOOM_BUILD(arg0, arg1)
+#define	SLABLIST_BLOOM_BUILD_ENABLED() (0)
+#define	SLABLIST_BLOOM_SKIP(arg0, arg1)
+#define	SLABLIST_BLOOM_SKIP_ENABLED() (0)
+#define	SLABLIST_BOUND_BEGIN(arg0, arg1)
+#define	SLABLIST_BOUND_BEGIN_ENABLED() (0)
+#define	SLABLIST_BOUND_END(arg0, arg1)
+#define	SLABLIST_BOUND_END_ENABLED() (0)
 #define	SLABLIST_BUBBLE_UP(arg0, arg1)
 #define	SLABLIST_BUBBLE_UP_ENABLED() (0)
 #define	SLABLIST_BUBBLE_UP_BEGIN(arg0)
@@ -2164,6 +2911,18 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_BWDSHIFT_BEGIN_ENABLED() (0)
 #define	SLABLIST_BWDSHIFT_END()
 #define	SLABLIST_BWDSHIFT_END_ENABLED() (0)
+#define	SLABLIST_CHECKPOINT_BEGIN(arg0)
+#define	SLABLIST_CHECKPOINT_BEGIN_ENABLED() (0)
+#define	SLABLIST_CHECKPOINT_END(arg0)
+#define	SLABLIST_CHECKPOINT_END_ENABLED() (0)
+#define	SLABLIST_CLONE(arg0, arg1)
+#define	SLABLIST_CLONE_ENABLED() (0)
+#define	SLABLIST_COMPRESS_BEGIN(arg0)
+#define	SLABLIST_COMPRESS_BEGIN_ENABLED() (0)
+#define	SLABLIST_COMPRESS_END(arg0)
+#define	SLABLIST_COMPRESS_END_ENABLED() (0)
+#define	SLABLIST_COW_BREAK(arg0)
+#define	SLABLIST_COW_BREAK_ENABLED() (0)
 #define	SLABLIST_CREATE(arg0)
 #define	SLABLIST_CREATE_ENABLED() (0)
 #define	SLABLIST_DESTROY(arg0)
@@ -2176,6 +2935,10 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_FIND_BEGIN_ENABLED() (0)
 #define	SLABLIST_FIND_END(arg0, arg1)
 #define	SLABLIST_FIND_END_ENABLED() (0)
+#define	SLABLIST_FIND_MANY_BEGIN(arg0, arg1)
+#define	SLABLIST_FIND_MANY_BEGIN_ENABLED() (0)
+#define	SLABLIST_FIND_MANY_END(arg0)
+#define	SLABLIST_FIND_MANY_END_ENABLED() (0)
 #define	SLABLIST_FIND_SLAB_POS_BEGIN(arg0)
 #define	SLABLIST_FIND_SLAB_POS_BEGIN_ENABLED() (0)
 #define	SLABLIST_FIND_SLAB_POS_END(arg0)
@@ -2206,6 +2969,8 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_GET_POS_TOP_WALK_ENABLED() (0)
 #define	SLABLIST_GOT_HERE(arg0)
 #define	SLABLIST_GOT_HERE_ENABLED() (0)
+#define	SLABLIST_LAST_SLAB_HIT(arg0, arg1)
+#define	SLABLIST_LAST_SLAB_HIT_ENABLED() (0)
 #define	SLABLIST_LINEAR_SCAN(arg0, arg1)
 #define	SLABLIST_LINEAR_SCAN_ENABLED() (0)
 #define	SLABLIST_LINEAR_SCAN_BEGIN(arg0)
@@ -2222,10 +2987,32 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_LINK_SUBSLAB_AFTER_ENABLED() (0)
 #define	SLABLIST_LINK_SUBSLAB_BEFORE(arg0, arg1, arg2)
 #define	SLABLIST_LINK_SUBSLAB_BEFORE_ENABLED() (0)
+#define	SLABLIST_LOAD_BEGIN(arg0)
+#define	SLABLIST_LOAD_BEGIN_ENABLED() (0)
+#define	SLABLIST_LOAD_END(arg0)
+#define	SLABLIST_LOAD_END_ENABLED() (0)
+#define	SLABLIST_LOG_REPLAY(arg0, arg1)
+#define	SLABLIST_LOG_REPLAY_ENABLED() (0)
+#define	SLABLIST_LOG_WRITE(arg0, arg1)
+#define	SLABLIST_LOG_WRITE_ENABLED() (0)
 #define	SLABLIST_MAP_BEGIN(arg0)
 #define	SLABLIST_MAP_BEGIN_ENABLED() (0)
 #define	SLABLIST_MAP_END(arg0)
 #define	SLABLIST_MAP_END_ENABLED() (0)
+#define	SLABLIST_MVCC_PIN(arg0, arg1)
+#define	SLABLIST_MVCC_PIN_ENABLED() (0)
+#define	SLABLIST_MVCC_UNPIN(arg0, arg1)
+#define	SLABLIST_MVCC_UNPIN_ENABLED() (0)
+#define	SLABLIST_MVCC_PUBLISH(arg0, arg1)
+#define	SLABLIST_MVCC_PUBLISH_ENABLED() (0)
+#define	SLABLIST_OPEN_MAPPED_BEGIN(arg0)
+#define	SLABLIST_OPEN_MAPPED_BEGIN_ENABLED() (0)
+#define	SLABLIST_OPEN_MAPPED_END(arg0)
+#define	SLABLIST_OPEN_MAPPED_END_ENABLED() (0)
+#define	SLABLIST_RANK_BEGIN(arg0, arg1)
+#define	SLABLIST_RANK_BEGIN_ENABLED() (0)
+#define	SLABLIST_RANK_END(arg0)
+#define	SLABLIST_RANK_END_ENABLED() (0)
 #define	SLABLIST_REAP_BEGIN(arg0)
 #define	SLABLIST_REAP_BEGIN_ENABLED() (0)
 #define	SLABLIST_REAP_END(arg0)
@@ -2246,6 +3033,14 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_RIPPLE_REM_SLAB_ENABLED() (0)
 #define	SLABLIST_RIPPLE_REM_SUBSLAB(arg0, arg1, arg2)
 #define	SLABLIST_RIPPLE_REM_SUBSLAB_ENABLED() (0)
+#define	SLABLIST_ROOT_INDEX_BUILD(arg0, arg1)
+#define	SLABLIST_ROOT_INDEX_BUILD_ENABLED() (0)
+#define	SLABLIST_ROOT_INDEX_FIND(arg0, arg1, arg2)
+#define	SLABLIST_ROOT_INDEX_FIND_ENABLED() (0)
+#define	SLABLIST_SAVE_BEGIN(arg0)
+#define	SLABLIST_SAVE_BEGIN_ENABLED() (0)
+#define	SLABLIST_SAVE_END(arg0)
+#define	SLABLIST_SAVE_END_ENABLED() (0)
 #define	SLABLIST_SET_CRUMB(arg0, arg1, arg2)
 #define	SLABLIST_SET_CRUMB_ENABLED() (0)
 #define	SLABLIST_SET_END(arg0, arg1)
@@ -2254,6 +3049,10 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_SET_HEAD_ENABLED() (0)
 #define	SLABLIST_SET_USR_ELEMS(arg0)
 #define	SLABLIST_SET_USR_ELEMS_ENABLED() (0)
+#define	SLABLIST_SHM_LOCK(arg0, arg1)
+#define	SLABLIST_SHM_LOCK_ENABLED() (0)
+#define	SLABLIST_SHM_UNLOCK(arg0)
+#define	SLABLIST_SHM_UNLOCK_ENABLED() (0)
 #define	SLABLIST_SL_DEC_ELEMS(arg0)
 #define	SLABLIST_SL_DEC_ELEMS_ENABLED() (0)
 #define	SLABLIST_SL_DEC_SLABS(arg0)
@@ -2294,6 +3093,8 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_SLAB_BIN_SRCH_ENABLED() (0)
 #define	SLABLIST_SLAB_DEC_ELEMS(arg0)
 #define	SLABLIST_SLAB_DEC_ELEMS_ENABLED() (0)
+#define	SLABLIST_SLAB_FREEZE(arg0, arg1)
+#define	SLABLIST_SLAB_FREEZE_ENABLED() (0)
 #define	SLABLIST_SLAB_INC_ELEMS(arg0)
 #define	SLABLIST_SLAB_INC_ELEMS_ENABLED() (0)
 #define	SLABLIST_SLAB_MK(arg0)
@@ -2314,6 +3115,12 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_SLAB_SET_MAX_ENABLED() (0)
 #define	SLABLIST_SLAB_SET_MIN(arg0)
 #define	SLABLIST_SLAB_SET_MIN_ENABLED() (0)
+#define	SLABLIST_SLAB_THAW(arg0, arg1)
+#define	SLABLIST_SLAB_THAW_ENABLED() (0)
+#define	SLABLIST_SPAN_BEGIN(arg0)
+#define	SLABLIST_SPAN_BEGIN_ENABLED() (0)
+#define	SLABLIST_SPAN_RUN(arg0)
+#define	SLABLIST_SPAN_RUN_ENABLED() (0)
 #define	SLABLIST_SUB_LINEAR_SCAN(arg0, arg1)
 #define	SLABLIST_SUB_LINEAR_SCAN_ENABLED() (0)
 #define	SLABLIST_SUB_LINEAR_SCAN_BEGIN(arg0)
@@ -2328,6 +3135,10 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_SUBFWDSHIFT_BEGIN_ENABLED() (0)
 #define	SLABLIST_SUBFWDSHIFT_END()
 #define	SLABLIST_SUBFWDSHIFT_END_ENABLED() (0)
+#define	SLABLIST_SUBSEQ_BEGIN(arg0, arg1)
+#define	SLABLIST_SUBSEQ_BEGIN_ENABLED() (0)
+#define	SLABLIST_SUBSEQ_END(arg0)
+#define	SLABLIST_SUBSEQ_END_ENABLED() (0)
 #define	SLABLIST_SUBSLAB_AA(arg0, arg1, arg2, arg3)
 #define	SLABLIST_SUBSLAB_AA_ENABLED() (0)
 #define	SLABLIST_SUBSLAB_AAM(arg0, arg1, arg2, arg3)
@@ -2378,8 +3189,16 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_TEST_ADD_ELEM_ENABLED() (0)
 #define	SLABLIST_TEST_ADD_SLAB(arg0, arg1, arg2, arg3, arg4)
 #define	SLABLIST_TEST_ADD_SLAB_ENABLED() (0)
+#define	SLABLIST_TEST_AGGREGATE(arg0)
+#define	SLABLIST_TEST_AGGREGATE_ENABLED() (0)
+#define	SLABLIST_TEST_BLOOM(arg0)
+#define	SLABLIST_TEST_BLOOM_ENABLED() (0)
+#define	SLABLIST_TEST_BOUND(arg0)
+#define	SLABLIST_TEST_BOUND_ENABLED() (0)
 #define	SLABLIST_TEST_BREAD_CRUMBS(arg0, arg1)
 #define	SLABLIST_TEST_BREAD_CRUMBS_ENABLED() (0)
+#define	SLABLIST_TEST_CLONE(arg0)
+#define	SLABLIST_TEST_CLONE_ENABLED() (0)
 #define	SLABLIST_TEST_FIND_BUBBLE_UP(arg0, arg1, arg2, arg3, arg4)
 #define	SLABLIST_TEST_FIND_BUBBLE_UP_ENABLED() (0)
 #define	SLABLIST_TEST_GET_ELEM_POS(arg0, arg1, arg2, arg3, arg4)
@@ -2388,6 +3207,12 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_TEST_IS_SLAB_LIST_ENABLED() (0)
 #define	SLABLIST_TEST_IS_SML_LIST(arg0)
 #define	SLABLIST_TEST_IS_SML_LIST_ENABLED() (0)
+#define	SLABLIST_TEST_LOAD(arg0)
+#define	SLABLIST_TEST_LOAD_ENABLED() (0)
+#define	SLABLIST_TEST_MAPPED(arg0)
+#define	SLABLIST_TEST_MAPPED_ENABLED() (0)
+#define	SLABLIST_TEST_RANK(arg0)
+#define	SLABLIST_TEST_RANK_ENABLED() (0)
 #define	SLABLIST_TEST_REM_RANGE(arg0, arg1, arg2)
 #define	SLABLIST_TEST_REM_RANGE_ENABLED() (0)
 #define	SLABLIST_TEST_REMOVE_ELEM(arg0, arg1, arg2)
@@ -2400,8 +3225,12 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_TEST_RIPPLE_ADD_SUBSLAB_ENABLED() (0)
 #define	SLABLIST_TEST_RIPPLE_UPDATE_EXTREMA(arg0, arg1)
 #define	SLABLIST_TEST_RIPPLE_UPDATE_EXTREMA_ENABLED() (0)
+#define	SLABLIST_TEST_ROOT_INDEX(arg0)
+#define	SLABLIST_TEST_ROOT_INDEX_ENABLED() (0)
 #define	SLABLIST_TEST_SLAB_BIN_SRCH(arg0, arg1, arg2)
 #define	SLABLIST_TEST_SLAB_BIN_SRCH_ENABLED() (0)
+#define	SLABLIST_TEST_SLAB_FREEZE(arg0, arg1)
+#define	SLABLIST_TEST_SLAB_FREEZE_ENABLED() (0)
 #define	SLABLIST_TEST_SLAB_MOVE_NEXT(arg0, arg1, arg2, arg3, arg4, arg5)
 #define	SLABLIST_TEST_SLAB_MOVE_NEXT_ENABLED() (0)
 #define	SLABLIST_TEST_SLAB_MOVE_PREV(arg0, arg1, arg2, arg3, arg4, arg5)
@@ -2412,6 +3241,10 @@ extern int __dtraceenabled_slablist___unlink_subslab(long);
 #define	SLABLIST_TEST_SMLIST_ELEMS_SORTED_ENABLED() (0)
 #define	SLABLIST_TEST_SMLIST_NELEMS(arg0)
 #define	SLABLIST_TEST_SMLIST_NELEMS_ENABLED() (0)
+#define	SLABLIST_TEST_SPAN(arg0)
+#define	SLABLIST_TEST_SPAN_ENABLED() (0)
+#define	SLABLIST_TEST_SUBSEQ(arg0)
+#define	SLABLIST_TEST_SUBSEQ_ENABLED() (0)
 #define	SLABLIST_TEST_SUBSLAB_BIN_SRCH(arg0, arg1, arg2)
 #define	SLABLIST_TEST_SUBSLAB_BIN_SRCH_ENABLED() (0)
 #define	SLABLIST_TEST_SUBSLAB_BIN_SRCH_TOP(arg0, arg1, arg2)
@@ -52,7 +52,7 @@ small_list_rem(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 {
 
 	int ret;
-	if (sl->sl_head == NULL || sl->sl_elems == 0) {
+	if (LNK(sl->sl_head) == NULL || sl->sl_elems == 0) {
 		return (SL_EMPTY);
 	}
 
@@ -68,7 +68,7 @@ small_list_rem(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 		 * a node, if it does not know what the previous element is (as
 		 * these are nodes in a single linked list)..
 		 */
-		small_list_t *sml = sl->sl_head;
+		small_list_t *sml = LNK(sl->sl_head);
 		uint64_t i = 0;
 		while (i < sl->sl_elems) {
 			/*
@@ -76,7 +76,7 @@ small_list_rem(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 			 * unlink it, free it, and set rdl to that elem.
 			 * Otherwise, we go to the next element.
 			 */
-			if (sl->sl_cmp_elem(elem, sml->sml_data) == 0) {
+			if (SL_CMPF(sl)(elem, sml->sml_data) == 0) {
 				*rdl = sml->sml_data;
 				unlink_sml_node(sl, prev);
 				rm_sml_node(sml);
@@ -84,7 +84,7 @@ small_list_rem(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 				goto end;
 			} else {
 				prev = sml;
-				sml = sml->sml_next;
+				sml = LNK(sml->sml_next);
 			}
 			i++;
 		}
@@ -99,7 +99,7 @@ small_list_rem(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 
 	} else {
 
-		small_list_t *sml = sl->sl_head;
+		small_list_t *sml = LNK(sl->sl_head);
 
 
 		if (sl->sl_elems < pos && !SLIST_IS_CIRCULAR(sl->sl_flags)) {
@@ -117,7 +117,7 @@ small_list_rem(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 		uint64_t i = 0;
 		while (i < mod) {
 			prev = sml;
-			sml = sml->sml_next;
+			sml = LNK(sml->sml_next);
 			i++;
 		}
 		*rdl = sml->sml_data;
@@ -161,7 +161,7 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 	uint64_t cpelems;			/* elems to copy */
 	uint64_t from = 0;			/* ix to start cping from */
 	size_t sz = sizeof (void *);
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 
 	if (!melems) {
 		return;
@@ -190,12 +190,12 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 		sncp = mk_subslab();
 		sa = mk_subarr();
 		sna = mk_subarr();
-		bcopy(s->ss_arr, sa, sizeof (subarr_t));
-		bcopy(sn->ss_arr, sna, sizeof (subarr_t));
+		bcopy(LNK(s->ss_arr), sa, sizeof (subarr_t));
+		bcopy(LNK(sn->ss_arr), sna, sizeof (subarr_t));
 		bcopy(s, scp, sizeof (subslab_t));
 		bcopy(sn, sncp, sizeof (subslab_t));
-		scp->ss_arr = sa;
-		sncp->ss_arr = sna;
+		scp->ss_arr = MKLNK(sa);
+		sncp->ss_arr = MKLNK(sna);
 		test_data_allocated++;
 	}
 
@@ -204,7 +204,7 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 	 * which necessarily come before the elements in the slab. We also want
 	 * to give preference to the slab with the most free space.
 	 */
-	bcopy(&(GET_SUBSLAB_ELEM(sn, 0)), &(GET_SUBSLAB_ELEM(sn, cpelems)),
+	bcopy(&SUBSLAB_ELEMS(sn)[0], &SUBSLAB_ELEMS(sn)[cpelems],
 	    nelems*sz);
 
 
@@ -218,7 +218,7 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 		while (i < (from + cpelems)) {
 			slab_t *slab = GET_SUBSLAB_ELEM(s, i);
 			sum_usr_elems += slab->s_elems;
-			slab->s_below = sn;
+			slab->s_below = MKLNK(sn);
 			SLABLIST_SLAB_SET_BELOW(slab);
 			i++;
 		}
@@ -226,7 +226,7 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 		while (i < (from + cpelems)) {
 			subslab_t *ss = GET_SUBSLAB_ELEM(s, i);
 			sum_usr_elems += ss->ss_usr_elems;
-			ss->ss_below = sn;
+			ss->ss_below = MKLNK(sn);
 			SLABLIST_SUBSLAB_SET_BELOW(sn);
 			i++;
 		}
@@ -236,7 +236,7 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 	/*
 	 * We actually move the elems from s to sn
 	 */
-	bcopy(&(GET_SUBSLAB_ELEM(s, from)), &(GET_SUBSLAB_ELEM(sn, 0)),
+	bcopy(&SUBSLAB_ELEMS(s)[from], &SUBSLAB_ELEMS(sn)[0],
 	    cpelems*sz);
 
 	/*
@@ -247,13 +247,15 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 	subslab_t *q = sn;
 	while (p != NULL) {
 		p->ss_usr_elems -= sum_usr_elems;
+		p->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(p);
-		p = p->ss_below;
+		p = LNK(p->ss_below);
 	}
 	while (q != NULL) {
 		q->ss_usr_elems += sum_usr_elems;
+		q->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(q);
-		q = q->ss_below;
+		q = LNK(q->ss_below);
 	}
 
 	sn->ss_elems = sn->ss_elems + cpelems;
@@ -308,11 +310,11 @@ sub_move_to_next(subslab_t *s, subslab_t *sn)
 	SLABLIST_SUBSLAB_DEC_ELEMS(s);
 	SLABLIST_SUBSLAB_SET_MAX(s);
 	SLABLIST_SUBSLAB_SET_MIN(sn);
-	if (sn->ss_below != NULL) {
+	if (LNK(sn->ss_below) != NULL) {
 		if (s->ss_elems > 0) {
-			ripple_update_extrema(s->ss_below);
+			ripple_update_extrema(LNK(s->ss_below));
 		}
-		ripple_update_extrema(sn->ss_below);
+		ripple_update_extrema(LNK(sn->ss_below));
 	}
 }
 
@@ -324,7 +326,7 @@ sub_move_to_prev(subslab_t *s, subslab_t *sp)
 	uint64_t cpelems = 0;			/* elems to cp */
 	uint64_t from = s->ss_elems - 1;	/* we copy from end to front */
 	size_t sz = sizeof (slablist_elem_t);
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 
 	if (!melems) {
 		return;
@@ -353,12 +355,12 @@ sub_move_to_prev(subslab_t *s, subslab_t *sp)
 		spcp = mk_subslab();
 		sa = mk_subarr();
 		spa = mk_subarr();
-		bcopy(s->ss_arr, sa, sizeof (subarr_t));
-		bcopy(sp->ss_arr, spa, sizeof (subarr_t));
+		bcopy(LNK(s->ss_arr), sa, sizeof (subarr_t));
+		bcopy(LNK(sp->ss_arr), spa, sizeof (subarr_t));
 		bcopy(s, scp, sizeof (subslab_t));
 		bcopy(sp, spcp, sizeof (subslab_t));
-		scp->ss_arr = sa;
-		spcp->ss_arr = spa;
+		scp->ss_arr = MKLNK(sa);
+		spcp->ss_arr = MKLNK(spa);
 		test_data_allocated++;
 	}
 
@@ -371,7 +373,7 @@ sub_move_to_prev(subslab_t *s, subslab_t *sp)
 		while (i < cpelems) {
 			slab_t *slab = GET_SUBSLAB_ELEM(s, i);
 			sum_usr_elems += slab->s_elems;
-			slab->s_below = sp;
+			slab->s_below = MKLNK(sp);
 			SLABLIST_SLAB_SET_BELOW(slab);
 			i++;
 		}
@@ -379,7 +381,7 @@ sub_move_to_prev(subslab_t *s, subslab_t *sp)
 		while (i < cpelems) {
 			subslab_t *ss = GET_SUBSLAB_ELEM(s, i);
 			sum_usr_elems += ss->ss_usr_elems;
-			ss->ss_below = sp;
+			ss->ss_below = MKLNK(sp);
 			SLABLIST_SUBSLAB_SET_BELOW(ss);
 			i++;
 		}
@@ -387,7 +389,7 @@ sub_move_to_prev(subslab_t *s, subslab_t *sp)
 	/*
 	 * We move the elems from s to sp.
 	 */
-	bcopy(&(GET_SUBSLAB_ELEM(s, 0)), &(GET_SUBSLAB_ELEM(sp, pelems)),
+	bcopy(&SUBSLAB_ELEMS(s)[0], &SUBSLAB_ELEMS(sp)[pelems],
 	    cpelems*sz);
 
 	subslab_t *p = s;
@@ -398,18 +400,20 @@ sub_move_to_prev(subslab_t *s, subslab_t *sp)
 	 */
 	while (p != NULL) {
 		p->ss_usr_elems -= sum_usr_elems;
+		p->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(p);
-		p = p->ss_below;
+		p = LNK(p->ss_below);
 	}
 	while (q != NULL) {
 		q->ss_usr_elems += sum_usr_elems;
+		q->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(q);
-		q = q->ss_below;
+		q = LNK(q->ss_below);
 	}
 	sp->ss_elems = sp->ss_elems + cpelems;
 	s->ss_elems = s->ss_elems - cpelems;
 	/* bwd shift */
-	bcopy(&(GET_SUBSLAB_ELEM(s, cpelems)), &(GET_SUBSLAB_ELEM(s, 0)),
+	bcopy(&SUBSLAB_ELEMS(s)[cpelems], &SUBSLAB_ELEMS(s)[0],
 	    (melems-cpelems)*sz);
 
 	/*
@@ -434,34 +438,34 @@ sub_move_to_prev(subslab_t *s, subslab_t *sp)
 	subslab_t *ss1;
 	if (sl->sl_layer == 1) {
 		int last = sp->ss_elems - 1;
-		ss0 = (slab_t *)GET_SUBSLAB_ELEM(s, 0);
-		s->ss_min = ss0->s_min;
+		ss0 = (slab_t *)GET_SUBSLAB_ELEM(sp, last);
+		sp->ss_max = ss0->s_max;
 		/*
-		 * We only update the max of the middle slab if it is not
+		 * We only update the min of the middle slab if it is not
 		 * empty.
 		 */
 		if (s->ss_elems) {
-			ss0 = (slab_t *)GET_SUBSLAB_ELEM(sp, last);
-			sp->ss_max = ss0->s_max;
+			ss0 = (slab_t *)GET_SUBSLAB_ELEM(s, 0);
+			s->ss_min = ss0->s_min;
 		}
 	} else {
 		int last = sp->ss_elems - 1;
-		ss1 = (subslab_t *)GET_SUBSLAB_ELEM(s, 0);
-		s->ss_min = ss1->ss_min;
+		ss1 = (subslab_t *)GET_SUBSLAB_ELEM(sp, last);
+		sp->ss_max = ss1->ss_max;
 		/*
-		 * We only update the max of the middle subslab if it
+		 * We only update the min of the middle subslab if it
 		 * is not empty.
 		 */
 		if (s->ss_elems) {
-			ss1 = (subslab_t *)GET_SUBSLAB_ELEM(sp, last);
-			sp->ss_max = ss1->ss_max;
+			ss1 = (subslab_t *)GET_SUBSLAB_ELEM(s, 0);
+			s->ss_min = ss1->ss_min;
 		}
 	}
-	if (sp->ss_below != NULL) {
+	if (LNK(sp->ss_below) != NULL) {
 		if (s->ss_elems > 0) {
-			ripple_update_extrema(s->ss_below);
+			ripple_update_extrema(LNK(s->ss_below));
 		}
-		ripple_update_extrema(sp->ss_below);
+		ripple_update_extrema(LNK(sp->ss_below));
 	}
 	SLABLIST_SUBSLAB_INC_ELEMS(sp);
 	SLABLIST_SUBSLAB_DEC_ELEMS(s);
@@ -481,7 +485,6 @@ move_to_next(slab_t *s, slab_t *sn)
 	uint64_t melems = s->s_elems;		/* elems in mid slab */
 	uint64_t cpelems;			/* elems to copy */
 	uint64_t from = 0;			/* ix to start cping from */
-	size_t sz = sizeof (slablist_elem_t);
 
 	if (!melems) {
 		return;
@@ -504,10 +507,10 @@ move_to_next(slab_t *s, slab_t *sn)
 	 * copied, we make copies of the slabs before they get modified.
 	 */
 	if (SLABLIST_TEST_SLAB_MOVE_NEXT_ENABLED()) {
-		scp = mk_slab();
-		sncp = mk_slab();
-		bcopy(s, scp, sizeof (slab_t));
-		bcopy(sn, sncp, sizeof (slab_t));
+		scp = mk_slab(SLIST_SLAB_BYTES(LNK(s->s_list)));
+		sncp = mk_slab(SLIST_SLAB_BYTES(LNK(s->s_list)));
+		bcopy(s, scp, SLIST_SLAB_BYTES(LNK(s->s_list)));
+		bcopy(sn, sncp, SLIST_SLAB_BYTES(LNK(s->s_list)));
 		test_data_allocated++;
 	}
 
@@ -516,32 +519,36 @@ move_to_next(slab_t *s, slab_t *sn)
 	 * which necessarily come before the elements in the slab. We also want
 	 * to give preference to the slab with the most free space.
 	 */
-	bcopy(&(sn->s_arr[0]), &(sn->s_arr[cpelems]), nelems*sz);
+	slab_move(sn, 0, sn, cpelems, nelems);
 
 
 	/*
 	 * We actually move the elems from s to sn.
 	 */
-	bcopy(&(s->s_arr[from]), &(sn->s_arr[0]), cpelems*sz);
+	slab_move(s, from, sn, 0, cpelems);
 	sn->s_elems = sn->s_elems + cpelems;
 	s->s_elems = s->s_elems - cpelems;
+	SLAB_SET_DIRTY(s);
+	SLAB_SET_DIRTY(sn);
 
 	/*
 	 * We update the ss_usr_elems count for all of the subslabs below s and
 	 * sn.
 	 */
 	uint64_t sum_usr_elems = cpelems;
-	subslab_t *p = s->s_below;
-	subslab_t *q = sn->s_below;
+	subslab_t *p = LNK(s->s_below);
+	subslab_t *q = LNK(sn->s_below);
 	while (p != NULL) {
 		p->ss_usr_elems -= sum_usr_elems;
+		p->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(p);
-		p = p->ss_below;
+		p = LNK(p->ss_below);
 	}
 	while (q != NULL) {
 		q->ss_usr_elems += sum_usr_elems;
+		q->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(q);
-		q = q->ss_below;
+		q = LNK(q->ss_below);
 	}
 
 	/*
@@ -556,18 +563,18 @@ move_to_next(slab_t *s, slab_t *sn)
 
 	if (test_data_allocated) {
 		test_data_allocated--;
-		rm_slab(scp);
-		rm_slab(sncp);
+		rm_slab(scp, SLIST_SLAB_BYTES(LNK(s->s_list)));
+		rm_slab(sncp, SLIST_SLAB_BYTES(LNK(s->s_list)));
 	}
 
-	sn->s_min = sn->s_arr[0];
-	s->s_max = s->s_arr[(s->s_elems - 1)];
+	sn->s_min = SLAB_GET(sn, 0);
+	s->s_max = SLAB_GET(s, (s->s_elems - 1));
 	SLABLIST_SLAB_INC_ELEMS(sn);
 	SLABLIST_SLAB_DEC_ELEMS(s);
 	SLABLIST_SLAB_SET_MAX(s);
 	SLABLIST_SLAB_SET_MIN(sn);
-	ripple_update_extrema(s->s_below);
-	ripple_update_extrema(sn->s_below);
+	ripple_update_extrema(LNK(s->s_below));
+	ripple_update_extrema(LNK(sn->s_below));
 }
 
 /*
@@ -582,7 +589,6 @@ move_to_prev(slab_t *s, slab_t *sp)
 	uint64_t melems = s->s_elems;		/* elems in middle slab */
 	uint64_t cpelems = 0;			/* elems to cp */
 	uint64_t from = s->s_elems - 1;		/* we copy from end to front */
-	size_t sz = sizeof (slablist_elem_t);
 
 	if (!melems) {
 		return;
@@ -605,37 +611,41 @@ move_to_prev(slab_t *s, slab_t *sp)
 	 * copied, we make copies of the slabs before they get modified.
 	 */
 	if (SLABLIST_TEST_SLAB_MOVE_PREV_ENABLED()) {
-		scp = mk_slab();
-		spcp = mk_slab();
-		bcopy(s, scp, sizeof (slab_t));
-		bcopy(sp, spcp, sizeof (slab_t));
+		scp = mk_slab(SLIST_SLAB_BYTES(LNK(s->s_list)));
+		spcp = mk_slab(SLIST_SLAB_BYTES(LNK(s->s_list)));
+		bcopy(s, scp, SLIST_SLAB_BYTES(LNK(s->s_list)));
+		bcopy(sp, spcp, SLIST_SLAB_BYTES(LNK(s->s_list)));
 		test_data_allocated++;
 	}
 
 	/*
 	 * We move the elems from s to sp.
 	 */
-	bcopy((s->s_arr), (sp->s_arr + pelems), cpelems*sz);
+	slab_move(s, 0, sp, pelems, cpelems);
 	sp->s_elems = sp->s_elems + cpelems;
 	s->s_elems = s->s_elems - cpelems;
+	SLAB_SET_DIRTY(s);
+	SLAB_SET_DIRTY(sp);
 	/* bwd shift */
-	bcopy((s->s_arr + cpelems), (s->s_arr), (melems-cpelems)*sz);
+	slab_move(s, cpelems, s, 0, melems - cpelems);
 	/*
 	 * We update the ss_usr_elems count for all of the subslabs below s and
 	 * sp.
 	 */
 	uint64_t sum_usr_elems = cpelems;
-	subslab_t *p = s->s_below;
-	subslab_t *q = sp->s_below;
+	subslab_t *p = LNK(s->s_below);
+	subslab_t *q = LNK(sp->s_below);
 	while (p != NULL) {
 		p->ss_usr_elems -= sum_usr_elems;
+		p->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(p);
-		p = p->ss_below;
+		p = LNK(p->ss_below);
 	}
 	while (q != NULL) {
 		q->ss_usr_elems += sum_usr_elems;
+		q->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(q);
-		q = q->ss_below;
+		q = LNK(q->ss_below);
 	}
 
 	/*
@@ -650,20 +660,20 @@ move_to_prev(slab_t *s, slab_t *sp)
 
 	if (test_data_allocated) {
 		test_data_allocated--;
-		rm_slab(scp);
-		rm_slab(spcp);
+		rm_slab(scp, SLIST_SLAB_BYTES(LNK(s->s_list)));
+		rm_slab(spcp, SLIST_SLAB_BYTES(LNK(s->s_list)));
 	}
 
-	s->s_min = s->s_arr[0];
-	sp->s_min = sp->s_arr[0];
-	sp->s_max = sp->s_arr[(sp->s_elems - 1)];
-	s->s_max = s->s_arr[(s->s_elems - 1)];
+	s->s_min = SLAB_GET(s, 0);
+	sp->s_min = SLAB_GET(sp, 0);
+	sp->s_max = SLAB_GET(sp, (sp->s_elems - 1));
+	s->s_max = SLAB_GET(s, (s->s_elems - 1));
 	SLABLIST_SLAB_INC_ELEMS(sp);
 	SLABLIST_SLAB_DEC_ELEMS(s);
 	SLABLIST_SLAB_SET_MAX(sp);
 	SLABLIST_SLAB_SET_MIN(s);
-	ripple_update_extrema(s->s_below);
-	ripple_update_extrema(sp->s_below);
+	ripple_update_extrema(LNK(s->s_below));
+	ripple_update_extrema(LNK(sp->s_below));
 }
 
 /*
@@ -695,28 +705,29 @@ slab_generic_rem(slab_t *sm, subslab_t **below)
 	 * though it hasn't been emptied.
 	 */
 	slab_t *uls = NULL;
-	slablist_t *sl = sm->s_list;
-	*below = sm->s_below;
+	slablist_t *sl = LNK(sm->s_list);
+	*below = LNK(sm->s_below);
 
 	/*
-	 * If the slab becomes empty we can free it right away.
+	 * If we have only one slab, there is nothing for us to do and
+	 * we return from the function. This includes an emptied key-value
+	 * list, which slablist_rem_impl() turns back into a small list.
 	 */
-	if (sm->s_elems == 0) {
-		uls = sm;
-		goto end;
+	if (sl->sl_slabs == 1) {
+		return (NULL);
 	}
 
 	/*
-	 * If we have only one slab, there is nothing for us to do and
-	 * we return from the function.
+	 * If the slab becomes empty we can free it right away.
 	 */
-	if (sl->sl_slabs == 1) {
-		return (NULL);
+	if (sm->s_elems == 0) {
+		uls = sm;
+		goto end;
 	}
 
 
-	slab_t *sn = sm->s_next;
-	slab_t *sp = sm->s_prev;
+	slab_t *sn = LNK(sm->s_next);
+	slab_t *sp = LNK(sm->s_prev);
 	if (sn != NULL && sm->s_elems <= SLAB_FREE_SPACE(sn)) {
 		SLABLIST_SLAB_MOVE_MID_TO_NEXT(sl, sm, sn);
 		move_to_next(sm, sn);
@@ -767,14 +778,14 @@ end:;
 	 * we insert a NULL-check anyway. We do the same in the sublslab
 	 * analogue of this code.
 	 */
-	if (sl->sl_head != NULL && sl->sl_head == uls) {
-		sl->sl_head = uls->s_next;
+	if (LNK(sl->sl_head) != NULL && LNK(sl->sl_head) == uls) {
+		sl->sl_head = MKLNK(LNK(uls->s_next));
 	}
 
 	if (uls != NULL) {
 		SLABLIST_RIPPLE_REM_SLAB(sl, uls, *below);
 		unlink_slab(uls);
-		rm_slab(uls);
+		put_spare_slab(sl, uls);
 		SLABLIST_SLAB_RM(sl);
 	}
 
@@ -790,8 +801,8 @@ subslab_generic_rem(subslab_t *sm, subslab_t **below)
 	 * though it hasn't been emptied.
 	 */
 	subslab_t *uls = NULL;
-	slablist_t *sl = sm->ss_list;
-	*below = sm->ss_below;
+	slablist_t *sl = LNK(sm->ss_list);
+	*below = LNK(sm->ss_below);
 
 	/*
 	 * If the slab becomes empty we can free it right away.
@@ -810,8 +821,8 @@ subslab_generic_rem(subslab_t *sm, subslab_t **below)
 	}
 
 
-	subslab_t *sn = sm->ss_next;
-	subslab_t *sp = sm->ss_prev;
+	subslab_t *sn = LNK(sm->ss_next);
+	subslab_t *sp = LNK(sm->ss_prev);
 	if (sn != NULL && sm->ss_elems <= SUBSLAB_FREE_SPACE(sn)) {
 		SLABLIST_SUBSLAB_MOVE_MID_TO_NEXT(sl, sm, sn);
 		sub_move_to_next(sm, sn);
@@ -860,15 +871,14 @@ end:;
 	 * we insert a NULL-check anyway. We do the same in the slab analogue
 	 * of this code.
 	 */
-	if (sl->sl_head != NULL && sl->sl_head == uls) {
-		sl->sl_head = uls->ss_next;
+	if (LNK(sl->sl_head) != NULL && LNK(sl->sl_head) == uls) {
+		sl->sl_head = MKLNK(LNK(uls->ss_next));
 	}
 
 	if (uls != NULL) {
 		SLABLIST_RIPPLE_REM_SUBSLAB(sl, uls, *below);
 		unlink_subslab(uls);
-		rm_subarr(uls->ss_arr);
-		rm_subslab(uls);
+		put_spare_subslab(sl, uls);
 		SLABLIST_SUBSLAB_RM(sl);
 	}
 
@@ -876,7 +886,7 @@ end:;
 }
 
 /*
- * This function, given an index (0..SELEM_MAX), removes the elment at that
+ * This function, given an index (0..SLAB_ELEM_MAX(s)), removes the elment at that
  * index and shifts all the elements _after_ that element to the left.
  */
 static void
@@ -886,40 +896,41 @@ remove_elem(uint64_t i, slab_t *s)
 		int f = test_remove_elem(i, s);
 		SLABLIST_TEST_REMOVE_ELEM(f, s, i);
 	}
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 
 
 	SLABLIST_BWDSHIFT_BEGIN(sl, s, i);
-	size_t sz = 8 * (s->s_elems - (i + 1));
 	if (i != (uint64_t)(s->s_elems - 1)) {
 		/*
 		 * If i is not the last element, we do a bwdshift. But if it
 		 * is, we only have to decrement s_elems.
 		 */
-		bcopy(&(s->s_arr[(i + 1)]), &(s->s_arr[i]), sz);
+		slab_move(s, i + 1, s, i, s->s_elems - (i + 1));
 	}
 	SLABLIST_BWDSHIFT_END();
 
 	s->s_elems--;
+	SLAB_SET_DIRTY(s);
 	SLABLIST_SLAB_DEC_ELEMS(s);
 
 	/*
 	 * Now we decrement the ss_usr_elems of the subslabs below s.
 	 */
-	subslab_t *ss = s->s_below;
+	subslab_t *ss = LNK(s->s_below);
 	while (ss != NULL) {
 		ss->ss_usr_elems--;
+		ss->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(ss);
-		ss = ss->ss_below;
+		ss = LNK(ss->ss_below);
 	}
 
 	if (s->s_elems && i == 0) {
-		s->s_min = s->s_arr[0];
+		s->s_min = SLAB_GET(s, 0);
 		SLABLIST_SLAB_SET_MIN(s);
 	}
 
 	if (s->s_elems && i == (s->s_elems)) {
-		s->s_max = s->s_arr[(i - 1)];
+		s->s_max = SLAB_GET(s, (i - 1));
 		SLABLIST_SLAB_SET_MAX(s);
 	}
 
@@ -930,13 +941,13 @@ remove_elem(uint64_t i, slab_t *s)
 }
 
 /*
- * This function, given an index (0..SUBELEM_MAX), removes the [sub]slab-ptr at
+ * This function, given an index (0..SUBSLAB_ELEM_MAX(s)), removes the [sub]slab-ptr at
  * that index and shifts all the [sub]slabs _after_ that [sub]slab to the left.
  */
 static void
 remove_slab(uint64_t i, subslab_t *s)
 {
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 
 	SLABLIST_SUBBWDSHIFT_BEGIN(sl, s, i);
 	size_t sz = 8 * (s->ss_elems - (i + 1));
@@ -947,7 +958,7 @@ remove_slab(uint64_t i, subslab_t *s)
 	if (i != (uint64_t)(s->ss_elems - 1)) {
 		int from = i + 1;
 		int to = i;
-		bcopy(&(GET_SUBSLAB_ELEM(s, from)), &(GET_SUBSLAB_ELEM(s, to)),
+		bcopy(&SUBSLAB_ELEMS(s)[from], &SUBSLAB_ELEMS(s)[to],
 		    sz);
 	}
 	SLABLIST_SUBBWDSHIFT_END();
@@ -1001,8 +1012,8 @@ ripple_rem_to_sublayers(slab_t *remd, subslab_t *below)
 {
 	subslab_t *e[3];
 	e[0] = below;
-	e[1] = below->ss_next;
-	e[2] = below->ss_prev;
+	e[1] = LNK(below->ss_next);
+	e[2] = LNK(below->ss_prev);
 	int epos = 0;
 	subslab_t *ss = below;
 	subslab_t *ss_below;
@@ -1039,7 +1050,7 @@ ripple_rem_to_sublayers(slab_t *remd, subslab_t *below)
 		SLABLIST_SUBSLAB_SET_MIN(ss);
 		ss->ss_max = l->s_max;
 		SLABLIST_SUBSLAB_SET_MAX(ss);
-		ss = ss->ss_below;
+		ss = LNK(ss->ss_below);
 		/*
 		 * And now we update the extrema of the subslabs that contain
 		 * subslabs.
@@ -1052,7 +1063,7 @@ ripple_rem_to_sublayers(slab_t *remd, subslab_t *below)
 			SLABLIST_SUBSLAB_SET_MIN(ss);
 			ss->ss_max = ssl->ss_max;
 			SLABLIST_SUBSLAB_SET_MAX(ss);
-			ss = ss->ss_below;
+			ss = LNK(ss->ss_below);
 		}
 		epos++;
 	}
@@ -1070,9 +1081,11 @@ ripple_rem_to_sublayers(slab_t *remd, subslab_t *below)
 void
 slablist_reap(slablist_t *sl)
 {
-	if (IS_SMALL_LIST(sl)) {
+	if (IS_SMALL_LIST(sl) || IS_MAPPED_LIST(sl)) {
 		return;
 	}
+	slablist_t *held = cow_enter(sl);
+	cow_own_all(sl);
 
 	/*
 	 * For now, we iterate over all slabs. but this is not neccessary.  We
@@ -1080,23 +1093,26 @@ slablist_reap(slablist_t *sl)
 	 * partial slabs, inclusive.
 	 */
 	SLABLIST_REAP_BEGIN(sl);
-	slab_t *s = sl->sl_head;
+	slab_t *s = LNK(sl->sl_head);
 	slab_t *sn = NULL;
 	slab_t *rmd;
 	subslab_t *below = NULL;
 	uint64_t i = 0;
 	while (i < (sl->sl_slabs - 1)) {
 		rmd = NULL;
-		sn = s->s_next;
-		if (s->s_elems < SELEM_MAX) {
+		sn = LNK(s->s_next);
+		if (s->s_elems < SLAB_ELEM_MAX(s)) {
+			s = thaw_slab(s);
+			sn = thaw_slab(sn);
 			move_to_prev(sn, s);
 			if (sn->s_elems == 0) {
 				/*
-				 * We unlink and free the slab.
+				 * We unlink and free the slab. The point of a
+				 * reap is to give memory back, so the slab
+				 * doesn't go to the spare pool.
 				 */
-				below = sn->s_below;
+				below = LNK(sn->s_below);
 				unlink_slab(sn);
-				rm_slab(sn);
 				rmd = sn;
 				SLABLIST_SLAB_RM(sl);
 				/*
@@ -1106,12 +1122,20 @@ slablist_reap(slablist_t *sl)
 				if (sl->sl_sublayers) {
 					ripple_rem_to_sublayers(rmd, below);
 				}
+				free_slab(sl, sn);
 			}
 		}
-		s = s->s_next;
+		s = LNK(s->s_next);
 		i++;
 	}
+	/*
+	 * The sublayers pool the subslabs that they lose, and earlier removals
+	 * may have filled the pool up too. We drain it for the same reason.
+	 */
+	rm_spares(sl);
+	agg_flush(sl);
 	SLABLIST_REAP_END(sl);
+	cow_exit(held);
 }
 
 void
@@ -1119,12 +1143,13 @@ update_below_usr_elems(subslab_t *s, uint64_t minus)
 {
 	while (s != NULL) {
 		s->ss_usr_elems -= minus;
+		s->ss_agg_ok = 0;
 		SLABLIST_SET_USR_ELEMS(s);
 		if (SLABLIST_TEST_REM_RANGE_ENABLED()) {
 			int f = test_rem_range_sub_slim(s);
 			SLABLIST_TEST_REM_RANGE(f, NULL, s);
 		}
-		s = s->ss_below;
+		s = LNK(s->ss_below);
 	}
 }
 
@@ -1141,19 +1166,18 @@ rem_subslabs_between(subslab_t *start, subslab_t *stop)
 	if (start == stop) {
 		return;
 	}
-	subslab_t *s = start->ss_next;
+	subslab_t *s = LNK(start->ss_next);
 	subslab_t *nx;
-	slablist_t *sl = start->ss_list;
+	slablist_t *sl = LNK(start->ss_list);
 	while (s != stop) {
-		nx = s->ss_next;
+		nx = LNK(s->ss_next);
 		sl->sl_elems -= s->ss_elems;
-		if (s->ss_below != NULL) {
-			int j = sublayer_slab_ptr_srch(s, s->ss_below);
-			remove_slab(j, s->ss_below);
+		if (LNK(s->ss_below) != NULL) {
+			int j = sublayer_slab_ptr_srch(s, LNK(s->ss_below));
+			remove_slab(j, LNK(s->ss_below));
 		}
 		unlink_subslab(s);
-		rm_subarr(s->ss_arr);
-		rm_subslab(s);
+		put_spare_subslab(sl, s);
 		s = nx;
 	}
 }
@@ -1164,22 +1188,21 @@ rem_slabs_between(slab_t *start, slab_t *stop)
 	if (start == stop) {
 		return;
 	}
-	slab_t *s = start->s_next;
+	slab_t *s = LNK(start->s_next);
 	slab_t *nx;
-	slablist_t *sl = start->s_list;
+	slablist_t *sl = LNK(start->s_list);
 	uint64_t elems;
 	while (s != stop) {
-		nx = s->s_next;
+		nx = LNK(s->s_next);
 		sl->sl_elems -= s->s_elems;
 		elems = s->s_elems;
-		s->s_elems = 0;
-		update_below_usr_elems(s->s_below, elems);
-		if (s->s_below != NULL) {
-			int j = sublayer_slab_ptr_srch(s, s->s_below);
-			remove_slab(j, s->s_below);
+		update_below_usr_elems(LNK(s->s_below), elems);
+		if (LNK(s->s_below) != NULL) {
+			int j = sublayer_slab_ptr_srch(s, LNK(s->s_below));
+			remove_slab(j, LNK(s->s_below));
 		}
 		unlink_slab(s);
-		rm_slab(s);
+		put_spare_slab(sl, s);
 		s = nx;
 	}
 }
@@ -1187,8 +1210,8 @@ rem_slabs_between(slab_t *start, slab_t *stop)
 int
 is_subslab_range(subslab_t *ss, slablist_elem_t min, slablist_elem_t max)
 {
-	if (ss->ss_list->sl_cmp_elem(min, ss->ss_min) <= 0 &&
-	    ss->ss_list->sl_cmp_elem(max, ss->ss_max) >= 0) {
+	if (SL_CMPF(LNK(ss->ss_list))(min, ss->ss_min) <= 0 &&
+	    SL_CMPF(LNK(ss->ss_list))(max, ss->ss_max) >= 0) {
 		return (1);
 	}
 	return (0);
@@ -1197,8 +1220,8 @@ is_subslab_range(subslab_t *ss, slablist_elem_t min, slablist_elem_t max)
 int
 is_slab_range(slab_t *s, slablist_elem_t min, slablist_elem_t max)
 {
-	if (s->s_list->sl_cmp_elem(min, s->s_min) <= 0 &&
-	    s->s_list->sl_cmp_elem(max, s->s_max) >= 0) {
+	if (SL_CMPF(LNK(s->s_list))(min, s->s_min) <= 0 &&
+	    SL_CMPF(LNK(s->s_list))(max, s->s_max) >= 0) {
 		return (1);
 	}
 	return (0);
@@ -1207,24 +1230,24 @@ is_slab_range(slab_t *s, slablist_elem_t min, slablist_elem_t max)
 int
 is_subslab_part_range(subslab_t *ss, slablist_elem_t min, slablist_elem_t max)
 {
-	if (ss->ss_list->sl_cmp_elem(min, ss->ss_min) > 0 &&
-	    ss->ss_list->sl_cmp_elem(max, ss->ss_max) < 0) {
+	if (SL_CMPF(LNK(ss->ss_list))(min, ss->ss_min) > 0 &&
+	    SL_CMPF(LNK(ss->ss_list))(max, ss->ss_max) < 0) {
 		return (1);
 	}
-	if (ss->ss_list->sl_cmp_elem(min, ss->ss_min) > 0 &&
-	    ss->ss_list->sl_cmp_elem(max, ss->ss_max) == 0) {
+	if (SL_CMPF(LNK(ss->ss_list))(min, ss->ss_min) > 0 &&
+	    SL_CMPF(LNK(ss->ss_list))(max, ss->ss_max) == 0) {
 		return (1);
 	}
-	if (ss->ss_list->sl_cmp_elem(min, ss->ss_min) == 0 &&
-	    ss->ss_list->sl_cmp_elem(max, ss->ss_max) < 0) {
+	if (SL_CMPF(LNK(ss->ss_list))(min, ss->ss_min) == 0 &&
+	    SL_CMPF(LNK(ss->ss_list))(max, ss->ss_max) < 0) {
 		return (1);
 	}
-	if (ss->ss_list->sl_cmp_elem(min, ss->ss_min) < 0 &&
-	    ss->ss_list->sl_cmp_elem(max, ss->ss_max) < 0) {
+	if (SL_CMPF(LNK(ss->ss_list))(min, ss->ss_min) < 0 &&
+	    SL_CMPF(LNK(ss->ss_list))(max, ss->ss_max) < 0) {
 		return (1);
 	}
-	if (ss->ss_list->sl_cmp_elem(min, ss->ss_min) > 0 &&
-	    ss->ss_list->sl_cmp_elem(max, ss->ss_max) > 0) {
+	if (SL_CMPF(LNK(ss->ss_list))(min, ss->ss_min) > 0 &&
+	    SL_CMPF(LNK(ss->ss_list))(max, ss->ss_max) > 0) {
 		return (1);
 	}
 	return (0);
@@ -1233,24 +1256,24 @@ is_subslab_part_range(subslab_t *ss, slablist_elem_t min, slablist_elem_t max)
 int
 is_slab_part_range(slab_t *s, slablist_elem_t min, slablist_elem_t max)
 {
-	if (s->s_list->sl_cmp_elem(min, s->s_min) > 0 &&
-	    s->s_list->sl_cmp_elem(max, s->s_max) < 0) {
+	if (SL_CMPF(LNK(s->s_list))(min, s->s_min) > 0 &&
+	    SL_CMPF(LNK(s->s_list))(max, s->s_max) < 0) {
 		return (1);
 	}
-	if (s->s_list->sl_cmp_elem(min, s->s_min) > 0 &&
-	    s->s_list->sl_cmp_elem(max, s->s_max) == 0) {
+	if (SL_CMPF(LNK(s->s_list))(min, s->s_min) > 0 &&
+	    SL_CMPF(LNK(s->s_list))(max, s->s_max) == 0) {
 		return (1);
 	}
-	if (s->s_list->sl_cmp_elem(min, s->s_min) == 0 &&
-	    s->s_list->sl_cmp_elem(max, s->s_max) < 0) {
+	if (SL_CMPF(LNK(s->s_list))(min, s->s_min) == 0 &&
+	    SL_CMPF(LNK(s->s_list))(max, s->s_max) < 0) {
 		return (1);
 	}
-	if (s->s_list->sl_cmp_elem(min, s->s_min) < 0 &&
-	    s->s_list->sl_cmp_elem(max, s->s_max) < 0) {
+	if (SL_CMPF(LNK(s->s_list))(min, s->s_min) < 0 &&
+	    SL_CMPF(LNK(s->s_list))(max, s->s_max) < 0) {
 		return (1);
 	}
-	if (s->s_list->sl_cmp_elem(min, s->s_min) > 0 &&
-	    s->s_list->sl_cmp_elem(max, s->s_max) > 0) {
+	if (SL_CMPF(LNK(s->s_list))(min, s->s_min) > 0 &&
+	    SL_CMPF(LNK(s->s_list))(max, s->s_max) > 0) {
 		return (1);
 	}
 	return (0);
@@ -1263,10 +1286,10 @@ remove_range_elems(slab_t *s, slablist_elem_t min, slablist_elem_t max,
 {
 	int i = slab_bin_srch(min, s);
 	int j = slab_bin_srch(max, s);
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 	if (j == s->s_elems) {
 		j--;
-	} else if (sl->sl_cmp_elem(max, s->s_arr[j]) < 0) {
+	} else if (SL_CMPF(sl)(max, SLAB_GET(s, j)) < 0) {
 		j--;
 	}
 	uint64_t tail = s->s_elems - 1 - j;
@@ -1275,19 +1298,21 @@ remove_range_elems(slab_t *s, slablist_elem_t min, slablist_elem_t max,
 		goto skip_cb;
 	}
 	while (k <= j) {
-		f(s->s_arr[k]);
+		f(SLAB_GET(s, k));
 		k++;
 	}
 skip_cb:;
 	s->s_elems -= j - i + 1;
+	sl->sl_elems -= j - i + 1;
+	SLAB_SET_DIRTY(s);
 	if (tail > 0) {
-		bcopy(s->s_arr + j + 1, s->s_arr + i, tail * 8);
+		slab_move(s, j + 1, s, i, tail);
 	}
-	s->s_min = s->s_arr[0];
-	s->s_max = s->s_arr[(s->s_elems - 1)];
-	update_below_usr_elems(s->s_below, j - i + 1);
-	if (s->s_below != NULL && s->s_below->ss_elems > 0) {
-		ripple_update_extrema(s->s_below);
+	s->s_min = SLAB_GET(s, 0);
+	s->s_max = SLAB_GET(s, (s->s_elems - 1));
+	update_below_usr_elems(LNK(s->s_below), j - i + 1);
+	if (LNK(s->s_below) != NULL && LNK(s->s_below)->ss_elems > 0) {
+		ripple_update_extrema(LNK(s->s_below));
 	}
 	if (SLABLIST_TEST_REM_RANGE_ENABLED()) {
 		int fail = test_rem_range(s);
@@ -1302,23 +1327,23 @@ decruftify_slab(slab_t *s, slablist_elem_t min, slablist_elem_t max,
 	int j;
 	int i = 0;
 	if (is_slab_range(s, min, max)) {
-		if (s->s_below != NULL) {
-			j = sublayer_slab_ptr_srch(s, s->s_below);
-			remove_slab(j, s->s_below);
+		if (LNK(s->s_below) != NULL) {
+			j = sublayer_slab_ptr_srch(s, LNK(s->s_below));
+			remove_slab(j, LNK(s->s_below));
 		}
 		if (f == NULL) {
 			goto skip_cb;
 		}
 		while (i < s->s_elems) {
-			f(s->s_arr[i]);
+			f(SLAB_ELEM(s, i));
 			i++;
 		}
 skip_cb:;
-		update_below_usr_elems(s->s_below, s->s_elems);
-		ripple_update_extrema(s->s_below);
-		s->s_list->sl_elems -= s->s_elems;
+		update_below_usr_elems(LNK(s->s_below), s->s_elems);
+		ripple_update_extrema(LNK(s->s_below));
+		LNK(s->s_list)->sl_elems -= s->s_elems;
 		unlink_slab(s);
-		rm_slab(s);
+		put_spare_slab(LNK(s->s_list), s);
 	} else if (is_slab_part_range(s, min, max)) {
 		remove_range_elems(s, min, max, f);
 	}
@@ -1332,14 +1357,13 @@ decruftify_subslab(subslab_t *s, slablist_elem_t min, slablist_elem_t max)
 	}
 	int j;
 	if (is_subslab_range(s, min, max)) {
-		if (s->ss_below != NULL) {
-			j = sublayer_slab_ptr_srch(s, s->ss_below);
-			remove_slab(j, s->ss_below);
+		if (LNK(s->ss_below) != NULL) {
+			j = sublayer_slab_ptr_srch(s, LNK(s->ss_below));
+			remove_slab(j, LNK(s->ss_below));
 		}
-		s->ss_list->sl_elems -= s->ss_elems;
+		LNK(s->ss_list)->sl_elems -= s->ss_elems;
 		unlink_subslab(s);
-		rm_subarr(s->ss_arr);
-		rm_subslab(s);
+		put_spare_subslab(LNK(s->ss_list), s);
 	}
 }
 
@@ -1354,28 +1378,28 @@ decruftify_edge_slabs(slab_t *start, slab_t *stop, slablist_elem_t min,
 	subslab_t *bstop;
 	subslab_t *p;
 	if (start == stop) {
-		bstart = start->s_below;
+		bstart = LNK(start->s_below);
 		decruftify_slab(start, min, max, f);
 		while (bstart != NULL) {
-			p = bstart->ss_below;
+			p = LNK(bstart->ss_below);
 			decruftify_subslab(bstart, min, max);
 			bstart = p;
 		}
 	} else {
-		bstart = start->s_below;
-		bstop = stop->s_below;
+		bstart = LNK(start->s_below);
+		bstop = LNK(stop->s_below);
 		decruftify_slab(start, min, max, f);
 		decruftify_slab(stop, min, max, f);
 		while (bstart != NULL) {
 			if (bstart == bstop) {
-				p = bstart->ss_below;
+				p = LNK(bstart->ss_below);
 				decruftify_subslab(bstart, min, max);
 				bstart = p;
 			} else {
-				p = bstart->ss_below;
+				p = LNK(bstart->ss_below);
 				decruftify_subslab(bstart, min, max);
 				bstart = p;
-				p = bstop->ss_below;
+				p = LNK(bstop->ss_below);
 				decruftify_subslab(bstop, min, max);
 				bstop = p;
 			}
@@ -1383,8 +1407,8 @@ decruftify_edge_slabs(slab_t *start, slab_t *stop, slablist_elem_t min,
 	}
 }
 
-int
-slablist_rem_range(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
+static int
+rem_range_impl(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
     slablist_rem_cb_t f)
 {
 	SLABLIST_REM_RANGE_BEGIN(sl, min, max);
@@ -1392,42 +1416,46 @@ slablist_rem_range(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
 		SLABLIST_REM_RANGE_END(SL_ARGORD);
 		return (SL_ARGORD);
 	}
+	if (IS_MAPPED_LIST(sl)) {
+		SLABLIST_REM_RANGE_END(SL_ERDONLY);
+		return (SL_ERDONLY);
+	}
 
 	int ret;
-	if (sl->sl_cmp_elem(min, max) == 0) {
+	if (SL_CMPF(sl)(min, max) == 0) {
 		ret = slablist_rem_impl(sl, min, 0, f);
 		SLABLIST_REM_RANGE_END(ret);
 		return (ret);
 	}
 
 	if (IS_SMALL_LIST(sl)) {
-		small_list_t *node = sl->sl_head;
+		small_list_t *node = LNK(sl->sl_head);
 		small_list_t *prev = NULL;
 		/* we find the first node */
-		while (sl->sl_cmp_elem(min, node->sml_data) > 0) {
+		while (SL_CMPF(sl)(min, node->sml_data) > 0) {
 			prev = node;
-			node = node->sml_next;
+			node = LNK(node->sml_next);
 		}
 		/* we got here so node is >= min */
 		small_list_t *to_rm = NULL;
 		int remd_head = 0;
 		/* we remove the nodes from [min, max] */
 		while (node != NULL &&
-		    sl->sl_cmp_elem(max, node->sml_data) >= 0) {
+		    SL_CMPF(sl)(max, node->sml_data) >= 0) {
 			to_rm = node;
-			node = node->sml_next;
+			node = LNK(node->sml_next);
 			rm_sml_node(to_rm);
-			if (to_rm == sl->sl_head) {
+			if (to_rm == LNK(sl->sl_head)) {
 				remd_head = 1;
 			}
 			sl->sl_elems--;
 			SLABLIST_SL_DEC_ELEMS(sl);
 		}
 		if (prev != NULL) {
-			prev->sml_next = node;
+			prev->sml_next = MKLNK(node);
 		}
 		if (remd_head) {
-			sl->sl_head = node;
+			sl->sl_head = MKLNK(node);
 		}
 		SLABLIST_REM_RANGE_END(SL_SUCCESS);
 		return (SL_SUCCESS);
@@ -1444,34 +1472,42 @@ slablist_rem_range(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
 		find_linear_scan(sl, max, &smax);
 	}
 
-	subslab_t *below_f = smin->s_below;
-	subslab_t *below_l = smax->s_below;
+	subslab_t *below_f = LNK(smin->s_below);
+	subslab_t *below_l = LNK(smax->s_below);
 	rem_slabs_between(smin, smax);
 	while (below_f != NULL) {
 		rem_subslabs_between(below_f, below_l);
-		below_f = below_f->ss_below;
-		below_l = below_l->ss_below;
+		below_f = LNK(below_f->ss_below);
+		below_l = LNK(below_l->ss_below);
 	}
 
 	/*
-	 * Now, all we have to do is handle the left over edge-slabs.
+	 * Now, all we have to do is handle the left over edge-slabs, which
+	 * have to be writable.
 	 */
+	if (smin == smax) {
+		smin = smax = thaw_slab(smin);
+	} else {
+		smin = thaw_slab(smin);
+		smax = thaw_slab(smax);
+	}
 	decruftify_edge_slabs(smin, smax, min, max, f);
 
 	/*
-	 * Remove uneccessary sublayers.
+	 * Remove uneccessary sublayers. A list that never had any has no
+	 * baselayer.
 	 */
-	bl = sl->sl_baselayer;
-	slablist_t *sup = bl->sl_superlayer;
-	uint8_t layer = bl->sl_layer;
+	bl = LNK(sl->sl_baselayer);
+	slablist_t *sup = bl == NULL ? NULL : LNK(bl->sl_superlayer);
+	uint8_t layer = bl == NULL ? 0 : bl->sl_layer;
 	while (layer > 0) {
 		if (sup->sl_slabs < sl->sl_req_sublayer) {
 			detach_sublayer(sup);
 		}
-		sup = sup->sl_superlayer;
+		sup = LNK(sup->sl_superlayer);
 		layer--;
 	}
-	if (!(IS_SMALL_LIST(sl)) && sl->sl_elems == SMELEM_MAX) {
+	if (!(IS_SMALL_LIST(sl)) && sl->sl_elems == sl->sl_smelem_max) {
 		/*
 		 * If we have lowered the number of elems to 1/2 a slab, we
 		 * turn the slab into a small linked list.
@@ -1482,6 +1518,33 @@ slablist_rem_range(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
 	return (SL_SUCCESS);
 }
 
+int
+slablist_rem_range(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
+    slablist_rem_cb_t f)
+{
+	int mtook = mvcc_enter(sl);
+	slablist_t *held = cow_enter(sl);
+	cow_own(sl, COW_RANGE, min, max);
+	int took = shm_enter(sl, 1);
+	uint64_t before = sl->sl_elems;
+	int ret = SL_SUCCESS;
+	if (sl->sl_log != NULL) {
+		ret = log_append(sl, SL_LOG_REM_RANGE, min, max, 0);
+	}
+	if (ret == SL_SUCCESS) {
+		ret = rem_range_impl(sl, min, max, f);
+		bloom_rem(sl, before);
+		agg_flush(sl);
+		if (ret != SL_SUCCESS && sl->sl_log != NULL) {
+			log_cancel(sl);
+		}
+	}
+	shm_exit(sl, took);
+	cow_exit(held);
+	mvcc_exit(sl, mtook);
+	return (ret);
+}
+
 /*
  * Implements the removal logic for `slablist_rem()` and for some calls of
  * `slablist_rem_range()`.
@@ -1497,14 +1560,13 @@ slablist_rem_impl(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 	slab_t *s = NULL;
 	int i;
 	int ret = 0;
-	slab_t *found = NULL;
 
 
 	/*
 	 * If we have lowered the number of elems to 1/2 a slab, we turn the
 	 * slab into a small linked list.
 	 */
-	if (!(IS_SMALL_LIST(sl)) && sl->sl_elems == SMELEM_MAX) {
+	if (!(IS_SMALL_LIST(sl)) && sl->sl_elems == sl->sl_smelem_max) {
 		slab_to_small_list(sl);
 	}
 
@@ -1528,16 +1590,7 @@ slablist_rem_impl(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 
 		SLABLIST_REM_BEGIN(sl, elem, pos);
 
-		if (sl->sl_sublayers) {
-
-			find_bubble_up(sl, elem, &found);
-			s = found;
-
-		} else {
-
-			find_linear_scan(sl, elem, &s);
-
-		}
+		find_slab(sl, elem, &s);
 
 		i = slab_bin_srch(elem, s);
 
@@ -1545,7 +1598,8 @@ slablist_rem_impl(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 		 * If the element was not found, we have nothing to remove, and
 		 * return.
 		 */
-		if (sl->sl_cmp_elem(s->s_arr[i], elem) != 0) {
+		if (i == s->s_elems ||
+		    SL_CMPF(sl)(SLAB_ELEM(s, i), elem) != 0) {
 			rdl.sle_u = 0;
 
 			ret = SL_ENFOUND;
@@ -1560,7 +1614,12 @@ slablist_rem_impl(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 		i = off_pos;
 	}
 
-	rdl = s->s_arr[i];
+	/*
+	 * slab_generic_rem() may move elements into or out of either
+	 * neighbour, so all three slabs have to be writable.
+	 */
+	s = thaw_slab_nbrs(s);
+	rdl = SLAB_GET(s, i);
 
 	remove_elem(i, s);
 
@@ -1569,8 +1628,8 @@ slablist_rem_impl(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 	remd = slab_generic_rem(s, &below);
 	if (sl->sl_sublayers) {
 		ripple_rem_to_sublayers(remd, below);
-		slablist_t *subl = sl->sl_baselayer;
-		slablist_t *supl = subl->sl_superlayer;
+		slablist_t *subl = LNK(sl->sl_baselayer);
+		slablist_t *supl = LNK(subl->sl_superlayer);
 		/*
 		 * If the baselayer's superlayer has < sl_req_sublayer, the
 		 * baselayer is not needed. We remove it.
@@ -1588,6 +1647,13 @@ slablist_rem_impl(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
 	if (rcb != NULL) {
 		rcb(rdl);
 	}
+	/*
+	 * A key-value list that has no elements left goes back to being an
+	 * empty small list (see slablist_create()).
+	 */
+	if (SLIST_IS_KV(sl->sl_flags) && sl->sl_elems == 0) {
+		slab_to_small_list(sl);
+	}
 end:;
 	SLABLIST_REM_END(ret);
 
@@ -1608,7 +1674,35 @@ int
 slablist_rem(slablist_t *sl, slablist_elem_t elem, uint64_t pos,
     slablist_rem_cb_t *rcb)
 {
-	int ret = slablist_rem_impl(sl, elem, pos, rcb);
+	if (IS_MAPPED_LIST(sl)) {
+		return (SL_ERDONLY);
+	}
+	int mtook = mvcc_enter(sl);
+	slablist_t *held = cow_enter(sl);
+	slablist_elem_t p;
+	p.sle_u = pos;
+	if (SLIST_SORTED(sl->sl_flags)) {
+		cow_own(sl, COW_RANGE, elem, elem);
+	} else {
+		cow_own(sl, COW_POS, p, p);
+	}
+	int took = shm_enter(sl, 1);
+	uint64_t before = sl->sl_elems;
+	int ret = SL_SUCCESS;
+	if (sl->sl_log != NULL) {
+		ret = log_append(sl, SL_LOG_REM, elem, p, 0);
+	}
+	if (ret == SL_SUCCESS) {
+		ret = slablist_rem_impl(sl, elem, pos, rcb);
+		bloom_rem(sl, before);
+		agg_flush(sl);
+		if (ret != SL_SUCCESS && sl->sl_log != NULL) {
+			log_cancel(sl);
+		}
+	}
+	shm_exit(sl, took);
+	cow_exit(held);
+	mvcc_exit(sl, mtook);
 	return (ret);
 }
 
@@ -1635,8 +1729,8 @@ slablist_xtract_simple(slablist_t *sl, char *nm, slablist_elem_t start,
 		slablist_bm_destroy(bm);
 		bm = slablist_bm_create();
 		int pos = 0;
-		slablist_t *nsl = slablist_create(nm, sl->sl_cmp_elem,
-		    sl->sl_bnd_elem, sl->sl_flags);
+		slablist_t *nsl = slablist_create(nm, SL_CMPF(sl),
+		    SL_BNDF(sl), sl->sl_flags);
 		while (!first) {
 			(void) slablist_next(sl, bm, next);
 			pos++;
@@ -1685,6 +1779,9 @@ slablist_xtract(slablist_t *sl, char *nm, slablist_elem_t start,
 	 * relinked whole-sale, removing the need to call slablist_add() which
 	 * re-creates those slabs and nodes from scratch.
 	 */
+	if (IS_MAPPED_LIST(sl) || SLIST_IS_KV(sl->sl_flags)) {
+		return (NULL);
+	}
 	slablist_t *ret = slablist_xtract_simple(sl, nm, start, end);
 	return (ret);
 }
@@ -78,6 +78,20 @@
 #define	E_TEST_ELEM_POS			46
 #define	E_TEST_SLAB_BELOW		47
 #define	E_TEST_FBU_NOT_LAYERED		48
+#define	E_TEST_SLAB_FREEZE		49
+#define	E_TEST_MAPPED_ELEMS		50
+#define	E_TEST_CLONE_SHARED		51
+#define	E_TEST_CLONE_DIFFERS		52
+#define	E_TEST_BLOOM_FALSE_NEG		53
+#define	E_TEST_ROOT_INDEX		54
+#define	E_TEST_SUBSLAB_AGG		55
+#define	E_TEST_AGGREGATE		56
+#define	E_TEST_RANK			57
+#define	E_TEST_BOUND			58
+#define	E_TEST_SPAN			59
+#define	E_TEST_SUBSEQ			60
+#define	E_TEST_SLAB_PFX			61
+#define	E_TEST_SLAB_AGG			62
 
 int
 test_slab_get_elem_pos(slablist_t *sl, slab_t *s, slab_t **f, uint64_t pos,
@@ -98,12 +112,12 @@ test_slab_to_sml(slablist_t *sl, slab_t *s)
 {
 	uint64_t elems = sl->sl_elems;
 	uint64_t i = 0;
-	small_list_t *sml = sl->sl_head;
+	small_list_t *sml = LNK(sl->sl_head);
 	while (i < elems) {
-		if (sl->sl_cmp_elem(s->s_arr[i], sml->sml_data) != 0) {
+		if (SL_CMPF(sl)(SLAB_ELEM(s, i), sml->sml_data) != 0) {
 			return (1);
 		}
-		sml = sml->sml_next;
+		sml = LNK(sml->sml_next);
 		i++;
 	}
 
@@ -115,13 +129,13 @@ test_smlist_nelems(slablist_t *sl)
 {
 
 	uint64_t i = 0;
-	small_list_t *sml = sl->sl_head;
+	small_list_t *sml = LNK(sl->sl_head);
 
 
 
 	if (sl->sl_elems) {
 		while (i < (sl->sl_elems - 1)) {
-			sml = sml->sml_next;
+			sml = LNK(sml->sml_next);
 			if (sml == NULL) {
 				return (1);
 			}
@@ -140,7 +154,7 @@ int
 test_smlist_elems_sorted(slablist_t *sl)
 {
 	uint64_t i = 0;
-	small_list_t *sml = sl->sl_head;
+	small_list_t *sml = LNK(sl->sl_head);
 	small_list_t *prev = NULL;
 
 	if (sl->sl_elems <= 1 || !(SLIST_SORTED(sl->sl_flags))) {
@@ -152,10 +166,10 @@ test_smlist_elems_sorted(slablist_t *sl)
 
 	while (i < (sl->sl_elems - 1)) {
 		prev = sml;
-		sml = sml->sml_next;
+		sml = LNK(sml->sml_next);
 		e1 = prev->sml_data;
 		e2 = sml->sml_data;
-		if (sl->sl_cmp_elem(e1, e2) > 0) {
+		if (SL_CMPF(sl)(e1, e2) > 0) {
 			return (1);
 		}
 		i++;
@@ -168,7 +182,7 @@ slab_t *
 get_first_slab(subslab_t *baseslab)
 {
 	int layer = 0;
-	int layers = baseslab->ss_list->sl_layer;
+	int layers = LNK(baseslab->ss_list)->sl_layer;
 	subslab_t *s = baseslab;
 	while (layer < layers - 1) {
 		s = GET_SUBSLAB_ELEM(s, 0);
@@ -182,7 +196,7 @@ slab_t *
 get_last_slab(subslab_t *baseslab)
 {
 	int layer = 0;
-	int layers = baseslab->ss_list->sl_layer;
+	int layers = LNK(baseslab->ss_list)->sl_layer;
 	subslab_t *s = baseslab;
 	int last;
 	while (layer < layers - 1) {
@@ -202,8 +216,8 @@ test_slab_extrema(slab_t *s)
 	uint32_t elems = s->s_elems;
 
 	/* test that extrema match the actual elems in the array */
-	if ((s->s_min.sle_u != s->s_arr[0].sle_u ||
-	    s->s_max.sle_u != s->s_arr[(elems - 1)].sle_u)) {
+	if ((s->s_min.sle_u != SLAB_ELEM(s, 0).sle_u ||
+	    s->s_max.sle_u != SLAB_ELEM(s, (elems - 1)).sle_u)) {
 		return (E_TEST_SLAB_EXTREMA);
 	}
 
@@ -217,7 +231,7 @@ test_subslab_usr_elems(subslab_t *ss)
 	uint64_t sum = 0;
 	subslab_t *sref = NULL;
 	slab_t *ref = NULL;
-	if (ss->ss_list->sl_layer > 1) {
+	if (LNK(ss->ss_list)->sl_layer > 1) {
 		while (i < ss->ss_elems) {
 			sref = GET_SUBSLAB_ELEM(ss, i);
 			sum += sref->ss_usr_elems;
@@ -245,13 +259,13 @@ test_subslab_extrema(subslab_t *ss)
 {
 	slab_t *f = get_first_slab(ss);
 	SLABLIST_EXTREME_SLAB(f);
-	slablist_t *top_lyr = f->s_list;
+	slablist_t *top_lyr = LNK(f->s_list);
 
-	if (top_lyr->sl_cmp_elem(ss->ss_min, f->s_min) != 0) {
+	if (SL_CMPF(top_lyr)(ss->ss_min, f->s_min) != 0) {
 		return (E_TEST_SUBSLAB_MIN);
 	}
 
-	if (top_lyr->sl_cmp_elem(ss->ss_min, f->s_arr[0]) != 0) {
+	if (SL_CMPF(top_lyr)(ss->ss_min, SLAB_ELEM(f, 0)) != 0) {
 		return (E_TEST_SUBSLAB_ARR_MIN);
 	}
 
@@ -259,11 +273,11 @@ test_subslab_extrema(subslab_t *ss)
 	slab_t *l = get_last_slab(ss);
 	SLABLIST_EXTREME_SLAB(l);
 	uint32_t lelems = l->s_elems;
-	if (top_lyr->sl_cmp_elem(ss->ss_max, l->s_max) != 0) {
+	if (SL_CMPF(top_lyr)(ss->ss_max, l->s_max) != 0) {
 		return (E_TEST_SUBSLAB_MAX);
 	}
 
-	if (top_lyr->sl_cmp_elem(ss->ss_max, l->s_arr[(lelems - 1)]) != 0) {
+	if (SL_CMPF(top_lyr)(ss->ss_max, SLAB_ELEM(l, (lelems - 1))) != 0) {
 		return (E_TEST_SUBSLAB_ARR_MAX);
 	}
 
@@ -279,11 +293,11 @@ test_slab(slab_t *s)
 	}
 
 	/* test that the list back-ptr is not NULL */
-	if (s->s_list == NULL) {
+	if (LNK(s->s_list) == NULL) {
 		return (E_TEST_SLAB_LIST_NULL);
 	}
 
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 
 	uint32_t elems = s->s_elems;
 
@@ -297,7 +311,7 @@ test_slab(slab_t *s)
 	}
 
 	/* test that this slab has a pointer to its subslab */
-	if (sl->sl_sublayers && s->s_below == NULL) {
+	if (sl->sl_sublayers && LNK(s->s_below) == NULL) {
 		return (E_TEST_SLAB_BELOW);
 	}
 
@@ -306,14 +320,25 @@ test_slab(slab_t *s)
 		return (f);
 	}
 
+	/* test that the prefixes are those of the elems */
+	if (SLIST_HAS_PFX(sl)) {
+		uint64_t j = 0;
+		while (j < elems) {
+			if (SLAB_PFX(s, j) != sl->sl_pfx(SLAB_GET(s, j))) {
+				return (E_TEST_SLAB_PFX);
+			}
+			j++;
+		}
+	}
+
 	/* test that elems are sorted within a slab */
 	if (elems > 1) {
 		uint64_t j = 0;
 		elems = s->s_elems;
 		while (j < (elems - 1)) {
-			slablist_elem_t e1 = s->s_arr[j];
-			slablist_elem_t e2 = s->s_arr[(j+1)];
-			int c = sl->sl_cmp_elem(e1, e2);
+			slablist_elem_t e1 = SLAB_ELEM(s, j);
+			slablist_elem_t e2 = SLAB_ELEM(s, (j+1));
+			int c = SL_CMPF(sl)(e1, e2);
 			if (c > 0) {
 				return (E_TEST_SLAB_UNSORTED);
 			}
@@ -325,20 +350,20 @@ test_slab(slab_t *s)
 	 * test that the slab is greater than the prev slab and less than the
 	 * next slab
 	 */
-	if (s->s_prev != NULL) {
-		if (sl->sl_cmp_elem(s->s_prev->s_max, s->s_min) > 0 ||
-		    sl->sl_cmp_elem(s->s_prev->s_max, s->s_max) > 0 ||
-		    sl->sl_cmp_elem(s->s_prev->s_min, s->s_min) > 0 ||
-		    sl->sl_cmp_elem(s->s_prev->s_min, s->s_max) > 0) {
+	if (LNK(s->s_prev) != NULL) {
+		if (SL_CMPF(sl)(LNK(s->s_prev)->s_max, s->s_min) > 0 ||
+		    SL_CMPF(sl)(LNK(s->s_prev)->s_max, s->s_max) > 0 ||
+		    SL_CMPF(sl)(LNK(s->s_prev)->s_min, s->s_min) > 0 ||
+		    SL_CMPF(sl)(LNK(s->s_prev)->s_min, s->s_max) > 0) {
 			return (E_TEST_SLAB_PREV);
 		}
 	}
 
-	if (s->s_next != NULL) {
-		if (sl->sl_cmp_elem(s->s_next->s_max, s->s_min) < 0 ||
-		    sl->sl_cmp_elem(s->s_next->s_max, s->s_max) < 0 ||
-		    sl->sl_cmp_elem(s->s_next->s_min, s->s_min) < 0 ||
-		    sl->sl_cmp_elem(s->s_next->s_min, s->s_max) < 0) {
+	if (LNK(s->s_next) != NULL) {
+		if (SL_CMPF(sl)(LNK(s->s_next)->s_max, s->s_min) < 0 ||
+		    SL_CMPF(sl)(LNK(s->s_next)->s_max, s->s_max) < 0 ||
+		    SL_CMPF(sl)(LNK(s->s_next)->s_min, s->s_min) < 0 ||
+		    SL_CMPF(sl)(LNK(s->s_next)->s_min, s->s_max) < 0) {
 			return (E_TEST_SLAB_NEXT);
 		}
 	}
@@ -355,15 +380,15 @@ test_subslab(subslab_t *s)
 	}
 
 	/* test that the list back-ptr is not NULL */
-	if (s->ss_list == NULL) {
+	if (LNK(s->ss_list) == NULL) {
 		return (E_TEST_SUBSLAB_LIST_NULL);
 	}
 
-	if (s->ss_arr == NULL) {
+	if (LNK(s->ss_arr) == NULL) {
 		return (E_TEST_SUBSLAB_SUBARR_NULL);
 	}
 
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 
 	uint32_t elems = s->ss_elems;
 
@@ -398,7 +423,7 @@ test_subslab(subslab_t *s)
 				k = j + 1;
 				slab_t *e1 = GET_SUBSLAB_ELEM(s, j);
 				slab_t *e2 = GET_SUBSLAB_ELEM(s, k);
-				int c = sl->sl_cmp_elem(e1->s_max, e2->s_max);
+				int c = SL_CMPF(sl)(e1->s_max, e2->s_max);
 				if (c > 0) {
 					return (E_TEST_SUBSLAB_UNSORTED);
 				}
@@ -412,7 +437,7 @@ test_subslab(subslab_t *s)
 				k = j + 1;
 				subslab_t *se1 = GET_SUBSLAB_ELEM(s, j);
 				subslab_t *se2 = GET_SUBSLAB_ELEM(s, k);
-				int c = sl->sl_cmp_elem(se1->ss_max,
+				int c = SL_CMPF(sl)(se1->ss_max,
 					    se2->ss_max);
 
 				if (c > 0) {
@@ -423,20 +448,20 @@ test_subslab(subslab_t *s)
 		}
 	}
 
-	if (s->ss_prev != NULL) {
-		if (sl->sl_cmp_elem(s->ss_prev->ss_max, s->ss_min) > 0 ||
-		    sl->sl_cmp_elem(s->ss_prev->ss_max, s->ss_max) > 0 ||
-		    sl->sl_cmp_elem(s->ss_prev->ss_min, s->ss_min) > 0 ||
-		    sl->sl_cmp_elem(s->ss_prev->ss_min, s->ss_max) > 0) {
+	if (LNK(s->ss_prev) != NULL) {
+		if (SL_CMPF(sl)(LNK(s->ss_prev)->ss_max, s->ss_min) > 0 ||
+		    SL_CMPF(sl)(LNK(s->ss_prev)->ss_max, s->ss_max) > 0 ||
+		    SL_CMPF(sl)(LNK(s->ss_prev)->ss_min, s->ss_min) > 0 ||
+		    SL_CMPF(sl)(LNK(s->ss_prev)->ss_min, s->ss_max) > 0) {
 			return (E_TEST_SUBSLAB_PREV);
 		}
 	}
 
-	if (s->ss_next != NULL) {
-		if (sl->sl_cmp_elem(s->ss_next->ss_max, s->ss_min) < 0 ||
-		    sl->sl_cmp_elem(s->ss_next->ss_max, s->ss_max) < 0 ||
-		    sl->sl_cmp_elem(s->ss_next->ss_min, s->ss_min) < 0 ||
-		    sl->sl_cmp_elem(s->ss_next->ss_min, s->ss_max) < 0) {
+	if (LNK(s->ss_next) != NULL) {
+		if (SL_CMPF(sl)(LNK(s->ss_next)->ss_max, s->ss_min) < 0 ||
+		    SL_CMPF(sl)(LNK(s->ss_next)->ss_max, s->ss_max) < 0 ||
+		    SL_CMPF(sl)(LNK(s->ss_next)->ss_min, s->ss_min) < 0 ||
+		    SL_CMPF(sl)(LNK(s->ss_next)->ss_min, s->ss_max) < 0) {
 			return (E_TEST_SUBSLAB_NEXT);
 		}
 	}
@@ -450,13 +475,13 @@ test_subslab_ref(subslab_t *s)
 	/* test that this subslab references all of the superslabs */
 	uint64_t j = 0;
 	uint64_t elems = s->ss_elems;
-	if (s->ss_list->sl_layer == 1) {
+	if (LNK(s->ss_list)->sl_layer == 1) {
 		slab_t *curslab = GET_SUBSLAB_ELEM(s, 0);
 		while (j < elems) {
 			if (GET_SUBSLAB_ELEM(s, j) != curslab) {
 				return (E_TEST_SUBSLAB_REFERENCES);
 			}
-			curslab = curslab->s_next;
+			curslab = LNK(curslab->s_next);
 			j++;
 		}
 	} else {
@@ -467,7 +492,7 @@ test_subslab_ref(subslab_t *s)
 			if (GET_SUBSLAB_ELEM(s, j) != cursubslab) {
 				return (E_TEST_SUBSLAB_REFERENCES);
 			}
-			cursubslab = cursubslab->ss_next;
+			cursubslab = LNK(cursubslab->ss_next);
 			j++;
 		}
 	}
@@ -541,7 +566,7 @@ test_add_elem(slab_t *s, slablist_elem_t elem, uint64_t i)
 		return (f);
 	}
 
-	slablist_t *sl = s->s_list;
+	slablist_t *sl = LNK(s->s_list);
 
 	if (s->s_elems == 0 && i > 0) {
 		return (E_TEST_INS_ELEM_INDEX);
@@ -555,20 +580,20 @@ test_add_elem(slab_t *s, slablist_elem_t elem, uint64_t i)
 	}
 
 	if (i > 0 && i <= (elems - 1)) {
-		if (sl->sl_cmp_elem(elem, s->s_arr[i]) > 0 ||
-		    sl->sl_cmp_elem(elem, s->s_arr[(i - 1)]) < 0) {
+		if (SL_CMPF(sl)(elem, SLAB_ELEM(s, i)) > 0 ||
+		    SL_CMPF(sl)(elem, SLAB_ELEM(s, (i - 1))) < 0) {
 			return (E_TEST_INS_ELEM_OUT_ORD);
 		}
 	}
 
 	if (i == elems) {
-		if (sl->sl_cmp_elem(elem, s->s_arr[(i - 1)]) < 0) {
+		if (SL_CMPF(sl)(elem, SLAB_ELEM(s, (i - 1))) < 0) {
 			return (E_TEST_INS_ELEM_OUT_ORD);
 		}
 	}
 
 	if (i == 0) {
-		if (sl->sl_cmp_elem(elem, s->s_arr[i]) > 0) {
+		if (SL_CMPF(sl)(elem, SLAB_ELEM(s, i)) > 0) {
 			return (E_TEST_INS_ELEM_OUT_ORD);
 		}
 	}
@@ -588,7 +613,7 @@ test_add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 		return (f);
 	}
 
-	slablist_t *sl = s->ss_list;
+	slablist_t *sl = LNK(s->ss_list);
 
 	if (s->ss_elems == 0 && i > 0) {
 		return (E_TEST_INS_SLAB_INDEX);
@@ -623,20 +648,20 @@ test_add_slab(subslab_t *s, slab_t *s1, subslab_t *s2, uint64_t i)
 	slab_t *next = GET_SUBSLAB_ELEM(s, i);
 	slab_t *prev = GET_SUBSLAB_ELEM(s, h);
 	if (i > 0 && i <= (elems - 1)) {
-		if (sl->sl_cmp_elem(s1->s_max, next->s_max) > 0 ||
-		    sl->sl_cmp_elem(s1->s_max, prev->s_max) < 0) {
+		if (SL_CMPF(sl)(s1->s_max, next->s_max) > 0 ||
+		    SL_CMPF(sl)(s1->s_max, prev->s_max) < 0) {
 			return (E_TEST_INS_SLAB_OUT_ORD);
 		}
 	}
 
 	if (i == elems && elems > 0) {
-		if (sl->sl_cmp_elem(s1->s_max, prev->s_max) < 0) {
+		if (SL_CMPF(sl)(s1->s_max, prev->s_max) < 0) {
 			return (E_TEST_INS_SLAB_OUT_ORD);
 		}
 	}
 
 	if (i == 0 && elems > 0) {
-		if (sl->sl_cmp_elem(s1->s_max, next->s_max) > 0) {
+		if (SL_CMPF(sl)(s1->s_max, next->s_max) > 0) {
 			return (E_TEST_INS_SLAB_OUT_ORD);
 		}
 	}
@@ -654,20 +679,20 @@ ss_test:;
 	subslab_t *snext = GET_SUBSLAB_ELEM(s, i);
 	subslab_t *sprev = GET_SUBSLAB_ELEM(s, h);
 	if (i > 0 && i <= (elems - 1)) {
-		if (sl->sl_cmp_elem(s2->ss_max, snext->ss_max) > 0 ||
-		    sl->sl_cmp_elem(s2->ss_max, sprev->ss_max) < 0) {
+		if (SL_CMPF(sl)(s2->ss_max, snext->ss_max) > 0 ||
+		    SL_CMPF(sl)(s2->ss_max, sprev->ss_max) < 0) {
 			return (E_TEST_INS_SLAB_OUT_ORD);
 		}
 	}
 
 	if (i == elems && elems > 0) {
-		if (sl->sl_cmp_elem(s2->ss_max, sprev->ss_max) < 0) {
+		if (SL_CMPF(sl)(s2->ss_max, sprev->ss_max) < 0) {
 			return (E_TEST_INS_SLAB_OUT_ORD);
 		}
 	}
 
 	if (i == 0 && elems > 0) {
-		if (sl->sl_cmp_elem(s2->ss_max, snext->ss_max) > 0) {
+		if (SL_CMPF(sl)(s2->ss_max, snext->ss_max) > 0) {
 			return (E_TEST_INS_SLAB_OUT_ORD);
 		}
 	}
@@ -686,7 +711,7 @@ test_remove_elem(uint64_t i, slab_t *s)
 	if (f != 0) {
 		return (f);
 	}
-	if (i > SELEM_MAX - 1) {
+	if (i >= (uint64_t)SLAB_ELEM_MAX(s)) {
 		return (E_TEST_REM_ELEM_BEYOND);
 	}
 	return (0);
@@ -699,7 +724,7 @@ test_remove_slab(uint64_t i, subslab_t *s)
 	if (f != 0) {
 		return (f);
 	}
-	if (i > SUBELEM_MAX - 1) {
+	if (i >= (uint64_t)SUBSLAB_ELEM_MAX(s)) {
 		return (E_TEST_REM_SLAB_BEYOND);
 	}
 	return (0);
@@ -714,7 +739,7 @@ test_ripple_add_subslab(subslab_t *new, int bc)
 	}
 
 	if (bc != 0) {
-		subslab_t *sub = new->ss_below;
+		subslab_t *sub = LNK(new->ss_below);
 		subslab_t *s = new;
 		int i = 0;
 		int has = 0;
@@ -740,7 +765,7 @@ test_ripple_add_slab(slab_t *new, slab_t *modified, int bc)
 		return (f);
 	}
 
-	subslab_t *sub = modified->s_below;
+	subslab_t *sub = LNK(modified->s_below);
 	if (bc != 0) {
 		slab_t *s = modified;
 		int i = 0;
@@ -759,6 +784,29 @@ test_ripple_add_slab(slab_t *new, slab_t *modified, int bc)
 	return (0);
 }
 
+/*
+ * Tests that the cold slab `c` decodes to exactly the elements of the hot slab
+ * `s` that it was frozen from.
+ */
+int
+test_slab_freeze(slab_t *s, slab_t *c)
+{
+	if (s->s_elems != c->s_elems) {
+		return (E_TEST_SLAB_FREEZE);
+	}
+	int i = 0;
+	while (i < s->s_elems) {
+		if (SLAB_GET(s, i).sle_u != SLAB_ELEM(c, i).sle_u) {
+			return (E_TEST_SLAB_FREEZE);
+		}
+		i++;
+	}
+	if (SLIST_SORTED(LNK(c->s_list)->sl_flags)) {
+		return (test_slab(c));
+	}
+	return (0);
+}
+
 int
 test_rem_range(slab_t *s)
 {
@@ -797,6 +845,499 @@ test_rem_range_sub(subslab_t *s)
 	return (0);
 }
 
+/*
+ * Tests every slab and subslab of the list `sl`, which was just loaded by
+ * slablist_load(), and returns the first failure.
+ */
+int
+test_load(slablist_t *sl)
+{
+	int f;
+	slab_t *s = LNK(sl->sl_head);
+	uint64_t i = 0;
+	while (i < sl->sl_slabs) {
+		f = test_slab(s);
+		if (f != 0) {
+			return (f);
+		}
+		s = LNK(s->s_next);
+		i++;
+	}
+	slablist_t *sub = LNK(sl->sl_sublayer);
+	while (sub != NULL) {
+		subslab_t *ss = LNK(sub->sl_head);
+		i = 0;
+		while (i < sub->sl_slabs) {
+			f = test_rem_range_sub(ss);
+			if (f == 0) {
+				f = test_subslab_ref(ss);
+			}
+			if (f != 0) {
+				return (f);
+			}
+			ss = LNK(ss->ss_next);
+			i++;
+		}
+		sub = LNK(sub->sl_sublayer);
+	}
+	return (0);
+}
+
+/*
+ * Tests every slab and index subslab of the mapped list `sl`, which was just
+ * opened by slablist_open_mapped().
+ */
+int
+test_mapped(slablist_t *sl)
+{
+	slablist_mhdr_t *m = sl->sl_map;
+	int sorted = SLIST_SORTED(sl->sl_flags);
+	uint64_t stride = MSLAB_BYTES(m->sm_selem_max);
+	uint64_t elems = 0;
+	uint64_t i = 0;
+	uint64_t j;
+	mslab_t *prev = NULL;
+	while (i < m->sm_slabs) {
+		mslab_t *s = MAPPED_SLAB(sl, i);
+		slablist_elem_t *arr = MSLAB_ARR(s);
+		if (s->ms_elems == 0 || s->ms_elems > m->sm_selem_max) {
+			return (E_TEST_MAPPED_ELEMS);
+		}
+		if (SL_CMPF(sl)(s->ms_min, arr[0]) != 0 ||
+		    SL_CMPF(sl)(s->ms_max, arr[s->ms_elems - 1]) != 0) {
+			return (E_TEST_SLAB_EXTREMA);
+		}
+		j = 1;
+		while (sorted && j < s->ms_elems) {
+			if (SL_CMPF(sl)(arr[j - 1], arr[j]) >= 0) {
+				return (E_TEST_SLAB_UNSORTED);
+			}
+			j++;
+		}
+		if (sorted && prev != NULL &&
+		    SL_CMPF(sl)(prev->ms_max, s->ms_min) >= 0) {
+			return (E_TEST_SLAB_UNSORTED);
+		}
+		elems += s->ms_elems;
+		prev = s;
+		i++;
+	}
+	if (elems != m->sm_elems) {
+		return (E_TEST_MAPPED_ELEMS);
+	}
+
+	uint64_t sstride = MSUBSLAB_BYTES(m->sm_subelem_max);
+	uint64_t off = m->sm_slab_off;
+	uint64_t n = m->sm_slabs;
+	uint64_t loff = off + (n * stride);
+	int layer = 0;
+	while (layer < m->sm_layers) {
+		uint64_t nsub = (n + m->sm_subelem_max - 1) /
+		    m->sm_subelem_max;
+		uint64_t c = 0;
+		i = 0;
+		while (i < nsub) {
+			msubslab_t *ss = MAPPED_AT(sl, loff + (i * sstride));
+			uint64_t *offs = MSUBSLAB_OFFS(ss);
+			uint64_t usr = 0;
+			j = 0;
+			while (j < ss->mss_elems) {
+				if (offs[j] != off + (c * stride)) {
+					return (E_TEST_SUBSLAB_REFERENCES);
+				}
+				if (layer == 0) {
+					usr += ((mslab_t *)
+					    MAPPED_AT(sl, offs[j]))->ms_elems;
+				} else {
+					usr += ((msubslab_t *)
+					    MAPPED_AT(sl, offs[j]))->mss_usr_elems;
+				}
+				c++;
+				j++;
+			}
+			mslab_t *first = MAPPED_AT(sl, offs[0]);
+			mslab_t *last = MAPPED_AT(sl, offs[ss->mss_elems - 1]);
+			if (SL_CMPF(sl)(ss->mss_min, first->ms_min) != 0) {
+				return (E_TEST_SUBSLAB_MIN);
+			}
+			if (SL_CMPF(sl)(ss->mss_max, last->ms_max) != 0) {
+				return (E_TEST_SUBSLAB_MAX);
+			}
+			if (ss->mss_usr_elems > usr) {
+				return (E_TEST_SUBSLAB_USR_ELEMS_OVER);
+			}
+			if (ss->mss_usr_elems < usr) {
+				return (E_TEST_SUBSLAB_USR_ELEMS_UNDER);
+			}
+			i++;
+		}
+		if (c != n) {
+			return (E_TEST_SUBSLAB_REFERENCES);
+		}
+		off = loff;
+		stride = sstride;
+		loff += nsub * sstride;
+		n = nsub;
+		layer++;
+	}
+	if (m->sm_layers > 0 && (m->sm_base_off != off ||
+	    m->sm_base_slabs != n)) {
+		return (E_TEST_SUBSLAB_REFERENCES);
+	}
+	return (0);
+}
+
+/*
+ * Tests the view of `sl` that cow_own() just left behind. Every layer has to
+ * link up in both directions, from its head to its end, and the children of
+ * each layer have to be the next layer up, in the same order. None of the
+ * nodes that `sl` sees can be one that it forwards to a copy.
+ */
+int
+test_clone(slablist_t *sl)
+{
+	if (IS_SMALL_LIST(sl)) {
+		return (0);
+	}
+	slablist_t *held = cow_enter(sl);
+	int ret = 0;
+	slablist_t *lay = sl;
+	while (LNK(lay->sl_sublayer) != NULL) {
+		lay = LNK(lay->sl_sublayer);
+	}
+	while (lay != NULL && ret == 0) {
+		int slabs = lay->sl_layer == 0;
+		int kids = lay->sl_layer == 1;
+		slablist_t *up = LNK(lay->sl_superlayer);
+		void *c = up == NULL ? NULL : LNK(up->sl_head);
+		void *p = NULL;
+		void *n = LNK(lay->sl_head);
+		uint64_t i = 0;
+		while (n != NULL && ret == 0) {
+			if (LNK(n) != n) {
+				ret = E_TEST_CLONE_SHARED;
+				break;
+			}
+			void *prev = slabs ?
+			    (void *)LNK(((slab_t *)n)->s_prev) :
+			    (void *)LNK(((subslab_t *)n)->ss_prev);
+			if (prev != p) {
+				ret = E_TEST_CLONE_DIFFERS;
+				break;
+			}
+			int j = 0;
+			while (!slabs && j < ((subslab_t *)n)->ss_elems) {
+				if (GET_SUBSLAB_ELEM((subslab_t *)n, j) != c) {
+					ret = E_TEST_CLONE_DIFFERS;
+					break;
+				}
+				c = kids ? (void *)LNK(((slab_t *)c)->s_next) :
+				    (void *)LNK(((subslab_t *)c)->ss_next);
+				j++;
+			}
+			p = n;
+			n = slabs ? (void *)LNK(((slab_t *)n)->s_next) :
+			    (void *)LNK(((subslab_t *)n)->ss_next);
+			i++;
+		}
+		if (ret == 0 && (i != lay->sl_slabs ||
+		    p != LNK(lay->sl_end) || c != NULL)) {
+			ret = E_TEST_CLONE_DIFFERS;
+		}
+		lay = up;
+	}
+	cow_exit(held);
+	return (ret);
+}
+
+/*
+ * Looks for `key` in every element of `sl` (the slow way), since its filter
+ * has said that `key` isn't there.
+ */
+int
+test_bloom(slablist_t *sl, slablist_elem_t key)
+{
+	uint64_t i = 0;
+	uint64_t j;
+	if (IS_MAPPED_LIST(sl)) {
+		while (i < sl->sl_slabs) {
+			mslab_t *ms = MAPPED_SLAB(sl, i);
+			slablist_elem_t *arr = MSLAB_ARR(ms);
+			j = 0;
+			while (j < ms->ms_elems) {
+				if (SL_CMPF(sl)(key, arr[j]) == 0) {
+					return (E_TEST_BLOOM_FALSE_NEG);
+				}
+				j++;
+			}
+			i++;
+		}
+		return (0);
+	}
+	if (IS_SMALL_LIST(sl)) {
+		small_list_t *n = LNK(sl->sl_head);
+		while (i < sl->sl_elems) {
+			if (SL_CMPF(sl)(key, n->sml_data) == 0) {
+				return (E_TEST_BLOOM_FALSE_NEG);
+			}
+			n = LNK(n->sml_next);
+			i++;
+		}
+		return (0);
+	}
+	slab_t *s = LNK(sl->sl_head);
+	while (i < sl->sl_slabs) {
+		j = 0;
+		while (j < s->s_elems) {
+			if (SL_CMPF(sl)(key, SLAB_ELEM(s, j)) == 0) {
+				return (E_TEST_BLOOM_FALSE_NEG);
+			}
+			j++;
+		}
+		s = LNK(s->s_next);
+		i++;
+	}
+	return (0);
+}
+
+/*
+ * Folds every element beneath `ss` into `acc`, one at a time.
+ */
+static slablist_elem_t
+test_fold_subslab(slablist_t *sl, subslab_t *ss, slablist_elem_t acc)
+{
+	int i = 0;
+	while (i < ss->ss_elems) {
+		if (LNK(ss->ss_list)->sl_layer > 1) {
+			acc = test_fold_subslab(sl, GET_SUBSLAB_ELEM(ss, i),
+			    acc);
+			i++;
+			continue;
+		}
+		slab_t *s = GET_SUBSLAB_ELEM(ss, i);
+		int j = 0;
+		while (j < s->s_elems) {
+			slablist_elem_t e = SLAB_ELEM(s, j);
+			acc = sl->sl_agg_fold(acc, &e, 1);
+			j++;
+		}
+		i++;
+	}
+	return (acc);
+}
+
+/*
+ * Checks that the aggregate cached in `ss` is the aggregate of the elements
+ * beneath it. This assumes that the aggregate doesn't depend on how the
+ * elements are grouped, which isn't quite true of floating point sums.
+ */
+int
+test_subslab_agg(slablist_t *sl, subslab_t *ss)
+{
+	slablist_elem_t acc = test_fold_subslab(sl, ss, sl->sl_agg_zero);
+	if (acc.sle_u != ss->ss_agg.sle_u) {
+		return (E_TEST_SUBSLAB_AGG);
+	}
+	return (0);
+}
+
+/*
+ * Checks that the aggregate kept in `s` is the aggregate of its elements.
+ */
+int
+test_slab_agg(slablist_t *sl, slab_t *s)
+{
+	slablist_elem_t acc = sl->sl_agg_zero;
+	int i = 0;
+	while (i < s->s_elems) {
+		slablist_elem_t e = SLAB_ELEM(s, i);
+		acc = sl->sl_agg_fold(acc, &e, 1);
+		i++;
+	}
+	if (acc.sle_u != s->s_agg.sle_u) {
+		return (E_TEST_SLAB_AGG);
+	}
+	return (0);
+}
+
+/*
+ * Checks that `agg` is the aggregate of the elements of `sl` that are within
+ * [min, max], by folding them one at a time.
+ */
+int
+test_aggregate(slablist_t *sl, slablist_elem_t min, slablist_elem_t max,
+    slablist_elem_t agg)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SMALL_LIST(sl)) {
+		return (0);
+	}
+	slablist_elem_t acc = sl->sl_agg_zero;
+	slab_t *s = LNK(sl->sl_head);
+	uint64_t i = 0;
+	while (i < sl->sl_slabs) {
+		int j = 0;
+		while (j < s->s_elems) {
+			slablist_elem_t e = SLAB_ELEM(s, j);
+			if (SL_CMPF(sl)(e, min) >= 0 &&
+			    SL_CMPF(sl)(e, max) <= 0) {
+				acc = sl->sl_agg_fold(acc, &e, 1);
+			}
+			j++;
+		}
+		s = LNK(s->s_next);
+		i++;
+	}
+	if (acc.sle_u != agg.sle_u) {
+		return (E_TEST_AGGREGATE);
+	}
+	return (0);
+}
+
+/*
+ * Checks that `rank` is the number of elements of `sl` that are less than
+ * `key`, or not greater than `key` if `incl` is set, by counting them.
+ */
+int
+test_rank(slablist_t *sl, slablist_elem_t key, int incl, uint64_t rank)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SMALL_LIST(sl)) {
+		return (0);
+	}
+	uint64_t r = 0;
+	slab_t *s = LNK(sl->sl_head);
+	uint64_t i = 0;
+	while (i < sl->sl_slabs) {
+		int j = 0;
+		while (j < s->s_elems) {
+			if (SL_CMPF(sl)(SLAB_ELEM(s, j), key) < incl) {
+				r++;
+			}
+			j++;
+		}
+		s = LNK(s->s_next);
+		i++;
+	}
+	if (r != rank) {
+		return (E_TEST_RANK);
+	}
+	return (0);
+}
+
+/*
+ * Checks what a bound query (see bound_impl()) returned, by scanning `sl` for
+ * the first element that doesn't come before `key`, or for the last one that
+ * does if `back` is set.
+ */
+int
+test_bound(slablist_t *sl, slablist_elem_t key, int incl, int back, int r,
+    slablist_elem_t found)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SMALL_LIST(sl)) {
+		return (0);
+	}
+	int want = -1;
+	slablist_elem_t e;
+	slab_t *s = LNK(sl->sl_head);
+	uint64_t i = 0;
+	while (i < sl->sl_slabs) {
+		int j = 0;
+		while (j < s->s_elems) {
+			slablist_elem_t x = SLAB_ELEM(s, j);
+			int before = SL_CMPF(sl)(x, key) < incl;
+			if (before && back) {
+				want = 0;
+				e = x;
+			}
+			if (!before && !back && want != 0) {
+				want = 0;
+				e = x;
+			}
+			j++;
+		}
+		s = LNK(s->s_next);
+		i++;
+	}
+	if (r != want || (want == 0 && SL_CMPF(sl)(e, found) != 0)) {
+		return (E_TEST_BOUND);
+	}
+	return (0);
+}
+
+/*
+ * Checks that a run of `len` elements that a span handed out is sorted, and
+ * within [min, max].
+ */
+int
+test_span(slablist_t *sl, slablist_elem_t *run, uint64_t len,
+    slablist_elem_t min, slablist_elem_t max)
+{
+	uint64_t i = 1;
+	while (i < len) {
+		if (SL_CMPF(sl)(run[i - 1], run[i]) >= 0) {
+			return (E_TEST_SPAN);
+		}
+		i++;
+	}
+	if (SL_CMPF(sl)(run[0], min) < 0 ||
+	    SL_CMPF(sl)(run[len - 1], max) > 0) {
+		return (E_TEST_SPAN);
+	}
+	return (0);
+}
+
+/*
+ * Checks that `r` says whether `pat` occurs in `sl`, by comparing the pattern
+ * against the elements that start at every position in turn.
+ */
+int
+test_subseq(slablist_t *sl, slablist_elem_t *pat, uint64_t len, int r)
+{
+	if (IS_MAPPED_LIST(sl) || IS_SMALL_LIST(sl)) {
+		return (0);
+	}
+	int found = 0;
+	slab_t *s = LNK(sl->sl_head);
+	int i = 0;
+	while (s != NULL && !found) {
+		slab_t *t = s;
+		int j = i;
+		uint64_t k = 0;
+		while (t != NULL && k < len &&
+		    SL_CMPF(sl)(SLAB_ELEM(t, j), pat[k]) == 0) {
+			k++;
+			j++;
+			if (j == t->s_elems) {
+				t = LNK(t->s_next);
+				j = 0;
+			}
+		}
+		found = (k == len);
+		i++;
+		if (i == s->s_elems) {
+			s = LNK(s->s_next);
+			i = 0;
+		}
+	}
+	if (found != r) {
+		return (E_TEST_SUBSEQ);
+	}
+	return (0);
+}
+
+/*
+ * Checks that the root index of `sl` found the same baselayer subslab as a
+ * linear scan of the baselayer does.
+ */
+int
+test_root_index(slablist_t *sl, slablist_elem_t elem, subslab_t *found)
+{
+	subslab_t *s = NULL;
+	(void) sub_find_linear_scan(LNK(sl->sl_baselayer), elem, &s);
+	if (s != found) {
+		return (E_TEST_ROOT_INDEX);
+	}
+	return (0);
+}
 
 int
 test_find_bubble_up(subslab_t *found, slab_t *sbptr, slablist_elem_t elem)
@@ -804,7 +1345,7 @@ test_find_bubble_up(subslab_t *found, slab_t *sbptr, slablist_elem_t elem)
 	int f;
 	if (sbptr == NULL) {
 		subslab_t *ss = found;
-		slablist_t *sl = ss->ss_list;
+		slablist_t *sl = LNK(ss->ss_list);
 		f = test_subslab(ss);
 		if (f != 0) {
 			return (f);
@@ -848,7 +1389,7 @@ test_find_bubble_up(subslab_t *found, slab_t *sbptr, slablist_elem_t elem)
 int
 test_slab_move_next(slab_t *scp, slab_t *sn, slab_t *sncp, int *i)
 {
-	uint64_t cpable = SELEM_MAX - sncp->s_elems;
+	uint64_t cpable = SLAB_ELEM_MAX(sncp) - sncp->s_elems;
 	uint64_t tocp = 0;
 	int from = 0;
 
@@ -860,7 +1401,8 @@ test_slab_move_next(slab_t *scp, slab_t *sn, slab_t *sncp, int *i)
 
 	/*
 	 * loops that check that elem scp[from] -> sncp[end] ==
-	 * the elem sn[0] to sn[NELEMS]. One loop per slab.
+	 * the elem sn[0] to sn[NELEMS]. One loop per slab. The values of a
+	 * key-value list have to have moved along with their keys.
 	 */
 	int j = 0;
 	int k = from;
@@ -869,7 +1411,8 @@ test_slab_move_next(slab_t *scp, slab_t *sn, slab_t *sncp, int *i)
 		 * We start at `scp` and check all the elements against the
 		 * _copied_ elements that are stored in `sn`.
 		 */
-		if (scp->s_arr[k].sle_u != sn->s_arr[j].sle_u) {
+		if (SLAB_GET(scp, k).sle_u != SLAB_GET(sn, j).sle_u ||
+		    slab_val(scp, k).sle_u != slab_val(sn, j).sle_u) {
 			*i = j;
 			return (E_TEST_SLAB_MOVE_NEXT_SCP);
 		}
@@ -882,7 +1425,8 @@ test_slab_move_next(slab_t *scp, slab_t *sn, slab_t *sncp, int *i)
 		 * We now continue to `sncp` and check all the elements against
 		 * the _original_ elements that are stored in `sn`.
 		 */
-		if (sncp->s_arr[k].sle_u != sn->s_arr[j].sle_u) {
+		if (SLAB_GET(sncp, k).sle_u != SLAB_GET(sn, j).sle_u ||
+		    slab_val(sncp, k).sle_u != slab_val(sn, j).sle_u) {
 			*i = j;
 			return (E_TEST_SLAB_MOVE_NEXT_SNCP);
 		}
@@ -896,7 +1440,7 @@ test_slab_move_next(slab_t *scp, slab_t *sn, slab_t *sncp, int *i)
 int
 test_slab_move_prev(slab_t *scp, slab_t *sp, slab_t *spcp, int *i)
 {
-	uint64_t cpable = SELEM_MAX - spcp->s_elems;
+	uint64_t cpable = SLAB_ELEM_MAX(spcp) - spcp->s_elems;
 	uint64_t tocp = 0;
 	int from = scp->s_elems - 1;
 
@@ -907,7 +1451,7 @@ test_slab_move_prev(slab_t *scp, slab_t *sp, slab_t *spcp, int *i)
 
 	/*
 	 * loops that check that elem spcp[from] -> scp[0] == the elem sp[0]
-	 * to s[NELEMS]. One loop per slab.
+	 * to s[NELEMS]. One loop per slab. As above, values move with keys.
 	 */
 	int j = sp->s_elems - 1;
 	int k = from;
@@ -916,7 +1460,8 @@ test_slab_move_prev(slab_t *scp, slab_t *sp, slab_t *spcp, int *i)
 	 * against all of the elements that have been _copied_ into `sp`.
 	 */
 	while (k >= 0) {
-		if (scp->s_arr[k].sle_u != sp->s_arr[j].sle_u) {
+		if (SLAB_GET(scp, k).sle_u != SLAB_GET(sp, j).sle_u ||
+		    slab_val(scp, k).sle_u != slab_val(sp, j).sle_u) {
 			*i = j;
 			return (E_TEST_SLAB_MOVE_PREV_SCP);
 		}
@@ -929,7 +1474,8 @@ test_slab_move_prev(slab_t *scp, slab_t *sp, slab_t *spcp, int *i)
 	 * elems.
 	 */
 	while (k >= 0) {
-		if (spcp->s_arr[k].sle_u != sp->s_arr[j].sle_u) {
+		if (SLAB_GET(spcp, k).sle_u != SLAB_GET(sp, j).sle_u ||
+		    slab_val(spcp, k).sle_u != slab_val(sp, j).sle_u) {
 			*i = j;
 			return (E_TEST_SLAB_MOVE_PREV_SPCP);
 		}
@@ -956,7 +1502,8 @@ test_subslab_move_next(subslab_t *scp, subslab_t *sn,
 
 	/*
 	 * loops that check that elem scp[from] -> sncp[end] ==
-	 * the elem sn[0] to sn[NELEMS]. One loop per slab.
+	 * the elem sn[0] to sn[NELEMS]. One loop per slab. The values of a
+	 * key-value list have to have moved along with their keys.
 	 */
 	int j = 0;
 	int k = from;
@@ -1005,7 +1552,7 @@ test_subslab_move_prev(subslab_t *scp, subslab_t *sp,
 
 	/*
 	 * loops that check that elem spcp[from] -> scp[0] == the elem sp[0]
-	 * to s[NELEMS]. One loop per slab.
+	 * to s[NELEMS]. One loop per slab. As above, values move with keys.
 	 */
 	int j = sp->ss_elems - 1;
 	int k = from;
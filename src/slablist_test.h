@@ -34,6 +34,21 @@ int test_remove_slab(uint64_t, subslab_t *);
 int test_rem_range_sub(subslab_t *);
 int test_rem_range_sub_slim(subslab_t *);
 int test_rem_range(slab_t *);
+int test_slab_freeze(slab_t *, slab_t *);
+int test_load(slablist_t *);
+int test_mapped(slablist_t *);
+int test_clone(slablist_t *);
+int test_bloom(slablist_t *, slablist_elem_t);
+int test_root_index(slablist_t *, slablist_elem_t, subslab_t *);
+int test_subslab_agg(slablist_t *, subslab_t *);
+int test_slab_agg(slablist_t *, slab_t *);
+int test_aggregate(slablist_t *, slablist_elem_t, slablist_elem_t,
+    slablist_elem_t);
+int test_rank(slablist_t *, slablist_elem_t, int, uint64_t);
+int test_bound(slablist_t *, slablist_elem_t, int, int, int, slablist_elem_t);
+int test_span(slablist_t *, slablist_elem_t *, uint64_t, slablist_elem_t,
+    slablist_elem_t);
+int test_subseq(slablist_t *, slablist_elem_t *, uint64_t, int);
 int test_slab_extrema(slab_t *);
 int test_ripple_add_slab(slab_t *, slab_t *, int);
 int test_ripple_add_subslab(subslab_t *, int);
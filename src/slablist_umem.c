@@ -33,15 +33,173 @@
 #define	UNUSED(x) (void)(x)
 #define	CTOR_HEAD	UNUSED(ignored); UNUSED(flags)
 
+#ifdef SL_COMPACT_LAYOUT
+#define	SLAB_ALIGN	SL_CACHE_LINE
+#else
+#define	SLAB_ALIGN	0
+#endif
+
+/*
+ * While a thread is modifying a shared slab list, the list's segment is the
+ * thread's arena, and everything that belongs to the list is allocated from,
+ * and freed to, the arena instead of the heap. See slablist_shm_t in
+ * slablist_impl.h. Bookmarks and add contexts never belong to a list, so they
+ * always come from the heap.
+ */
+#ifdef SL_COMPACT_LAYOUT
+#define	SHM_ALIGN	SL_CACHE_LINE
+#else
+#define	SHM_ALIGN	16
+#endif
+#define	SHM_ROUND(sz)	(((sz) + SHM_ALIGN - 1) & ~((size_t)SHM_ALIGN - 1))
+
+static __thread slablist_shm_t *shm_arena;
+
+/*
+ * Makes `shm` the arena of the calling thread (or makes it use the heap, if
+ * `shm` is NULL), and returns the previous arena.
+ */
+slablist_shm_t *
+shm_set_arena(slablist_shm_t *shm)
+{
+	slablist_shm_t *old = shm_arena;
+	shm_arena = shm;
+	return (old);
+}
+
+static shm_free_t *
+shm_free_list(slablist_shm_t *shm, size_t sz)
+{
+	uint64_t off = shm->shm_free;
+	while (off != 0) {
+		shm_free_t *f = SHM_AT(shm, off);
+		if (f->sf_size == sz) {
+			return (f);
+		}
+		off = f->sf_next;
+	}
+	return (NULL);
+}
+
+static void *
+shm_alloc(slablist_shm_t *shm, size_t sz)
+{
+	sz = SHM_ROUND(sz);
+	shm_free_t *f = shm_free_list(shm, sz);
+	void *p;
+	if (f != NULL && f->sf_head != 0) {
+		p = SHM_AT(shm, f->sf_head);
+		f->sf_head = *(uint64_t *)p;
+	} else {
+		if (shm->shm_size - shm->shm_brk < sz) {
+			return (NULL);
+		}
+		p = SHM_AT(shm, shm->shm_brk);
+		shm->shm_brk += sz;
+	}
+	bzero(p, sz);
+	return (p);
+}
+
+/*
+ * The free chunks of a size are linked together by the offsets of the chunks
+ * that follow them, which are stored in the chunks themselves.
+ */
+static void
+shm_free(slablist_shm_t *shm, void *p, size_t sz)
+{
+	sz = SHM_ROUND(sz);
+	shm_free_t *f = shm_free_list(shm, sz);
+	if (f == NULL) {
+		f = shm_alloc(shm, sizeof (shm_free_t));
+		if (f == NULL) {
+			/* We leak the chunk, rather than lose the segment. */
+			return;
+		}
+		f->sf_size = sz;
+		f->sf_next = shm->shm_free;
+		shm->shm_free = SHM_OFF(shm, f);
+	}
+	*(uint64_t *)p = f->sf_head;
+	f->sf_head = SHM_OFF(shm, p);
+}
+
+static int
+shm_owns(void *p)
+{
+	return (shm_arena != NULL && (char *)p >= (char *)shm_arena &&
+	    (char *)p < (char *)shm_arena + shm_arena->shm_size);
+}
+
+/*
+ * Returns how many of `n` chunks of `sz` bytes can't be taken off a free list.
+ */
+static size_t
+shm_lacking(slablist_shm_t *shm, size_t sz, size_t n)
+{
+	shm_free_t *f = shm_free_list(shm, SHM_ROUND(sz));
+	uint64_t off = f != NULL ? f->sf_head : 0;
+	while (off != 0 && n > 0) {
+		off = *(uint64_t *)SHM_AT(shm, off);
+		n--;
+	}
+	return (n * SHM_ROUND(sz));
+}
+
+/*
+ * An insertion can split a slab, and a subslab in every sublayer, and attach
+ * a new sublayer. Since the code that does all that cannot fail half-way,
+ * slablist_add() refuses to start one unless the segment has room for the
+ * worst case.
+ */
+int
+shm_full(slablist_t *sl)
+{
+	slablist_shm_t *shm = LNK(sl->sl_shm);
+	size_t nsub = sl->sl_sublayers + 2;
+#ifdef SL_COMPACT_LAYOUT
+	size_t need = shm_lacking(shm, sizeof (subslab_co_t), nsub);
+#else
+	size_t need = shm_lacking(shm, sizeof (subslab_t), nsub) +
+	    shm_lacking(shm, sizeof (subarr_t), nsub);
+#endif
+	need += shm_lacking(shm, SLIST_SLAB_BYTES(sl), 1) +
+	    shm_lacking(shm, sizeof (slablist_t), 1) +
+	    2 * SHM_ROUND(sizeof (shm_free_t));
+	return (shm->shm_size - shm->shm_brk < need);
+}
+
+#if defined(SL_COMPACT_LAYOUT) && !defined(UMEM)
+/*
+ * The compact layout relies on slabs and subslabs starting on a cache line.
+ */
+static void *
+mk_aligned(size_t sz)
+{
+	void *p;
+	if (posix_memalign(&p, SL_CACHE_LINE, sz) != 0) {
+		return (NULL);
+	}
+	bzero(p, sz);
+	return (p);
+}
+#endif
+
 
 #ifdef UMEM
 umem_cache_t *cache_slablist;
 umem_cache_t *cache_bm;
 umem_cache_t *cache_lk_slablist;
 umem_cache_t *cache_mt_slablist;
-umem_cache_t *cache_slab;
+umem_cache_t *cache_slab_512;
+umem_cache_t *cache_slab_1k;
+umem_cache_t *cache_slab_4k;
+umem_cache_t *cache_slab_16k;
 umem_cache_t *cache_subslab;
 umem_cache_t *cache_subarr;
+#ifdef SL_COMPACT_LAYOUT
+umem_cache_t *cache_subslab_co;
+#endif
 umem_cache_t *cache_small_list;
 umem_cache_t *cache_add_ctx;
 
@@ -81,12 +239,15 @@ mt_slablist_ctor(void *buf, void *ignored, int flags)
 	return (0);
 }
 
+/*
+ * The `ignored` argument of the slab constructor is the size of the slab.
+ */
 int
 slab_ctor(void *buf, void *ignored, int flags)
 {
-	CTOR_HEAD;
+	UNUSED(flags);
 	slab_t *s = buf;
-	bzero(s, (sizeof (slab_t)));
+	bzero(s, (size_t)ignored);
 	return (0);
 }
 
@@ -108,6 +269,16 @@ subarr_ctor(void *buf, void *ignored, int flags)
 	return (0);
 }
 
+#ifdef SL_COMPACT_LAYOUT
+int
+subslab_co_ctor(void *buf, void *ignored, int flags)
+{
+	CTOR_HEAD;
+	subslab_co_t *sc = buf;
+	bzero(sc, (sizeof (subslab_co_t)));
+	return (0);
+}
+#endif
 
 int
 small_list_ctor(void *buf, void *ignored, int flags)
@@ -172,14 +343,44 @@ slablist_umem_init()
 		NULL,
 		0);
 
-	cache_slab = umem_cache_create("slab",
-		sizeof (slab_t),
-		0,
+	cache_slab_512 = umem_cache_create("slab_512",
+		512,
+		SLAB_ALIGN,
+		slab_ctor,
+		NULL,
+		NULL,
+		(void *)512,
+		NULL,
+		0);
+
+	cache_slab_1k = umem_cache_create("slab_1k",
+		1024,
+		SLAB_ALIGN,
+		slab_ctor,
+		NULL,
+		NULL,
+		(void *)1024,
+		NULL,
+		0);
+
+	cache_slab_4k = umem_cache_create("slab_4k",
+		4096,
+		SLAB_ALIGN,
 		slab_ctor,
 		NULL,
 		NULL,
+		(void *)4096,
+		NULL,
+		0);
+
+	cache_slab_16k = umem_cache_create("slab_16k",
+		16384,
+		SLAB_ALIGN,
+		slab_ctor,
 		NULL,
 		NULL,
+		(void *)16384,
+		NULL,
 		0);
 
 	cache_subslab = umem_cache_create("subslab",
@@ -202,6 +403,18 @@ slablist_umem_init()
 		NULL,
 		0);
 
+#ifdef SL_COMPACT_LAYOUT
+	cache_subslab_co = umem_cache_create("subslab_co",
+		sizeof (subslab_co_t),
+		SLAB_ALIGN,
+		subslab_co_ctor,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		0);
+#endif
+
 	cache_small_list = umem_cache_create("small_list",
 		sizeof (small_list_t),
 		0,
@@ -229,6 +442,9 @@ slablist_umem_init()
 slablist_t *
 mk_slablist()
 {
+	if (shm_arena != NULL) {
+		return (shm_alloc(shm_arena, sizeof (slablist_t)));
+	}
 #ifdef UMEM
 	return (umem_cache_alloc(cache_slablist, UMEM_NOFAIL));
 #else
@@ -240,6 +456,10 @@ mk_slablist()
 void
 rm_slablist(slablist_t *sl)
 {
+	if (shm_owns(sl)) {
+		shm_free(shm_arena, sl, sizeof (slablist_t));
+		return;
+	}
 #ifdef UMEM
 	bzero(sl, sizeof (slablist_t));
 	umem_cache_free(cache_slablist, sl);
@@ -317,23 +537,55 @@ rm_mt_slablist(mt_slablist_t *sl)
 #endif
 }
 
+#ifdef UMEM
+/*
+ * Every slab capacity corresponds to exactly one of the slab sizes.
+ */
+static umem_cache_t *
+slab_cache(size_t sz)
+{
+	if (sz <= 512) {
+		return (cache_slab_512);
+	}
+	if (sz <= 1024) {
+		return (cache_slab_1k);
+	}
+	if (sz <= 4096) {
+		return (cache_slab_4k);
+	}
+	return (cache_slab_16k);
+}
+#endif
+
+/*
+ * Allocates a slab that is `sz` bytes long (see SLIST_SLAB_BYTES()).
+ */
 slab_t *
-mk_slab()
+mk_slab(size_t sz)
 {
+	if (shm_arena != NULL) {
+		return (shm_alloc(shm_arena, sz));
+	}
 #ifdef UMEM
-	slab_t *s = umem_cache_alloc(cache_slab, UMEM_NOFAIL);
+	slab_t *s = umem_cache_alloc(slab_cache(sz), UMEM_NOFAIL);
+#elif defined(SL_COMPACT_LAYOUT)
+	slab_t *s = mk_aligned(sz);
 #else
-	slab_t *s = calloc(1, sizeof (slab_t));
+	slab_t *s = calloc(1, sz);
 #endif
 	return (s);
 }
 
 void
-rm_slab(slab_t *s)
+rm_slab(slab_t *s, size_t sz)
 {
-	bzero(s, sizeof (slab_t));
+	if (shm_owns(s)) {
+		shm_free(shm_arena, s, sz);
+		return;
+	}
+	bzero(s, sz);
 #ifdef UMEM
-	umem_cache_free(cache_slab, s);
+	umem_cache_free(slab_cache(sz), s);
 #else
 	free(s);
 #endif
@@ -343,6 +595,9 @@ rm_slab(slab_t *s)
 subslab_t *
 mk_subslab()
 {
+	if (shm_arena != NULL) {
+		return (shm_alloc(shm_arena, sizeof (subslab_t)));
+	}
 #ifdef UMEM
 	subslab_t *ss = umem_cache_alloc(cache_subslab, UMEM_NOFAIL);
 #else
@@ -354,6 +609,10 @@ mk_subslab()
 void
 rm_subslab(subslab_t *s)
 {
+	if (shm_owns(s)) {
+		shm_free(shm_arena, s, sizeof (subslab_t));
+		return;
+	}
 	bzero(s, sizeof (subslab_t));
 #ifdef UMEM
 	umem_cache_free(cache_subslab, s);
@@ -387,6 +646,9 @@ rm_add_ctx(add_ctx_t *ctx)
 subarr_t *
 mk_subarr()
 {
+	if (shm_arena != NULL) {
+		return (shm_alloc(shm_arena, sizeof (subarr_t)));
+	}
 #ifdef UMEM
 	subarr_t *sa = umem_cache_alloc(cache_subarr, UMEM_NOFAIL);
 #else
@@ -398,6 +660,10 @@ mk_subarr()
 void
 rm_subarr(subarr_t *s)
 {
+	if (shm_owns(s)) {
+		shm_free(shm_arena, s, sizeof (subarr_t));
+		return;
+	}
 	bzero(s, sizeof (subarr_t));
 #ifdef UMEM
 	umem_cache_free(cache_subarr, s);
@@ -406,9 +672,60 @@ rm_subarr(subarr_t *s)
 #endif
 }
 
+/*
+ * Allocates a subslab that already has an (empty) subarr_t attached to it. In
+ * the compact layout both live in the same allocation.
+ */
+subslab_t *
+mk_subslab_arr()
+{
+#ifdef SL_COMPACT_LAYOUT
+	subslab_co_t *sc;
+	if (shm_arena != NULL) {
+		sc = shm_alloc(shm_arena, sizeof (subslab_co_t));
+	} else {
+#ifdef UMEM
+		sc = umem_cache_alloc(cache_subslab_co, UMEM_NOFAIL);
+#else
+		sc = mk_aligned(sizeof (subslab_co_t));
+#endif
+	}
+	sc->sc_ss.ss_arr = MKLNK(&sc->sc_arr);
+	return (&sc->sc_ss);
+#else
+	subslab_t *ss = mk_subslab();
+	ss->ss_arr = MKLNK(mk_subarr());
+	return (ss);
+#endif
+}
+
+void
+rm_subslab_arr(subslab_t *s)
+{
+#ifdef SL_COMPACT_LAYOUT
+	subslab_co_t *sc = (subslab_co_t *)s;
+	if (shm_owns(sc)) {
+		shm_free(shm_arena, sc, sizeof (subslab_co_t));
+		return;
+	}
+	bzero(sc, sizeof (subslab_co_t));
+#ifdef UMEM
+	umem_cache_free(cache_subslab_co, sc);
+#else
+	free(sc);
+#endif
+#else
+	rm_subarr(LNK(s->ss_arr));
+	rm_subslab(s);
+#endif
+}
+
 small_list_t *
 mk_sml_node()
 {
+	if (shm_arena != NULL) {
+		return (shm_alloc(shm_arena, sizeof (small_list_t)));
+	}
 #ifdef UMEM
 	small_list_t *s = umem_cache_alloc(cache_small_list, UMEM_NOFAIL);
 #else
@@ -420,6 +737,10 @@ mk_sml_node()
 void
 rm_sml_node(small_list_t *s)
 {
+	if (shm_owns(s)) {
+		shm_free(shm_arena, s, sizeof (small_list_t));
+		return;
+	}
 	bzero(s, sizeof (small_list_t));
 #ifdef UMEM
 	umem_cache_free(cache_small_list, s);
@@ -431,6 +752,9 @@ rm_sml_node(small_list_t *s)
 void *
 mk_buf(size_t sz)
 {
+	if (shm_arena != NULL) {
+		return (shm_alloc(shm_arena, sz));
+	}
 #ifdef UMEM
 	return (umem_alloc(sz, UMEM_NOFAIL));
 #else
@@ -441,6 +765,9 @@ mk_buf(size_t sz)
 void *
 mk_zbuf(size_t sz)
 {
+	if (shm_arena != NULL) {
+		return (shm_alloc(shm_arena, sz));
+	}
 #ifdef UMEM
 	return (umem_zalloc(sz, UMEM_NOFAIL));
 #else
@@ -451,6 +778,10 @@ mk_zbuf(size_t sz)
 void
 rm_buf(void *s, size_t sz)
 {
+	if (shm_owns(s)) {
+		shm_free(shm_arena, s, sz);
+		return;
+	}
 #ifdef UMEM
 	umem_free(s, sz);
 #else